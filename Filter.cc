@@ -1,5 +1,7 @@
 #include "Filter.h"
 
+TOPOPT_NAMESPACE_BEGIN // # new
+
 /* -----------------------------------------------------------------------------
  Authors: Niels Aage, Erik Andreassen, Boyan Lazarov, August 2013
  Copyright (C) 2013-2014,
@@ -33,8 +35,10 @@ Filter::Filter (DM da_nodes, Vec x, PetscInt filterT, PetscScalar Rin,
   H = NULL;
   Hs = NULL;
   dx = NULL; // # new added
+  xtmp = NULL; // # new
   da_elem = NULL;
   pdef = NULL;
+  am = NULL; // # new
 
   // Get parameters
   R = Rin;
@@ -61,6 +65,12 @@ Filter::~Filter () {
   if (dx != NULL) {
     VecDestroy (&dx);
   }
+  if (xtmp != NULL) { // # new
+    VecDestroy (&xtmp);
+  }
+  if (am != NULL) { // # new
+    delete am;
+  }
 }
 
 // Filter design variables
@@ -118,6 +128,12 @@ PetscErrorCode Filter::FilterProject (Vec x, Vec xTilde, Vec xPhys,
     VecCopy (xTilde, xPhys);
   }
 
+  // # new; printed densities
+  if (am != NULL) {
+    ierr = am->FilterProject (xPhys, xPhys);
+    CHKERRQ(ierr);
+  }
+
   return ierr;
 }
 
@@ -126,6 +142,12 @@ PetscErrorCode Filter::Gradients (Vec x, Vec xTilde, Vec dfdx, PetscInt m,
     Vec *dgdx, PetscBool projectionFilter, PetscScalar beta, PetscScalar eta) {
 
   PetscErrorCode ierr = 0;
+  // # new; chainrule of the printed densities first
+  if (am != NULL) {
+    ierr = am->Gradients (dfdx, m, dgdx);
+    CHKERRQ(ierr);
+  }
+
   // Cheinrule for projection filtering
   if (projectionFilter) {
 
@@ -172,19 +194,13 @@ PetscErrorCode Filter::Gradients (Vec x, Vec xTilde, Vec dfdx, PetscInt m,
   if (filterType == 0)
       // Filter the sensitivities, df,dg
       {
-    Vec xtmp;
-    ierr = VecDuplicate (xTilde, &xtmp);
-    CHKERRQ(ierr);
+    // # modified; xtmp is a work vector of the filter
     VecPointwiseMult (xtmp, dfdx, x);
     MatMult (H, xtmp, dfdx);
     VecPointwiseDivide (xtmp, dfdx, Hs);
     VecPointwiseDivide (dfdx, xtmp, x);
-    VecDestroy (&xtmp);
   } else if (filterType == 1) {
     // Filter the densities, df,dg: STANDARD FILTER
-    Vec xtmp;
-    ierr = VecDuplicate (x, &xtmp);
-    CHKERRQ(ierr);
     // dfdx
     VecPointwiseDivide (xtmp, dfdx, Hs);
     MatMult (H, xtmp, dfdx);
@@ -193,8 +209,6 @@ PetscErrorCode Filter::Gradients (Vec x, Vec xTilde, Vec dfdx, PetscInt m,
       VecPointwiseDivide (xtmp, dgdx[i], Hs);
       MatMult (H, xtmp, dgdx[i]);
     }
-    // tidy up
-    VecDestroy (&xtmp);
   } else if (filterType == 2) {
     // Filter the densities, df,dg: PDE FILTER
     ierr = pdef->Gradients (dfdx, dfdx);
@@ -208,6 +222,85 @@ PetscErrorCode Filter::Gradients (Vec x, Vec xTilde, Vec dfdx, PetscInt m,
   return ierr;
 }
 
+// # new
+PetscErrorCode Filter::FilterProjectRobust (Vec x, Vec xTilde, PetscInt nReal,
+    Vec *xReal, const PetscReal *etaReal, PetscScalar beta) {
+  PetscErrorCode ierr;
+
+  // Filter once, no projection
+  ierr = FilterProject (x, xTilde, xTilde, PETSC_FALSE, beta, etaReal[0]);
+  CHKERRQ(ierr);
+
+  // Project every filtered density into all the realizations
+  PetscScalar *xt;
+  std::vector<PetscScalar*> &xr = workArrays;
+  xr.resize (nReal);
+  PetscInt nelloc;
+  VecGetLocalSize (xTilde, &nelloc);
+  ierr = VecGetArray (xTilde, &xt);
+  CHKERRQ(ierr);
+  for (PetscInt k = 0; k < nReal; k++) {
+    ierr = VecGetArray (xReal[k], &xr[k]);
+    CHKERRQ(ierr);
+  }
+  for (PetscInt i = 0; i < nelloc; i++) {
+    for (PetscInt k = 0; k < nReal; k++) {
+      xr[k][i] = SmoothProjection (xt[i], beta, etaReal[k]);
+    }
+  }
+  for (PetscInt k = 0; k < nReal; k++) {
+    ierr = VecRestoreArray (xReal[k], &xr[k]);
+    CHKERRQ(ierr);
+  }
+  ierr = VecRestoreArray (xTilde, &xt);
+  CHKERRQ(ierr);
+
+  return ierr;
+}
+
+// # new
+PetscErrorCode Filter::GradientsRobust (Vec x, Vec xTilde, PetscInt nv,
+    Vec *dv, const PetscInt *real, PetscInt nReal, const PetscReal *etaReal,
+    PetscScalar beta) {
+  PetscErrorCode ierr;
+
+  // Projection chainrule of all the vectors in one pass
+  PetscScalar *xt;
+  std::vector<PetscScalar*> &dp = workArrays;
+  std::vector<PetscScalar> &dxr = workChainrule;
+  dp.resize (nv);
+  dxr.resize (nReal);
+  PetscInt nelloc;
+  VecGetLocalSize (xTilde, &nelloc);
+  ierr = VecGetArray (xTilde, &xt);
+  CHKERRQ(ierr);
+  for (PetscInt v = 0; v < nv; v++) {
+    ierr = VecGetArray (dv[v], &dp[v]);
+    CHKERRQ(ierr);
+  }
+  for (PetscInt i = 0; i < nelloc; i++) {
+    for (PetscInt k = 0; k < nReal; k++) {
+      dxr[k] = ChainruleSmoothProjection (xt[i], beta, etaReal[k]);
+    }
+    for (PetscInt v = 0; v < nv; v++) {
+      dp[v][i] *= dxr[real[v]];
+    }
+  }
+  for (PetscInt v = 0; v < nv; v++) {
+    ierr = VecRestoreArray (dv[v], &dp[v]);
+    CHKERRQ(ierr);
+  }
+  ierr = VecRestoreArray (xTilde, &xt);
+  CHKERRQ(ierr);
+
+  // Filter chainrule, shared by the realizations
+  ierr = Gradients (x, xTilde, dv[0], nv - 1, dv + 1, PETSC_FALSE, beta,
+      etaReal[0]);
+  CHKERRQ(ierr);
+
+  return ierr;
+}
+
 PetscScalar Filter::GetMND (Vec x) {
 
   PetscScalar mnd, mndloc = 0.0;
@@ -229,6 +322,25 @@ PetscScalar Filter::GetMND (Vec x) {
   return mnd;
 }
 
+// # new
+PetscErrorCode Filter::AccountMemory (MemoryReport *mem) {
+  PetscErrorCode ierr = 0;
+  if (filterType == 0 || filterType == 1) {
+    mem->Add ("Filter H",
+        MemoryReport::MatBytes (H) + MemoryReport::VecBytes (Hs));
+  }
+  if (pdef != NULL) {
+    ierr = pdef->AccountMemory (mem);
+    CHKERRQ(ierr);
+  }
+  mem->Add ("Filter work vectors", MemoryReport::VecBytes (dx));
+  if (am != NULL) {
+    ierr = am->AccountMemory (mem);
+    CHKERRQ(ierr);
+  }
+  return ierr;
+}
+
 PetscErrorCode Filter::HeavisideFilter (Vec y, Vec x, PetscReal beta,
     PetscReal eta) {
   PetscErrorCode ierr;
@@ -304,6 +416,7 @@ PetscErrorCode Filter::SetUp (DM da_nodes, Vec x, Vec xPassive0, Vec xPassive1,
 
   VecDuplicate (x, &dx);
   VecSet (dx, 1.0);
+  VecDuplicate (x, &xtmp); // # new
 
   if (filterType == 0 || filterType == 1) {
 #if DIM == 2   // # new
@@ -384,6 +497,7 @@ PetscErrorCode Filter::SetUp (DM da_nodes, Vec x, Vec xPassive0, Vec xPassive1,
     PetscScalar ymax = (N - 1) * dy;
     DMDASetUniformCoordinates (da_elem, dx / 2.0, xmax - dx / 2.0, dy / 2.0,
         ymax - dy / 2.0, 0.0, 0.0);
+    PetscScalar xd[4] = { 0.0, xmax, 0.0, ymax }; // # new; mirror planes
 
     // Allocate and assemble
     DMCreateMatrix (da_elem, &H);
@@ -425,18 +539,11 @@ PetscErrorCode Filter::SetUp (DM da_nodes, Vec x, Vec xPassive0, Vec xPassive1,
           for (PetscInt i2 = PetscMax(i - info.sw, 0);
               i2 <= PetscMin(i + info.sw, info.mx - 1); i2++) {
             PetscInt col = (i2 - info.gxs) + (j2 - info.gys) * (info.gxm);
-            PetscScalar dist = 0.0;
-            // Compute the distance from the "col"-element to the
-            // "row"-element
-            for (PetscInt kk = 0; kk < 2; kk++) {
-              dist = dist
-                  + PetscPowScalar(lcoorp[2 * row + kk] - lcoorp[2 * col + kk],
-                      2.0);
-            }
-            dist = PetscSqrtScalar(dist);
-            if (dist < R) {
-              // Longer distances should have less weight
-              dist = R - dist;
+            // # modified; Longer distances should have less weight, the
+            // images of the "col"-element across the mirror planes count
+            PetscScalar dist = symmetry.FilterWeight (&lcoorp[2 * row],
+                &lcoorp[2 * col], xd, R);
+            if (dist > 0.0) {
               MatSetValuesLocal (H, 1, &row, 1, &col, &dist, INSERT_VALUES);
             }
           }
@@ -569,6 +676,7 @@ PetscErrorCode Filter::SetUp (DM da_nodes, Vec x, Vec xPassive0, Vec xPassive1,
     PetscScalar ymax = (N - 1) * dy;
     PetscScalar zmax = (P - 1) * dz;
     DMDASetUniformCoordinates (da_elem, dx / 2.0, xmax - dx / 2.0, dy / 2.0, ymax - dy / 2.0, dz / 2.0, zmax - dz / 2.0);
+    PetscScalar xd[6] = { 0.0, xmax, 0.0, ymax, 0.0, zmax }; // # new; mirror planes
 
     // Allocate and assemble
     DMCreateMatrix (da_elem, &H);
@@ -612,16 +720,10 @@ PetscErrorCode Filter::SetUp (DM da_nodes, Vec x, Vec xPassive0, Vec xPassive1,
               for (PetscInt i2 = PetscMax(i - info.sw, 0);
                   i2 <= PetscMin(i + info.sw, info.mx - 1); i2++) {
                 PetscInt col = (i2 - info.gxs) + (j2 - info.gys) * (info.gxm) + (k2 - info.gzs) * (info.gxm) * (info.gym);
-                PetscScalar dist = 0.0;
-                // Compute the distance from the "col"-element to the
-                // "row"-element
-                for (PetscInt kk = 0; kk < 3; kk++) {
-                  dist = dist + PetscPowScalar(lcoorp[3 * row + kk] - lcoorp[3 * col + kk], 2.0);
-                }
-                dist = PetscSqrtScalar(dist);
-                if (dist < R) {
-                  // Longer distances should have less weight
-                  dist = R - dist;
+                // # modified; Longer distances should have less weight, the
+                // images of the "col"-element across the mirror planes count
+                PetscScalar dist = symmetry.FilterWeight (&lcoorp[3 * row], &lcoorp[3 * col], xd, R);
+                if (dist > 0.0) {
                   MatSetValuesLocal (H, 1, &row, 1, &col, &dist, INSERT_VALUES);
                 }
               }
@@ -716,6 +818,13 @@ PetscErrorCode Filter::SetUp (DM da_nodes, Vec x, Vec xPassive0, Vec xPassive1,
     pdef = new PDEFilt (da_nodes, R);
   }
 
+  // # new; AM filter of the printed densities
+  am = new AMFilter (da_nodes, xPassive0);
+  if (!am->Active ()) {
+    delete am;
+    am = NULL;
+  }
+
   return ierr;
 }
 
@@ -823,3 +932,5 @@ PetscErrorCode Filter::DMDAGetElements_3D (DM dm, PetscInt *nel, PetscInt *nen,
   return (0);
 }
 #endif
+
+TOPOPT_NAMESPACE_END // # new
@@ -6,9 +6,15 @@
 #include "PDEFilter.h"
 #include <iostream>
 #include <math.h>
+#include <vector> // # new
 #include <petsc/private/dmdaimpl.h>
 
 #include "options.h" // # new ; framework options
+#include "memoryreport.h" // # new
+#include "AMFilter.h" // # new
+#include "SymmetryPlanes.h" // # new
+
+TOPOPT_NAMESPACE_BEGIN // # new
 
 /* -----------------------------------------------------------------------------
  Authors: Niels Aage, Erik Andreassen, Boyan Lazarov, August 2013
@@ -56,6 +62,17 @@ class Filter {
         Vec *dgdx, PetscBool projectionFilter, PetscScalar beta,
         PetscScalar eta);
 
+    // # new; Robust formulation: the filtered field and its projections with
+    // the thresholds etaReal of the nReal realizations, in one pass
+    PetscErrorCode FilterProjectRobust (Vec x, Vec xTilde, PetscInt nReal,
+        Vec *xReal, const PetscReal *etaReal, PetscScalar beta);
+
+    // # new; Chainrule of FilterProjectRobust, in place: dv[v] is w.r.t. the
+    // realization real[v] in, w.r.t. x out
+    PetscErrorCode GradientsRobust (Vec x, Vec xTilde, PetscInt nv, Vec *dv,
+        const PetscInt *real, PetscInt nReal, const PetscReal *etaReal,
+        PetscScalar beta);
+
     // COntinuation for projection filter
     PetscBool IncreaseBeta (PetscReal *beta, PetscReal betaFinal,
         PetscScalar gx, PetscInt itr, PetscReal ch);
@@ -63,11 +80,21 @@ class Filter {
     // Measure of non-discreteness
     PetscScalar GetMND (Vec x);
 
+    // # new; Add the bytes of the filter to the memory report
+    PetscErrorCode AccountMemory (MemoryReport *mem);
+
   private:
+    friend class MicroBenchmark; // # new; bench/microbench.cc
+
     // Standard density/sensitivity filter matrix
     Mat H; // Filter matrix
     Vec Hs; // Filter "sum weight" (normalization factor) vector
     Vec dx; // Projection filter chainrule correction
+    Vec xtmp; // # new; work vector of the sensitivity chainrule
+
+    // # new; Scratch of the robust projection, kept between the iterations
+    std::vector<PetscScalar*> workArrays;
+    std::vector<PetscScalar> workChainrule;
 
     PetscInt filterType;
     PetscScalar R;
@@ -78,6 +105,13 @@ class Filter {
     // PDE filtering
     PDEFilt *pdef; // PDE filter class
 
+    // # new; AM overhang filter after the projection, NULL without
+    AMFilter *am;
+
+    // # new; Mirror planes of a reduced model, the density filter is not
+    // truncated at them
+    SymmetryPlanes symmetry;
+
     // Setup datastructures for the filter
     PetscErrorCode SetUp (DM da_nodes, Vec x, Vec xPassive0, Vec xPassive1,
         Vec xPassive2, Vec xPassive3); // # new
@@ -114,4 +148,6 @@ class Filter {
 #endif
 };
 
+TOPOPT_NAMESPACE_END // # new
+
 #endif
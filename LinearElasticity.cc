@@ -1,4 +1,10 @@
 #include "LinearElasticity.h"
+#include "scopedtimer.h" // # new; timed regions
+#include "imbalance.h" // # new; load-imbalance diagnostics
+#include "petscutils.h" // # new; GetArrays, CreateElementDA
+#include "elementcoloring.h" // # new; threaded element loops
+
+TOPOPT_NAMESPACE_BEGIN // # new
 
 /*
  Authors: Niels Aage, Erik Andreassen, Boyan Lazarov, August 2013
@@ -23,8 +29,28 @@ LinearElasticity::LinearElasticity (DM da_nodes, PetscInt m, PetscInt numDES,
   RHS = NULL;
   N = NULL;
   ksp = NULL;
+  reusePC = PETSC_FALSE; // # new
+  UFEA = NULL; // # new
+  numFEA = 0; // # new
   da_nodal = NULL;
 
+  // # new; All the solves run on the communicator of the mesh
+  PetscObjectGetComm ((PetscObject) da_nodes, &comm);
+  caseBegin = 0;
+  caseEnd = numLODFIX;
+  group = NULL;
+  groupComm = MPI_COMM_NULL;
+  groupXPhys = NULL;
+  groupDfdx = NULL;
+  groupDgdx = NULL;
+  elemDup = NULL;
+  nodeDup = NULL;
+  elemScatter = NULL;
+  nodeScatter = NULL;
+  for (PetscInt i = 0; i < 4; ++i) {
+    groupPassive[i] = NULL;
+  }
+
   // Parameters - to be changed on read of variables
   this->nu = nu; // # modified
   this->E = E; // # new
@@ -34,8 +60,11 @@ LinearElasticity::LinearElasticity (DM da_nodes, PetscInt m, PetscInt numDES,
   PetscOptionsGetReal (NULL, NULL, "-nu", &nu, &flg);
 
   this->m = m; // # new
+  dgp = new PetscScalar*[m]; // # new
   this->numDES = numDES; // # new; num of design domains, save for internal uses
   this->numLODFIX = numLODFIX; // # new; num of loads, save for internal uses
+  kspIterations.resize (numLODFIX, 0); // # new
+  kspResiduals.resize (numLODFIX, 0.0); // # new
   this->loadVector = new PetscScalar[numLODFIX * DIM]; // # new; total body load (e.g. gravity accleration)
   this->numNodeLoadAddingCounts = numNodeLoadAddingCounts; // # new; num of node load adding counts
 
@@ -47,8 +76,17 @@ LinearElasticity::LinearElasticity (DM da_nodes, PetscInt m, PetscInt numDES,
     }
   }
 
-  RHS = new Vec[numLODFIX]; // # new
-  N = new Vec[numLODFIX]; // # new
+  dirichlet = new DirichletRows[numLODFIX]; // # new
+
+  // # new; Split the load cases over groups of ranks, -loadCaseGroups: the
+  // groups own the load cases, this object only keeps the mesh and the state
+  // field, without a stiffness matrix or solver of its own
+  if (NumLoadCaseGroups () > 1) {
+    SetUpMesh (da_nodes);
+    SetUpLoadCaseGroups (da_nodes, loadVector, xPassive0, xPassive1,
+        xPassive2, xPassive3);
+    return;
+  }
 
   // Setup sitffness matrix, load vector and bcs (Dirichlet) for the design
   // problem
@@ -64,7 +102,11 @@ LinearElasticity::~LinearElasticity ()
   // Deallocate
   VecDestroy (&(U)); // # modified
   VecDestroyVecs (numLODFIX, &(RHS)); // # modified
+  if (UFEA != NULL) { // # new
+    VecDestroyVecs (numFEA, &UFEA);
+  }
   VecDestroyVecs (numLODFIX, &(N)); // # modified
+  delete[] dirichlet; // # new
   MatDestroy (&(K));
   KSPDestroy (&(ksp));
 
@@ -72,94 +114,224 @@ LinearElasticity::~LinearElasticity ()
     DMDestroy (&(da_nodal));
   }
   if (loadVector != NULL) delete loadVector; // # new
+  delete[] dgp; // # new
+
+  // # new; Load case groups
+  if (group != NULL) {
+    delete group;
+    for (PetscInt i = 0; i < 4; ++i) {
+      VecDestroy (&(groupPassive[i]));
+    }
+    VecDestroy (&groupXPhys);
+    VecDestroy (&groupDfdx);
+    VecDestroyVecs (m, &groupDgdx);
+    VecDestroy (&elemDup);
+    VecDestroy (&nodeDup);
+    VecScatterDestroy (&elemScatter);
+    VecScatterDestroy (&nodeScatter);
+    MPI_Comm_free (&groupComm);
+  }
 }
 
+// # new; The nodal mesh of the physics with the partition of da_nodes, the
+// domain, the element stiffness matrix and the state field
 PetscErrorCode
-LinearElasticity::SetUpLoadAndBC (DM da_nodes, Vec xPassive0, Vec xPassive1,
-    Vec xPassive2, Vec xPassive3, PetscInt loadCondition) {
+LinearElasticity::SetUpMesh (DM da_nodes) {
   PetscErrorCode ierr = 0;
 
-#if DIM == 2  // # new
-  if (da_nodal == NULL) { // # new; Only set up da_nodal once
-    // Extract information from input DM and create one for the linear elasticity
-    // number of nodal dofs: (u,v)
-    PetscInt numnodaldof = 2;
+#if DIM == 2
+  // Extract information from input DM and create one for the linear elasticity
+  // number of nodal dofs: (u,v)
+  PetscInt numnodaldof = 2;
+
+  // Stencil width: each node connects to a box around it - linear elements
+  PetscInt stencilwidth = 1;
+
+  PetscScalar dx, dy;
+  DMBoundaryType bx, by;
+  DMDAStencilType stype;
+  {
+    // Extract information from the nodal mesh
+    PetscInt M, N, md, nd;
+    DMDAGetInfo (da_nodes, NULL, &M, &N, NULL, &md, &nd, NULL, NULL, NULL,
+        &bx,
+        &by, NULL, &stype);
+
+    // Find the element size
+    Vec lcoor;
+    DMGetCoordinatesLocal (da_nodes, &lcoor);
+    PetscScalar *lcoorp;
+    VecGetArray (lcoor, &lcoorp);
 
-    // Stencil width: each node connects to a box around it - linear elements
-    PetscInt stencilwidth = 1;
+    PetscInt nel, nen;
+    const PetscInt *necon;
+    DMDAGetElements_2D (da_nodes, &nel, &nen, &necon);
 
-    PetscScalar dx, dy;
-    DMBoundaryType bx, by;
-    DMDAStencilType stype;
-    {
-      // Extract information from the nodal mesh
-      PetscInt M, N, md, nd;
-      DMDAGetInfo (da_nodes, NULL, &M, &N, NULL, &md, &nd, NULL, NULL, NULL,
-          &bx,
-          &by, NULL, &stype);
-
-      // Find the element size
-      Vec lcoor;
-      DMGetCoordinatesLocal (da_nodes, &lcoor);
-      PetscScalar *lcoorp;
-      VecGetArray (lcoor, &lcoorp);
-
-      PetscInt nel, nen;
-      const PetscInt *necon;
-      DMDAGetElements_2D (da_nodes, &nel, &nen, &necon);
-
-      // Use the first element to compute the dx, dy, dz
-      dx = lcoorp[DIM * necon[0 * nen + 1] + 0]
-           - lcoorp[DIM * necon[0 * nen + 0] + 0];
-      dy = lcoorp[DIM * necon[0 * nen + 2] + 1]
-           - lcoorp[DIM * necon[0 * nen + 1] + 1];
-      VecRestoreArray (lcoor, &lcoorp);
-
-      nn[0] = M;
-      nn[1] = N;
-
-      ne[0] = nn[0] - 1;
-      ne[1] = nn[1] - 1;
-
-      xc[0] = 0.0;
-      xc[1] = ne[0] * dx;
-      xc[2] = 0.0;
-      xc[3] = ne[1] * dy;
-    }
+    // Use the first element to compute the dx, dy, dz
+    dx = lcoorp[DIM * necon[0 * nen + 1] + 0]
+         - lcoorp[DIM * necon[0 * nen + 0] + 0];
+    dy = lcoorp[DIM * necon[0 * nen + 2] + 1]
+         - lcoorp[DIM * necon[0 * nen + 1] + 1];
+    VecRestoreArray (lcoor, &lcoorp);
 
-    // Create the nodal mesh
-    DMDACreate2d (PETSC_COMM_WORLD, bx, by, stype, nn[0], nn[1], PETSC_DECIDE,
-    PETSC_DECIDE, numnodaldof, stencilwidth, 0, 0, &(da_nodal));
-    // Initialize
-    DMSetFromOptions (da_nodal);
-    DMSetUp (da_nodal);
+    nn[0] = M;
+    nn[1] = N;
 
-    // Set the coordinates
-    DMDASetUniformCoordinates (da_nodal, xc[0], xc[1], xc[2], xc[3], 0.0, 0.0);
-    // Set the element type to Q1: Otherwise calls to GetElements will change to
-    // P1 ! STILL DOESN*T WORK !!!!
-    DMDASetElementType (da_nodal, DMDA_ELEMENT_Q1);
+    ne[0] = nn[0] - 1;
+    ne[1] = nn[1] - 1;
 
-    // Allocate matrix and the RHS and Solution vector and Dirichlet vector
-    ierr = DMCreateMatrix (da_nodal, &(K));
+    xc[0] = 0.0;
+    xc[1] = ne[0] * dx;
+    xc[2] = 0.0;
+    xc[3] = ne[1] * dy;
+  }
+
+  // # modified; Create the nodal mesh with the partition of da_nodes, which
+  // may be occupancy weighted (-balanceDomain)
+  PetscInt mdn, ndn;
+  const PetscInt *lxn, *lyn;
+  DMDAGetInfo (da_nodes, NULL, NULL, NULL, NULL, &mdn, &ndn, NULL, NULL, NULL,
+      NULL, NULL, NULL, NULL);
+  DMDAGetOwnershipRanges (da_nodes, &lxn, &lyn, NULL);
+  DMDACreate2d (comm, bx, by, stype, nn[0], nn[1], mdn, ndn,
+      numnodaldof, stencilwidth, lxn, lyn, &(da_nodal));
+  // Initialize
+  DMSetFromOptions (da_nodal);
+  DMSetUp (da_nodal);
+
+  // Set the coordinates
+  DMDASetUniformCoordinates (da_nodal, xc[0], xc[1], xc[2], xc[3], 0.0, 0.0);
+  // Set the element type to Q1: Otherwise calls to GetElements will change to
+  // P1 ! STILL DOESN*T WORK !!!!
+  DMDASetElementType (da_nodal, DMDA_ELEMENT_Q1);
+
+  // # modified; Allocate the solution vector; the matrix and the RHS and
+  // Dirichlet vectors come with the load cases in SetUpLoadAndBC
+  ierr = DMCreateGlobalVector (da_nodal, &(U));
+  CHKERRQ(ierr);
+
+  // Set the local stiffness matrix
+  PetscScalar X[4] = { 0.0, dx, dx, 0.0 };
+  PetscScalar Y[4] = { 0.0, 0.0, dy, dy };
+
+  // Compute the element stiffnes matrix - constant due to structured grid
+  Quad4Isoparametric (X, Y, nu, false, KE);
+
+  // Save the element size for other uses
+  this->dx = dx;
+  this->dy = dy;
+#elif DIM == 3
+  // Extract information from input DM and create one for the linear elasticity
+  // number of nodal dofs: (u,v,w)
+  PetscInt numnodaldof = 3;
+
+  // Stencil width: each node connects to a box around it - linear elements
+  PetscInt stencilwidth = 1;
+
+  PetscScalar dx, dy, dz;
+  DMBoundaryType bx, by, bz;
+  DMDAStencilType stype;
+  {
+    // Extract information from the nodal mesh
+    PetscInt M, N, P, md, nd, pd;
+    DMDAGetInfo (da_nodes, NULL, &M, &N, &P, &md, &nd, &pd, NULL, NULL, &bx,
+        &by, &bz, &stype);
+
+    // Find the element size
+    Vec lcoor;
+    DMGetCoordinatesLocal (da_nodes, &lcoor);
+    PetscScalar *lcoorp;
+    VecGetArray (lcoor, &lcoorp);
+
+    PetscInt nel, nen;
+    const PetscInt *necon;
+    DMDAGetElements_3D (da_nodes, &nel, &nen, &necon);
+
+    // Use the first element to compute the dx, dy, dz
+    dx = lcoorp[3 * necon[0 * nen + 1] + 0]
+         - lcoorp[3 * necon[0 * nen + 0] + 0];
+    dy = lcoorp[3 * necon[0 * nen + 2] + 1]
+         - lcoorp[3 * necon[0 * nen + 1] + 1];
+    dz = lcoorp[3 * necon[0 * nen + 4] + 2]
+         - lcoorp[3 * necon[0 * nen + 0] + 2];
+    VecRestoreArray (lcoor, &lcoorp);
+
+    nn[0] = M;
+    nn[1] = N;
+    nn[2] = P;
+
+    ne[0] = nn[0] - 1;
+    ne[1] = nn[1] - 1;
+    ne[2] = nn[2] - 1;
+
+    xc[0] = 0.0;
+    xc[1] = ne[0] * dx;
+    xc[2] = 0.0;
+    xc[3] = ne[1] * dy;
+    xc[4] = 0.0;
+    xc[5] = ne[2] * dz;
+  }
+
+  // # modified; Create the nodal mesh with the partition of da_nodes, which
+  // may be occupancy weighted (-balanceDomain)
+  PetscInt mdn, ndn, pdn;
+  const PetscInt *lxn, *lyn, *lzn;
+  DMDAGetInfo (da_nodes, NULL, NULL, NULL, NULL, &mdn, &ndn, &pdn, NULL, NULL,
+      NULL, NULL, NULL, NULL);
+  DMDAGetOwnershipRanges (da_nodes, &lxn, &lyn, &lzn);
+  DMDACreate3d (comm, bx, by, bz, stype, nn[0], nn[1], nn[2], mdn,
+      ndn, pdn, numnodaldof, stencilwidth, lxn, lyn, lzn, &(da_nodal));
+  // Initialize
+  DMSetFromOptions (da_nodal);
+  DMSetUp (da_nodal);
+
+  // Set the coordinates
+  DMDASetUniformCoordinates (da_nodal, xc[0], xc[1], xc[2], xc[3], xc[4],
+      xc[5]);
+  // Set the element type to Q1: Otherwise calls to GetElements will change to
+  // P1 ! STILL DOESN*T WORK !!!!
+  DMDASetElementType (da_nodal, DMDA_ELEMENT_Q1);
+
+  // # modified; Allocate the solution vector; the matrix and the RHS and
+  // Dirichlet vectors come with the load cases in SetUpLoadAndBC
+  ierr = DMCreateGlobalVector (da_nodal, &(U));
+  CHKERRQ(ierr);
+
+  // Set the local stiffness matrix
+  PetscScalar X[8] = { 0.0, dx, dx, 0.0, 0.0, dx, dx, 0.0 };
+  PetscScalar Y[8] = { 0.0, 0.0, dy, dy, 0.0, 0.0, dy, dy };
+  PetscScalar Z[8] = { 0.0, 0.0, 0.0, 0.0, dz, dz, dz, dz };
+
+  // Compute the element stiffnes matrix - constant due to structured grid
+  Hex8Isoparametric (X, Y, Z, nu, false, KE);
+
+  // # new; Save the element size for other uses
+  this->dx = dx;
+  this->dy = dy;
+  this->dz = dz;
+#endif
+
+  return ierr;
+}
+
+PetscErrorCode
+LinearElasticity::SetUpLoadAndBC (DM da_nodes, Vec xPassive0, Vec xPassive1,
+    Vec xPassive2, Vec xPassive3, PetscInt loadCondition) {
+  PetscErrorCode ierr = 0;
+
+  if (da_nodal == NULL) { // # modified; Only set up da_nodal once
+    ierr = SetUpMesh (da_nodes);
     CHKERRQ(ierr);
-    ierr = DMCreateGlobalVector (da_nodal, &(U));
+  }
+  if (K == NULL) { // # new; not set up by the outer object of the load case
+    // groups until a verification solve needs it
+    ierr = DMCreateMatrix (da_nodal, &(K));
     CHKERRQ(ierr);
     VecDuplicateVecs (U, numLODFIX, &(RHS));
     VecDuplicateVecs (U, numLODFIX, &(N));
-
-    // Set the local stiffness matrix
-    PetscScalar X[4] = { 0.0, dx, dx, 0.0 };
-    PetscScalar Y[4] = { 0.0, 0.0, dy, dy };
-
-    // Compute the element stiffnes matrix - constant due to structured grid
-    Quad4Isoparametric (X, Y, nu, false, KE);
-
-    // Save the element size for other uses
-    this->dx = dx;
-    this->dy = dy;
   }
 
+#if DIM == 2  // # new
   // Set the RHS and Dirichlet vector
   VecSet (N[loadCondition], 1.0);
   VecSet (RHS[loadCondition], 0.0);
@@ -187,7 +359,6 @@ LinearElasticity::SetUpLoadAndBC (DM da_nodes, Vec xPassive0, Vec xPassive1,
   VecGetArray (xPassive3, &xPassive3p);
 
   // Set the RHS and Dirichlet vector
-  PetscScalar rhs_ele[8]; // local rhs
   PetscScalar n_ele[8]; // local n
   PetscInt edof[8];
 
@@ -196,7 +367,7 @@ LinearElasticity::SetUpLoadAndBC (DM da_nodes, Vec xPassive0, Vec xPassive1,
   const PetscInt *necon;
   DMDAGetElements_2D (da_nodes, &nel, &nen, &necon);
 
-  if (IMPORT_GEO == 0) {
+  if (importGeo == 0) { // # modified; -importGeo
     // Set the values:
     // In this case: N = the wall at x=xmin is fully clamped
     // RHS(z) = -0.001 at the middle point of the right boundary
@@ -220,9 +391,9 @@ LinearElasticity::SetUpLoadAndBC (DM da_nodes, Vec xPassive0, Vec xPassive1,
     // xPassive2 indicates fix,
     // xPassive3 indicates loading.
     // Load and constraints
+    // # modified; The loads are set by SetUpLoad below
     for (PetscInt i = 0; i < nel; i++) {
 
-      memset (rhs_ele, 0.0, sizeof(rhs_ele[0]) * 8);
       memset (n_ele, 0.0, sizeof(n_ele[0]) * 8);
 
       // Global dof in the RHS vector
@@ -232,15 +403,6 @@ LinearElasticity::SetUpLoadAndBC (DM da_nodes, Vec xPassive0, Vec xPassive1,
         }
       }
 
-      if (std::fmod ((xPassive3p[i] / std::pow (2.0, loadCondition)), 2) >= 1.0) {
-        for (PetscInt j = 0; j < 8; j++) {
-          rhs_ele[j] = loadVector[DIM * loadCondition + j % DIM];
-        }
-        ierr = VecSetValuesLocal (RHS[loadCondition], 8, edof, rhs_ele,
-            ADD_VALUES);
-        CHKERRQ(ierr);
-      }
-
       if (std::fmod ((xPassive2p[i] / std::pow (2.0, loadCondition)), 2) >= 1.0) {
         for (PetscInt j = 0; j < 8; j++) {
           n_ele[j] = 0.0;
@@ -253,96 +415,6 @@ LinearElasticity::SetUpLoadAndBC (DM da_nodes, Vec xPassive0, Vec xPassive1,
   }
 
 #elif DIM == 3
-  if (da_nodal == NULL) { // # new; Only set up da_nodal once
-    // Extract information from input DM and create one for the linear elasticity
-    // number of nodal dofs: (u,v,w)
-    PetscInt numnodaldof = 3;
-
-    // Stencil width: each node connects to a box around it - linear elements
-    PetscInt stencilwidth = 1;
-
-    PetscScalar dx, dy, dz;
-    DMBoundaryType bx, by, bz;
-    DMDAStencilType stype;
-    {
-      // Extract information from the nodal mesh
-      PetscInt M, N, P, md, nd, pd;
-      DMDAGetInfo (da_nodes, NULL, &M, &N, &P, &md, &nd, &pd, NULL, NULL, &bx,
-          &by, &bz, &stype);
-
-      // Find the element size
-      Vec lcoor;
-      DMGetCoordinatesLocal (da_nodes, &lcoor);
-      PetscScalar *lcoorp;
-      VecGetArray (lcoor, &lcoorp);
-
-      PetscInt nel, nen;
-      const PetscInt *necon;
-      DMDAGetElements_3D (da_nodes, &nel, &nen, &necon);
-
-      // Use the first element to compute the dx, dy, dz
-      dx = lcoorp[3 * necon[0 * nen + 1] + 0]
-           - lcoorp[3 * necon[0 * nen + 0] + 0];
-      dy = lcoorp[3 * necon[0 * nen + 2] + 1]
-           - lcoorp[3 * necon[0 * nen + 1] + 1];
-      dz = lcoorp[3 * necon[0 * nen + 4] + 2]
-           - lcoorp[3 * necon[0 * nen + 0] + 2];
-      VecRestoreArray (lcoor, &lcoorp);
-
-      nn[0] = M;
-      nn[1] = N;
-      nn[2] = P;
-
-      ne[0] = nn[0] - 1;
-      ne[1] = nn[1] - 1;
-      ne[2] = nn[2] - 1;
-
-      xc[0] = 0.0;
-      xc[1] = ne[0] * dx;
-      xc[2] = 0.0;
-      xc[3] = ne[1] * dy;
-      xc[4] = 0.0;
-      xc[5] = ne[2] * dz;
-    }
-
-    // Create the nodal mesh
-    DMDACreate3d (PETSC_COMM_WORLD, bx, by, bz, stype, nn[0], nn[1], nn[2],
-    PETSC_DECIDE, PETSC_DECIDE, PETSC_DECIDE, numnodaldof, stencilwidth, 0, 0,
-        0,
-        &(da_nodal));
-    // Initialize
-    DMSetFromOptions (da_nodal);
-    DMSetUp (da_nodal);
-
-    // Set the coordinates
-    DMDASetUniformCoordinates (da_nodal, xc[0], xc[1], xc[2], xc[3], xc[4],
-        xc[5]);
-    // Set the element type to Q1: Otherwise calls to GetElements will change to
-    // P1 ! STILL DOESN*T WORK !!!!
-    DMDASetElementType (da_nodal, DMDA_ELEMENT_Q1);
-
-    // Allocate matrix and the RHS and Solution vector and Dirichlet vector
-    ierr = DMCreateMatrix (da_nodal, &(K));
-    CHKERRQ(ierr);
-    ierr = DMCreateGlobalVector (da_nodal, &(U));
-    CHKERRQ(ierr);
-    VecDuplicateVecs (U, numLODFIX, &(RHS)); // # modified
-    VecDuplicateVecs (U, numLODFIX, &(N)); // # modified
-
-    // Set the local stiffness matrix
-    PetscScalar X[8] = { 0.0, dx, dx, 0.0, 0.0, dx, dx, 0.0 };
-    PetscScalar Y[8] = { 0.0, 0.0, dy, dy, 0.0, 0.0, dy, dy };
-    PetscScalar Z[8] = { 0.0, 0.0, 0.0, 0.0, dz, dz, dz, dz };
-
-    // Compute the element stiffnes matrix - constant due to structured grid
-    Hex8Isoparametric (X, Y, Z, nu, false, KE);
-
-    // # new; Save the element size for other uses
-    this->dx = dx;
-    this->dy = dy;
-    this->dz = dz;
-  }
-
   // Set the RHS and Dirichlet vector
   VecSet (N[loadCondition], 1.0); // # modified
   VecSet (RHS[loadCondition], 0.0); // # modified
@@ -370,8 +442,7 @@ LinearElasticity::SetUpLoadAndBC (DM da_nodes, Vec xPassive0, Vec xPassive1,
   VecGetArray (xPassive2, &xPassive2p);
   VecGetArray (xPassive3, &xPassive3p);
 
-  // # new; Set the local RHS and Dirichlet vector
-  PetscScalar rhs_ele[24]; // local rhs
+  // # new; Set the local Dirichlet vector
   PetscScalar n_ele[24]; // local n
   PetscInt edof[24];
 
@@ -380,7 +451,7 @@ LinearElasticity::SetUpLoadAndBC (DM da_nodes, Vec xPassive0, Vec xPassive1,
   const PetscInt *necon;
   DMDAGetElements_3D (da_nodal, &nel, &nen, &necon);
 
-  if (IMPORT_GEO == 0) {
+  if (importGeo == 0) { // # modified; -importGeo
     // Set the values:
     // In this case: N = the wall at x=xmin is fully clamped
     //               RHS(z) = sin(pi*y/Ly) at x=xmax,z=zmin;
@@ -426,9 +497,8 @@ LinearElasticity::SetUpLoadAndBC (DM da_nodes, Vec xPassive0, Vec xPassive1,
     // xPassive2 indicates fix,
     // xPassive3 indicates loading.
     // Load and constraints
+    // # modified; The loads are set by SetUpLoad below
     for (PetscInt i = 0; i < nel; i++) {
-      //std::fill_n(rhs_ele, 24, 0); // initialization
-      memset (rhs_ele, 0.0, sizeof(rhs_ele[0]) * 24);
       memset (n_ele, 0.0, sizeof(n_ele[0]) * 24);
 
       // Global dof in the RHS vector
@@ -438,15 +508,6 @@ LinearElasticity::SetUpLoadAndBC (DM da_nodes, Vec xPassive0, Vec xPassive1,
         }
       }
 
-      if (std::fmod ((xPassive3p[i] / std::pow (2.0, loadCondition)), 2) >= 1.0) {
-        for (PetscInt j = 0; j < 24; j++) {
-          rhs_ele[j] = loadVector[DIM * loadCondition + j % DIM];
-        }
-        ierr = VecSetValuesLocal (RHS[loadCondition], 24, edof, rhs_ele,
-            ADD_VALUES);
-        CHKERRQ(ierr);
-      }
-
       if (std::fmod ((xPassive2p[i] / std::pow (2.0, loadCondition)), 2) >= 1.0) {
         for (PetscInt j = 0; j < 24; j++) {
           n_ele[j] = 0.0;
@@ -460,10 +521,27 @@ LinearElasticity::SetUpLoadAndBC (DM da_nodes, Vec xPassive0, Vec xPassive1,
 
 #endif
 
+  // # new; Mirror planes of a reduced model, -symmetry
+  ierr = symmetry.ZeroNormalDisplacement (N[loadCondition], lcoorp, nn, xc,
+      epsi);
+  CHKERRQ(ierr);
+
   VecAssemblyBegin (N[loadCondition]); // # modified
   VecAssemblyEnd (N[loadCondition]); // # modified
   VecAssemblyBegin (RHS[loadCondition]); // # modified
   VecAssemblyEnd (RHS[loadCondition]); // # modified
+
+  // # new; The constrained dofs, and no loads on them
+  ierr = dirichlet[loadCondition].SetUp (N[loadCondition]);
+  CHKERRQ(ierr);
+  if (importGeo == 0) { // # modified; -importGeo
+    ierr = VecPointwiseMult (RHS[loadCondition], RHS[loadCondition],
+        N[loadCondition]);
+    CHKERRQ(ierr);
+  } else {
+    ierr = SetUpLoad (xPassive3, loadCondition, RHS[loadCondition]);
+    CHKERRQ(ierr);
+  }
   VecRestoreArray (lcoor, &lcoorp);
   DMDARestoreElements (da_nodal, &nel, &nen, &necon); // # new
   VecRestoreArray (xPassive0, &xPassive0p); // # new
@@ -474,30 +552,97 @@ LinearElasticity::SetUpLoadAndBC (DM da_nodes, Vec xPassive0, Vec xPassive1,
   return ierr;
 }
 
+// # new; The element loads of the imported geometry: the elements with bit
+// loadCondition set in xPassive3 carry loadVector of the load case. The
+// supports N[loadCondition] must be set up.
+PetscErrorCode
+LinearElasticity::SetUpLoad (Vec xPassive3, PetscInt loadCondition, Vec rhs) {
+  PetscErrorCode ierr = 0;
+
+  ierr = VecSet (rhs, 0.0);
+  CHKERRQ(ierr);
+
+  PetscInt nel, nen;
+  const PetscInt *necon;
+#if DIM == 2
+  ierr = DMDAGetElements_2D (da_nodal, &nel, &nen, &necon);
+  CHKERRQ(ierr);
+#elif DIM == 3
+  ierr = DMDAGetElements_3D (da_nodal, &nel, &nen, &necon);
+  CHKERRQ(ierr);
+#endif
+  PetscScalar *xPassive3p;
+  VecGetArray (xPassive3, &xPassive3p);
+
+  // The same load at every dof of a loaded element
+  const PetscInt nedof = nen * DIM;
+  PetscScalar rhs_ele[24]; // local rhs
+  PetscInt edof[24];
+  for (PetscInt j = 0; j < nedof; j++) {
+    rhs_ele[j] = loadVector[DIM * loadCondition + j % DIM];
+  }
+
+  for (PetscInt i = 0; i < nel; i++) {
+    if (std::fmod ((xPassive3p[i] / std::pow (2.0, loadCondition)), 2) < 1.0) {
+      continue;
+    }
+    for (PetscInt l = 0; l < nen; l++) {
+      for (PetscInt m = 0; m < DIM; m++) {
+        edof[l * DIM + m] = DIM * necon[i * nen + l] + m; // dof in globe
+      }
+    }
+    ierr = VecSetValuesLocal (rhs, nedof, edof, rhs_ele, ADD_VALUES);
+    CHKERRQ(ierr);
+  }
+  VecAssemblyBegin (rhs);
+  VecAssemblyEnd (rhs);
+
+  // No loads on the constrained dofs
+  ierr = VecPointwiseMult (rhs, rhs, N[loadCondition]);
+  CHKERRQ(ierr);
+
+  VecRestoreArray (xPassive3, &xPassive3p);
+  DMDARestoreElements (da_nodal, &nel, &nen, &necon);
+
+  return ierr;
+}
+
 PetscErrorCode
 LinearElasticity::SolveState (Vec xPhys, PetscScalar Emin,
     PetscScalar Emax, PetscScalar penal, PetscInt loadCondition) {
 
   PetscErrorCode ierr;
 
-  double t1, t2;
-  t1 = MPI_Wtime ();
+  ScopedTimer solveTimer ("SolveState"); // # modified
 
   // Assemble the stiffness matrix
-  ierr = AssembleStiffnessMatrix (xPhys, Emin, Emax, penal, loadCondition);
+  {
+    ScopedTimer assembleTimer ("Assemble"); // # new
+    ierr = AssembleStiffnessMatrix (xPhys, Emin, Emax, penal, loadCondition);
+    CHKERRQ(ierr);
+  }
+
+  // # new; Time the wait for the slowest rank's assembly, -imbalance
+  ierr = ImbalanceWait (comm);
   CHKERRQ(ierr);
 
   // Setup the solver
-  if (ksp == NULL) {
-    ierr = SetUpSolver ();
-    CHKERRQ(ierr);
-  } else {
-    ierr = KSPSetOperators (ksp, K, K);
-    CHKERRQ(ierr);
-    KSPSetUp (ksp);
+  {
+    ScopedTimer setupTimer ("PCSetUp"); // # new
+    if (ksp == NULL) {
+      ierr = SetUpSolver ();
+      CHKERRQ(ierr);
+    } else {
+      ierr = KSPSetOperators (ksp, K, K);
+      CHKERRQ(ierr);
+      ierr = KSPSetReusePreconditioner (ksp, reusePC); // # new
+      CHKERRQ(ierr);
+      KSPSetUp (ksp);
+    }
   }
 
   // Solve
+  ScopedTimer kspTimer ("KSPSolve"); // # new
   ierr = KSPSolve (ksp, RHS[loadCondition], U);
   CHKERRQ(ierr);
   CHKERRQ(ierr);
@@ -512,10 +657,15 @@ LinearElasticity::SolveState (Vec xPhys, PetscScalar Emin,
   ierr = VecNorm (RHS[loadCondition], NORM_2, &RHSnorm);
   CHKERRQ(ierr);
   rnorm = rnorm / RHSnorm;
+  kspTimer.Stop (); // # new
+  if (loadCondition < (PetscInt) kspIterations.size ()) { // # new
+    kspIterations[loadCondition] = niter;
+    kspResiduals[loadCondition] = PetscRealPart (rnorm);
+  }
 
-  t2 = MPI_Wtime ();
-  PetscPrintf (PETSC_COMM_WORLD,
-      "State solver:  iter: %i, rerr.: %e, time: %f\n", niter, rnorm, t2 - t1);
+  PetscPrintf (comm,
+      "State solver:  iter: %i, rerr.: %e, time: %f\n", niter, rnorm,
+      solveTimer.Elapsed ()); // # modified
 
   return ierr;
 }
@@ -528,35 +678,47 @@ LinearElasticity::ComputeObjectiveConstraintsSensitivities (
   // Errorcode
   PetscErrorCode ierr;
 
-  for (PetscInt loadCondition = 0; loadCondition < numLODFIX; ++loadCondition) { // # new
-    // Solve state eqs
-    ierr = SolveState (xPhys, Emin, Emax, penal, loadCondition); // # modified
+  // # new; The load cases are solved by the groups, -loadCaseGroups
+  if (group != NULL) {
+    ierr = ComputeWithLoadCaseGroups (fx, gx, dfdx, dgdx, xPhys, Emin, Emax,
+        penal, volfrac, xPassive0, xPassive1, xPassive2, xPassive3);
     CHKERRQ(ierr);
+    return ierr;
+  }
 
-    // Get the FE mesh structure (from the nodal mesh)
-    PetscInt nel, nen;
-    const PetscInt *necon;
+  // Get the FE mesh structure (from the nodal mesh)
+  PetscInt nel, nen;
+  const PetscInt *necon;
 #if DIM == 2    // # new
-    ierr = DMDAGetElements_2D (da_nodal, &nel, &nen, &necon);
-    CHKERRQ(ierr);
+  ierr = DMDAGetElements_2D (da_nodal, &nel, &nen, &necon);
+  CHKERRQ(ierr);
 #elif DIM == 3
-    ierr = DMDAGetElements_3D (da_nodal, &nel, &nen, &necon);
-    CHKERRQ(ierr);
+  ierr = DMDAGetElements_3D (da_nodal, &nel, &nen, &necon);
+  CHKERRQ(ierr);
 #endif
-    // DMDAGetElements(da_nodes,&nel,&nen,&necon); // Still issue with elemtype
-    // change !
+  // DMDAGetElements(da_nodes,&nel,&nen,&necon); // Still issue with elemtype
+  // change !
+
+  // # modified; The objective and its sensitivities are summed over the load
+  // cases of this object
+  fx[0] = 0.0;
+  VecSet (dfdx, 0.0);
+  for (PetscInt loadCondition = caseBegin; loadCondition < caseEnd;
+      ++loadCondition) { // # new
+    // Solve state eqs
+    ierr = SolveState (xPhys, Emin, Emax, penal, loadCondition); // # modified
+    CHKERRQ(ierr);
+
+    ScopedTimer sensTimer ("Sensitivity"); // # new
 
     // Get pointer to the densities
-    PetscScalar *xp, *xPassive0p, *xPassive1p, *xPassive2p, *xPassive3p; // # modified
+    PetscScalar *xp, *xPassive0p; // # modified
     VecGetArray (xPhys, &xp);
     VecGetArray (xPassive0, &xPassive0p); // # new
-    VecGetArray (xPassive1, &xPassive1p); // # new
-    VecGetArray (xPassive2, &xPassive2p); // # new
-    VecGetArray (xPassive3, &xPassive3p); // # new
 
     // Get Solution
     Vec Uloc;
-    DMCreateLocalVector (da_nodal, &Uloc);
+    DMGetLocalVector (da_nodal, &Uloc); // # modified
     DMGlobalToLocalBegin (da_nodal, U, INSERT_VALUES, Uloc);
     DMGlobalToLocalEnd (da_nodal, U, INSERT_VALUES, Uloc);
 
@@ -568,95 +730,116 @@ LinearElasticity::ComputeObjectiveConstraintsSensitivities (
     PetscScalar *df;
     VecGetArray (dfdx, &df);
 
-    // # new; Get dgdx
-    PetscScalar **dg;
-    for (PetscInt i = 0; i < m; ++i) {
-      VecSet (dgdx[i], 0);
-      gx[i] = 0;
-    }
-    VecGetArrays (dgdx, m, &dg);
-
-    // Number of total elements and nonDesign domain elements
-    PetscInt neltot = 0;
-    PetscScalar nNonDesign = 0; // # new
-    VecGetSize (xPhys, &neltot); // # modified
-
-    // Edof array
-    PetscInt edof[nedof]; // # modified
-
-    fx[0] = 0.0;
-    // # modified; Loop over elements
+    // # modified; Loop over the design elements, threaded with the
+    // objective reduced
+    PetscScalar fsum = 0.0;
+    TOPOPT_OMP(parallel for reduction(+:fsum))
     for (PetscInt i = 0; i < nel; i++) {
+      if (xPassive0p[i] == 0) continue;
+      // Edof array
+      PetscInt edof[nedof];
       // loop over element nodes
-      if (xPassive0p[i] != 0) {
-        for (PetscInt j = 0; j < nen; j++) {
-          // Get local dofs
-          for (PetscInt k = 0; k < DIM; k++) {
-            edof[j * DIM + k] = DIM * necon[i * nen + j] + k;
-          }
-        }
-        // Use SIMP for stiffness interpolation
-        PetscScalar uKu = 0.0;
-        for (PetscInt k = 0; k < nedof; k++) {
-          for (PetscInt h = 0; h < nedof; h++) {
-            uKu += up[edof[k]] * KE[k * nedof + h] * up[edof[h]];
-          }
+      for (PetscInt j = 0; j < nen; j++) {
+        // Get local dofs
+        for (PetscInt k = 0; k < DIM; k++) {
+          edof[j * DIM + k] = DIM * necon[i * nen + j] + k;
         }
-        // Add to objective
-        fx[0] += (Emin + PetscPowScalar(xp[i], penal) * (Emax - Emin)) * uKu;
-        // Set the Senstivity
-        df[i] = -1.0 * penal * PetscPowScalar(xp[i], penal - 1) * (Emax - Emin)
-                * uKu;
-        // # new; Constraints
-        for (PetscInt j = 0; j < m; ++j) {
-          gx[j] += xp[i];
-          dg[j][i] = 1;
+      }
+      // Use SIMP for stiffness interpolation
+      PetscScalar uKu = 0.0;
+      for (PetscInt k = 0; k < nedof; k++) {
+        for (PetscInt h = 0; h < nedof; h++) {
+          uKu += up[edof[k]] * KE[k * nedof + h] * up[edof[h]];
         }
-
-      } else if (xPassive1p[i] != 0 || xPassive2p[i] != 0
-                 || xPassive3p[i] != 0) { // # new
-        df[i] = -1.0E9; // # new
-        nNonDesign += 1; // # new
-      } else { // # new
-        df[i] = 1.0E9; // # new
-        nNonDesign += 1; // # new
       }
+      // Add to objective
+      fsum += (Emin + PetscPowScalar(xp[i], penal) * (Emax - Emin)) * uKu;
+      // Add to the Senstivity
+      df[i] += -1.0 * penal * PetscPowScalar(xp[i], penal - 1)
+               * (Emax - Emin) * uKu;
     }
-
-    // Allreduce fx[0]
-    PetscScalar tmp = fx[0];
-    fx[0] = 0.0;
-    MPI_Allreduce(&tmp, &(fx[0]), 1, MPIU_SCALAR, MPI_SUM, PETSC_COMM_WORLD);
-
-    tmp = nNonDesign;
-    nNonDesign = 0.0;
-    MPI_Allreduce(&tmp, &(nNonDesign), 1, MPIU_SCALAR, MPI_SUM,
-        PETSC_COMM_WORLD);
-
-    // # modified; Allreduce gx
-    for (PetscInt i = 0; i < m; ++i) {
-      tmp = gx[i];
-      gx[i] = 0.0;
-      MPI_Allreduce(&tmp, &(gx[i]), 1, MPIU_SCALAR, MPI_SUM, PETSC_COMM_WORLD);
-      gx[i] = gx[i]
-              / ((PetscScalar) neltot - nNonDesign)
-              - volfrac; // # modified
-      VecScale (dgdx[i],
-          1.0 / ((PetscScalar) neltot - nNonDesign)); // # modified
-    }
+    fx[0] += fsum;
 
     VecRestoreArray (xPhys, &xp);
     VecRestoreArray (xPassive0, &xPassive0p); // # new
-    VecRestoreArray (xPassive1, &xPassive1p); // # new
-    VecRestoreArray (xPassive2, &xPassive2p); // # new
-    VecRestoreArray (xPassive3, &xPassive3p); // # new
     VecRestoreArray (Uloc, &up);
     VecRestoreArray (dfdx, &df);
-    VecRestoreArrays (dgdx, m, &dg);
-    VecDestroy (&Uloc);
-
+    DMRestoreLocalVector (da_nodal, &Uloc); // # modified
   } // # new
 
+  // # new; Volume constraints and the passive elements, the same for all the
+  // load cases
+  ScopedTimer sensTimer ("Sensitivity");
+  PetscScalar *xp, *xPassive0p, *xPassive1p, *xPassive2p, *xPassive3p;
+  VecGetArray (xPhys, &xp);
+  VecGetArray (xPassive0, &xPassive0p);
+  VecGetArray (xPassive1, &xPassive1p);
+  VecGetArray (xPassive2, &xPassive2p);
+  VecGetArray (xPassive3, &xPassive3p);
+  PetscScalar *df;
+  VecGetArray (dfdx, &df);
+  PetscScalar **dg = dgp; // # modified
+  for (PetscInt i = 0; i < m; ++i) {
+    VecSet (dgdx[i], 0);
+    gx[i] = 0;
+  }
+  GetArrays (dgdx, m, dg); // # modified
+
+  // Number of total elements and nonDesign domain elements
+  PetscInt neltot = 0;
+  PetscScalar nNonDesign = 0;
+  VecGetSize (xPhys, &neltot);
+
+  PetscScalar volume = 0.0;
+  TOPOPT_OMP(parallel for reduction(+:volume, nNonDesign))
+  for (PetscInt i = 0; i < nel; i++) {
+    if (xPassive0p[i] != 0) {
+      volume += xp[i];
+      for (PetscInt j = 0; j < m; ++j) {
+        dg[j][i] = 1;
+      }
+    } else if (xPassive1p[i] != 0 || xPassive2p[i] != 0
+               || xPassive3p[i] != 0) {
+      df[i] = -1.0E9;
+      nNonDesign += 1;
+    } else {
+      df[i] = 1.0E9;
+      nNonDesign += 1;
+    }
+  }
+  for (PetscInt j = 0; j < m; ++j) {
+    gx[j] = volume;
+  }
+
+  // Allreduce fx[0]
+  PetscScalar tmp = fx[0];
+  fx[0] = 0.0;
+  MPI_Allreduce(&tmp, &(fx[0]), 1, MPIU_SCALAR, MPI_SUM, comm);
+
+  tmp = nNonDesign;
+  nNonDesign = 0.0;
+  MPI_Allreduce(&tmp, &(nNonDesign), 1, MPIU_SCALAR, MPI_SUM, comm);
+
+  // # modified; Allreduce gx
+  for (PetscInt i = 0; i < m; ++i) {
+    tmp = gx[i];
+    gx[i] = 0.0;
+    MPI_Allreduce(&tmp, &(gx[i]), 1, MPIU_SCALAR, MPI_SUM, comm);
+    gx[i] = gx[i]
+            / ((PetscScalar) neltot - nNonDesign)
+            - volfrac; // # modified
+    VecScale (dgdx[i],
+        1.0 / ((PetscScalar) neltot - nNonDesign)); // # modified
+  }
+
+  VecRestoreArray (xPhys, &xp);
+  VecRestoreArray (xPassive0, &xPassive0p);
+  VecRestoreArray (xPassive1, &xPassive1p);
+  VecRestoreArray (xPassive2, &xPassive2p);
+  VecRestoreArray (xPassive3, &xPassive3p);
+  VecRestoreArray (dfdx, &df);
+  RestoreArrays (dgdx, m, dg); // # modified
+
   return (ierr);
 }
 
@@ -751,18 +934,18 @@ LinearElasticity::ComputeObjectiveConstraints (PetscScalar *fx,
       // Allreduce fx[0]
       PetscScalar tmp = fx[0];
       fx[0] = 0.0;
-      MPI_Allreduce(&tmp, &(fx[0]), 1, MPIU_SCALAR, MPI_SUM, PETSC_COMM_WORLD);
+      MPI_Allreduce(&tmp, &(fx[0]), 1, MPIU_SCALAR, MPI_SUM, comm);
 
       tmp = nNonDesign; // # new
       nNonDesign = 0.0; // # new
       MPI_Allreduce(&tmp, &(nNonDesign), 1, MPIU_SCALAR, MPI_SUM,
-          PETSC_COMM_WORLD); // # new
+          comm); // # new
       // # modified; Allreduce gx
       for (PetscInt i = 0; i < m; ++i) {
         tmp = gx[i];
         gx[i] = 0.0;
         MPI_Allreduce(&tmp, &(gx[i]), 1, MPIU_SCALAR, MPI_SUM,
-            PETSC_COMM_WORLD);
+            comm);
         gx[i] = gx[i]
                 / ((PetscScalar) neltot - nNonDesign)
                 - volfrac; // # modified
@@ -783,7 +966,7 @@ LinearElasticity::ComputeObjectiveConstraints (PetscScalar *fx,
 PetscErrorCode
 LinearElasticity::ComputeSensitivities (Vec dfdx, Vec *dgdx,
     Vec xPhys, PetscScalar Emin, PetscScalar Emax, PetscScalar penal,
-    PetscScalar volfrac, Vec xPassive0, Vec xPassive1,
+    PetscScalar /* volfrac */, Vec xPassive0, Vec xPassive1,
     Vec xPassive2, Vec xPassive3) {
 
   PetscErrorCode ierr;
@@ -873,7 +1056,7 @@ LinearElasticity::ComputeSensitivities (Vec dfdx, Vec *dgdx,
     PetscScalar tmp = nNonDesign;
     nNonDesign = 0.0;
     MPI_Allreduce(&tmp, &(nNonDesign), 1, MPIU_SCALAR, MPI_SUM,
-        PETSC_COMM_WORLD);
+        comm);
 
     // # modified; Allreduce gx
     for (PetscInt i = 0; i < m; ++i) {
@@ -896,6 +1079,30 @@ LinearElasticity::ComputeSensitivities (Vec dfdx, Vec *dgdx,
   return (ierr);
 }
 
+// # new
+PetscErrorCode
+LinearElasticity::AccountMemory (MemoryReport *mem)
+{
+  PetscErrorCode ierr = 0;
+  mem->Add ("Physics K", MemoryReport::MatBytes (K));
+  mem->Add ("Physics assembly map", assemblyMap.Bytes ()); // # new
+  for (PetscInt i = 0; i < numLODFIX; i++) { // # new
+    mem->Add ("Physics Dirichlet rows", dirichlet[i].Bytes ());
+  }
+  mem->Add ("Physics MG hierarchy", MemoryReport::MGBytes (ksp));
+  mem->Add ("Physics U, RHS/N per load case",
+      MemoryReport::VecBytes (U) + MemoryReport::VecsBytes (RHS, numLODFIX)
+      + MemoryReport::VecsBytes (N, numLODFIX));
+  if (UFEA != NULL) { // # new; verification states, FEAWithTopOptResults
+    mem->Add ("Physics U per verification load", MemoryReport::VecsBytes (
+        UFEA, numFEA));
+  }
+  if (group != NULL) { // # new; the full problem again on the group
+    group->AccountMemory (mem);
+  }
+  return ierr;
+}
+
 PetscErrorCode
 LinearElasticity::WriteRestartFiles ()
 {
@@ -917,10 +1124,10 @@ LinearElasticity::WriteRestartFiles ()
 // Open viewers for writing
   PetscViewer view; // vectors
   if (!flip) {
-    PetscViewerBinaryOpen (PETSC_COMM_WORLD, filename00.c_str (),
+    PetscViewerBinaryOpen (comm, filename00.c_str (),
         FILE_MODE_WRITE, &view);
   } else if (flip) {
-    PetscViewerBinaryOpen (PETSC_COMM_WORLD, filename01.c_str (),
+    PetscViewerBinaryOpen (comm, filename01.c_str (),
         FILE_MODE_WRITE, &view);
   }
 
@@ -934,27 +1141,89 @@ LinearElasticity::WriteRestartFiles ()
 }
 
 PetscErrorCode LinearElasticity::FEAWithTopOptResults (Vec xPhys, Vec xPassive0,
-    Vec xPassive1, Vec xPassive2, Vec xPassive3, PetscInt loadConditionFEA,
+    Vec xPassive1, Vec xPassive2, Vec xPassive3, PetscInt numLoadFEA,
     PetscScalar *loadVectorFEAp) { // # new
   // Errorcode
   PetscErrorCode ierr = 0;
 
-  PetscPrintf (PETSC_COMM_WORLD, "FEA with TopOpt Results, step: %d\n",
-      loadConditionFEA);
+  ScopedTimer solveTimer ("SolveState"); // # modified
+
+  // # modified; The verification loads share the supports of the first
+  // load condition, so the stiffness matrix is assembled and the
+  // preconditioner set up once for all of them
+  ierr = SetUpLoadAndBC (da_nodal, xPassive0, xPassive1, xPassive2, xPassive3,
+      0);
+  CHKERRQ(ierr);
+  {
+    ScopedTimer assembleTimer ("Assemble");
+    ierr = AssembleStiffnessMatrix (xPhys, 1E-9, 1.0, 1.0, 0);
+    CHKERRQ(ierr);
+  }
+  {
+    ScopedTimer setupTimer ("PCSetUp");
+    if (ksp == NULL) {
+      ierr = SetUpSolver ();
+      CHKERRQ(ierr);
+    } else {
+      ierr = KSPSetOperators (ksp, K, K);
+      CHKERRQ(ierr);
+      ierr = KSPSetReusePreconditioner (ksp, PETSC_FALSE);
+      CHKERRQ(ierr);
+    }
+    ierr = KSPSetUp (ksp);
+    CHKERRQ(ierr);
+  }
 
-  for (PetscInt i = 0; i < DIM; ++i) {
-    if (numNodeLoadAddingCounts != 0) {
-      loadVector[i] = loadVectorFEAp[DIM * loadConditionFEA + i]
-                      / numNodeLoadAddingCounts; // update the load vector
-    } else
-      loadVector[i] = loadVectorFEAp[DIM * loadConditionFEA + i]; // update the load vector
+  if (UFEA != NULL && numFEA != numLoadFEA) {
+    VecDestroyVecs (numFEA, &UFEA);
   }
-  // only first load condition because we are solving FEA only one at a time
-  SetUpLoadAndBC (da_nodal, xPassive0, xPassive1, xPassive2, xPassive3, 0);
-  // Solve state eqs,
-  ierr = SolveState (xPhys, 1E-9, 1.0, 1.0, 0);
+  if (UFEA == NULL) {
+    ierr = VecDuplicateVecs (U, numLoadFEA, &UFEA);
+    CHKERRQ(ierr);
+    numFEA = numLoadFEA;
+  }
+
+  // # modified; Only the load vector changes from one load to the next, the
+  // right hand side alone is rebuilt in RHS[0], on the supports and Dirichlet
+  // rows of load condition 0, and solved with the same operator
+  ScopedTimer kspTimer ("KSPSolve");
+  for (PetscInt loadConditionFEA = 0; loadConditionFEA < numLoadFEA;
+      ++loadConditionFEA) {
+    for (PetscInt i = 0; i < DIM; ++i) {
+      if (numNodeLoadAddingCounts != 0) {
+        loadVector[i] = loadVectorFEAp[DIM * loadConditionFEA + i]
+                        / numNodeLoadAddingCounts; // update the load vector
+      } else
+        loadVector[i] = loadVectorFEAp[DIM * loadConditionFEA + i]; // update the load vector
+    }
+    if (importGeo != 0) { // the built-in load does not use loadVector
+      ierr = SetUpLoad (xPassive3, 0, RHS[0]);
+      CHKERRQ(ierr);
+    }
+
+    ierr = VecSet (UFEA[loadConditionFEA], 0.0);
+    CHKERRQ(ierr);
+    ierr = KSPSolve (ksp, RHS[0], UFEA[loadConditionFEA]);
+    CHKERRQ(ierr);
+
+    PetscInt niter;
+    PetscReal rnorm, RHSnorm;
+    KSPGetIterationNumber (ksp, &niter);
+    KSPGetResidualNorm (ksp, &rnorm);
+    ierr = VecNorm (RHS[0], NORM_2, &RHSnorm);
+    CHKERRQ(ierr);
+    PetscPrintf (comm, "FEA with TopOpt Results, step: %d, iter: %i, "
+        "rerr.: %e\n", loadConditionFEA, niter, rnorm / RHSnorm);
+  }
+  kspTimer.Stop ();
+
+  // The state field holds the last load, as after a single solve
+  ierr = VecCopy (UFEA[numLoadFEA - 1], U);
   CHKERRQ(ierr);
 
+  PetscPrintf (comm, "FEA with TopOpt Results: %i loads, time: %f\n",
+      numLoadFEA, solveTimer.Elapsed ());
+
   return (ierr);
 }
 
@@ -965,6 +1234,255 @@ PetscErrorCode LinearElasticity::FEAWithTopOptResults (Vec xPhys, Vec xPassive0,
 //##################################################################
 //##################################################################
 
+// # new; Scatter between vWorld on comm and vGroup on a group communicator,
+// matched by the natural ordering of their meshes. As in PCREDUNDANT, vDup is
+// a vector on comm with the local layout of vGroup, whose array is placed
+// into it for every scatter. Ranks not participating take part with no
+// entries.
+static PetscErrorCode CreateGroupScatter (DM daWorld, DM daGroup, Vec vWorld,
+    Vec vGroup, PetscBool participate, Vec *vDup, VecScatter *scatter) {
+  PetscErrorCode ierr = 0;
+
+  MPI_Comm comm;
+  PetscObjectGetComm ((PetscObject) vWorld, &comm);
+  PetscInt nloc, rstart, dupStart;
+  VecGetLocalSize (vGroup, &nloc);
+  VecGetOwnershipRange (vGroup, &rstart, NULL);
+  ierr = VecCreateMPIWithArray (comm, 1, nloc, PETSC_DECIDE, NULL, vDup);
+  CHKERRQ(ierr);
+  VecGetOwnershipRange (*vDup, &dupStart, NULL);
+
+  // Group PETSc ordering -> natural ordering -> world PETSc ordering
+  AO aoWorld, aoGroup;
+  ierr = DMDAGetAO (daWorld, &aoWorld);
+  CHKERRQ(ierr);
+  ierr = DMDAGetAO (daGroup, &aoGroup);
+  CHKERRQ(ierr);
+  std::vector<PetscInt> idx (nloc);
+  for (PetscInt i = 0; i < nloc; ++i) {
+    idx[i] = rstart + i;
+  }
+  ierr = AOPetscToApplication (aoGroup, nloc, idx.data ());
+  CHKERRQ(ierr);
+  ierr = AOApplicationToPetsc (aoWorld, nloc, idx.data ());
+  CHKERRQ(ierr);
+
+  IS isWorld, isDup;
+  PetscInt n = participate ? nloc : 0;
+  ierr = ISCreateGeneral (comm, n, idx.data (), PETSC_COPY_VALUES, &isWorld);
+  CHKERRQ(ierr);
+  ierr = ISCreateStride (comm, n, dupStart, 1, &isDup);
+  CHKERRQ(ierr);
+  ierr = VecScatterCreate (vWorld, isWorld, *vDup, isDup, scatter);
+  CHKERRQ(ierr);
+  ISDestroy (&isWorld);
+  ISDestroy (&isDup);
+
+  return ierr;
+}
+
+// # new; Forward: vWorld to vGroup, reverse: vGroup to vWorld
+static PetscErrorCode GroupScatter (VecScatter scatter, Vec vWorld, Vec vDup,
+    Vec vGroup, InsertMode imode, ScatterMode smode) {
+  PetscErrorCode ierr = 0;
+
+  PetscScalar *vGroupp;
+  VecGetArray (vGroup, &vGroupp);
+  VecPlaceArray (vDup, vGroupp);
+  if (smode == SCATTER_FORWARD) {
+    ierr = VecScatterBegin (scatter, vWorld, vDup, imode, smode);
+    CHKERRQ(ierr);
+    ierr = VecScatterEnd (scatter, vWorld, vDup, imode, smode);
+    CHKERRQ(ierr);
+  } else {
+    ierr = VecScatterBegin (scatter, vDup, vWorld, imode, smode);
+    CHKERRQ(ierr);
+    ierr = VecScatterEnd (scatter, vDup, vWorld, imode, smode);
+    CHKERRQ(ierr);
+  }
+  VecResetArray (vDup);
+  VecRestoreArray (vGroup, &vGroupp);
+
+  return ierr;
+}
+
+// # new
+PetscInt LinearElasticity::NumLoadCaseGroups () {
+  PetscInt groups = 1;
+  PetscBool flg;
+  PetscOptionsGetInt (NULL, NULL, "-loadCaseGroups", &groups, &flg);
+
+  // The physics of a group does not split again
+  PetscMPIInt size, worldSize;
+  MPI_Comm_size (comm, &size);
+  MPI_Comm_size (PETSC_COMM_WORLD, &worldSize);
+  if (size < worldSize) return 1;
+  return PetscMax(1, PetscMin(groups, PetscMin(numLODFIX, (PetscInt) size)));
+}
+
+// # new
+PetscErrorCode
+LinearElasticity::SetUpLoadCaseGroups (DM da_nodes, PetscScalar *loadVector,
+    Vec xPassive0, Vec xPassive1, Vec xPassive2, Vec xPassive3) {
+  PetscErrorCode ierr = 0;
+
+  PetscInt groups = NumLoadCaseGroups ();
+  PetscMPIInt rank, size;
+  MPI_Comm_rank (comm, &rank);
+  MPI_Comm_size (comm, &size);
+
+  // Contiguous ranks and load cases per group
+  PetscMPIInt color = (PetscMPIInt) ((PetscInt) rank * groups / size);
+  ierr = MPI_Comm_split (comm, color, rank, &groupComm);
+  CHKERRQ(ierr);
+
+  // Nodal and element meshes of the group
+  PetscInt M, N, P;
+  DMBoundaryType bx, by, bz;
+  DMDAStencilType stype;
+  DMDAGetInfo (da_nodes, NULL, &M, &N, &P, NULL, NULL, NULL, NULL, NULL, &bx,
+      &by, &bz, &stype);
+  DM groupNodes, groupElem;
+#if DIM == 2
+  ierr = DMDACreate2d (groupComm, bx, by, stype, M, N, PETSC_DECIDE,
+      PETSC_DECIDE, 1, 1, NULL, NULL, &groupNodes);
+  CHKERRQ(ierr);
+#elif DIM == 3
+  ierr = DMDACreate3d (groupComm, bx, by, bz, stype, M, N, P, PETSC_DECIDE,
+      PETSC_DECIDE, PETSC_DECIDE, 1, 1, NULL, NULL, NULL, &groupNodes);
+  CHKERRQ(ierr);
+#endif
+  DMSetUp (groupNodes);
+#if DIM == 2
+  DMDASetUniformCoordinates (groupNodes, xc[0], xc[1], xc[2], xc[3], 0.0, 0.0);
+#elif DIM == 3
+  DMDASetUniformCoordinates (groupNodes, xc[0], xc[1], xc[2], xc[3], xc[4],
+      xc[5]);
+#endif
+  DMDASetElementType (groupNodes, DMDA_ELEMENT_Q1);
+
+  ierr = CreateElementDA (groupNodes, &groupElem);
+  CHKERRQ(ierr);
+
+  // Element vectors of the group, with the passive elements of TopOpt
+  DMCreateGlobalVector (groupElem, &(groupPassive[0]));
+  for (PetscInt i = 1; i < 4; ++i) {
+    VecDuplicate (groupPassive[0], &(groupPassive[i]));
+  }
+  VecDuplicate (groupPassive[0], &groupXPhys);
+  VecDuplicate (groupPassive[0], &groupDfdx);
+  VecDuplicateVecs (groupPassive[0], m, &groupDgdx);
+
+  DM da_elem;
+  ierr = CreateElementDA (da_nodal, &da_elem);
+  CHKERRQ(ierr);
+  ierr = CreateGroupScatter (da_elem, groupElem, xPassive0, groupPassive[0],
+      PETSC_TRUE, &elemDup, &elemScatter);
+  CHKERRQ(ierr);
+  DMDestroy (&da_elem);
+  Vec xPassive[4] = { xPassive0, xPassive1, xPassive2, xPassive3 };
+  for (PetscInt i = 0; i < 4; ++i) {
+    ierr = GroupScatter (elemScatter, xPassive[i], elemDup, groupPassive[i],
+        INSERT_VALUES, SCATTER_FORWARD);
+    CHKERRQ(ierr);
+  }
+
+  // Physics of the group, restricted to its load cases
+  group = new LinearElasticity (groupNodes, m, numDES, numLODFIX,
+      numNodeLoadAddingCounts, nu, E, loadVector, groupPassive[0],
+      groupPassive[1], groupPassive[2], groupPassive[3]);
+  group->caseBegin = color * numLODFIX / groups;
+  group->caseEnd = (color + 1) * numLODFIX / groups;
+  DMDestroy (&groupNodes);
+  DMDestroy (&groupElem);
+
+  // The state field shown in the output is the one of the last load case
+  ierr = CreateGroupScatter (da_nodal, group->da_nodal, U, group->U,
+      (PetscBool) (color == groups - 1), &nodeDup, &nodeScatter);
+  CHKERRQ(ierr);
+
+  PetscPrintf (comm, "# Load case groups (-loadCaseGroups): %i groups of "
+      "about %i ranks, %i load cases\n", groups, size / groups, numLODFIX);
+
+  return ierr;
+}
+
+// # new
+PetscErrorCode
+LinearElasticity::ComputeWithLoadCaseGroups (PetscScalar *fx, PetscScalar *gx,
+    Vec dfdx, Vec *dgdx, Vec xPhys, PetscScalar Emin, PetscScalar Emax,
+    PetscScalar penal, PetscScalar volfrac, Vec xPassive0, Vec xPassive1,
+    Vec xPassive2, Vec xPassive3) {
+  PetscErrorCode ierr = 0;
+
+  ierr = GroupScatter (elemScatter, xPhys, elemDup, groupXPhys, INSERT_VALUES,
+      SCATTER_FORWARD);
+  CHKERRQ(ierr);
+
+  // The groups solve their load cases concurrently
+  PetscScalar fxGroup;
+  ierr = group->ComputeObjectiveConstraintsSensitivities (&fxGroup, gx,
+      groupDfdx, groupDgdx, groupXPhys, Emin, Emax, penal, volfrac,
+      groupPassive[0], groupPassive[1], groupPassive[2], groupPassive[3]);
+  CHKERRQ(ierr);
+
+  // Objective summed over the groups, counted once per group
+  PetscMPIInt groupRank;
+  MPI_Comm_rank (groupComm, &groupRank);
+  PetscScalar tmp = groupRank == 0 ? fxGroup : 0.0;
+  MPI_Allreduce(&tmp, &(fx[0]), 1, MPIU_SCALAR, MPI_SUM, comm);
+
+  // Sensitivities summed over the groups, the constraints (gx from the group)
+  // are the same in every group
+  VecSet (dfdx, 0.0);
+  ierr = GroupScatter (elemScatter, dfdx, elemDup, groupDfdx, ADD_VALUES,
+      SCATTER_REVERSE);
+  CHKERRQ(ierr);
+  for (PetscInt i = 0; i < m; ++i) {
+    ierr = GroupScatter (elemScatter, dgdx[i], elemDup, groupDgdx[i],
+        INSERT_VALUES, SCATTER_REVERSE);
+    CHKERRQ(ierr);
+  }
+
+  // The markers of the passive elements were added by every group
+  PetscScalar *df, *xPassive0p, *xPassive1p, *xPassive2p, *xPassive3p;
+  PetscInt nel;
+  VecGetLocalSize (dfdx, &nel);
+  VecGetArray (dfdx, &df);
+  VecGetArray (xPassive0, &xPassive0p);
+  VecGetArray (xPassive1, &xPassive1p);
+  VecGetArray (xPassive2, &xPassive2p);
+  VecGetArray (xPassive3, &xPassive3p);
+  for (PetscInt i = 0; i < nel; i++) {
+    if (xPassive0p[i] != 0) continue;
+    if (xPassive1p[i] != 0 || xPassive2p[i] != 0 || xPassive3p[i] != 0) {
+      df[i] = -1.0E9;
+    } else {
+      df[i] = 1.0E9;
+    }
+  }
+  VecRestoreArray (dfdx, &df);
+  VecRestoreArray (xPassive0, &xPassive0p);
+  VecRestoreArray (xPassive1, &xPassive1p);
+  VecRestoreArray (xPassive2, &xPassive2p);
+  VecRestoreArray (xPassive3, &xPassive3p);
+
+  // State field of the last load case, as without groups
+  ierr = GroupScatter (nodeScatter, U, nodeDup, group->U, INSERT_VALUES,
+      SCATTER_REVERSE);
+  CHKERRQ(ierr);
+
+  // Krylov statistics, each load case is solved by one group
+  ierr = MPI_Allreduce(group->kspIterations.data (), kspIterations.data (),
+      numLODFIX, MPIU_INT, MPI_MAX, comm);
+  CHKERRQ(ierr);
+  ierr = MPI_Allreduce(group->kspResiduals.data (), kspResiduals.data (),
+      numLODFIX, MPIU_REAL, MPI_MAX, comm);
+  CHKERRQ(ierr);
+
+  return ierr;
+}
+
 PetscErrorCode
 LinearElasticity::AssembleStiffnessMatrix (Vec xPhys,
     PetscScalar Emin, PetscScalar Emax, PetscScalar penal,
@@ -987,49 +1505,20 @@ LinearElasticity::AssembleStiffnessMatrix (Vec xPhys,
   PetscScalar *xp;
   VecGetArray (xPhys, &xp);
 
-// Zero the matrix
-  MatZeroEntries (K);
-
-// # modified; Edof array
-  PetscInt edof[nedof];
-  PetscScalar ke[nedof * nedof];
-
-// # modified; Loop over elements
-  for (PetscInt i = 0; i < nel; i++) {
-    // loop over element nodes
-    for (PetscInt j = 0; j < nen; j++) {
-      // Get local dofs
-      for (PetscInt k = 0; k < DIM; k++) {
-        edof[j * DIM + k] = DIM * necon[i * nen + j] + k;
-      }
-    }
-    // Use SIMP for stiffness interpolation
-    PetscScalar dens = Emin + PetscPowScalar(xp[i], penal) * (Emax - Emin);
-    for (PetscInt k = 0; k < nedof * nedof; k++) {
-      ke[k] = KE[k] * dens;
-    }
-    // Add values to the sparse matrix
-    ierr = MatSetValuesLocal (K, nedof, edof, nedof, edof, ke, ADD_VALUES);
-    CHKERRQ(ierr);
-  }
+// # modified; Zero the matrix and add the SIMP scaled element matrices,
+// through the cached destinations of the element entries (-assemblyMap)
+  ierr = assemblyMap.Assemble (K, nel, nen, necon, DIM, KE, xp, Emin, Emax,
+      penal);
+  CHKERRQ(ierr);
   MatAssemblyBegin (K, MAT_FINAL_ASSEMBLY);
   MatAssemblyEnd (K, MAT_FINAL_ASSEMBLY);
 
-// Impose the dirichlet conditions, i.e. K = N'*K*N - (N-I)
-// 1.: K = N'*K*N
-  MatDiagonalScale (K, N[loadCondition], N[loadCondition]); // # modified
-// 2. Add ones, i.e. K = K + NI, NI = I - N
-  Vec NI;
-  VecDuplicate (N[loadCondition], &NI); // # modified
-  VecSet (NI, 1.0);
-  VecAXPY (NI, -1.0, N[loadCondition]); // # modified
-  MatDiagonalSet (K, NI, ADD_VALUES);
-
-// Zero out possible loads in the RHS that coincide
-// with Dirichlet conditions
-  VecPointwiseMult (RHS[loadCondition], RHS[loadCondition], N[loadCondition]); // # modified
-
-  VecDestroy (&NI);
+// # modified; Impose the dirichlet conditions, i.e. K = N'*K*N - (N-I), by
+// zeroing the constrained rows and columns in place; the loads on them are
+// zeroed in SetUpLoadAndBC
+  ierr = dirichlet[loadCondition].Apply (K);
+  CHKERRQ(ierr);
+
   VecRestoreArray (xPhys, &xp);
   DMDARestoreElements (da_nodal, &nel, &nen, &necon);
 
@@ -1078,14 +1567,14 @@ LinearElasticity::SetUpSolver ()
       }
 
       // PRINT TO SCREEN
-      PetscPrintf (PETSC_COMM_WORLD,
+      PetscPrintf (comm,
           "# Restarting with solution (State Vector) from "
               "(-restartFileVecSol): %s \n", restartFileVec.c_str ());
 
       // Check if files exist:
       PetscBool vecFile = fexists (restartFileVec);
       if (!vecFile) {
-        PetscPrintf (PETSC_COMM_WORLD, "File: %s NOT FOUND \n",
+        PetscPrintf (comm, "File: %s NOT FOUND \n",
             restartFileVec.c_str ());
       }
 
@@ -1093,7 +1582,7 @@ LinearElasticity::SetUpSolver ()
       if (vecFile) {
         PetscViewer view;
         // Open the data files
-        ierr = PetscViewerBinaryOpen (PETSC_COMM_WORLD,
+        ierr = PetscViewerBinaryOpen (comm,
             restartFileVec.c_str (),
             FILE_MODE_READ, &view);
 
@@ -1107,7 +1596,7 @@ LinearElasticity::SetUpSolver ()
   PC pc;
 
 // The fine grid Krylov method
-  KSPCreate (PETSC_COMM_WORLD, &(ksp));
+  KSPCreate (comm, &(ksp));
 
 // SET THE DEFAULT SOLVER PARAMETERS
 // The fine grid solver settings
@@ -1292,11 +1781,11 @@ LinearElasticity::SetUpSolver ()
   PCGetType (pc, &pctype);
   PetscInt mmax;
   KSPGetTolerances (ksp, NULL, NULL, NULL, &mmax);
-  PetscPrintf (PETSC_COMM_WORLD,
+  PetscPrintf (comm,
       "##############################################################\n");
-  PetscPrintf (PETSC_COMM_WORLD,
+  PetscPrintf (comm,
       "################# Linear solver settings #####################\n");
-  PetscPrintf (PETSC_COMM_WORLD,
+  PetscPrintf (comm,
       "# Main solver: %s, prec.: %s, maxiter.: %i \n", ksptype, pctype, mmax);
 
 // Only if pcmg is used
@@ -1313,12 +1802,12 @@ LinearElasticity::SetUpSolver ()
       PCGetType (dpc, &dpctype);
       PetscInt mmax;
       KSPGetTolerances (dksp, NULL, NULL, NULL, &mmax);
-      PetscPrintf (PETSC_COMM_WORLD,
+      PetscPrintf (comm,
           "# Level %i smoother: %s, prec.: %s, sweep: %i \n", k, dksptype,
           dpctype, mmax);
     }
   }
-  PetscPrintf (PETSC_COMM_WORLD,
+  PetscPrintf (comm,
       "##############################################################\n");
 
   return (ierr);
@@ -1833,3 +2322,5 @@ LinearElasticity::Dot (PetscScalar *v1, PetscScalar *v2,
   }
   return result;
 }
+
+TOPOPT_NAMESPACE_END // # new
@@ -6,8 +6,16 @@
 #include <math.h>
 #include <petsc.h>
 #include <petsc/private/dmdaimpl.h>
+#include <vector>
 
+#include "Physics.h" // # new; interface of the physical problems
 #include "options.h" // # new; framework options
+#include "memoryreport.h" // # new
+#include "assemblymap.h" // # new
+#include "dirichletrows.h" // # new
+#include "SymmetryPlanes.h" // # new; mirror planes of reduced models
+
+TOPOPT_NAMESPACE_BEGIN // # new
 
 /*
  Authors: Niels Aage, Erik Andreassen, Boyan Lazarov, August 2013
@@ -24,7 +32,7 @@
  * Modified by Zhidong Brian Zhang in May 2020, University of Waterloo
  */
 
-class LinearElasticity {
+class LinearElasticity : public Physics { // # modified
 
   public:
     // Constructor
@@ -63,20 +71,40 @@ class LinearElasticity {
       return (U);
     }
 
-    // Get pointer to DMDA
-    DM GetDM () {
-      return (da_nodal);
+    // # new; Keep the preconditioner of the last set up for the next solves,
+    // e.g. the realizations of the robust formulation after the blueprint
+    void SetReusePreconditioner (PetscBool reuse) {
+      reusePC = reuse;
+      if (group != NULL) {
+        group->SetReusePreconditioner (reuse);
+      }
     }
 
-    // Logical mesh
-    DM da_nodal; // Nodal mesh
+    // # new; Add the bytes of the system matrix, its multigrid hierarchy and
+    // the vectors of all load cases to the memory report
+    PetscErrorCode AccountMemory (MemoryReport *mem);
 
-    // # new; FEA with the TopOpt final results
+    // # new; FEA with the TopOpt final results for all the verification
+    // loads, one assembly and preconditioner set up for the batch
     PetscErrorCode FEAWithTopOptResults (Vec xPhys, Vec xPassive0,
-        Vec xPassive1, Vec xPassive2, Vec xPassive3, PetscInt loadConditionFEA,
+        Vec xPassive1, Vec xPassive2, Vec xPassive3, PetscInt numLoadFEA,
         PetscScalar *loadVectorFEAp);
 
+    // # new; States of the verification loads of the last
+    // FEAWithTopOptResults
+    PetscInt GetNumFEAStates () {
+      return (numFEA);
+    }
+    Vec *GetFEAStates () {
+      return (UFEA);
+    }
+
   private:
+    friend class MicroBenchmark; // # new; bench/microbench.cc
+
+    // # new; Mirror planes, zero normal displacement
+    SymmetryPlanes symmetry;
+
     // Logical mesh
     PetscInt nn[DIM]; // # modified; Number of nodes in each direction
     PetscInt ne[DIM]; // # modified; Number of elements in each direction
@@ -85,6 +113,8 @@ class LinearElasticity {
     // Linear algebra
     Mat K; // Global stiffness matrix
     Vec U; // # modified; Displacement vector
+    Vec *UFEA; // # new; Displacement of each verification load
+    PetscInt numFEA; // # new; Number of verification loads in UFEA
     Vec *RHS; // # modified; Load vector
     Vec *N; // # modified; Dirichlet vector (used when imposing BCs)
 #if DIM == 2  // # new
@@ -96,6 +126,7 @@ class LinearElasticity {
 
     // Solver
     KSP ksp; // Pointer to the KSP object i.e. the linear solver+prec
+    PetscBool reusePC; // # new; see SetReusePreconditioner
     PetscInt nlvls;
     PetscScalar nu; // Possions ratio
     PetscScalar E; // Young's modulus
@@ -111,11 +142,20 @@ class LinearElasticity {
 
     // Number of constraints
     PetscInt m; // # new
+    PetscScalar **dgp; // # new; the arrays of dgdx, see GetArrays
+    AssemblyMap assemblyMap; // # new; cached element assembly of K
+    DirichletRows *dirichlet; // # new; constrained dofs of each load case
+
+    // # new; Nodal mesh, element stiffness matrix and state field
+    PetscErrorCode SetUpMesh (DM da_nodes);
 
     // Set up the FE mesh, data structures, and load and boundary conditions
     PetscErrorCode SetUpLoadAndBC (DM da_nodes, Vec xPassive0, Vec xPassive1,
         Vec xPassive2, Vec xPassive3, PetscInt loadCondition); // # modified
 
+    // # new; Only the load of a load case, in rhs, see FEAWithTopOptResults
+    PetscErrorCode SetUpLoad (Vec xPassive3, PetscInt loadCondition, Vec rhs);
+
     // Solve the FE problem
     PetscErrorCode SolveState (Vec xPhys, PetscScalar Emin, PetscScalar Emax,
         PetscScalar penal, PetscInt loadCondition); // # modified
@@ -127,6 +167,28 @@ class LinearElasticity {
     // Start the solver
     PetscErrorCode SetUpSolver ();
 
+    // # new; Concurrent load cases (-loadCaseGroups <g>): the ranks are split
+    // into g groups, each solving a contiguous range of the load cases on its
+    // own copy of the mesh and solver. This object then has no matrix or
+    // solver: it only scatters xPhys to the group and sums the sensitivities
+    // back
+    MPI_Comm comm; // communicator of the mesh
+    PetscInt caseBegin, caseEnd; // load cases solved by this object
+    LinearElasticity *group; // physics of this rank's group, or NULL
+    MPI_Comm groupComm;
+    Vec groupPassive[4], groupXPhys, groupDfdx, *groupDgdx;
+    Vec elemDup, nodeDup; // the group vectors on comm, see GroupScatter
+    VecScatter elemScatter; // element vectors, to/from every group
+    VecScatter nodeScatter; // state field, from the group of the last case
+
+    PetscInt NumLoadCaseGroups (); // 1 without groups
+    PetscErrorCode SetUpLoadCaseGroups (DM da_nodes, PetscScalar *loadVector,
+        Vec xPassive0, Vec xPassive1, Vec xPassive2, Vec xPassive3);
+    PetscErrorCode ComputeWithLoadCaseGroups (PetscScalar *fx, PetscScalar *gx,
+        Vec dfdx, Vec *dgdx, Vec xPhys, PetscScalar Emin, PetscScalar Emax,
+        PetscScalar penal, PetscScalar volfrac, Vec xPassive0, Vec xPassive1,
+        Vec xPassive2, Vec xPassive3);
+
 #if DIM == 2    // # new
     // Routine that doesn't change the element type upon repeated calls
     PetscErrorCode DMDAGetElements_2D (DM dm, PetscInt *nel, PetscInt *nen,
@@ -170,4 +232,6 @@ class LinearElasticity {
     }
 };
 
+TOPOPT_NAMESPACE_END // # new
+
 #endif
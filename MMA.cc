@@ -1,8 +1,26 @@
 
 #include "MMA.h"
+#include "petscutils.h" // # new; GetArrays
 #include <iostream>
 #include <math.h>
 
+// # new; Store a value in the precision of the state, rounded down or up so
+// that the asymptotes and move limits never move towards the design
+static inline void StoreDown(PetscScalar* p, PetscScalar v) { *p = v; }
+static inline void StoreUp(PetscScalar* p, PetscScalar v) { *p = v; }
+static inline void StoreDown(float* p, PetscScalar v) {
+    *p = (float)v;
+    if (*p > v) {
+        *p = nextafterf(*p, -HUGE_VALF);
+    }
+}
+static inline void StoreUp(float* p, PetscScalar v) {
+    *p = (float)v;
+    if (*p < v) {
+        *p = nextafterf(*p, HUGE_VALF);
+    }
+}
+
 MMA::MMA(PetscInt nn, PetscInt mm, PetscInt kk, Vec xo1t, Vec xo2t, Vec Ut, Vec Lt, PetscScalar* at, PetscScalar* ct,
          PetscScalar* dt) {
     n = nn;
@@ -31,62 +49,19 @@ MMA::MMA(PetscInt nn, PetscInt mm, PetscInt kk, Vec xo1t, Vec xo2t, Vec Ut, Vec
     y   = new PetscScalar[m];
     lam = new PetscScalar[m];
 
-    VecDuplicate(xo1t, &L);
-    VecDuplicate(xo1t, &U);
-
-    VecDuplicate(xo1t, &alpha);
-    VecDuplicate(xo1t, &beta);
-
-    VecDuplicate(xo1t, &p0);
-    VecDuplicate(xo1t, &q0);
-    VecDuplicateVecs(xo1t, m, &pij);
-    VecDuplicateVecs(xo1t, m, &qij);
+    AllocateState(xo1t); // # modified; Vecs or float storage (-mmaFloat)
 
     b = new PetscScalar[m];
 
-    VecDuplicate(xo1t, &xo1);
-    VecDuplicate(xo1t, &xo2);
-
     grad = new PetscScalar[m];
     mu   = new PetscScalar[m];
     s    = new PetscScalar[2 * m];
 
     Hess = new PetscScalar[m * m];
+    AllocateScratch(); // # new
 
     // Now insert the values into xo1,xo2,U,L
-    PetscInt nloc;
-    VecGetLocalSize(xo1t, &nloc);
-
-    // input
-    PetscScalar *pxo1t, *pxo2t, *pUt, *pLt;
-    VecGetArray(xo1t, &pxo1t);
-    VecGetArray(xo2t, &pxo2t);
-    VecGetArray(Ut, &pUt);
-    VecGetArray(Lt, &pLt);
-
-    // internal
-    PetscScalar *pxo1, *pxo2, *pU, *pL;
-    VecGetArray(xo1, &pxo1);
-    VecGetArray(xo2, &pxo2);
-    VecGetArray(U, &pU);
-    VecGetArray(L, &pL);
-
-    // Copy data
-    memcpy(pxo1, pxo1t, nloc * sizeof(PetscScalar));
-    memcpy(pxo2, pxo2t, nloc * sizeof(PetscScalar));
-    memcpy(pU, pUt, nloc * sizeof(PetscScalar));
-    memcpy(pL, pLt, nloc * sizeof(PetscScalar));
-
-    // Restore arrays
-    VecRestoreArray(xo1t, &pxo1t);
-    VecRestoreArray(xo2t, &pxo2t);
-    VecRestoreArray(Ut, &pUt);
-    VecRestoreArray(Lt, &pLt);
-
-    VecRestoreArray(xo1, &pxo1);
-    VecRestoreArray(xo2, &pxo2);
-    VecRestoreArray(U, &pU);
-    VecRestoreArray(L, &pL);
+    CopyState(xo1t, xo2t, Ut, Lt, PETSC_TRUE); // # modified
 }
 
 MMA::MMA(PetscInt nn, PetscInt mm, PetscInt kk, Vec xo1t, Vec xo2t, Vec Ut, Vec Lt) {
@@ -118,62 +93,19 @@ MMA::MMA(PetscInt nn, PetscInt mm, PetscInt kk, Vec xo1t, Vec xo2t, Vec Ut, Vec
     y   = new PetscScalar[m];
     lam = new PetscScalar[m];
 
-    VecDuplicate(xo1t, &L);
-    VecDuplicate(xo1t, &U);
-
-    VecDuplicate(xo1t, &alpha);
-    VecDuplicate(xo1t, &beta);
-
-    VecDuplicate(xo1t, &p0);
-    VecDuplicate(xo1t, &q0);
-    VecDuplicateVecs(xo1t, m, &pij);
-    VecDuplicateVecs(xo1t, m, &qij);
+    AllocateState(xo1t); // # modified; Vecs or float storage (-mmaFloat)
 
     b = new PetscScalar[m];
 
-    VecDuplicate(xo1t, &xo1);
-    VecDuplicate(xo1t, &xo2);
-
     grad = new PetscScalar[m];
     mu   = new PetscScalar[m];
     s    = new PetscScalar[2 * m];
 
     Hess = new PetscScalar[m * m];
+    AllocateScratch(); // # new
 
     // Now insert the values into xo1,xo2,U,L
-    PetscInt nloc;
-    VecGetLocalSize(xo1t, &nloc);
-
-    // input
-    PetscScalar *pxo1t, *pxo2t, *pUt, *pLt;
-    VecGetArray(xo1t, &pxo1t);
-    VecGetArray(xo2t, &pxo2t);
-    VecGetArray(Ut, &pUt);
-    VecGetArray(Lt, &pLt);
-
-    // internal
-    PetscScalar *pxo1, *pxo2, *pU, *pL;
-    VecGetArray(xo1, &pxo1);
-    VecGetArray(xo2, &pxo2);
-    VecGetArray(U, &pU);
-    VecGetArray(L, &pL);
-
-    // Copy data
-    memcpy(pxo1, pxo1t, nloc * sizeof(PetscScalar));
-    memcpy(pxo2, pxo2t, nloc * sizeof(PetscScalar));
-    memcpy(pU, pUt, nloc * sizeof(PetscScalar));
-    memcpy(pL, pLt, nloc * sizeof(PetscScalar));
-
-    // Restore arrays
-    VecRestoreArray(xo1t, &pxo1t);
-    VecRestoreArray(xo2t, &pxo2t);
-    VecRestoreArray(Ut, &pUt);
-    VecRestoreArray(Lt, &pLt);
-
-    VecRestoreArray(xo1, &pxo1);
-    VecRestoreArray(xo2, &pxo2);
-    VecRestoreArray(U, &pU);
-    VecRestoreArray(L, &pL);
+    CopyState(xo1t, xo2t, Ut, Lt, PETSC_TRUE); // # modified
 }
 
 MMA::MMA(PetscInt nn, PetscInt mm, Vec x, PetscScalar* at, PetscScalar* ct, PetscScalar* dt) {
@@ -201,27 +133,16 @@ MMA::MMA(PetscInt nn, PetscInt mm, Vec x, PetscScalar* at, PetscScalar* ct, Pets
     y   = new PetscScalar[m];
     lam = new PetscScalar[m];
 
-    VecDuplicate(x, &L);
-    VecDuplicate(x, &U);
-
-    VecDuplicate(x, &alpha);
-    VecDuplicate(x, &beta);
-
-    VecDuplicate(x, &p0);
-    VecDuplicate(x, &q0);
-    VecDuplicateVecs(x, m, &pij);
-    VecDuplicateVecs(x, m, &qij);
+    AllocateState(x); // # modified; Vecs or float storage (-mmaFloat)
 
     b = new PetscScalar[m];
 
-    VecDuplicate(x, &xo1);
-    VecDuplicate(x, &xo2);
-
     grad = new PetscScalar[m];
     mu   = new PetscScalar[m];
     s    = new PetscScalar[2 * m];
 
     Hess = new PetscScalar[m * m];
+    AllocateScratch(); // # new
 }
 
 MMA::MMA(PetscInt nn, PetscInt mm, Vec x) {
@@ -252,26 +173,16 @@ MMA::MMA(PetscInt nn, PetscInt mm, Vec x) {
     y   = new PetscScalar[m];
     lam = new PetscScalar[m];
 
-    VecDuplicate(x, &L);
-    VecDuplicate(x, &U);
-
-    VecDuplicate(x, &alpha);
-    VecDuplicate(x, &beta);
+    AllocateState(x); // # modified; Vecs or float storage (-mmaFloat)
 
-    VecDuplicate(x, &p0);
-    VecDuplicate(x, &q0);
-    VecDuplicateVecs(x, m, &pij);
-    VecDuplicateVecs(x, m, &qij);
     b = new PetscScalar[m];
 
-    VecDuplicate(x, &xo1);
-    VecDuplicate(x, &xo2);
-
     grad = new PetscScalar[m];
     mu   = new PetscScalar[m];
     s    = new PetscScalar[2 * m];
 
     Hess = new PetscScalar[m * m];
+    AllocateScratch(); // # new
 }
 
 MMA::~MMA() {
@@ -282,20 +193,164 @@ MMA::~MMA() {
     delete[] d;
     delete[] y;
     delete[] lam;
-    VecDestroy(&L);
-    VecDestroy(&U);
-    VecDestroy(&alpha);
-    VecDestroy(&beta);
-    VecDestroy(&p0);
-    VecDestroy(&q0);
-    VecDestroyVecs(m, &pij);
-    VecDestroyVecs(m, &qij);
-    VecDestroy(&xo1);
-    VecDestroy(&xo2);
+    if (!singleStorage) { // # modified; the float storage frees itself
+        VecDestroy(&L);
+        VecDestroy(&U);
+        VecDestroy(&alpha);
+        VecDestroy(&beta);
+        VecDestroy(&p0);
+        VecDestroy(&q0);
+        VecDestroyVecs(m, &pij);
+        VecDestroyVecs(m, &qij);
+        VecDestroy(&xo1);
+        VecDestroy(&xo2);
+    }
     delete[] grad;
     delete[] mu;
     delete[] s;
     delete[] Hess;
+    // # new
+    delete[] PQ;
+    delete[] res;
+    delete[] pijv;
+    delete[] qijv;
+    delete[] dgdxv;
+}
+
+// # new
+void MMA::AllocateScratch() {
+    PQ    = new PetscScalar[m];
+    res   = new PetscScalar[2 * m];
+    pijv  = new PetscScalar*[m];
+    qijv  = new PetscScalar*[m];
+    dgdxv = new PetscScalar*[m];
+}
+
+// # new
+void MMA::AllocateState(Vec x) {
+    singleStorage = PETSC_FALSE;
+    PetscBool flg;
+    PetscOptionsGetBool(NULL, NULL, "-mmaFloat", &singleStorage, &flg);
+    VecGetLocalSize(x, &nloc);
+    if (!singleStorage) {
+        VecDuplicate(x, &L);
+        VecDuplicate(x, &U);
+        VecDuplicate(x, &alpha);
+        VecDuplicate(x, &beta);
+        VecDuplicate(x, &p0);
+        VecDuplicate(x, &q0);
+        VecDuplicateVecs(x, m, &pij);
+        VecDuplicateVecs(x, m, &qij);
+        VecDuplicate(x, &xo1);
+        VecDuplicate(x, &xo2);
+        return;
+    }
+    L = U = alpha = beta = p0 = q0 = xo1 = xo2 = NULL;
+    pij = qij = NULL;
+    // L, U, alpha, beta, p0, q0, xo1, xo2, then pij and qij
+    fstore.assign((8 + 2 * m) * nloc, 0.0f);
+    fpij.resize(m);
+    fqij.resize(m);
+    for (PetscInt j = 0; j < m; j++) {
+        fpij[j] = fstore.data() + (8 + j) * nloc;
+        fqij[j] = fstore.data() + (8 + m + j) * nloc;
+    }
+}
+
+// # new
+PetscErrorCode MMA::GetState(State<PetscScalar>& st) {
+    PetscErrorCode ierr = 0;
+    VecGetArray(L, &st.L);
+    VecGetArray(U, &st.U);
+    VecGetArray(alpha, &st.alpha);
+    VecGetArray(beta, &st.beta);
+    VecGetArray(p0, &st.p0);
+    VecGetArray(q0, &st.q0);
+    VecGetArray(xo1, &st.xo1);
+    VecGetArray(xo2, &st.xo2);
+    GetArrays(pij, m, pijv);
+    GetArrays(qij, m, qijv);
+    st.pij = pijv;
+    st.qij = qijv;
+    return ierr;
+}
+
+// # new
+PetscErrorCode MMA::RestoreState(State<PetscScalar>& st) {
+    PetscErrorCode ierr = 0;
+    VecRestoreArray(L, &st.L);
+    VecRestoreArray(U, &st.U);
+    VecRestoreArray(alpha, &st.alpha);
+    VecRestoreArray(beta, &st.beta);
+    VecRestoreArray(p0, &st.p0);
+    VecRestoreArray(q0, &st.q0);
+    VecRestoreArray(xo1, &st.xo1);
+    VecRestoreArray(xo2, &st.xo2);
+    RestoreArrays(pij, m, pijv);
+    RestoreArrays(qij, m, qijv);
+    return ierr;
+}
+
+// # new
+PetscErrorCode MMA::GetState(State<float>& st) {
+    float* f = fstore.data();
+    st.L     = f;
+    st.U     = f + nloc;
+    st.alpha = f + 2 * nloc;
+    st.beta  = f + 3 * nloc;
+    st.p0    = f + 4 * nloc;
+    st.q0    = f + 5 * nloc;
+    st.xo1   = f + 6 * nloc;
+    st.xo2   = f + 7 * nloc;
+    st.pij   = fpij.data();
+    st.qij   = fqij.data();
+    return 0;
+}
+
+// # new
+PetscErrorCode MMA::RestoreState(State<float>&) { return 0; }
+
+// # new
+PetscErrorCode MMA::CopyState(Vec xo1t, Vec xo2t, Vec Ut, Vec Lt, PetscBool toState) {
+    PetscErrorCode ierr = 0;
+    Vec            ext[4] = {xo1t, xo2t, Ut, Lt};
+    PetscScalar*   pext[4];
+    ierr = GetArrays(ext, 4, pext);
+    CHKERRQ(ierr);
+    if (singleStorage) {
+        State<float> st;
+        GetState(st);
+        for (PetscInt i = 0; i < nloc; i++) {
+            if (toState) {
+                st.xo1[i] = pext[0][i];
+                st.xo2[i] = pext[1][i];
+                StoreUp(&st.U[i], pext[2][i]);
+                StoreDown(&st.L[i], pext[3][i]);
+            } else {
+                pext[0][i] = st.xo1[i];
+                pext[1][i] = st.xo2[i];
+                pext[2][i] = st.U[i];
+                pext[3][i] = st.L[i];
+            }
+        }
+    } else {
+        Vec          own[4] = {xo1, xo2, U, L};
+        PetscScalar* pown[4];
+        ierr = GetArrays(own, 4, pown);
+        CHKERRQ(ierr);
+        for (PetscInt v = 0; v < 4; v++) {
+            if (toState) {
+                memcpy(pown[v], pext[v], nloc * sizeof(PetscScalar));
+            } else {
+                memcpy(pext[v], pown[v], nloc * sizeof(PetscScalar));
+            }
+        }
+        ierr = RestoreArrays(own, 4, pown);
+        CHKERRQ(ierr);
+    }
+    ierr = RestoreArrays(ext, 4, pext);
+    CHKERRQ(ierr);
+    return ierr;
 }
 
 // restart method
@@ -305,39 +360,8 @@ PetscErrorCode MMA::Restart(Vec xo1t, Vec xo2t, Vec Ut, Vec Lt) {
     PetscErrorCode ierr = 0;
 
     // Insert values into xo1t,xo2t,Ut,Lt
-    PetscInt nloc;
-    VecGetLocalSize(xo1t, &nloc);
-
-    // input
-    PetscScalar *pxo1t, *pxo2t, *pUt, *pLt;
-    VecGetArray(xo1t, &pxo1t);
-    VecGetArray(xo2t, &pxo2t);
-    VecGetArray(Ut, &pUt);
-    VecGetArray(Lt, &pLt);
-
-    // internal
-    PetscScalar *pxo1, *pxo2, *pU, *pL;
-    VecGetArray(xo1, &pxo1);
-    VecGetArray(xo2, &pxo2);
-    VecGetArray(U, &pU);
-    VecGetArray(L, &pL);
-
-    // Copy data
-    memcpy(pxo1t, pxo1, nloc * sizeof(PetscScalar));
-    memcpy(pxo2t, pxo2, nloc * sizeof(PetscScalar));
-    memcpy(pUt, pU, nloc * sizeof(PetscScalar));
-    memcpy(pLt, pL, nloc * sizeof(PetscScalar));
-
-    // Restore arrays
-    VecRestoreArray(xo1t, &pxo1t);
-    VecRestoreArray(xo2t, &pxo2t);
-    VecRestoreArray(Ut, &pUt);
-    VecRestoreArray(Lt, &pLt);
-
-    VecRestoreArray(xo1, &pxo1);
-    VecRestoreArray(xo2, &pxo2);
-    VecRestoreArray(U, &pU);
-    VecRestoreArray(L, &pL);
+    ierr = CopyState(xo1t, xo2t, Ut, Lt, PETSC_FALSE); // # modified
+    CHKERRQ(ierr);
 
     return (ierr);
 }
@@ -419,7 +443,7 @@ PetscErrorCode MMA::KKTresidual(Vec x, Vec dfdx, PetscScalar* fx, Vec* dgdx, Vec
         return -1;
     }
 
-    PetscScalar *xp, *xminp, *xmaxp, *df0dxp, **dfdxp;
+    PetscScalar *xp, *xminp, *xmaxp, *df0dxp, **dfdxp = dgdxv; // # modified
     PetscInt     locsiz;
     VecGetLocalSize(x, &locsiz);
 
@@ -427,7 +451,7 @@ PetscErrorCode MMA::KKTresidual(Vec x, Vec dfdx, PetscScalar* fx, Vec* dgdx, Vec
     VecGetArray(xmin, &xminp);
     VecGetArray(xmax, &xmaxp);
     VecGetArray(dfdx, &df0dxp);
-    VecGetArrays(dgdx, m, &dfdxp);
+    GetArrays(dgdx, m, dfdxp); // # modified
 
     PetscScalar resi, ri, mu_min, mu_max;
 
@@ -461,7 +485,7 @@ PetscErrorCode MMA::KKTresidual(Vec x, Vec dfdx, PetscScalar* fx, Vec* dgdx, Vec
     VecRestoreArray(xmin, &xminp);
     VecRestoreArray(xmax, &xmaxp);
     VecRestoreArray(dfdx, &df0dxp);
-    VecRestoreArrays(dgdx, m, &dfdxp);
+    RestoreArrays(dgdx, m, dfdxp); // # modified
     PetscScalar n2tmp = norm2[0];
     PetscScalar nItmp = normInf[0];
     norm2[0]          = 0.0;
@@ -493,8 +517,20 @@ PetscErrorCode MMA::Update(Vec xval, Vec dfdx, PetscScalar* gx, Vec* dgdx, Vec x
     GenSub(xval, dfdx, gx, dgdx, xmin, xmax);
 
     // Update xolds
-    VecCopy(xo1, xo2);
-    VecCopy(xval, xo1);
+    if (singleStorage) { // # new
+        State<float> st;
+        GetState(st);
+        memcpy(st.xo2, st.xo1, nloc * sizeof(float));
+        const PetscScalar* xv;
+        VecGetArrayRead(xval, &xv);
+        for (PetscInt i = 0; i < nloc; i++) {
+            st.xo1[i] = xv[i];
+        }
+        VecRestoreArrayRead(xval, &xv);
+    } else {
+        VecCopy(xo1, xo2);
+        VecCopy(xval, xo1);
+    }
 
     // Solve the dual with an interior point method
     SolveDIP(xval);
@@ -503,7 +539,9 @@ PetscErrorCode MMA::Update(Vec xval, Vec dfdx, PetscScalar* gx, Vec* dgdx, Vec x
 
 // PRIVATE METHODS
 
-PetscErrorCode MMA::GenSub(Vec xval, Vec dfdx, PetscScalar* gx, Vec* dgdx, Vec xmin, Vec xmax) {
+// # modified; on the Vecs (T = PetscScalar) or the float storage
+template <typename T>
+PetscErrorCode MMA::GenSubT(Vec xval, Vec dfdx, PetscScalar* gx, Vec* dgdx, Vec xmin, Vec xmax) {
     PetscErrorCode ierr = 0;
 
     PetscScalar gamma, helpvar;
@@ -511,31 +549,25 @@ PetscErrorCode MMA::GenSub(Vec xval, Vec dfdx, PetscScalar* gx, Vec* dgdx, Vec x
     k++;
     PetscInt nloc;
     VecGetLocalSize(xval, &nloc);
-    PetscScalar *xv, *Lv, *Uv, *x1v, *x2v, *xminv, *xmaxv;
-    PetscScalar *alf, *bet, *dfdxv, *p0v, *q0v, **dgdxv, **pijv, **qijv;
-    if (k < 3) {
-        VecAXPBYPCZ(L, (PetscScalar)1.0, -asyminit, (PetscScalar)0.0, xval, xmax);
-        VecAXPY(L, asyminit, xmin);
-        VecAXPBYPCZ(U, (PetscScalar)1.0, +asyminit, (PetscScalar)0.0, xval, xmax);
-        VecAXPY(U, -asyminit, xmin);
-    }
+    PetscScalar *xv, *xminv, *xmaxv, *dfdxv; // # modified
     VecGetArray(xval, &xv);
-    VecGetArray(L, &Lv);
-    VecGetArray(U, &Uv);
-    VecGetArray(xo1, &x1v);
-    VecGetArray(xo2, &x2v);
     VecGetArray(xmin, &xminv);
     VecGetArray(xmax, &xmaxv);
-
-    VecGetArray(alpha, &alf);
-    VecGetArray(beta, &bet);
     VecGetArray(dfdx, &dfdxv);
-    VecGetArray(p0, &p0v);
-    VecGetArray(q0, &q0v);
 
-    VecGetArrays(dgdx, m, &dgdxv);
-    VecGetArrays(pij, m, &pijv);
-    VecGetArrays(qij, m, &qijv);
+    State<T> st; // # modified
+    GetState(st);
+    T *Lv = st.L, *Uv = st.U, *x1v = st.xo1, *x2v = st.xo2;
+    T *alf = st.alpha, *bet = st.beta, *p0v = st.p0, *q0v = st.q0;
+    T **pijs = st.pij, **qijs = st.qij;
+
+    GetArrays(dgdx, m, dgdxv); // # modified
+    if (k < 3) {
+        for (PetscInt i = 0; i < nloc; i++) { // # modified
+            StoreDown(&Lv[i], xv[i] - asyminit * xmaxv[i] + asyminit * xminv[i]);
+            StoreUp(&Uv[i], xv[i] + asyminit * xmaxv[i] - asyminit * xminv[i]);
+        }
+    }
     if (k > 2) {
         for (PetscInt i = 0; i < nloc; i++) {
             helpvar = (xv[i] - x1v[i]) * (x1v[i] - x2v[i]);
@@ -546,38 +578,40 @@ PetscErrorCode MMA::GenSub(Vec xval, Vec dfdx, PetscScalar* gx, Vec* dgdx, Vec x
             } else {
                 gamma = 1.0;
             }
-            Lv[i] = xv[i] - gamma * (x1v[i] - Lv[i]);
-            Uv[i] = xv[i] + gamma * (Uv[i] - x1v[i]);
+            PetscScalar Li = xv[i] - gamma * (x1v[i] - Lv[i]); // # modified
+            PetscScalar Ui = xv[i] + gamma * (Uv[i] - x1v[i]);
             PetscScalar xmi, xma;
             xmi = Max(1.0e-5, xmaxv[i] - xminv[i]);
             if (RobustAsymptotesType == 0) {
-                Lv[i] = Max(Lv[i], xv[i] - 10.0 * xmi);
-                Lv[i] = Min(Lv[i], xv[i] - 0.01 * xmi);
-                Uv[i] = Max(Uv[i], xv[i] + 0.01 * xmi);
-                Uv[i] = Min(Uv[i], xv[i] + 10.0 * xmi);
+                Li = Max(Li, xv[i] - 10.0 * xmi);
+                Li = Min(Li, xv[i] - 0.01 * xmi);
+                Ui = Max(Ui, xv[i] + 0.01 * xmi);
+                Ui = Min(Ui, xv[i] + 10.0 * xmi);
             } else if (RobustAsymptotesType == 1) {
-                Lv[i] = Max(Lv[i], xv[i] - 100.0 * xmi);
-                Lv[i] = Min(Lv[i], xv[i] - 1.0e-4 * xmi);
-                Uv[i] = Max(Uv[i], xv[i] + 1.0e-4 * xmi);
-                Uv[i] = Min(Uv[i], xv[i] + 100.0 * xmi);
-                xmi   = xminv[i] - 1.0e-5;
-                xma   = xmaxv[i] + 1.0e-5;
+                Li  = Max(Li, xv[i] - 100.0 * xmi);
+                Li  = Min(Li, xv[i] - 1.0e-4 * xmi);
+                Ui  = Max(Ui, xv[i] + 1.0e-4 * xmi);
+                Ui  = Min(Ui, xv[i] + 100.0 * xmi);
+                xmi = xminv[i] - 1.0e-5;
+                xma = xmaxv[i] + 1.0e-5;
                 if (xv[i] < xmi) {
-                    Lv[i] = xv[i] - (xma - xv[i]) / 0.9;
-                    Uv[i] = xv[i] + (xma - xv[i]) / 0.9;
+                    Li = xv[i] - (xma - xv[i]) / 0.9;
+                    Ui = xv[i] + (xma - xv[i]) / 0.9;
                 }
                 if (xv[i] > xma) {
-                    Lv[i] = xv[i] - (xv[i] - xmi) / 0.9;
-                    Uv[i] = xv[i] + (xv[i] - xmi) / 0.9;
+                    Li = xv[i] - (xv[i] - xmi) / 0.9;
+                    Ui = xv[i] + (xv[i] - xmi) / 0.9;
                 }
             }
+            StoreDown(&Lv[i], Li); // # modified
+            StoreUp(&Uv[i], Ui);
         }
     }
     PetscScalar dfdxp, dfdxm;
     PetscScalar feps = 1.0e-6;
     for (PetscInt i = 0; i < nloc; i++) {
-        alf[i] = Max(xminv[i], 0.9 * Lv[i] + 0.1 * xv[i]);
-        bet[i] = Min(xmaxv[i], 0.9 * Uv[i] + 0.1 * xv[i]);
+        StoreUp(&alf[i], Max(xminv[i], 0.9 * Lv[i] + 0.1 * xv[i])); // # modified
+        StoreDown(&bet[i], Min(xmaxv[i], 0.9 * Uv[i] + 0.1 * xv[i]));
         dfdxp  = Max(0.0, dfdxv[i]);
         dfdxm  = Max(0.0, -1.0 * dfdxv[i]);
         p0v[i] = pow(Uv[i] - xv[i], 2.0) * (dfdxp + 0.001 * Abs(dfdxv[i]) + 0.5 * feps / (Uv[i] - Lv[i]));
@@ -586,52 +620,44 @@ PetscErrorCode MMA::GenSub(Vec xval, Vec dfdx, PetscScalar* gx, Vec* dgdx, Vec x
             dfdxp = Max(0.0, dgdxv[j][i]);
             dfdxm = Max(0.0, -1.0 * dgdxv[j][i]);
             if (constraintModification) {
-                pijv[j][i] =
+                pijs[j][i] =
                     pow(Uv[i] - xv[i], 2.0) * (dfdxp + 0.001 * Abs(dgdxv[j][i]) + 0.5 * feps / (Uv[i] - Lv[i]));
-                qijv[j][i] =
+                qijs[j][i] =
                     pow(xv[i] - Lv[i], 2.0) * (dfdxm + 0.001 * Abs(dgdxv[j][i]) + 0.5 * feps / (Uv[i] - Lv[i]));
             } else {
-                pijv[j][i] = pow(Uv[i] - xv[i], 2.0) * (dfdxp);
-                qijv[j][i] = pow(xv[i] - Lv[i], 2.0) * (dfdxm);
+                pijs[j][i] = pow(Uv[i] - xv[i], 2.0) * (dfdxp);
+                qijs[j][i] = pow(xv[i] - Lv[i], 2.0) * (dfdxm);
             }
         }
     }
     for (PetscInt j = 0; j < m; j++) {
         b[j] = 0.0;
         for (PetscInt i = 0; i < nloc; i++) {
-            b[j] += pijv[j][i] / (Uv[i] - xv[i]) + qijv[j][i] / (xv[i] - Lv[i]);
-        }
-    }
-    {
-        PetscScalar* tmp = new PetscScalar[m];
-        for (PetscInt i = 0; i < m; i++) {
-            tmp[i] = 0.0;
+            b[j] += pijs[j][i] / (Uv[i] - xv[i]) + qijs[j][i] / (xv[i] - Lv[i]);
         }
-        MPI_Allreduce(b, tmp, m, MPIU_SCALAR, MPI_SUM, PETSC_COMM_WORLD);
-        memcpy(b, tmp, sizeof(PetscScalar) * m);
-        delete[] tmp;
     }
+    MPI_Allreduce(MPI_IN_PLACE, b, m, MPIU_SCALAR, MPI_SUM, PETSC_COMM_WORLD); // # modified
     for (PetscInt j = 0; j < m; j++) {
         b[j] += -gx[j];
     }
     VecRestoreArray(xval, &xv);
-    VecRestoreArray(L, &Lv);
-    VecRestoreArray(U, &Uv);
-    VecRestoreArray(xo1, &x1v);
-    VecRestoreArray(xo2, &x2v);
     VecRestoreArray(xmin, &xminv);
     VecRestoreArray(xmax, &xmaxv);
-
-    VecRestoreArray(alpha, &alf);
-    VecRestoreArray(beta, &bet);
     VecRestoreArray(dfdx, &dfdxv);
 
-    VecRestoreArrays(dgdx, m, &dgdxv);
-    VecRestoreArrays(pij, m, &pijv);
-    VecRestoreArrays(qij, m, &qijv);
+    RestoreArrays(dgdx, m, dgdxv); // # modified
+    RestoreState(st);
     return ierr;
 }
 
+// # new
+PetscErrorCode MMA::GenSub(Vec xval, Vec dfdx, PetscScalar* gx, Vec* dgdx, Vec xmin, Vec xmax) {
+    if (singleStorage) {
+        return GenSubT<float>(xval, dfdx, gx, dgdx, xmin, xmax);
+    }
+    return GenSubT<PetscScalar>(xval, dfdx, gx, dgdx, xmin, xmax);
+}
+
 PetscErrorCode MMA::SolveDIP(Vec x) {
     PetscErrorCode ierr = 0;
 
@@ -671,21 +697,19 @@ PetscErrorCode MMA::SolveDIP(Vec x) {
     return ierr;
 }
 
-PetscErrorCode MMA::XYZofLAMBDA(Vec x) {
+// # modified; on the Vecs (T = PetscScalar) or the float storage
+template <typename T>
+PetscErrorCode MMA::XYZofLAMBDAT(Vec x) {
     PetscErrorCode ierr = 0;
 
     PetscInt nloc;
     VecGetLocalSize(x, &nloc);
-    PetscScalar *xv, **pijv, **qijv, *p0v, *q0v, *alf, *bet, *Lv, *Uv;
+    PetscScalar* xv; // # modified
     VecGetArray(x, &xv);
-    VecGetArray(p0, &p0v);
-    VecGetArray(q0, &q0v);
-    VecGetArray(alpha, &alf);
-    VecGetArray(beta, &bet);
-    VecGetArrays(pij, m, &pijv);
-    VecGetArrays(qij, m, &qijv);
-    VecGetArray(L, &Lv);
-    VecGetArray(U, &Uv);
+    State<T> st;
+    GetState(st);
+    T *p0v = st.p0, *q0v = st.q0, *alf = st.alpha, *bet = st.beta, *Lv = st.L, *Uv = st.U;
+    T **pijs = st.pij, **qijs = st.qij;
     PetscScalar lamai = 0.0;
     for (PetscInt i = 0; i < m; i++) {
         if (lam[i] < 0.0) {
@@ -700,8 +724,8 @@ PetscErrorCode MMA::XYZofLAMBDA(Vec x) {
         pjlam = p0v[i];
         qjlam = q0v[i];
         for (PetscInt j = 0; j < m; j++) {
-            pjlam += pijv[j][i] * lam[j];
-            qjlam += qijv[j][i] * lam[j];
+            pjlam += pijs[j][i] * lam[j];
+            qjlam += qijs[j][i] * lam[j];
         }
         xv[i] = (sqrt(pjlam) * Lv[i] + sqrt(qjlam) * Uv[i]) / (sqrt(pjlam) + sqrt(qjlam));
         if (xv[i] < alf[i]) {
@@ -712,113 +736,85 @@ PetscErrorCode MMA::XYZofLAMBDA(Vec x) {
         }
     }
     VecRestoreArray(x, &xv);
-    VecRestoreArrays(pij, m, &pijv);
-    VecRestoreArrays(qij, m, &qijv);
-    VecRestoreArray(p0, &p0v);
-    VecRestoreArray(q0, &q0v);
-    VecRestoreArray(alpha, &alf);
-    VecRestoreArray(beta, &bet);
-    VecRestoreArray(L, &Lv);
-    VecRestoreArray(U, &Uv);
+    RestoreState(st); // # modified
     return ierr;
 }
 
-PetscErrorCode MMA::DualGrad(Vec x) {
+// # new
+PetscErrorCode MMA::XYZofLAMBDA(Vec x) {
+    return singleStorage ? XYZofLAMBDAT<float>(x) : XYZofLAMBDAT<PetscScalar>(x);
+}
+
+// # modified; on the Vecs (T = PetscScalar) or the float storage
+template <typename T>
+PetscErrorCode MMA::DualGradT(Vec x) {
     PetscErrorCode ierr = 0;
 
     PetscInt nloc;
     VecGetLocalSize(x, &nloc);
-    PetscScalar *xv, *Lv, *Uv, **pijv, **qijv;
+    PetscScalar* xv; // # modified
     VecGetArray(x, &xv);
-    VecGetArrays(pij, m, &pijv);
-    VecGetArrays(qij, m, &qijv);
-    VecGetArray(L, &Lv);
-    VecGetArray(U, &Uv);
+    State<T> st;
+    GetState(st);
+    T *Lv = st.L, *Uv = st.U, **pijs = st.pij, **qijs = st.qij;
     for (PetscInt j = 0; j < m; j++) {
         grad[j] = 0.0;
         for (PetscInt i = 0; i < nloc; i++) {
-            grad[j] += pijv[j][i] / (Uv[i] - xv[i]) + qijv[j][i] / (xv[i] - Lv[i]);
+            grad[j] += pijs[j][i] / (Uv[i] - xv[i]) + qijs[j][i] / (xv[i] - Lv[i]);
         }
     }
-    {
-        PetscScalar* tmp = new PetscScalar[m];
-        for (PetscInt i = 0; i < m; i++) {
-            tmp[i] = 0.0;
-        }
-        MPI_Allreduce(grad, tmp, m, MPIU_SCALAR, MPI_SUM, PETSC_COMM_WORLD);
-        memcpy(grad, tmp, sizeof(PetscScalar) * m);
-        delete[] tmp;
-    }
+    MPI_Allreduce(MPI_IN_PLACE, grad, m, MPIU_SCALAR, MPI_SUM, PETSC_COMM_WORLD); // # modified
     for (PetscInt j = 0; j < m; j++) {
         grad[j] += -b[j] - a[j] * z - y[j];
     }
     VecRestoreArray(x, &xv);
-    VecRestoreArrays(pij, m, &pijv);
-    VecRestoreArrays(qij, m, &qijv);
-    VecRestoreArray(L, &Lv);
-    VecRestoreArray(U, &Uv);
+    RestoreState(st); // # modified
     return ierr;
 }
 
-PetscErrorCode MMA::DualHess(Vec x) {
+// # new
+PetscErrorCode MMA::DualGrad(Vec x) { return singleStorage ? DualGradT<float>(x) : DualGradT<PetscScalar>(x); }
+
+// # modified; on the Vecs (T = PetscScalar) or the float storage
+template <typename T>
+PetscErrorCode MMA::DualHessT(Vec x) {
     PetscErrorCode ierr = 0;
 
     PetscInt nloc;
     VecGetLocalSize(x, &nloc);
-    PetscScalar *xv, *Lv, *Uv, **pijv, **qijv, *alf, *bet, *p0v, *q0v;
+    PetscScalar* xv; // # modified
     VecGetArray(x, &xv);
-    VecGetArrays(pij, m, &pijv);
-    VecGetArrays(qij, m, &qijv);
-    VecGetArray(L, &Lv);
-    VecGetArray(U, &Uv);
-    VecGetArray(alpha, &alf);
-    VecGetArray(beta, &bet);
-    VecGetArray(p0, &p0v);
-    VecGetArray(q0, &q0v);
-    PetscScalar* df2 = new PetscScalar[nloc];
-    PetscScalar* PQ  = new PetscScalar[nloc * m];
-    PetscScalar  pjlam, qjlam;
+    State<T> st;
+    GetState(st);
+    T *Lv = st.L, *Uv = st.U, *alf = st.alpha, *bet = st.beta, *p0v = st.p0, *q0v = st.q0;
+    T **pijs = st.pij, **qijs = st.qij;
+    // # modified; Hess = PQ' diag(df2) PQ accumulated element by element, PQ
+    // holds the m entries of the current element
+    for (PetscInt i = 0; i < m * m; i++) {
+        Hess[i] = 0.0;
+    }
+    PetscScalar pjlam, qjlam, df2;
     for (PetscInt i = 0; i < nloc; i++) {
         pjlam = p0v[i];
         qjlam = q0v[i];
         for (PetscInt j = 0; j < m; j++) {
-            pjlam += pijv[j][i] * lam[j];
-            qjlam += qijv[j][i] * lam[j];
-            PQ[i * m + j] = pijv[j][i] / pow(Uv[i] - xv[i], 2.0) - qijv[j][i] / pow(xv[i] - Lv[i], 2.0);
+            pjlam += pijs[j][i] * lam[j];
+            qjlam += qijs[j][i] * lam[j];
+            PQ[j] = pijs[j][i] / pow(Uv[i] - xv[i], 2.0) - qijs[j][i] / pow(xv[i] - Lv[i], 2.0);
         }
-        df2[i]         = -1.0 / (2.0 * pjlam / pow(Uv[i] - xv[i], 3.0) + 2.0 * qjlam / pow(xv[i] - Lv[i], 3.0));
+        df2            = -1.0 / (2.0 * pjlam / pow(Uv[i] - xv[i], 3.0) + 2.0 * qjlam / pow(xv[i] - Lv[i], 3.0));
         PetscScalar xp = (sqrt(pjlam) * Lv[i] + sqrt(qjlam) * Uv[i]) / (sqrt(pjlam) + sqrt(qjlam));
-        if (xp < alf[i]) {
-            df2[i] = 0.0;
-        }
-        if (xp > bet[i]) {
-            df2[i] = 0.0;
-        }
-    }
-    PetscScalar* tmp = new PetscScalar[n * m];
-    for (PetscInt j = 0; j < m; j++) {
-        for (PetscInt i = 0; i < nloc; i++) {
-            tmp[j * nloc + i] = 0.0;
-            tmp[j * nloc + i] += PQ[i * m + j] * df2[i];
+        if (xp < alf[i] || xp > bet[i]) {
+            continue;
         }
-    }
-    for (PetscInt i = 0; i < m; i++) {
         for (PetscInt j = 0; j < m; j++) {
-            Hess[i * m + j] = 0.0;
-            for (PetscInt k = 0; k < nloc; k++) {
-                Hess[i * m + j] += tmp[i * nloc + k] * PQ[k * m + j];
+            PetscScalar PQdf2 = PQ[j] * df2;
+            for (PetscInt k = 0; k < m; k++) {
+                Hess[j * m + k] += PQdf2 * PQ[k];
             }
         }
     }
-    {
-        PetscScalar* tmpp = new PetscScalar[m * m];
-        for (PetscInt i = 0; i < m * m; i++) {
-            tmpp[i] = Hess[i];
-        }
-        MPI_Allreduce(Hess, tmpp, m * m, MPIU_SCALAR, MPI_SUM, PETSC_COMM_WORLD);
-        memcpy(Hess, tmpp, sizeof(PetscScalar) * m * m);
-        delete[] tmpp;
-    }
+    MPI_Allreduce(MPI_IN_PLACE, Hess, m * m, MPIU_SCALAR, MPI_SUM, PETSC_COMM_WORLD); // # modified
     PetscScalar lamai = 0.0;
     for (PetscInt j = 0; j < m; j++) {
         if (lam[j] < 0.0) {
@@ -849,20 +845,13 @@ PetscErrorCode MMA::DualHess(Vec x) {
         Hess[i * m + i] += HessCorr;
     }
     VecRestoreArray(x, &xv);
-    VecRestoreArrays(pij, m, &pijv);
-    VecRestoreArrays(qij, m, &qijv);
-    VecRestoreArray(L, &Lv);
-    VecRestoreArray(U, &Uv);
-    VecRestoreArray(q0, &q0v);
-    VecRestoreArray(p0, &p0v);
-    VecRestoreArray(alpha, &alf);
-    VecRestoreArray(beta, &bet);
-    delete[] df2;
-    delete[] PQ;
-    delete[] tmp;
+    RestoreState(st); // # modified
     return ierr;
 }
 
+// # new
+PetscErrorCode MMA::DualHess(Vec x) { return singleStorage ? DualHessT<float>(x) : DualHessT<PetscScalar>(x); }
+
 PetscErrorCode MMA::DualLineSearch() {
     PetscErrorCode ierr = 0;
 
@@ -883,33 +872,43 @@ PetscErrorCode MMA::DualLineSearch() {
     return ierr;
 }
 
-PetscScalar MMA::DualResidual(Vec x, PetscScalar epsi) {
+// # new
+PetscErrorCode MMA::AccountMemory(MemoryReport* mem) {
+    PetscErrorCode ierr = 0;
+    // xo1, xo2, L, U, alpha, beta, p0, q0 and pij, qij per constraint
+    PetscLogDouble vecs = fstore.capacity() * sizeof(float); // # modified; -mmaFloat
+    if (!singleStorage) {
+        vecs = MemoryReport::VecBytes(xo1) + MemoryReport::VecBytes(xo2) + MemoryReport::VecBytes(L) +
+               MemoryReport::VecBytes(U) + MemoryReport::VecBytes(alpha) + MemoryReport::VecBytes(beta) +
+               MemoryReport::VecBytes(p0) + MemoryReport::VecBytes(q0) + MemoryReport::VecsBytes(pij, m) +
+               MemoryReport::VecsBytes(qij, m);
+    }
+    // a, c, d, y, lam, mu, b, grad (m each), s (2m) and Hess (m*m); scratch
+    // PQ (m) and res (2m)
+    PetscLogDouble dense = (13.0 * m + m * m) * sizeof(PetscScalar);
+    mem->Add("MMA vectors", vecs + dense);
+    return ierr;
+}
+
+// # modified; on the Vecs (T = PetscScalar) or the float storage
+template <typename T>
+PetscScalar MMA::DualResidualT(Vec x, PetscScalar epsi) {
 
     PetscInt nloc;
     VecGetLocalSize(x, &nloc);
-    PetscScalar* res = new PetscScalar[2 * m];
-    PetscScalar *xv, *Lv, *Uv, **pijv, **qijv;
+    PetscScalar* xv; // # modified
     VecGetArray(x, &xv);
-    VecGetArrays(pij, m, &pijv);
-    VecGetArrays(qij, m, &qijv);
-    VecGetArray(L, &Lv);
-    VecGetArray(U, &Uv);
+    State<T> st;
+    GetState(st);
+    T *Lv = st.L, *Uv = st.U, **pijs = st.pij, **qijs = st.qij;
     for (PetscInt j = 0; j < m; j++) {
         res[j]     = 0.0;
         res[j + m] = 0.0;
         for (PetscInt i = 0; i < nloc; i++) {
-            res[j] += pijv[j][i] / (Uv[i] - xv[i]) + qijv[j][i] / (xv[i] - Lv[i]);
+            res[j] += pijs[j][i] / (Uv[i] - xv[i]) + qijs[j][i] / (xv[i] - Lv[i]);
         }
     }
-    {
-        PetscScalar* tmp = new PetscScalar[2 * m];
-        for (PetscInt i = 0; i < 2 * m; i++) {
-            tmp[i] = 0.0;
-        }
-        MPI_Allreduce(res, tmp, 2 * m, MPIU_SCALAR, MPI_SUM, PETSC_COMM_WORLD);
-        memcpy(res, tmp, sizeof(PetscScalar) * 2 * m);
-        delete[] tmp;
-    }
+    MPI_Allreduce(MPI_IN_PLACE, res, 2 * m, MPIU_SCALAR, MPI_SUM, PETSC_COMM_WORLD); // # modified
     for (PetscInt j = 0; j < m; j++) {
         res[j] += -b[j] - a[j] * z - y[j] + mu[j];
         res[j + m] += mu[j] * lam[j] - epsi;
@@ -920,15 +919,16 @@ PetscScalar MMA::DualResidual(Vec x, PetscScalar epsi) {
             nrI = Abs(res[i]);
         }
     }
-    delete[] res;
     VecRestoreArray(x, &xv);
-    VecRestoreArrays(pij, m, &pijv);
-    VecRestoreArrays(qij, m, &qijv);
-    VecRestoreArray(L, &Lv);
-    VecRestoreArray(U, &Uv);
+    RestoreState(st); // # modified
     return nrI;
 }
 
+// # new
+PetscScalar MMA::DualResidual(Vec x, PetscScalar epsi) {
+    return singleStorage ? DualResidualT<float>(x, epsi) : DualResidualT<PetscScalar>(x, epsi);
+}
+
 PetscErrorCode MMA::Factorize(PetscScalar* K, PetscInt nn) {
     PetscErrorCode ierr = 0;
 
@@ -2,6 +2,12 @@
 #define __MMA__
 
 #include <petsc.h>
+#include "memoryreport.h" // # new
+#include <vector>         // # new
+
+// # new; Micro-benchmarks of each dimension, see dispatch.cc
+namespace topopt_d2 { class MicroBenchmark; }
+namespace topopt_d3 { class MicroBenchmark; }
 
 /*
 Copyright (C) 2013-2019, Niels Aage
@@ -52,7 +58,13 @@ class MMA {
     // PETSc!!!!!
     PetscScalar DesignChange(Vec x, Vec xold);
 
+    // # new; Add the bytes of the MMA vectors to the memory report
+    PetscErrorCode AccountMemory(MemoryReport* mem);
+
   private:
+    friend class topopt_d2::MicroBenchmark; // # new; bench/microbench.cc of
+    friend class topopt_d3::MicroBenchmark; // each dimension
+
     // Set up the MMA subproblem based on old x's and xval
     PetscErrorCode GenSub(Vec xval, Vec dfdx, PetscScalar* gx, Vec* dgdx, Vec xmin, Vec xmax);
 
@@ -109,6 +121,43 @@ class MMA {
     // Global: Old design variables
     Vec xo1, xo2;
 
+    // # new; Local scratch of the dual solver, allocated once by the
+    // constructors: PQ (m), res (2m), and the arrays of pij, qij and dgdx
+    PetscScalar *PQ, *res;
+    PetscScalar **pijv, **qijv, **dgdxv;
+    void AllocateScratch();
+
+    // # new; Single precision storage (-mmaFloat): L, U, alpha, beta, p0,
+    // q0, pij, qij, xo1 and xo2 are float arrays instead of Vecs, i.e. half
+    // the bytes per design variable; all arithmetic stays in PetscScalar and
+    // the asymptotes and move limits are rounded away from the design
+    PetscBool          singleStorage;
+    PetscInt           nloc;
+    std::vector<float> fstore;
+    std::vector<float*> fpij, fqij;
+
+    // # new; Arrays of the state, from the Vecs or the float storage
+    template <typename T> struct State {
+        T *L, *U, *alpha, *beta, *p0, *q0, *xo1, *xo2;
+        T **pij, **qij;
+    };
+    void           AllocateState(Vec x);
+    PetscErrorCode GetState(State<PetscScalar>& st);
+    PetscErrorCode RestoreState(State<PetscScalar>& st);
+    PetscErrorCode GetState(State<float>& st);
+    PetscErrorCode RestoreState(State<float>& st);
+
+    // # new; Copy xo1, xo2, U, L from (toState) or to restart vectors
+    PetscErrorCode CopyState(Vec xo1t, Vec xo2t, Vec Ut, Vec Lt, PetscBool toState);
+
+    // # new; The subproblem and the dual solver on either storage
+    template <typename T>
+    PetscErrorCode GenSubT(Vec xval, Vec dfdx, PetscScalar* gx, Vec* dgdx, Vec xmin, Vec xmax);
+    template <typename T> PetscErrorCode XYZofLAMBDAT(Vec x);
+    template <typename T> PetscErrorCode DualGradT(Vec x);
+    template <typename T> PetscErrorCode DualHessT(Vec x);
+    template <typename T> PetscScalar    DualResidualT(Vec x, PetscScalar epsi);
+
     // Math helpers
     PetscErrorCode Factorize(PetscScalar* K, PetscInt nn);
     PetscErrorCode Solve(PetscScalar* K, PetscScalar* x, PetscInt nn);
@@ -2,6 +2,9 @@
 #include "MPIIO.h"
 #include <cstdlib> // To get the exit function
 #include <iostream>
+#include "SymmetryPlanes.h" // # new
+
+TOPOPT_NAMESPACE_BEGIN // # new
 
 /* -----------------------------------------------------------------------------
  Authors: Niels Aage, Erik Andreassen, Boyan Lazarov, August 2013
@@ -33,10 +36,18 @@
 // Constructor
 #define _NO_SUCH_FILE 35
 
-MPIIO::MPIIO (DM da_nodes, int nPf, std::string pnames, int nCf, std::string cnames) {
+MPIIO::MPIIO (DM da_nodes, int nPf, std::string pnames, int nCf, std::string cnames, std::string name) { // # modified
+
+  // # new; bytes written by this rank
+  bytesWritten = 0;
 
   // User defined string
   std::string infoString = "TopOpt result version 1.1";
+  // # new; Mirror planes of a reduced model, read by bin2vtu.py
+  SymmetryPlanes symmetry;
+  if (symmetry.Active ()) {
+    infoString.append (" symmetry " + symmetry.Describe ());
+  }
   // Maximum number of points per element
 #if DIM == 2  // # new
   int nPEl = 4; // 2D includes 4 nodes per element
@@ -92,7 +103,7 @@ MPIIO::MPIIO (DM da_nodes, int nPf, std::string pnames, int nCf, std::string cna
   nCellsMyrank[0] = nel; // We have this number from when we called DMDAGetElements_2D/DMDAGetElements_3D
 
   // --------- Allocate the output object: -------
-  Allocate (infoString, nDom, nPFields, nCFields, nPointsMyrank, nCellsMyrank, nPEl, pFieldNames, cFieldNames);
+  Allocate (infoString, nDom, nPFields, nCFields, nPointsMyrank, nCellsMyrank, nPEl, pFieldNames, cFieldNames, name); // # modified
 
   // Write the points (or coordinates of the points)
   float *pointsDomain0 = new float[3 * nPointsMyrank[0]]; // always use "3" because point data in VTK All point data must use 3 coordinates
@@ -176,6 +187,17 @@ MPIIO::MPIIO (DM da_nodes, int nPf, std::string pnames, int nCf, std::string cna
   delete[] cellsTypes0;
 }
 
+// # new
+PetscErrorCode MPIIO::AccountMemory (MemoryReport *mem) {
+  PetscErrorCode ierr = 0;
+  PetscLogDouble work = (nPointsMyrank[0] * nPFields[0]
+      + nCellsMyrank[0] * nCFields[0]) * (PetscLogDouble) sizeof(float);
+  PetscLogDouble counts = (4.0 * nDom * ncpu + 2.0 * nDom)
+      * sizeof(unsigned long int);
+  mem->Add ("MPIIO work buffers", work + counts);
+  return ierr;
+}
+
 // Destructor
 MPIIO::~MPIIO () {
   // Delete the allocated arrays
@@ -193,6 +215,19 @@ MPIIO::~MPIIO () {
 }
 
 PetscErrorCode MPIIO::WriteVTK (DM da_nodes, Vec U, Vec nodeDensity, Vec x, Vec xTilde, Vec xPhys, Vec xPassive0, Vec xPassive1,Vec xPassive2, Vec xPassive3, PetscInt itr) {
+  // # modified; A single state
+  return WriteVTK (da_nodes, 1, &U, nodeDensity, x, xTilde, xPhys, xPassive0,
+      xPassive1, xPassive2, xPassive3, itr);
+}
+
+PetscErrorCode MPIIO::WriteVTK (DM da_nodes, PetscInt nStates, Vec *U,
+    Vec nodeDensity, Vec x, Vec xTilde, Vec xPhys, Vec xPassive0,
+    Vec xPassive1, Vec xPassive2, Vec xPassive3, PetscInt itr) { // # new
+
+  if (3 * nStates + 1 != nPFields[0]) { // # new
+    abort ("Point fields do not match the number of states",
+        "MPIIO:WriteVTK");
+  }
 
   // Here we only have one "timestep" (no optimization)
   unsigned long int timestep = itr;
@@ -200,24 +235,63 @@ PetscErrorCode MPIIO::WriteVTK (DM da_nodes, Vec U, Vec nodeDensity, Vec x, Vec
   PetscErrorCode ierr;
 
   // POINT FIELD(S)
+  // # new; Dofs per node of the state, 1 for linear heat conduction
+  PetscInt dof;
+  ierr = DMDAGetInfo (da_nodes, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &dof,
+      NULL, NULL, NULL, NULL, NULL);
+  CHKERRQ(ierr);
+
   // Displacement
   Vec Ulocal;
-  DMCreateLocalVector (da_nodes, &Ulocal);
+  DMGetLocalVector (da_nodes, &Ulocal); // # modified; work vector of the DM
   ierr = VecSet (Ulocal, 0.0);
   CHKERRQ(ierr);
-  // Update the local vector from global solution
-  ierr = DMGlobalToLocalBegin (da_nodes, U, INSERT_VALUES, Ulocal);
-  CHKERRQ(ierr);
-  ierr = DMGlobalToLocalEnd (da_nodes, U, INSERT_VALUES, Ulocal);
-  CHKERRQ(ierr);
   // We need a pointer to the local vector
   PetscScalar *UlocalPointer;
-  ierr = VecGetArray (Ulocal, &UlocalPointer);
-  CHKERRQ(ierr);
+
+  // # modified; The 3 components of each state
+  for (PetscInt k = 0; k < nStates; ++k) {
+    // Update the local vector from global solution
+    ierr = DMGlobalToLocalBegin (da_nodes, U[k], INSERT_VALUES, Ulocal);
+    CHKERRQ(ierr);
+    ierr = DMGlobalToLocalEnd (da_nodes, U[k], INSERT_VALUES, Ulocal);
+    CHKERRQ(ierr);
+    ierr = VecGetArray (Ulocal, &UlocalPointer);
+    CHKERRQ(ierr);
+    float *Uk = workPointField + 3 * k * nPointsMyrank[0];
+
+    if (dof > 1) { // # modified
+      for (unsigned long int i = 0; i < nPointsMyrank[0]; i++) {
+        // Ux
+        Uk[i] = float (UlocalPointer[DIM * i]);
+        // Uy
+        Uk[i + nPointsMyrank[0]] = float (UlocalPointer[DIM * i + 1]);
+#if DIM == 2   // # new
+        // Uz fake, because all point data must use 3 coordinates in VTK files
+        Uk[i + 2 * nPointsMyrank[0]] = float (0.0);
+#elif DIM == 3
+        // Uz
+        Uk[i + 2 * nPointsMyrank[0]] = float (UlocalPointer[DIM * i + 2]);
+#endif
+      }
+    } else { // # new
+      for (unsigned long int i = 0; i < nPointsMyrank[0]; i++) {
+        // Ux
+        Uk[i] = float (UlocalPointer[i]);
+        // Uy and Uz fake, because all point data must use 3 coordinates in
+        // VTK files
+        Uk[i + nPointsMyrank[0]] = float (0.0);
+        Uk[i + 2 * nPointsMyrank[0]] = float (0.0);
+      }
+    }
+    // Restore Ulocal array
+    ierr = VecRestoreArray (Ulocal, &UlocalPointer);
+    CHKERRQ(ierr);
+  }
 
   // Node density
   Vec NDlocal;
-  DMCreateLocalVector (da_nodes, &NDlocal);
+  DMGetLocalVector (da_nodes, &NDlocal); // # modified
   ierr = VecSet (NDlocal, 0.0);
   CHKERRQ(ierr);
   // Update the local vector from global solution
@@ -230,43 +304,12 @@ PetscErrorCode MPIIO::WriteVTK (DM da_nodes, Vec U, Vec nodeDensity, Vec x, Vec
   ierr = VecGetArray (NDlocal, &NDlocalPointer);
   CHKERRQ(ierr);
 
-#if PHYSICS == 0 || PHYSICS == 1
-  for (unsigned long int i = 0; i < nPointsMyrank[0]; i++) {
-    // Ux
-    workPointField[i] = float (UlocalPointer[DIM * i]);
-    // Uy
-    workPointField[i + nPointsMyrank[0]] = float (UlocalPointer[DIM * i + 1]);
-#if DIM == 2   // # new
-    // Uz fake, because all point data must use 3 coordinates in VTK files
-    workPointField[i + 2 * nPointsMyrank[0]] = float (0.0);
-#elif DIM == 3
-    // Uz
-    workPointField[i + 2 * nPointsMyrank[0]] = float (UlocalPointer[DIM * i + 2]);
-#endif
-    // Node density
-    workPointField[i + 3 * nPointsMyrank[0]] = float (NDlocalPointer[DIM * i]);
-  }
-#elif PHYSICS == 2   // # new
+  float *ND = workPointField + 3 * nStates * nPointsMyrank[0]; // # new
   for (unsigned long int i = 0; i < nPointsMyrank[0]; i++) {
-    // Ux
-    workPointField[i] = float (UlocalPointer[i]);
-    // Uy
-    workPointField[i + nPointsMyrank[0]] = float (0.0);
-#if DIM == 2
-    // Uz fake, because all point data must use 3 coordinates in VTK files
-    workPointField[i + 2 * nPointsMyrank[0]] = float (0.0);
-#elif DIM == 3
-    // Uz
-    workPointField[i + 2 * nPointsMyrank[0]] = float (0.0);
-#endif
     // Node density
-    workPointField[i + 3 * nPointsMyrank[0]] = float (NDlocalPointer[i]);
+    ND[i] = float (NDlocalPointer[dof * i]); // # modified
   }
-#endif
   writePointFields (timestep, 0, workPointField);
-  // Restore Ulocal array
-  ierr = VecRestoreArray (Ulocal, &UlocalPointer);
-  CHKERRQ(ierr);
   ierr = VecRestoreArray (NDlocal, &NDlocalPointer);
   CHKERRQ(ierr);
 
@@ -303,9 +346,9 @@ PetscErrorCode MPIIO::WriteVTK (DM da_nodes, Vec U, Vec nodeDensity, Vec x, Vec
   VecRestoreArray (xPassive3, &xPassive3p); // # new
 
   // clean up
-  ierr = VecDestroy (&Ulocal);
+  ierr = DMRestoreLocalVector (da_nodes, &Ulocal); // # modified
   CHKERRQ(ierr);
-  ierr = VecDestroy (&NDlocal);  // # new
+  ierr = DMRestoreLocalVector (da_nodes, &NDlocal); // # modified
   CHKERRQ(ierr);  // # new
 
   return ierr;
@@ -314,7 +357,7 @@ PetscErrorCode MPIIO::WriteVTK (DM da_nodes, Vec U, Vec nodeDensity, Vec x, Vec
 void MPIIO::Allocate (std::string info, const int nDom, const int nPFields[],
     const int nCFields[], unsigned long int nPointsMyrank[],
     unsigned long int nCellsMyrank[], unsigned long int nodesPerElement,
-    std::string pFNames, std::string cFNames) //, std::string filename)
+    std::string pFNames, std::string cFNames, std::string name) // # modified
     /*  info = string with user defined info
      nDom = number of domains
      nPFields = array with number of point fields in each domain (the number
@@ -325,10 +368,11 @@ void MPIIO::Allocate (std::string info, const int nDom, const int nPFields[],
      thread=Myrank nCellsMyrank = array with number of cells in each domain in
      thread=Myrank nodesPerElement = (max) number of nodes per element. filename =
      name of output file (default = "output.dat")
+     name = stem of the file name (# new)
      */
     {
   // default name
-  std::string filename = "output_00000.dat";
+  std::string filename = name + "_00000.dat"; // # modified
 
   // Check PETSc input for a work directory
   char filenameChar[PETSC_MAX_PATH_LEN];
@@ -340,7 +384,7 @@ void MPIIO::Allocate (std::string info, const int nDom, const int nPFields[],
   if (flg) {
     filename = "";
     filename.append (filenameChar);
-    filename.append ("/output.dat");
+    filename.append ("/" + name + ".dat"); // # modified
   }
 
   PetscPrintf (PETSC_COMM_WORLD,
@@ -454,6 +498,7 @@ void MPIIO::Allocate (std::string info, const int nDom, const int nPFields[],
     if (ierror) {
       abort ("Problems writing to file", "MPIIO::MPIIO");
     }
+    bytesWritten += MPI_CS * info.size (); // # new
     // Set view
     offset += MPI_CS * info.size (); // Adjust offset
     ierror = MPI_File_set_view (fh, offset, MPI_UNSIGNED_LONG,
@@ -467,6 +512,7 @@ void MPIIO::Allocate (std::string info, const int nDom, const int nPFields[],
     if (ierror) {
       abort ("Problems writing to file", "MPIIO::MPIIO");
     }
+    bytesWritten += MPI_IS * headerLen; // # new
     // Set view
     offset += MPI_IS * headerLen; // Adjust offset
     ierror = MPI_File_set_view (fh, offset, MPI_CHAR, MPI_CHAR,
@@ -481,6 +527,7 @@ void MPIIO::Allocate (std::string info, const int nDom, const int nPFields[],
     // Write to the file
     ierror = MPI_File_write (fh, (char*) pFNames.c_str (), pFNames.size (),
     MPI_CHAR, MPI_STATUS_IGNORE);
+    bytesWritten += MPI_CS * pFNames.size (); // # new
     // Close the file (I don't think we need a barrier here)
     ierror = MPI_File_close (&fh);
     if (ierror) {
@@ -527,6 +574,7 @@ void MPIIO::writePoints (int domain, float coordinates[])
   if (ierror) {
     abort ("Problems writing to file", "MPIIO::writePoints");
   }
+  bytesWritten += MPI_FS * len; // # new
   // Close the file (I don't think we need a barrier here)
   ierror = MPI_File_close (&fh);
   if (ierror) {
@@ -595,6 +643,7 @@ void MPIIO::writeCells (int domain, unsigned long int elements[],
   if (ierror) {
     abort ("Problems writing ELEMENTS to file", "MPIIO::writeCells");
   }
+  bytesWritten += MPI_IS * len; // # new
 
   // Write the VTK OFFSET
   // Update the write offset
@@ -619,6 +668,7 @@ void MPIIO::writeCells (int domain, unsigned long int elements[],
   // write the offset list
   ierror = MPI_File_write_all (fh, cellsOffset0, len, MPI_UNSIGNED_LONG,
   MPI_STATUS_IGNORE);
+  bytesWritten += MPI_IS * len; // # new
 
   // Write the VTK ELEMENT TYPE
   // First jump past ALL the offsets
@@ -633,6 +683,7 @@ void MPIIO::writeCells (int domain, unsigned long int elements[],
   // write the type list to file
   ierror = MPI_File_write_all (fh, cellsTypes0, len, MPI_UNSIGNED_LONG,
   MPI_STATUS_IGNORE);
+  bytesWritten += MPI_IS * len; // # new
 
   // Close the file (I don't think we need a barrier here)
   ierror = MPI_File_close (&fh);
@@ -709,6 +760,7 @@ void MPIIO::writePointFields (unsigned long int timeStep, int domain,
       if (ierror) {
         abort ("Problems writing to file", "MPIIO::writePointFields");
       }
+      bytesWritten += MPI_IS; // # new
       // Close the file
       ierror = MPI_File_close (&fh);
       if (ierror) {
@@ -760,6 +812,7 @@ void MPIIO::writePointFields (unsigned long int timeStep, int domain,
   if (ierror) {
     abort ("Problems writing to file", "MPIIO::writePointFields");
   }
+  bytesWritten += MPI_FS * count * blocklength; // # new
   // Close the file
   ierror = MPI_File_close (&fh);
   if (ierror) {
@@ -842,6 +895,7 @@ void MPIIO::writeCellFields (int domain, float fields[])
   if (ierror) {
     abort ("Problems writing to file", "MPIIO::writeCellFields");
   }
+  bytesWritten += MPI_FS * count * blocklength; // # new
   // Close the file
   ierror = MPI_File_close (&fh);
   if (ierror) {
@@ -986,3 +1040,5 @@ PetscErrorCode MPIIO::DMDAGetElements_3D (DM dm, PetscInt *nel, PetscInt *nen,
   return (0);
 }
 #endif
+
+TOPOPT_NAMESPACE_END // # new
@@ -10,6 +10,9 @@
 #include <string>
 
 #include "options.h" // # new; framework options
+#include "memoryreport.h" // # new
+
+TOPOPT_NAMESPACE_BEGIN // # new
 
 /* -----------------------------------------------------------------------------
  Authors: Niels Aage, Erik Andreassen, Boyan Lazarov, August 2013
@@ -42,7 +45,7 @@ class MPIIO {
     // ------------- METHODS ------------------------------------------
 
     MPIIO (DM da_nodes, int nPfields, std::string pnames, int nCfields,
-        std::string cnames);
+        std::string cnames, std::string name = "output"); // # modified
     ~MPIIO ();
 
     // NOT CLEAN INTERFACE: REPLACE BY STD::PAIR OR SUCH !!!!!!
@@ -50,6 +53,20 @@ class MPIIO {
         Vec xTilde, Vec xPhys, Vec xPassive0, Vec xPassive1, Vec xPassive2, Vec xPassive3,
         PetscInt itr);  // # modified
 
+    // # new; One step with the 3 components of each of the nStates states,
+    // e.g. the verification loads, then the node density as point fields
+    PetscErrorCode WriteVTK (DM da_nodes, PetscInt nStates, Vec *U,
+        Vec nodeDen, Vec x, Vec xTilde, Vec xPhys, Vec xPassive0,
+        Vec xPassive1, Vec xPassive2, Vec xPassive3, PetscInt itr);
+
+    // # new; Bytes written by this rank since construction
+    unsigned long int GetBytesWritten () {
+      return bytesWritten;
+    }
+
+    // # new; Add the bytes of the work buffers to the memory report
+    PetscErrorCode AccountMemory (MemoryReport *mem);
+
   private:
     // -------------- METHODS -----------------------------------------
 
@@ -70,11 +87,13 @@ class MPIIO {
     bool firstFieldOutputDone; //!< Will be set to true after first field output
     std::string filename; //!< Output filename
     MPI_File fh; //!< Filehandle
+    unsigned long int bytesWritten; //!< # new; Bytes written by this rank
 
     void Allocate (std::string info, const int nDom, const int nPFields[],
         const int nCFields[], unsigned long int nPointsMyrank[],
         unsigned long int nCellsMyrank[], unsigned long int nodesPerElement,
-        std::string pFNames, std::string cFNames);
+        std::string pFNames, std::string cFNames,
+        std::string name); // # modified
     // std::string filename = "/home/naage/PETSc/output2.dat");
 
     void writePoints (int domain, float coordinates[]);
@@ -177,4 +196,6 @@ class MPIIO {
  @endcode
  */
 
+TOPOPT_NAMESPACE_END // # new
+
 #endif
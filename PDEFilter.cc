@@ -2,6 +2,10 @@
 //#include "TopOpt.h"
 //#include <petsc-private/dmdaimpl.h>
 #include <petsc/private/dmdaimpl.h>
+#include "SymmetryPlanes.h" // # new
+
+TOPOPT_NAMESPACE_BEGIN // # new
+
 /* -----------------------------------------------------------------------------
  Authors: Niels Aage, Erik Andreassen, Boyan Lazarov, August 2013
  Updated: June 2019, Niels Aage
@@ -80,9 +84,14 @@ PDEFilt::PDEFilt (DM da_nodes, PetscScalar rmin) {
         xc[3] = ne[1] * N;
     }
 
-    // Create the nodal mesh
-    DMDACreate2d(PETSC_COMM_WORLD, bx, by, stype, nn[0], nn[1], PETSC_DECIDE, PETSC_DECIDE,
-                 numnodaldof, stencilwidth, 0, 0, &(da_nodal));
+    // # modified; Create the nodal mesh with the partition of da_nodes, which
+    // may be occupancy weighted (-balanceDomain)
+    PetscInt mdn, ndn;
+    const PetscInt *lxn, *lyn;
+    DMDAGetInfo(da_nodes, NULL, NULL, NULL, NULL, &mdn, &ndn, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+    DMDAGetOwnershipRanges(da_nodes, &lxn, &lyn, NULL);
+    DMDACreate2d(PETSC_COMM_WORLD, bx, by, stype, nn[0], nn[1], mdn, ndn,
+                 numnodaldof, stencilwidth, lxn, lyn, &(da_nodal));
     // Initialize
     DMSetFromOptions(da_nodal);
     DMSetUp(da_nodal);
@@ -177,10 +186,15 @@ PDEFilt::PDEFilt (DM da_nodes, PetscScalar rmin) {
     xc[5] = ne[2] * P;
   }
 
-  // Create the nodal mesh
-  DMDACreate3d (PETSC_COMM_WORLD, bx, by, bz, stype, nn[0], nn[1], nn[2],
-  PETSC_DECIDE, PETSC_DECIDE, PETSC_DECIDE, numnodaldof, stencilwidth, 0, 0, 0,
-      &(da_nodal));
+  // # modified; Create the nodal mesh with the partition of da_nodes, which
+  // may be occupancy weighted (-balanceDomain)
+  PetscInt mdn, ndn, pdn;
+  const PetscInt *lxn, *lyn, *lzn;
+  DMDAGetInfo (da_nodes, NULL, NULL, NULL, NULL, &mdn, &ndn, &pdn, NULL, NULL,
+  NULL, NULL, NULL, NULL);
+  DMDAGetOwnershipRanges (da_nodes, &lxn, &lyn, &lzn);
+  DMDACreate3d (PETSC_COMM_WORLD, bx, by, bz, stype, nn[0], nn[1], nn[2], mdn,
+      ndn, pdn, numnodaldof, stencilwidth, lxn, lyn, lzn, &(da_nodal));
   // Initialize
   DMSetFromOptions (da_nodal);
   DMSetUp (da_nodal);
@@ -275,6 +289,15 @@ PDEFilt::PDEFilt (DM da_nodes, PetscScalar rmin) {
     MatSetLocalToGlobalMapping (T, rmapping, cmapping);
   }
 
+  // # new; No condition is imposed on the faces, so the flux of the filtered
+  // field is zero there: on the mirror planes of a reduced model this is
+  // the mirror condition, the stencil is not truncated
+  SymmetryPlanes symmetry;
+  if (symmetry.Active ()) {
+    PetscPrintf (PETSC_COMM_WORLD, "# PDE filter mirrored at: %s\n",
+        symmetry.Describe ().c_str ());
+  }
+
   MatAssemble ();
   SetUpSolver ();
 
@@ -327,6 +350,17 @@ PetscErrorCode PDEFilt::Gradients (Vec OS, Vec FS) {
   return FilterProject (OS, FS);
 }
 
+// # new
+PetscErrorCode PDEFilt::AccountMemory (MemoryReport *mem) {
+  PetscErrorCode ierr = 0;
+  mem->Add ("PDEFilt K + MG",
+      MemoryReport::MatBytes (K) + MemoryReport::MGBytes (ksp));
+  mem->Add ("PDEFilt T and vectors",
+      MemoryReport::MatBytes (T) + MemoryReport::VecBytes (RHS)
+      + MemoryReport::VecBytes (U) + MemoryReport::VecBytes (X));
+  return ierr;
+}
+
 PDEFilt::~PDEFilt () {
   Free ();
 }
@@ -826,3 +860,5 @@ void PDEFilt::PDEFilterMatrix (PetscScalar dx, PetscScalar dy, PetscScalar dz,
   T[7] = 0.125 * vol;
 }
 #endif
+
+TOPOPT_NAMESPACE_END // # new
@@ -4,6 +4,10 @@
 #include <petsc.h>
 
 #include "options.h"   // # new
+#include "memoryreport.h" // # new
+
+TOPOPT_NAMESPACE_BEGIN // # new
+
 /* -----------------------------------------------------------------------------
  Authors: Niels Aage, Erik Andreassen, Boyan Lazarov, August 2013
  Updated: June 2019, Niels Aage
@@ -40,6 +44,9 @@ class PDEFilt {
     PetscErrorCode FilterProject (Vec XX, Vec F);
     PetscErrorCode Gradients (Vec OS, Vec FS);
 
+    // # new; Add the bytes of the PDE filter to the memory report
+    PetscErrorCode AccountMemory (MemoryReport *mem);
+
   private:
 #if DIM == 2  // # new
     PetscInt    nn[2];   // Number of nodes in each direction
@@ -93,4 +100,6 @@ class PDEFilt {
     PetscErrorCode Free ();
 };
 
+TOPOPT_NAMESPACE_END // # new
+
 #endif
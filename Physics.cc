@@ -0,0 +1,63 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * Physics.cc
+ */
+
+#include "Physics.h"
+#include "TopOpt.h"
+#include "LinearElasticity.h"
+#include "LinearCompliant.h"
+#include "LinearHeatConduction.h"
+
+TOPOPT_NAMESPACE_BEGIN
+
+Physics::Physics () {
+  da_nodal = NULL;
+  importGeo = IMPORT_GEO;
+  PetscBool flg;
+  PetscOptionsGetInt (NULL, NULL, "-importGeo", &importGeo, &flg);
+}
+
+PetscErrorCode Physics::Create (TopOpt *opt, Physics **physics) {
+  PetscErrorCode ierr = 0;
+
+  // 0 - linear elasticity, 1 - compliant, 2 - linear heat conduction
+  if (opt->physics == 0) {
+    *physics = new LinearElasticity (opt->da_nodes, opt->m, opt->numDES,
+        opt->numLODFIX, opt->numNodeLoadAddingCounts, opt->nu, opt->E,
+        opt->loadVector, opt->xPassive0, opt->xPassive1, opt->xPassive2,
+        opt->xPassive3);
+  } else if (opt->physics == 1) {
+    *physics = new LinearCompliant (opt->da_nodes, opt->m, opt->numDES,
+        opt->numLODFIX, opt->nu, opt->E, opt->xPassive0, opt->xPassive1,
+        opt->xPassive2, opt->xPassive3);
+  } else if (opt->physics == 2) {
+    *physics = new LinearHeatConduction (opt->da_nodes, opt->da_elem, opt->m,
+        opt->numDES, opt->numLODFIX, opt->xPassive0, opt->xPassive1,
+        opt->xPassive2, opt->xPassive3);
+  } else {
+    SETERRQ1(PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE,
+        "Unknown -physics %D", opt->physics);
+  }
+
+  return ierr;
+}
+
+TOPOPT_NAMESPACE_END
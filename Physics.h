@@ -0,0 +1,114 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * Physics.h
+ */
+
+#ifndef PHYSICS_H_
+#define PHYSICS_H_
+
+#include <petsc.h>
+#include <vector>
+
+#include "options.h"
+#include "memoryreport.h"
+
+TOPOPT_NAMESPACE_BEGIN
+
+class TopOpt;
+
+/*
+ * Interface of the physical problems, so the problem is chosen at run time
+ * within the variant of each dimension (see dispatch.cc). The constructors
+ * of the derived classes set up the mesh, the loads and supports and the
+ * solver.
+ *
+ * Options:
+ * -physics <int>    0-Linear elasticity, 1-Compliant, 2-Heat conduction
+ *                   (default PHYSICS of options.h), read by TopOpt
+ * -importGeo <int>  0-Default geometries, 1-Imported CAD geometries
+ *                   (default IMPORT_GEO of options.h)
+ */
+class Physics {
+  public:
+
+    Physics ();
+
+    virtual ~Physics () {
+    }
+
+    /*
+     * New physics of opt->physics on the mesh and domains of opt
+     * \param[in] optimization parameters, mesh and passive elements
+     * \param[out] physics, deleted by the caller
+     * \return PetscErrorCode
+     */
+    static PetscErrorCode Create (TopOpt *opt, Physics **physics);
+
+    // Solve the states and compute the objective, the constraints and their
+    // sensitivities
+    virtual PetscErrorCode ComputeObjectiveConstraintsSensitivities (
+        PetscScalar *fx, PetscScalar *gx, Vec dfdx, Vec *dgdx, Vec xPhys,
+        PetscScalar Emin, PetscScalar Emax, PetscScalar penal,
+        PetscScalar volfrac, Vec xPassive0, Vec xPassive1, Vec xPassive2,
+        Vec xPassive3) = 0;
+
+    // Solve the verification loads with the final design
+    virtual PetscErrorCode FEAWithTopOptResults (Vec xPhys, Vec xPassive0,
+        Vec xPassive1, Vec xPassive2, Vec xPassive3, PetscInt numLoadFEA,
+        PetscScalar *loadVectorFEAp) = 0;
+
+    // States of the verification loads of the last FEAWithTopOptResults
+    virtual PetscInt GetNumFEAStates () = 0;
+    virtual Vec *GetFEAStates () = 0;
+
+    // Restart writer
+    virtual PetscErrorCode WriteRestartFiles () = 0;
+
+    // Get pointer to the FE solution
+    virtual Vec GetStateField () = 0;
+
+    // Keep the preconditioner of the last set up for the next solves
+    virtual void SetReusePreconditioner (PetscBool reuse) = 0;
+
+    // Add the bytes of the system matrix, its multigrid hierarchy and the
+    // vectors of all load cases to the memory report
+    virtual PetscErrorCode AccountMemory (MemoryReport *mem) = 0;
+
+    // Get pointer to DMDA
+    DM GetDM () {
+      return (da_nodal);
+    }
+
+    // Logical mesh
+    DM da_nodal; // Nodal mesh
+
+    // Krylov iterations and relative residual of the last solve of each load
+    // case
+    std::vector<PetscInt> kspIterations;
+    std::vector<PetscReal> kspResiduals;
+
+  protected:
+    // Supports and loads of the imported geometries, or the default ones
+    PetscInt importGeo;
+};
+
+TOPOPT_NAMESPACE_END
+
+#endif /* PHYSICS_H_ */
@@ -1,5 +1,9 @@
 #include "TopOpt.h"
 #include <cmath>
+#include "PrePostProcess.h" // # new; voxelization for -balanceDomain
+#include "scopedtimer.h" // # new
+
+TOPOPT_NAMESPACE_BEGIN // # new
 
 /*
  Authors: Niels Aage, Erik Andreassen, Boyan Lazarov, August 2013
@@ -19,12 +23,22 @@
 TopOpt::TopOpt (PetscInt nconstraints) {
 
   m = nconstraints;
+  gridStage = 0; // # new
   Init ();
 }
 
 TopOpt::TopOpt () {
 
   m = 1;
+  gridStage = 0; // # new
+  Init ();
+}
+
+// # new
+TopOpt::TopOpt (PetscInt nconstraints, PetscInt stage) {
+
+  m = nconstraints;
+  gridStage = stage;
   Init ();
 }
 
@@ -105,90 +119,102 @@ PetscErrorCode TopOpt::SetUp () {
 
   PetscErrorCode ierr = 0;
 
+  // # new; Physical problem and source of the geometry, see Physics.h
+  physics = PHYSICS;
+  importGeo = IMPORT_GEO;
+  PetscBool flg;
+  PetscOptionsGetInt (NULL, NULL, "-physics", &physics, &flg);
+  PetscOptionsGetInt (NULL, NULL, "-importGeo", &importGeo, &flg);
+  if (physics < 0 || physics > 2) {
+    PetscPrintf (PETSC_COMM_WORLD, "UNKNOWN PHYSICS %i (-physics): 0-Linear "
+        "elasticity, 1-Compliant, 2-Heat conduction\n", physics);
+    exit (1);
+  }
+
   // SET DEFAULTS for FE mesh and levels for MG solver
 #if DIM == 2   // # new
 
-#if PHYSICS == 0
-  // Linear elasticity
-  nxyz[0] = 241;
-  nxyz[1] = 121;
-  xc[0] = 0.0;
-  xc[1] = 2.0;
-  xc[2] = 0.0;
-  xc[3] = 1.0;
-  numDES = 1; // # new; number of design domains
-  numSLD = 1; // # new; number of solid domains
-  numLODFIX = 1; // # new; number of loading conditions
-  loadVector = new PetscScalar[numLODFIX * DIM]; // # new; applied load vector
-  loadVector[0 * DIM + 0] = 0; // # new; x
-  loadVector[0 * DIM + 1] = -1.0; // # new;  y
-  numLODFIXFEA = 1; // # new; number of loading conditions
-  loadVectorFEA = new PetscScalar[numLODFIXFEA * DIM]; // # new; applied load vector
-  loadVectorFEA[0 * DIM + 0] = 1.0; // # new; x
-  loadVectorFEA[0 * DIM + 1] = -1.0; // # new;  y
-  inputSTL_DES = new std::string[numDES]; // # new
-  inputSTL_SLD = new std::string[numSLD]; // # new
-  inputSTL_FIX = new std::string[numLODFIX]; // # new
-  inputSTL_LOD = new std::string[numLODFIX]; // # new
-  inputSTL_DES[0].assign ("./CAD_models/2D/2D_elasticity/2D_bracket_DES.STL"); // # new
-  inputSTL_SLD[0].assign (""); // # new
-  inputSTL_FIX[0].assign ("./CAD_models/2D/2D_elasticity/2D_bracket_FIX.STL"); // # new
-  inputSTL_LOD[0].assign ("./CAD_models/2D/2D_elasticity/2D_bracket_LOD.STL"); // # new
-  volfrac = 0.45;
-  rmin = 6.0 * PetscMax(xc[1] / (nxyz[0] - 1),
-             PetscMax(xc[3]/(nxyz[1]-1), xc[5]/(nxyz[2]-1)));
-  Emin = 1.0e-9;
-  E = 1.0;
-
-#elif PHYSICS == 1  // # new
-  // Compliant
-  nxyz[0] = 241;
-  nxyz[1] = 121;
-  xc[0] = 0.0;
-  xc[1] = 80.0;
-  xc[2] = 0.0;
-  xc[3] = 40.0;
-  numDES = 1; // # new; number of design domains
-  numSLD = 1; // # new; number of solid domains
-  numLODFIX = 2; // number of loading conditions
-  inputSTL_DES = new std::string[numDES];
-  inputSTL_SLD = new std::string[numSLD];
-  inputSTL_FIX = new std::string[numLODFIX];
-  inputSTL_LOD = new std::string[numLODFIX];
-  numLODFIXFEA = 1; // # new; number of loading conditions
-  inputSTL_DES[0].assign ("./CAD_models/2D/2D_compliant/2D_compliant_DES.STL");
-  inputSTL_SLD[0].assign ("");
-  inputSTL_FIX[0].assign ("./CAD_models/2D/2D_compliant/2D_compliant_FIX.STL");
-  inputSTL_LOD[0].assign ("");
-  volfrac = 0.3;
-  rmin = 3.0 * PetscMax(xc[1] / (nxyz[0] - 1),
-             PetscMax(xc[3]/(nxyz[1]-1), xc[5]/(nxyz[2]-1)));
-  Emin = 1.0e-9;
-#elif PHYSICS == 2  // # new
-  // Linear heat conduction
-  nxyz[0] = 201;
-  nxyz[1] = 249;
-  xc[0] = 0.0;
-  xc[1] = 50;
-  xc[2] = 0.0;
-  xc[3] = 62;
-  numDES = 1; // # new; number of design domains
-  numSLD = 1; // # new; number of solid domains
-  numLODFIX = 1; // number of loading conditions
-  inputSTL_DES = new std::string[numDES];
-  inputSTL_SLD = new std::string[numSLD];
-  inputSTL_FIX = new std::string[numLODFIX];
-  inputSTL_LOD = new std::string[numLODFIX];
-  numLODFIXFEA = 1; // # new; number of loading conditions
-  inputSTL_DES[0].assign ("./CAD_models/2D/2D_heat/2D_heatSink_DES.STL");
-  inputSTL_SLD[0].assign ("");
-  inputSTL_FIX[0].assign ("./CAD_models/2D/2D_heat/2D_heatSink_FIX.STL");
-  inputSTL_LOD[0].assign ("");
-  volfrac = 0.45;
-  rmin = 3.0 * PetscMax(xc[1] / (nxyz[0] - 1),
-             PetscMax(xc[3]/(nxyz[1]-1), xc[5]/(nxyz[2]-1)));
-  Emin = 1.0e-3;
-#endif
+  if (physics == 0) { // # modified; -physics
+    // Linear elasticity
+    nxyz[0] = 241;
+    nxyz[1] = 121;
+    xc[0] = 0.0;
+    xc[1] = 2.0;
+    xc[2] = 0.0;
+    xc[3] = 1.0;
+    numDES = 1; // # new; number of design domains
+    numSLD = 1; // # new; number of solid domains
+    numLODFIX = 1; // # new; number of loading conditions
+    loadVector = new PetscScalar[numLODFIX * DIM]; // # new; applied load vector
+    loadVector[0 * DIM + 0] = 0; // # new; x
+    loadVector[0 * DIM + 1] = -1.0; // # new;  y
+    numLODFIXFEA = 1; // # new; number of loading conditions
+    loadVectorFEA = new PetscScalar[numLODFIXFEA * DIM]; // # new; applied load vector
+    loadVectorFEA[0 * DIM + 0] = 1.0; // # new; x
+    loadVectorFEA[0 * DIM + 1] = -1.0; // # new;  y
+    inputSTL_DES = new std::string[numDES]; // # new
+    inputSTL_SLD = new std::string[numSLD]; // # new
+    inputSTL_FIX = new std::string[numLODFIX]; // # new
+    inputSTL_LOD = new std::string[numLODFIX]; // # new
+    inputSTL_DES[0].assign ("./CAD_models/2D/2D_elasticity/2D_bracket_DES.STL"); // # new
+    inputSTL_SLD[0].assign (""); // # new
+    inputSTL_FIX[0].assign ("./CAD_models/2D/2D_elasticity/2D_bracket_FIX.STL"); // # new
+    inputSTL_LOD[0].assign ("./CAD_models/2D/2D_elasticity/2D_bracket_LOD.STL"); // # new
+    volfrac = 0.45;
+    rmin = 6.0 * PetscMax(xc[1] / (nxyz[0] - 1),
+               PetscMax(xc[3]/(nxyz[1]-1), xc[5]/(nxyz[2]-1)));
+    Emin = 1.0e-9;
+    E = 1.0;
+
+  } else if (physics == 1) { // # new
+    // Compliant
+    nxyz[0] = 241;
+    nxyz[1] = 121;
+    xc[0] = 0.0;
+    xc[1] = 80.0;
+    xc[2] = 0.0;
+    xc[3] = 40.0;
+    numDES = 1; // # new; number of design domains
+    numSLD = 1; // # new; number of solid domains
+    numLODFIX = 2; // number of loading conditions
+    inputSTL_DES = new std::string[numDES];
+    inputSTL_SLD = new std::string[numSLD];
+    inputSTL_FIX = new std::string[numLODFIX];
+    inputSTL_LOD = new std::string[numLODFIX];
+    numLODFIXFEA = 1; // # new; number of loading conditions
+    inputSTL_DES[0].assign ("./CAD_models/2D/2D_compliant/2D_compliant_DES.STL");
+    inputSTL_SLD[0].assign ("");
+    inputSTL_FIX[0].assign ("./CAD_models/2D/2D_compliant/2D_compliant_FIX.STL");
+    inputSTL_LOD[0].assign ("");
+    volfrac = 0.3;
+    rmin = 3.0 * PetscMax(xc[1] / (nxyz[0] - 1),
+               PetscMax(xc[3]/(nxyz[1]-1), xc[5]/(nxyz[2]-1)));
+    Emin = 1.0e-9;
+  } else if (physics == 2) { // # new
+    // Linear heat conduction
+    nxyz[0] = 201;
+    nxyz[1] = 249;
+    xc[0] = 0.0;
+    xc[1] = 50;
+    xc[2] = 0.0;
+    xc[3] = 62;
+    numDES = 1; // # new; number of design domains
+    numSLD = 1; // # new; number of solid domains
+    numLODFIX = 1; // number of loading conditions
+    inputSTL_DES = new std::string[numDES];
+    inputSTL_SLD = new std::string[numSLD];
+    inputSTL_FIX = new std::string[numLODFIX];
+    inputSTL_LOD = new std::string[numLODFIX];
+    numLODFIXFEA = 1; // # new; number of loading conditions
+    inputSTL_DES[0].assign ("./CAD_models/2D/2D_heat/2D_heatSink_DES.STL");
+    inputSTL_SLD[0].assign ("");
+    inputSTL_FIX[0].assign ("./CAD_models/2D/2D_heat/2D_heatSink_FIX.STL");
+    inputSTL_LOD[0].assign ("");
+    volfrac = 0.45;
+    rmin = 3.0 * PetscMax(xc[1] / (nxyz[0] - 1),
+               PetscMax(xc[3]/(nxyz[1]-1), xc[5]/(nxyz[2]-1)));
+    Emin = 1.0e-3;
+  }
 
   nu = 0.3;
   nlvls = 4;
@@ -211,101 +237,101 @@ PetscErrorCode TopOpt::SetUp () {
 
 #elif DIM == 3
 
-#if PHYSICS == 0
-  // Linear elasticity
-  nxyz[0] = 65; //129; //241
-  nxyz[1] = 33; //65;  //121
-  nxyz[2] = 33; //65;  //121
-  xc[0] = 0.0;
-  xc[1] = 2.0;
-  xc[2] = 0.0;
-  xc[3] = 1.0;
-  xc[4] = 0.0;
-  xc[5] = 1.0;
-
-  numDES = 1; // # new; number of design domains
-  numSLD = 1; // # new; number of solid domains
-  numLODFIX = 1; // # new; number of loading conditions
-  loadVector = new PetscScalar[numLODFIX * DIM]; // # new; applied load vector
-  loadVector[0 * DIM + 0] = 0; // # new; x
-  loadVector[0 * DIM + 1] = -1.0; // # new;  y
-  loadVector[0 * DIM + 2] = 0; // # new; z
-  numLODFIXFEA = 1; // # new; number of loading conditions
-  loadVectorFEA = new PetscScalar[numLODFIXFEA * DIM]; // # new; applied load vector
-  loadVectorFEA[0 * DIM + 0] = 1.0; // # new; x
-  loadVectorFEA[0 * DIM + 1] = -1.0; // # new;  y
-  loadVectorFEA[0 * DIM + 2] = 0; // # new; z
-  inputSTL_DES = new std::string[numDES]; // # new
-  inputSTL_SLD = new std::string[numSLD]; // # new
-  inputSTL_FIX = new std::string[numLODFIX]; // # new
-  inputSTL_LOD = new std::string[numLODFIX]; // # new
-  inputSTL_DES[0].assign ("./CAD_models/3D/3D_elasticity/3D_bracket_DES.STL"); // # new
-  inputSTL_SLD[0].assign (""); // # new
-  inputSTL_FIX[0].assign ("./CAD_models/3D/3D_elasticity/3D_bracket_FIX.STL"); // # new
-  inputSTL_LOD[0].assign ("./CAD_models/3D/3D_elasticity/3D_bracket_LOD.STL"); // # new
-  volfrac = 0.12;
-  rmin = 3.0
-         * PetscMax(xc[1] / (nxyz[0] - 1),
-             PetscMax(xc[3]/(nxyz[1]-1), xc[5]/(nxyz[2]-1))); // # modified 0.08;
-  Emin = 1.0e-9;
-
-#elif PHYSICS == 1   // # new
-  // Compliant
-  nxyz[0] = 81; //241;
-  nxyz[1] = 41; //121;
-  nxyz[2] = 9; //33;
-  xc[0] = 0.0;
-  xc[1] = 80.0;
-  xc[2] = 0.0;
-  xc[3] = 40.0;
-  xc[4] = 0.0;
-  xc[5] = 10.0;
-  numDES = 1; // # new; number of design domains
-  numSLD = 1; // # new; number of solid domains
-  numLODFIX = 2; // number of loading conditions
-  inputSTL_DES = new std::string[numDES];
-  inputSTL_SLD = new std::string[numSLD];
-  inputSTL_FIX = new std::string[numLODFIX];
-  inputSTL_LOD = new std::string[numLODFIX];
-  numLODFIXFEA = 1; // # new; number of loading conditions
-  inputSTL_DES[0].assign ("./CAD_models/3D/3D_compliant/3D_compliant_DES.STL");
-  inputSTL_SLD[0].assign ("");
-  inputSTL_FIX[0].assign ("./CAD_models/3D/3D_compliant/3D_compliant_FIX.STL");
-  inputSTL_LOD[0].assign ("");
-  volfrac = 0.3;
-  rmin = 3.0
-         * PetscMax(xc[1] / (nxyz[0] - 1),
-             PetscMax(xc[3]/(nxyz[1]-1), xc[5]/(nxyz[2]-1))); // 0.08;
-  Emin = 1.0e-9;
-#elif PHYSICS == 2   // # new
-  // Linear heat conduction
-  nxyz[0] = 49; //97; // 201;
-  nxyz[1] = 65; //129; //249;
-  nxyz[2] = 49; //97; //201;
-  xc[0] = 0.0;
-  xc[1] = 50.0;
-  xc[2] = 0.0;
-  xc[3] = 62;
-  xc[4] = 0.0;
-  xc[5] = 50.0;
-  numDES = 1; // # new; number of design domains
-  numSLD = 1; // # new; number of solid domains
-  numLODFIX = 1; // number of loading conditions
-  inputSTL_DES = new std::string[numDES];
-  inputSTL_SLD = new std::string[numSLD];
-  inputSTL_FIX = new std::string[numLODFIX];
-  inputSTL_LOD = new std::string[numLODFIX];
-  numLODFIXFEA = 1; // # new; number of loading conditions
-  inputSTL_DES[0].assign ("./CAD_models/3D/3D_heat/3D_heatSink_oneQuarter_DES.STL");
-  inputSTL_SLD[0].assign ("");
-  inputSTL_FIX[0].assign ("./CAD_models/3D/3D_heat/3D_heatSink_oneQuarter_FIX.STL");
-  inputSTL_LOD[0].assign ("");
-  volfrac = 0.3;
-  rmin = 3.0
-         * PetscMax(xc[1] / (nxyz[0] - 1),
-             PetscMax(xc[3]/(nxyz[1]-1), xc[5]/(nxyz[2]-1))); // 0.08;
-  Emin = 1.0e-3;
-#endif
+  if (physics == 0) { // # modified; -physics
+    // Linear elasticity
+    nxyz[0] = 65; //129; //241
+    nxyz[1] = 33; //65;  //121
+    nxyz[2] = 33; //65;  //121
+    xc[0] = 0.0;
+    xc[1] = 2.0;
+    xc[2] = 0.0;
+    xc[3] = 1.0;
+    xc[4] = 0.0;
+    xc[5] = 1.0;
+
+    numDES = 1; // # new; number of design domains
+    numSLD = 1; // # new; number of solid domains
+    numLODFIX = 1; // # new; number of loading conditions
+    loadVector = new PetscScalar[numLODFIX * DIM]; // # new; applied load vector
+    loadVector[0 * DIM + 0] = 0; // # new; x
+    loadVector[0 * DIM + 1] = -1.0; // # new;  y
+    loadVector[0 * DIM + 2] = 0; // # new; z
+    numLODFIXFEA = 1; // # new; number of loading conditions
+    loadVectorFEA = new PetscScalar[numLODFIXFEA * DIM]; // # new; applied load vector
+    loadVectorFEA[0 * DIM + 0] = 1.0; // # new; x
+    loadVectorFEA[0 * DIM + 1] = -1.0; // # new;  y
+    loadVectorFEA[0 * DIM + 2] = 0; // # new; z
+    inputSTL_DES = new std::string[numDES]; // # new
+    inputSTL_SLD = new std::string[numSLD]; // # new
+    inputSTL_FIX = new std::string[numLODFIX]; // # new
+    inputSTL_LOD = new std::string[numLODFIX]; // # new
+    inputSTL_DES[0].assign ("./CAD_models/3D/3D_elasticity/3D_bracket_DES.STL"); // # new
+    inputSTL_SLD[0].assign (""); // # new
+    inputSTL_FIX[0].assign ("./CAD_models/3D/3D_elasticity/3D_bracket_FIX.STL"); // # new
+    inputSTL_LOD[0].assign ("./CAD_models/3D/3D_elasticity/3D_bracket_LOD.STL"); // # new
+    volfrac = 0.12;
+    rmin = 3.0
+           * PetscMax(xc[1] / (nxyz[0] - 1),
+               PetscMax(xc[3]/(nxyz[1]-1), xc[5]/(nxyz[2]-1))); // # modified 0.08;
+    Emin = 1.0e-9;
+
+  } else if (physics == 1) { // # new
+    // Compliant
+    nxyz[0] = 81; //241;
+    nxyz[1] = 41; //121;
+    nxyz[2] = 9; //33;
+    xc[0] = 0.0;
+    xc[1] = 80.0;
+    xc[2] = 0.0;
+    xc[3] = 40.0;
+    xc[4] = 0.0;
+    xc[5] = 10.0;
+    numDES = 1; // # new; number of design domains
+    numSLD = 1; // # new; number of solid domains
+    numLODFIX = 2; // number of loading conditions
+    inputSTL_DES = new std::string[numDES];
+    inputSTL_SLD = new std::string[numSLD];
+    inputSTL_FIX = new std::string[numLODFIX];
+    inputSTL_LOD = new std::string[numLODFIX];
+    numLODFIXFEA = 1; // # new; number of loading conditions
+    inputSTL_DES[0].assign ("./CAD_models/3D/3D_compliant/3D_compliant_DES.STL");
+    inputSTL_SLD[0].assign ("");
+    inputSTL_FIX[0].assign ("./CAD_models/3D/3D_compliant/3D_compliant_FIX.STL");
+    inputSTL_LOD[0].assign ("");
+    volfrac = 0.3;
+    rmin = 3.0
+           * PetscMax(xc[1] / (nxyz[0] - 1),
+               PetscMax(xc[3]/(nxyz[1]-1), xc[5]/(nxyz[2]-1))); // 0.08;
+    Emin = 1.0e-9;
+  } else if (physics == 2) { // # new
+    // Linear heat conduction
+    nxyz[0] = 49; //97; // 201;
+    nxyz[1] = 65; //129; //249;
+    nxyz[2] = 49; //97; //201;
+    xc[0] = 0.0;
+    xc[1] = 50.0;
+    xc[2] = 0.0;
+    xc[3] = 62;
+    xc[4] = 0.0;
+    xc[5] = 50.0;
+    numDES = 1; // # new; number of design domains
+    numSLD = 1; // # new; number of solid domains
+    numLODFIX = 1; // number of loading conditions
+    inputSTL_DES = new std::string[numDES];
+    inputSTL_SLD = new std::string[numSLD];
+    inputSTL_FIX = new std::string[numLODFIX];
+    inputSTL_LOD = new std::string[numLODFIX];
+    numLODFIXFEA = 1; // # new; number of loading conditions
+    inputSTL_DES[0].assign ("./CAD_models/3D/3D_heat/3D_heatSink_oneQuarter_DES.STL");
+    inputSTL_SLD[0].assign ("");
+    inputSTL_FIX[0].assign ("./CAD_models/3D/3D_heat/3D_heatSink_oneQuarter_FIX.STL");
+    inputSTL_LOD[0].assign ("");
+    volfrac = 0.3;
+    rmin = 3.0
+           * PetscMax(xc[1] / (nxyz[0] - 1),
+               PetscMax(xc[3]/(nxyz[1]-1), xc[5]/(nxyz[2]-1))); // 0.08;
+    Emin = 1.0e-3;
+  }
 
   nu = 0.3;
   nlvls = 4;
@@ -333,6 +359,42 @@ PetscErrorCode TopOpt::SetUp () {
   E = 1.0;
   nnd = 0;
 
+  // # new; Synthetic benchmark domain: the whole box is designable and the
+  // supports/loads are generated on the grid, see
+  // PrePostProcess::SyntheticGeometry. Non-empty names flag the domains.
+  benchmark = PETSC_FALSE;
+  PetscOptionsGetBool (NULL, NULL, "-benchmark", &benchmark, &flg);
+  if (benchmark) {
+    inputSTL_DES[0].assign ("synthetic");
+    for (PetscInt i = 1; i < numDES; ++i) {
+      inputSTL_DES[i].assign ("");
+    }
+    for (PetscInt i = 0; i < numSLD; ++i) {
+      inputSTL_SLD[i].assign ("");
+    }
+    for (PetscInt i = 0; i < numLODFIX; ++i) {
+      inputSTL_FIX[i].assign ("synthetic");
+      inputSTL_LOD[i].assign (physics == 0 ? "synthetic" : "");
+    }
+  }
+
+  // # new; Occupancy weighted partition of arbitrary domains: the geometry
+  // is voxelized before the mesh and the ownership ranges balance the active
+  // elements per rank, see BalanceMESH
+  balanceDomain = PETSC_FALSE;
+  balanceVoidWeight = 0.25;
+  voxels = NULL;
+  PetscOptionsGetBool (NULL, NULL, "-balanceDomain", &balanceDomain, &flg);
+  PetscOptionsGetReal (NULL, NULL, "-balanceVoidWeight", &balanceVoidWeight,
+      &flg);
+
+  // # new; Crop the mesh to the bounding box of the STL geometries with a
+  // padding of empty elements, see CropDomain
+  cropDomain = PETSC_FALSE;
+  cropPadding = 1;
+  PetscOptionsGetBool (NULL, NULL, "-cropDomain", &cropDomain, &flg);
+  PetscOptionsGetInt (NULL, NULL, "-cropPadding", &cropPadding, &flg);
+
   ierr = SetUpMESH ();
   CHKERRQ(ierr);
 
@@ -360,6 +422,12 @@ PetscErrorCode TopOpt::SetUpMESH () {
   PetscOptionsGetReal (NULL, NULL, "-penal", &penal, &flg);
   PetscOptionsGetInt (NULL, NULL, "-nlvls", &nlvls, &flg); // NEEDS THIS TO CHECK IF MESH IS OK BEFORE PROCEEDING !!!!
 
+  // # new; Crop to the geometry before the mesh is checked and created
+  ierr = CropDomain ();
+  CHKERRQ(ierr);
+  ierr = CoarsenMESH ();
+  CHKERRQ(ierr);
+
   // Write parameters for the physics _ OWNED BY TOPOPT
   PetscPrintf (PETSC_COMM_WORLD,
       "##############################################"
@@ -421,13 +489,8 @@ PetscErrorCode TopOpt::SetUpMESH () {
   PetscInt ny = nxyz[1];
 
   // number of nodal dofs: Nodal design variable - NOT REALLY NEEDED
-#if PHYSICS == 0 // 0 is linear elastic
-  PetscInt numnodaldof = 2;
-#elif PHYSICS == 1  // 1 is compliant
-  PetscInt numnodaldof = 2;
-#elif PHYSICS == 2  // 2 is linear heat conduction
-  PetscInt numnodaldof = 1;
-#endif
+  // # modified; 1 for linear heat conduction
+  PetscInt numnodaldof = (physics == 2) ? 1 : 2;
 
   // Stencil width: each node connects to a box around it - linear elements
   PetscInt stencilwidth = 1;
@@ -446,6 +509,10 @@ PetscErrorCode TopOpt::SetUpMESH () {
   DMSetFromOptions (da_nodes);
   DMSetUp (da_nodes);
 
+  // # new; Occupancy weighted ownership ranges (-balanceDomain)
+  ierr = BalanceMESH ();
+  CHKERRQ(ierr);
+
   // Set the coordinates
   ierr = DMDASetUniformCoordinates (da_nodes, xmin, xmax, ymin, ymax, 0, 0);
   CHKERRQ(ierr);
@@ -522,6 +589,12 @@ PetscErrorCode TopOpt::SetUpMESH () {
   PetscOptionsGetReal (NULL, NULL, "-penal", &penal, &flg);
   PetscOptionsGetInt (NULL, NULL, "-nlvls", &nlvls, &flg); // NEEDS THIS TO CHECK IF MESH IS OK BEFORE PROCEEDING !!!!
 
+  // # new; Crop to the geometry before the mesh is checked and created
+  ierr = CropDomain ();
+  CHKERRQ(ierr);
+  ierr = CoarsenMESH ();
+  CHKERRQ(ierr);
+
   // Write parameters for the physics _ OWNED BY TOPOPT
   PetscPrintf (PETSC_COMM_WORLD,
       "##############################################"
@@ -596,13 +669,8 @@ PetscErrorCode TopOpt::SetUpMESH () {
   PetscInt nz = nxyz[2];
 
   // # modified; number of nodal dofs: Nodal design variable - NOT REALLY NEEDED
-#if PHYSICS == 0 // 0 is linear elastic
-  PetscInt numnodaldof = 3;
-#elif PHYSICS == 1  // 1 is compliant
-  PetscInt numnodaldof = 3;
-#elif PHYSICS == 2  // 2 is linear heat conduction
-  PetscInt numnodaldof = 1;
-#endif
+  // 1 for linear heat conduction
+  PetscInt numnodaldof = (physics == 2) ? 1 : 3;
 
   // Stencil width: each node connects to a box around it - linear elements
   PetscInt stencilwidth = 1;
@@ -624,6 +692,10 @@ PetscErrorCode TopOpt::SetUpMESH () {
   DMSetFromOptions (da_nodes);
   DMSetUp (da_nodes);
 
+  // # new; Occupancy weighted ownership ranges (-balanceDomain)
+  ierr = BalanceMESH ();
+  CHKERRQ(ierr);
+
   // Set the coordinates
   ierr = DMDASetUniformCoordinates (da_nodes, xmin, xmax, ymin, ymax, zmin,
       zmax);
@@ -696,6 +768,228 @@ PetscErrorCode TopOpt::SetUpMESH () {
   return (ierr);
 }
 
+PetscErrorCode TopOpt::CoarsenMESH () {
+  PetscErrorCode ierr = 0;
+  if (gridStage == 0) return ierr;
+
+  // The coarse grid keeps at least two multigrid levels
+  PetscInt ratio = 1 << gridStage;
+  if (nlvls - gridStage < 2) {
+    PetscPrintf (PETSC_COMM_WORLD,
+        "GRID SEQUENCING STAGE %i NEEDS AT LEAST %i MULTIGRID LEVELS!\n",
+        gridStage, gridStage + 2);
+    exit (0);
+  }
+  for (PetscInt axis = 0; axis < DIM; ++axis) {
+    if ((nxyz[axis] - 1) % ratio != 0) {
+      PetscPrintf (PETSC_COMM_WORLD,
+          "MESH DIMENSION NOT COMPATIBLE WITH GRID SEQUENCING!\n");
+      PetscPrintf (PETSC_COMM_WORLD,
+          "Number of nodes %i cannot be halfened %i times\n", nxyz[axis],
+          gridStage);
+      exit (0);
+    }
+    nxyz[axis] = (nxyz[axis] - 1) / ratio + 1;
+  }
+  nlvls -= gridStage;
+
+  PetscPrintf (PETSC_COMM_WORLD,
+      "# Grid sequencing stage %i (-gridSequence): elements coarsened by %i, "
+      "%i multigrid levels\n", gridStage, ratio, nlvls);
+
+  return ierr;
+}
+
+PetscErrorCode TopOpt::CropDomain () {
+  PetscErrorCode ierr = 0;
+  if (importGeo != 1 || !cropDomain || benchmark) return ierr; // # modified
+
+  ScopedTimer cropTimer ("CropDomain");
+
+  float bound[6];
+  ierr = PrePostProcess::GeometryBound (this, bound);
+  CHKERRQ(ierr);
+
+  // Element sizes of the requested mesh are kept
+  PetscInt ne[DIM];
+  PetscScalar h[DIM], extent[DIM];
+  for (PetscInt axis = 0; axis < DIM; ++axis) {
+    ne[axis] = nxyz[axis] - 1;
+    h[axis] = (xc[2 * axis + 1] - xc[2 * axis]) / ne[axis];
+    extent[axis] = bound[2 * axis + 1] - bound[2 * axis];
+  }
+
+  // Scale of the geometry as fitted by StlVoxelizer::ScaleAndTranslate into
+  // the requested mesh minus the padding
+  PetscScalar factor = PETSC_MAX_REAL;
+  for (PetscInt axis = 0; axis < DIM; ++axis) {
+    if (extent[axis] > 0.0) {
+      factor = PetscMin(factor,
+          (ne[axis] - 2 * cropPadding) * h[axis] / extent[axis]);
+    }
+  }
+  if (factor <= 0.0 || factor == PETSC_MAX_REAL) {
+    PetscPrintf (PETSC_COMM_WORLD,
+        "# -cropDomain: padding of %i elements leaves no room for the "
+        "geometry, the mesh is not cropped\n", cropPadding);
+    cropDomain = PETSC_FALSE;
+    return ierr;
+  }
+
+  // Tight box plus padding, rounded up to whole coarsest multigrid elements,
+  // so the mesh supports -nlvls and the geometry is not cut
+  PetscInt unit = 1 << (nlvls - 1);
+  PetscScalar nold = 1.0, nnew = 1.0;
+  for (PetscInt axis = 0; axis < DIM; ++axis) {
+    PetscInt tight = (PetscInt) std::ceil (
+        factor * extent[axis] / h[axis] - 1.0e-6) + 2 * cropPadding;
+    PetscInt cropped = ((tight + unit - 1) / unit) * unit;
+    cropped = PetscMax(PetscMin(cropped, ne[axis]), unit);
+    nold *= ne[axis];
+    nnew *= cropped;
+    nxyz[axis] = cropped + 1;
+    xc[2 * axis + 1] = xc[2 * axis] + cropped * h[axis];
+  }
+#if DIM == 2
+  PetscPrintf (PETSC_COMM_WORLD,
+      "# Cropped to the geometry (-cropDomain, padding %i): %i x %i elements, "
+      "%.1f%% of the requested mesh\n", cropPadding, nxyz[0] - 1,
+      nxyz[1] - 1, 100.0 * nnew / nold);
+#elif DIM == 3
+  PetscPrintf (PETSC_COMM_WORLD,
+      "# Cropped to the geometry (-cropDomain, padding %i): %i x %i x %i "
+      "elements, %.1f%% of the requested mesh\n", cropPadding, nxyz[0] - 1,
+      nxyz[1] - 1, nxyz[2] - 1, 100.0 * nnew / nold);
+#endif
+
+  return ierr;
+}
+
+/*
+ * Split the element slabs along one axis into nproc parts of similar weight.
+ * The cuts are on multiples of unit elements, the element size of the
+ * coarsest multigrid level, so every level keeps the same partition and each
+ * part owns at least one coarse element. Returns false, i.e. keep the even
+ * partition, if the axis cannot be split that way.
+ */
+static PetscBool SplitSlabs (const std::vector<PetscScalar> &weights,
+    PetscInt nproc, PetscInt unit, PetscInt *lnodes) {
+  PetscInt nb = weights.size () / unit;
+  if (nb < nproc) return PETSC_FALSE;
+
+  // Cumulative weight at the block boundaries
+  std::vector<PetscScalar> cum (nb + 1, 0.0);
+  for (PetscInt b = 0; b < nb; ++b) {
+    cum[b + 1] = cum[b];
+    for (PetscInt e = b * unit; e < (b + 1) * unit; ++e) {
+      cum[b + 1] += weights[e];
+    }
+  }
+  if (cum[nb] <= 0.0) return PETSC_FALSE;
+
+  // Greedy cuts closest to the ideal prefix weights, leaving one block for
+  // each remaining part
+  PetscInt last = 0;
+  for (PetscInt r = 0; r < nproc - 1; ++r) {
+    PetscScalar target = cum[nb] * (r + 1) / nproc;
+    PetscInt end = last + 1;
+    while (end < nb - (nproc - 1 - r)
+           && std::fabs (cum[end + 1] - target) <= std::fabs (cum[end] - target)) {
+      end++;
+    }
+    lnodes[r] = (end - last) * unit;
+    last = end;
+  }
+  lnodes[nproc - 1] = (nb - last) * unit;
+
+  // The first part also owns the nodes at the lower left corner
+  lnodes[0] += 1;
+
+  return PETSC_TRUE;
+}
+
+/*
+ * Max/mean weight of the parts of an axis split, lnodes as of the nodal mesh
+ */
+static PetscScalar SlabImbalance (const std::vector<PetscScalar> &weights,
+    PetscInt nproc, const PetscInt *lnodes) {
+  PetscScalar wmax = 0.0, wsum = 0.0;
+  PetscInt start = 0;
+  for (PetscInt r = 0; r < nproc; ++r) {
+    PetscInt end = start + lnodes[r] - (r == 0 ? 1 : 0);
+    PetscScalar w = 0.0;
+    for (PetscInt e = start; e < end; ++e) {
+      w += weights[e];
+    }
+    wmax = PetscMax(wmax, w);
+    wsum += w;
+    start = end;
+  }
+  return wsum > 0.0 ? wmax * nproc / wsum : 1.0;
+}
+
+PetscErrorCode TopOpt::BalanceMESH () {
+  PetscErrorCode ierr = 0;
+  if (importGeo != 1 || !balanceDomain) return ierr; // # modified
+
+  ScopedTimer balanceTimer ("BalanceMesh");
+
+  // Layout of the even partition: the process grid is kept
+  PetscInt M, N, P, md, nd, pd, dof, s;
+  DMBoundaryType bx, by, bz;
+  DMDAStencilType stype;
+  ierr = DMDAGetInfo (da_nodes, NULL, &M, &N, &P, &md, &nd, &pd, &dof, &s, &bx,
+      &by, &bz, &stype);
+  CHKERRQ(ierr);
+  PetscInt nproc[3] = { md, nd, pd };
+  const PetscInt *Leven[3];
+  ierr = DMDAGetOwnershipRanges (da_nodes, &Leven[0], &Leven[1], &Leven[2]);
+  CHKERRQ(ierr);
+
+  // Voxelize before the mesh is partitioned, main reuses the occupancy
+  voxels = new PrePostProcess (this);
+  ierr = voxels->Voxelize (this);
+  CHKERRQ(ierr);
+  std::vector<PetscScalar> weights[DIM];
+  ierr = voxels->SlabWeights (balanceVoidWeight, weights);
+  CHKERRQ(ierr);
+
+  // Cut each axis on the coarsest multigrid elements
+  PetscInt unit = 1 << (nlvls - 1);
+  std::vector<PetscInt> lnodes[DIM];
+  const char axes[3] = { 'x', 'y', 'z' };
+  PetscPrintf (PETSC_COMM_WORLD,
+      "# Occupancy weighted partition (-balanceDomain, void weight %g):\n",
+      balanceVoidWeight);
+  for (PetscInt axis = 0; axis < DIM; ++axis) {
+    lnodes[axis].assign (Leven[axis], Leven[axis] + nproc[axis]);
+    SplitSlabs (weights[axis], nproc[axis], unit, lnodes[axis].data ());
+    PetscPrintf (PETSC_COMM_WORLD,
+        "#   %c: %i ranks, slab weight max/mean %.3f (even %.3f)\n", axes[axis],
+        nproc[axis], SlabImbalance (weights[axis], nproc[axis],
+            lnodes[axis].data ()),
+        SlabImbalance (weights[axis], nproc[axis], Leven[axis]));
+  }
+
+  // Recreate the nodal mesh, the element mesh follows its ranges
+  ierr = DMDestroy (&da_nodes);
+  CHKERRQ(ierr);
+#if DIM == 2
+  ierr = DMDACreate2d (PETSC_COMM_WORLD, bx, by, stype, M, N, md, nd, dof, s,
+      lnodes[0].data (), lnodes[1].data (), &(da_nodes));
+  CHKERRQ(ierr);
+#elif DIM == 3
+  ierr = DMDACreate3d (PETSC_COMM_WORLD, bx, by, bz, stype, M, N, P, md, nd,
+      pd, dof, s, lnodes[0].data (), lnodes[1].data (), lnodes[2].data (),
+      &(da_nodes));
+  CHKERRQ(ierr);
+#endif
+  DMSetFromOptions (da_nodes);
+  DMSetUp (da_nodes);
+
+  return ierr;
+}
+
 PetscErrorCode TopOpt::SetUpOPT () {
 
   PetscErrorCode ierr;
@@ -718,6 +1012,15 @@ PetscErrorCode TopOpt::SetUpOPT () {
   PetscOptionsGetReal (NULL, NULL, "-volfrac", &volfrac, &flg);
   PetscOptionsGetReal (NULL, NULL, "-penal", &penal, &flg);
   PetscOptionsGetReal (NULL, NULL, "-rmin", &rmin, &flg);
+  // # new; The filter radius is a length, kept on the coarse grid stages
+  // as long as it spans 1.5 elements, so the filter still regularizes
+  if (gridStage > 0) {
+#if DIM == 2
+    rmin = PetscMax(rmin, 1.5 * PetscMax(dx, dy));
+#elif DIM == 3
+    rmin = PetscMax(rmin, 1.5 * PetscMax(dx, PetscMax(dy, dz)));
+#endif
+  }
   PetscOptionsGetInt (NULL, NULL, "-maxItr", &maxItr, &flg);
   PetscOptionsGetInt (NULL, NULL, "-filter", &filter, &flg);
   PetscOptionsGetReal (NULL, NULL, "-Xmin", &Xmin, &flg);
@@ -820,7 +1123,8 @@ PetscErrorCode TopOpt::SetUpOPT () {
   return (ierr);
 }
 
-PetscErrorCode TopOpt::AllocateMMAwithRestart (PetscInt *itr, MMA **mma) {
+PetscErrorCode TopOpt::AllocateMMAwithRestart (PetscInt *itr, MMA **mma,
+    TopOpt *coarse, MMA *coarseMMA) { // # modified
 
   PetscErrorCode ierr = 0;
 
@@ -843,6 +1147,9 @@ PetscErrorCode TopOpt::AllocateMMAwithRestart (PetscInt *itr, MMA **mma) {
   PetscBool flg;
   char filenameChar[PETSC_MAX_PATH_LEN];
   PetscOptionsGetBool (NULL, NULL, "-restart", &restart, &flg);
+  if (benchmark || gridStage > 0) {
+    restart = PETSC_FALSE; // # modified; benchmarks and coarse grid stages always start from scratch
+  }
   PetscOptionsGetBool (NULL, NULL, "-onlyLoadDesign", &onlyLoadDesign, &flg);
 
   if (restart) {
@@ -919,7 +1226,16 @@ PetscErrorCode TopOpt::AllocateMMAwithRestart (PetscInt *itr, MMA **mma) {
 
   PetscInt nGlobalDesignVar;
   VecGetSize (x, &nGlobalDesignVar); // ASSUMES THAT SIZE IS ALWAYS MATCHED TO CURRENT MESH
-  if (restart && vecFile && itrFile) {
+  if (coarse != NULL) {
+    // # new; Grid sequencing: continue from the coarser stage
+    ierr = ProlongateDesign (coarse, coarseMMA);
+    CHKERRQ(ierr);
+    *mma = new MMA (nGlobalDesignVar, m, *itr, xo1, xo2, U, L, aMMA, cMMA,
+        dMMA);
+    PetscPrintf (PETSC_COMM_WORLD,
+        "# Continue optimization from grid stage %i at iteration %i\n",
+        coarse->gridStage, *itr);
+  } else if (restart && vecFile && itrFile) { // # modified
 
     PetscViewer view;
     // Open the data files
@@ -961,6 +1277,156 @@ PetscErrorCode TopOpt::AllocateMMAwithRestart (PetscInt *itr, MMA **mma) {
   return ierr;
 }
 
+// # new
+PetscErrorCode TopOpt::Prolongate (TopOpt *coarse, Vec vc, Vec vf) {
+  PetscErrorCode ierr = 0;
+
+  // Element (i,j,k) of this mesh lies in element (i/rx,j/ry,k/rz) of the
+  // coarse mesh; the index is natural and mapped to the PETSc ordering
+  PetscInt Mc, Nc, Pc, Mf, Nf, Pf;
+  ierr = DMDAGetInfo (coarse->da_elem, NULL, &Mc, &Nc, &Pc, NULL, NULL, NULL,
+  NULL, NULL, NULL, NULL, NULL, NULL);
+  CHKERRQ(ierr);
+  ierr = DMDAGetInfo (da_elem, NULL, &Mf, &Nf, &Pf, NULL, NULL, NULL, NULL,
+  NULL, NULL, NULL, NULL, NULL);
+  CHKERRQ(ierr);
+  PetscInt rx = Mf / Mc, ry = Nf / Nc, rz = Pf / Pc;
+
+  PetscInt xs, ys, zs, xm, ym, zm;
+  ierr = DMDAGetCorners (da_elem, &xs, &ys, &zs, &xm, &ym, &zm);
+  CHKERRQ(ierr);
+  std::vector<PetscInt> idx (xm * ym * zm);
+  PetscInt nloc = 0;
+  for (PetscInt k = zs; k < zs + zm; k++) {
+    for (PetscInt j = ys; j < ys + ym; j++) {
+      for (PetscInt i = xs; i < xs + xm; i++) {
+        idx[nloc++] = ((k / rz) * Nc + j / ry) * Mc + i / rx;
+      }
+    }
+  }
+  AO ao;
+  ierr = DMDAGetAO (coarse->da_elem, &ao);
+  CHKERRQ(ierr);
+  ierr = AOApplicationToPetsc (ao, nloc, idx.data ());
+  CHKERRQ(ierr);
+
+  // The local elements are contiguous in the global vector
+  PetscInt lo;
+  ierr = VecGetOwnershipRange (vf, &lo, NULL);
+  CHKERRQ(ierr);
+  IS isc, isf;
+  ierr = ISCreateGeneral (PETSC_COMM_SELF, nloc, idx.data (),
+      PETSC_COPY_VALUES, &isc);
+  CHKERRQ(ierr);
+  ierr = ISCreateStride (PETSC_COMM_SELF, nloc, lo, 1, &isf);
+  CHKERRQ(ierr);
+  VecScatter scatter;
+  ierr = VecScatterCreate (vc, isc, vf, isf, &scatter);
+  CHKERRQ(ierr);
+  ierr = VecScatterBegin (scatter, vc, vf, INSERT_VALUES, SCATTER_FORWARD);
+  CHKERRQ(ierr);
+  ierr = VecScatterEnd (scatter, vc, vf, INSERT_VALUES, SCATTER_FORWARD);
+  CHKERRQ(ierr);
+  VecScatterDestroy (&scatter);
+  ISDestroy (&isc);
+  ISDestroy (&isf);
+
+  return ierr;
+}
+
+// # new
+PetscErrorCode TopOpt::ProlongateDesign (TopOpt *coarse, MMA *coarseMMA) {
+  PetscErrorCode ierr = 0;
+
+  // MMA history of the coarse stage
+  Vec cxo1, cxo2, cU, cL;
+  VecDuplicate (coarse->x, &cxo1);
+  VecDuplicate (coarse->x, &cxo2);
+  VecDuplicate (coarse->x, &cU);
+  VecDuplicate (coarse->x, &cL);
+  ierr = coarseMMA->Restart (cxo1, cxo2, cU, cL);
+  CHKERRQ(ierr);
+  if (xo1 == NULL) {
+    VecDuplicate (x, &xo1);
+    VecDuplicate (x, &xo2);
+    VecDuplicate (x, &U);
+    VecDuplicate (x, &L);
+  }
+
+  // Fine elements which are designable on both grids take the coarse
+  // values, the others keep the initial design of AssignPassiveElement;
+  // the asymptotes are injected everywhere
+  Vec cDesign, work;
+  VecDuplicate (x, &cDesign);
+  VecDuplicate (x, &work);
+  ierr = Prolongate (coarse, coarse->xPassive0, cDesign);
+  CHKERRQ(ierr);
+
+  VecCopy (x, xPhys);
+  VecCopy (x, xo1);
+  VecCopy (x, xo2);
+
+  Vec from[6] = { coarse->x, coarse->xPhys, cxo1, cxo2, cU, cL };
+  Vec to[6] = { x, xPhys, xo1, xo2, U, L };
+  PetscScalar *workp, *top, *cDesignp, *xPassive0p;
+  PetscInt nel;
+  VecGetLocalSize (x, &nel);
+  for (PetscInt v = 0; v < 6; ++v) {
+    ierr = Prolongate (coarse, from[v], work);
+    CHKERRQ(ierr);
+    if (to[v] == U || to[v] == L) {
+      VecCopy (work, to[v]);
+      continue;
+    }
+    VecGetArray (work, &workp);
+    VecGetArray (to[v], &top);
+    VecGetArray (cDesign, &cDesignp);
+    VecGetArray (xPassive0, &xPassive0p);
+    for (PetscInt i = 0; i < nel; i++) {
+      if (xPassive0p[i] != 0 && cDesignp[i] != 0) {
+        top[i] = workp[i];
+      }
+    }
+    VecRestoreArray (work, &workp);
+    VecRestoreArray (to[v], &top);
+    VecRestoreArray (cDesign, &cDesignp);
+    VecRestoreArray (xPassive0, &xPassive0p);
+  }
+  VecCopy (x, xold);
+
+  // Scaling of the objective and projection continuation go on
+  fscale = coarse->fscale;
+  beta = coarse->beta;
+
+  VecDestroy (&cxo1);
+  VecDestroy (&cxo2);
+  VecDestroy (&cU);
+  VecDestroy (&cL);
+  VecDestroy (&cDesign);
+  VecDestroy (&work);
+
+  return ierr;
+}
+
+// # new
+PetscErrorCode TopOpt::AccountMemory (MemoryReport *mem) {
+  PetscErrorCode ierr = 0;
+  mem->Add ("Design vectors",
+      MemoryReport::VecBytes (x) + MemoryReport::VecBytes (xTilde)
+      + MemoryReport::VecBytes (xPhys) + MemoryReport::VecBytes (dfdx)
+      + MemoryReport::VecsBytes (dgdx, m) + MemoryReport::VecBytes (xmin)
+      + MemoryReport::VecBytes (xmax) + MemoryReport::VecBytes (xold));
+  mem->Add ("Passive and nodal vectors",
+      MemoryReport::VecBytes (xPassive0) + MemoryReport::VecBytes (xPassive1)
+      + MemoryReport::VecBytes (xPassive2) + MemoryReport::VecBytes (xPassive3)
+      + MemoryReport::VecBytes (nodeDensity)
+      + MemoryReport::VecBytes (nodeAddingCounts));
+  mem->Add ("Restart vectors",
+      MemoryReport::VecBytes (xo1) + MemoryReport::VecBytes (xo2)
+      + MemoryReport::VecBytes (U) + MemoryReport::VecBytes (L));
+  return ierr;
+}
+
 PetscErrorCode TopOpt::WriteRestartFiles (PetscInt *itr, MMA *mma) {
 
   PetscErrorCode ierr = 0;
@@ -1030,3 +1496,5 @@ PetscErrorCode TopOpt::WriteRestartFiles (PetscInt *itr, MMA *mma) {
   // PetscPrintf(PETSC_COMM_WORLD,"DONE WRITING DATA\n");
   return ierr;
 }
+
+TOPOPT_NAMESPACE_END // # new
@@ -11,6 +11,12 @@
 #include <sstream>
 
 #include "options.h" // # new; framework options
+#include "memoryreport.h" // # new
+#include <vector> // # new
+
+TOPOPT_NAMESPACE_BEGIN // # new
+
+class PrePostProcess; // # new; voxelized geometry for -balanceDomain
 
 /*
  Authors: Niels Aage, Erik Andreassen, Boyan Lazarov, August 2013
@@ -45,12 +51,19 @@ class TopOpt {
     // Constructor/Destructor
     TopOpt (PetscInt nconstraint);
     TopOpt ();
+    // # new; Mesh coarsened stage times by 2 for grid sequencing
+    TopOpt (PetscInt nconstraint, PetscInt stage);
     ~TopOpt ();
 
     // Method to allocate MMA with/without restarting
-    PetscErrorCode AllocateMMAwithRestart (PetscInt *itr, MMA **mma);
+    // # modified; or continue from the design of a coarser grid stage
+    PetscErrorCode AllocateMMAwithRestart (PetscInt *itr, MMA **mma,
+        TopOpt *coarse = NULL, MMA *coarseMMA = NULL);
     PetscErrorCode WriteRestartFiles (PetscInt *itr, MMA *mma);
 
+    // # new; Add the bytes of the design vectors to the memory report
+    PetscErrorCode AccountMemory (MemoryReport *mem);
+
     // Physical domain variables
     PetscScalar xc[2 * DIM]; // # modified; Domain coordinates
     PetscScalar dx, dy, dz; // Element size
@@ -110,6 +123,19 @@ class TopOpt {
     PetscErrorCode SetUpMESH ();
     PetscErrorCode SetUpOPT ();
 
+    // # new; Shrink the mesh to the bounding box of the geometry
+    PetscErrorCode CropDomain ();
+
+    // # new; Coarsen the mesh and the multigrid levels for a grid stage
+    PetscErrorCode CoarsenMESH ();
+
+    // # new; Inject the design and the MMA history of a coarser stage
+    PetscErrorCode ProlongateDesign (TopOpt *coarse, MMA *coarseMMA);
+    PetscErrorCode Prolongate (TopOpt *coarse, Vec vc, Vec vf);
+
+    // # new; Recreate da_nodes with occupancy weighted ownership ranges
+    PetscErrorCode BalanceMESH ();
+
     // Restart filenames
     std::string filename00, filename00Itr, filename01, filename01Itr;
 
@@ -146,6 +172,17 @@ class TopOpt {
     Vec xPassive2; // # new; the passive loading position element index
     Vec nodeDensity; // # new; node density
     Vec nodeAddingCounts; // # new; node adding counts when summing node density from element density
+    PetscBool benchmark; // # new; synthetic cantilever/box domain instead of the STL input
+    PetscBool balanceDomain; // # new; occupancy weighted ownership ranges of da_nodes/da_elem
+    PetscScalar balanceVoidWeight; // # new; work of a void element relative to an active one
+    PrePostProcess *voxels; // # new; geometry voxelized for -balanceDomain, owned by main afterwards
+    PetscBool cropDomain; // # new; mesh cropped to the bounding box of the geometry
+    PetscInt cropPadding; // # new; empty elements kept around the geometry when cropping
+    PetscInt gridStage; // # new; grid sequencing stage, the mesh is coarsened gridStage times by 2
+    PetscInt physics; // # new; physical problem of -physics, 0-Linear elasticity, 1-Compliant, 2-Heat conduction
+    PetscInt importGeo; // # new; 0-Default geometries, 1-Imported CAD geometries of -importGeo
 };
 
+TOPOPT_NAMESPACE_END // # new
+
 #endif
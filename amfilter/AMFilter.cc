@@ -0,0 +1,448 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * AMFilter.cc
+ */
+
+#include "AMFilter.h"
+#include "petscutils.h"
+
+#include <cstdlib>
+#include <cstring>
+
+TOPOPT_NAMESPACE_BEGIN // # new
+
+static const char *faceNames[6] = { "xmin", "xmax", "ymin", "ymax", "zmin",
+    "zmax" };
+
+// Message tags of the two sweeps
+static const PetscMPIInt forwardTag = 0, adjointTag = 1;
+
+AMFilter::AMFilter (DM da_nodes, Vec xPassive0) {
+  buildAxis = -1;
+  buildSign = 1;
+  nLayers = 0;
+  W1 = 1;
+  W2 = 1;
+  L = 0;
+  layer0 = 0;
+  tile = 1;
+  prev = -1;
+  next = -1;
+  P = 40.0;
+  epsilon = 1.0e-4;
+  xi0 = 0.5;
+  slab = NULL;
+  scatter = NULL;
+
+  char faceChar[PETSC_MAX_PATH_LEN];
+  PetscBool flg;
+  PetscOptionsGetString (NULL, NULL, "-amBasePlate", faceChar,
+      sizeof(faceChar), &flg);
+  if (!flg) return;
+  PetscInt f = 0;
+  while (f < 2 * DIM && strcmp (faceChar, faceNames[f]) != 0) {
+    f++;
+  }
+  if (f == 2 * DIM) {
+    PetscPrintf (PETSC_COMM_WORLD,
+        "# -amBasePlate: '%s' is not a face of the %iD mesh (xmin, xmax, ..)\n",
+        faceChar, DIM);
+    exit (0);
+  }
+  buildAxis = f / 2;
+  buildSign = (f % 2 == 0) ? 1 : -1;
+  PetscOptionsGetReal (NULL, NULL, "-amP", &P, &flg);
+  PetscOptionsGetReal (NULL, NULL, "-amEpsilon", &epsilon, &flg);
+
+  // Elements per axis, the transverse axes follow the build axis
+  PetscInt nn[3] = { 1, 1, 1 }, ne[3] = { 1, 1, 1 };
+  DMDAGetInfo (da_nodes, NULL, &nn[0], &nn[1], &nn[2], NULL, NULL, NULL, NULL,
+      NULL, NULL, NULL, NULL, NULL);
+  for (PetscInt a = 0; a < DIM; ++a) {
+    ne[a] = nn[a] - 1;
+  }
+  PetscInt t1 = (buildAxis == 0) ? 1 : 0;
+  PetscInt t2 = (buildAxis == 2) ? 1 : 2;
+  nLayers = ne[buildAxis];
+  W1 = ne[t1];
+  W2 = ne[t2];
+  PetscInt W = W1 * W2;
+
+  // Slabs of whole layers, the ranks with layers come first
+  MPI_Comm comm;
+  PetscObjectGetComm ((PetscObject) da_nodes, &comm);
+  PetscMPIInt rank, size;
+  MPI_Comm_rank (comm, &rank);
+  MPI_Comm_size (comm, &size);
+  layers.resize (size);
+  for (PetscMPIInt r = 0; r < size; ++r) {
+    layers[r] = nLayers / size + (r < nLayers % size ? 1 : 0);
+    if (r < rank) {
+      layer0 += layers[r];
+    }
+  }
+  L = layers[rank];
+  prev = (rank > 0 && L > 0) ? rank - 1 : -1;
+  next = (rank + 1 < size && layers[rank + 1] > 0) ? rank + 1 : -1;
+  PetscInt nActive = PetscMin(size, nLayers);
+  tile = PetscMax(1, W1 / (4 * nActive));
+  PetscOptionsGetInt (NULL, NULL, "-amTile", &tile, &flg);
+  tile = PetscMax(1, tile);
+
+  // Local elements of the slab in natural -> PETSc ordering of the mesh
+  PetscInt nloc = L * W;
+  std::vector<PetscInt> idx (nloc);
+  for (PetscInt l = 0; l < L; ++l) {
+    PetscInt k = layer0 + l;
+    for (PetscInt b = 0; b < W2; ++b) {
+      for (PetscInt a = 0; a < W1; ++a) {
+        PetscInt c[3];
+        c[buildAxis] = (buildSign > 0) ? k : ne[buildAxis] - 1 - k;
+        c[t1] = a;
+        c[t2] = b;
+        idx[l * W + b * W1 + a] = c[0] + c[1] * ne[0] + c[2] * ne[0] * ne[1];
+      }
+    }
+  }
+  DM daElem;
+  AO ao;
+  CreateElementDA (da_nodes, &daElem);
+  DMDAGetAO (daElem, &ao);
+  AOApplicationToPetsc (ao, nloc, idx.data ());
+
+  VecCreateMPI (comm, nloc, nLayers * W, &slab);
+  IS isFrom, isTo;
+  ISCreateGeneral (comm, nloc, idx.data (), PETSC_COPY_VALUES, &isFrom);
+  ISCreateStride (comm, nloc, layer0 * W, 1, &isTo);
+  VecScatterCreate (xPassive0, isFrom, slab, isTo, &scatter);
+  ISDestroy (&isFrom);
+  ISDestroy (&isTo);
+  DMDestroy (&daElem);
+
+  // Design elements are filtered
+  xBlue.resize (nloc);
+  design.resize (nloc);
+  xi.resize ((L + 1) * W);
+  VecScatterBegin (scatter, xPassive0, slab, INSERT_VALUES, SCATTER_FORWARD);
+  VecScatterEnd (scatter, xPassive0, slab, INSERT_VALUES, SCATTER_FORWARD);
+  PetscScalar *sp;
+  VecGetArray (slab, &sp);
+  for (PetscInt e = 0; e < nloc; ++e) {
+    design[e] = (sp[e] != 0) ? 1.0 : 0.0;
+  }
+  VecRestoreArray (slab, &sp);
+
+  PetscPrintf (PETSC_COMM_WORLD,
+      "##############################################################\n");
+  PetscPrintf (PETSC_COMM_WORLD,
+      "# AM filter (-amBasePlate): %s, %i layers on %i ranks, tile "
+          "(-amTile) %i, P (-amP) %f, epsilon (-amEpsilon) %e\n",
+      faceNames[f], nLayers, nActive, tile, P, epsilon);
+}
+
+AMFilter::~AMFilter () {
+  if (scatter != NULL) {
+    VecScatterDestroy (&scatter);
+  }
+  if (slab != NULL) {
+    VecDestroy (&slab);
+  }
+}
+
+PetscInt AMFilter::ForwardPrefix (PetscInt c, PetscInt n) const {
+  // The top layer of tile c ends n - 1 columns before its bottom
+  if (c >= Tiles (n) - 1) return W1;
+  return PetscMax(0, PetscMin(W1, (c + 1) * tile - (n - 1)));
+}
+
+PetscInt AMFilter::AdjointPrefix (PetscInt c, PetscInt n) const {
+  // A column of the layer below also needs its right neighbour above
+  if (c >= Tiles (n) - 1) return W1;
+  return PetscMax(0, PetscMin(W1, (c + 1) * tile - n));
+}
+
+PetscInt AMFilter::Supports (PetscInt a, PetscInt b, PetscInt *s) const {
+  PetscInt n = 0;
+  s[n++] = a + W1 * b;
+  if (a > 0) s[n++] = a - 1 + W1 * b;
+  if (a < W1 - 1) s[n++] = a + 1 + W1 * b;
+#if DIM == 3
+  if (b > 0) s[n++] = a + W1 * (b - 1);
+  if (b < W2 - 1) s[n++] = a + W1 * (b + 1);
+#endif
+  return n;
+}
+
+PetscScalar AMFilter::SmoothMax (const PetscScalar *v, PetscInt n,
+    PetscScalar *dv) const {
+  // P-norm with the exponent Q chosen so that n supports at xi0 give xi0
+  PetscScalar Q = P + PetscLogScalar((PetscScalar) n) / PetscLogScalar(xi0);
+  PetscScalar S = 0.0;
+  for (PetscInt j = 0; j < n; ++j) {
+    S += PetscPowScalar(v[j], P);
+  }
+  if (S <= 0.0) {
+    for (PetscInt j = 0; j < n; ++j) {
+      dv[j] = 0.0;
+    }
+    return 0.0;
+  }
+  PetscScalar smax = PetscPowScalar(S, 1.0 / Q);
+  for (PetscInt j = 0; j < n; ++j) {
+    dv[j] = P / Q * smax / S * PetscPowScalar(v[j], P - 1.0);
+  }
+  return smax;
+}
+
+PetscScalar AMFilter::SmoothMin (PetscScalar x, PetscScalar y,
+    PetscScalar *dx, PetscScalar *dy) const {
+  PetscScalar s = PetscSqrtScalar((x - y) * (x - y) + epsilon);
+  *dx = 0.5 * (1.0 - (x - y) / s);
+  *dy = 0.5 * (1.0 + (x - y) / s);
+  return 0.5 * (x + y - s + PetscSqrtScalar(epsilon));
+}
+
+PetscErrorCode AMFilter::FilterProject (Vec x, Vec xPrint) {
+  PetscErrorCode ierr = 0;
+  if (!Active ()) {
+    if (x != xPrint) {
+      ierr = VecCopy (x, xPrint);
+      CHKERRQ(ierr);
+    }
+    return ierr;
+  }
+
+  ierr = VecScatterBegin (scatter, x, slab, INSERT_VALUES, SCATTER_FORWARD);
+  CHKERRQ(ierr);
+  ierr = VecScatterEnd (scatter, x, slab, INSERT_VALUES, SCATTER_FORWARD);
+  CHKERRQ(ierr);
+  PetscScalar *sp;
+  VecGetArray (slab, &sp);
+  std::copy (sp, sp + xBlue.size (), xBlue.begin ());
+
+  MPI_Comm comm;
+  PetscObjectGetComm ((PetscObject) slab, &comm);
+  PetscInt W = W1 * W2;
+  std::vector<PetscScalar> &buf = work;
+  buf.resize (W);
+  PetscInt nPrev = (prev >= 0) ? layers[prev] : 0;
+  PetscInt recvEnd = (prev >= 0) ? 0 : W1, recvTile = -1, sendEnd = 0;
+  PetscInt s[5];
+  PetscScalar v[5], dv[5], dsx, dsy;
+
+  for (PetscInt c = 0; L > 0 && c < Tiles (L); ++c) {
+    // Supports of the bottom layer from the slab below
+    PetscInt need = PetscMin(W1, (c + 1) * tile + 1);
+    while (recvEnd < need) {
+      PetscInt end = ForwardPrefix (++recvTile, nPrev);
+      if (end <= recvEnd) continue;
+      PetscInt w = end - recvEnd;
+      ierr = MPI_Recv (buf.data (), w * W2, MPIU_SCALAR, prev, forwardTag,
+          comm, MPI_STATUS_IGNORE);
+      CHKERRQ(ierr);
+      for (PetscInt b = 0; b < W2; ++b) {
+        for (PetscInt a = 0; a < w; ++a) {
+          xi[recvEnd + a + W1 * b] = buf[b * w + a];
+        }
+      }
+      recvEnd = end;
+    }
+
+    // Skewed tile, bottom up
+    for (PetscInt l = 0; l < L; ++l) {
+      PetscInt lo = PetscMax(0, c * tile - l);
+      PetscInt hi = PetscMin(W1, (c + 1) * tile - l);
+      const PetscScalar *below = &xi[l * W];
+      PetscScalar *cur = &xi[(l + 1) * W];
+      for (PetscInt b = 0; b < W2; ++b) {
+        for (PetscInt a = lo; a < hi; ++a) {
+          PetscInt t = a + W1 * b, e = l * W + t;
+          if (layer0 + l == 0 || design[e] == 0) {
+            cur[t] = xBlue[e];
+            continue;
+          }
+          PetscInt n = Supports (a, b, s);
+          for (PetscInt j = 0; j < n; ++j) {
+            v[j] = below[s[j]];
+          }
+          cur[t] = SmoothMin (xBlue[e], SmoothMax (v, n, dv), &dsx, &dsy);
+        }
+      }
+    }
+
+    // Final columns of the top layer to the slab above
+    PetscInt end = ForwardPrefix (c, L);
+    if (next >= 0 && end > sendEnd) {
+      PetscInt w = end - sendEnd;
+      for (PetscInt b = 0; b < W2; ++b) {
+        for (PetscInt a = 0; a < w; ++a) {
+          buf[b * w + a] = xi[L * W + sendEnd + a + W1 * b];
+        }
+      }
+      ierr = MPI_Send (buf.data (), w * W2, MPIU_SCALAR, next, forwardTag,
+          comm);
+      CHKERRQ(ierr);
+      sendEnd = end;
+    }
+  }
+
+  std::copy (xi.begin () + W, xi.end (), sp);
+  VecRestoreArray (slab, &sp);
+  ierr = VecScatterBegin (scatter, slab, xPrint, INSERT_VALUES,
+      SCATTER_REVERSE);
+  CHKERRQ(ierr);
+  ierr = VecScatterEnd (scatter, slab, xPrint, INSERT_VALUES, SCATTER_REVERSE);
+  CHKERRQ(ierr);
+
+  return ierr;
+}
+
+PetscErrorCode AMFilter::Gradients (Vec dfdx, PetscInt m, Vec *dgdx) {
+  PetscErrorCode ierr = 0;
+  if (!Active ()) return ierr;
+
+  // All the sensitivities in one sweep, interleaved per element, with the
+  // contributions to the top layer of the slab below first
+  PetscInt nv = 1 + m, W = W1 * W2;
+  vecs.resize (nv);
+  vecs[0] = dfdx;
+  for (PetscInt i = 0; i < m; ++i) {
+    vecs[1 + i] = dgdx[i];
+  }
+  lam.assign ((L + 1) * W * nv, 0.0);
+  PetscScalar *sp;
+  for (PetscInt i = 0; i < nv; ++i) {
+    ierr = VecScatterBegin (scatter, vecs[i], slab, INSERT_VALUES,
+        SCATTER_FORWARD);
+    CHKERRQ(ierr);
+    ierr = VecScatterEnd (scatter, vecs[i], slab, INSERT_VALUES,
+        SCATTER_FORWARD);
+    CHKERRQ(ierr);
+    VecGetArray (slab, &sp);
+    for (PetscInt e = 0; e < L * W; ++e) {
+      lam[(W + e) * nv + i] = sp[e];
+    }
+    VecRestoreArray (slab, &sp);
+  }
+
+  MPI_Comm comm;
+  PetscObjectGetComm ((PetscObject) slab, &comm);
+  std::vector<PetscScalar> &buf = work;
+  buf.resize (W * nv);
+  PetscInt nNext = (next >= 0) ? layers[next] : 0;
+  PetscInt recvEnd = (next >= 0) ? 0 : W1, recvTile = -1, sendEnd = 0;
+  PetscInt s[5];
+  PetscScalar v[5], dv[5], dsx, dsy;
+
+  for (PetscInt c = 0; L > 0 && c < Tiles (L); ++c) {
+    // Contributions of the slab above to the top layer
+    PetscInt need = PetscMin(W1, (c + 1) * tile);
+    while (recvEnd < need) {
+      PetscInt end = AdjointPrefix (++recvTile, nNext);
+      if (end <= recvEnd) continue;
+      PetscInt w = end - recvEnd;
+      ierr = MPI_Recv (buf.data (), w * W2 * nv, MPIU_SCALAR, next,
+          adjointTag, comm, MPI_STATUS_IGNORE);
+      CHKERRQ(ierr);
+      for (PetscInt b = 0; b < W2; ++b) {
+        for (PetscInt a = 0; a < w; ++a) {
+          PetscScalar *lt = &lam[(L * W + recvEnd + a + W1 * b) * nv];
+          for (PetscInt i = 0; i < nv; ++i) {
+            lt[i] += buf[(b * w + a) * nv + i];
+          }
+        }
+      }
+      recvEnd = end;
+    }
+
+    // Skewed tile, top down
+    for (PetscInt l = L - 1; l >= 0; --l) {
+      PetscInt lp = L - 1 - l;
+      PetscInt lo = PetscMax(0, c * tile - lp);
+      PetscInt hi = PetscMin(W1, (c + 1) * tile - lp);
+      for (PetscInt b = 0; b < W2; ++b) {
+        for (PetscInt a = lo; a < hi; ++a) {
+          PetscInt t = a + W1 * b, e = l * W + t;
+          if (layer0 + l == 0 || design[e] == 0) continue;
+          PetscInt n = Supports (a, b, s);
+          for (PetscInt j = 0; j < n; ++j) {
+            v[j] = xi[l * W + s[j]];
+          }
+          SmoothMin (xBlue[e], SmoothMax (v, n, dv), &dsx, &dsy);
+          PetscScalar *lt = &lam[(W + e) * nv];
+          for (PetscInt j = 0; j < n; ++j) {
+            PetscScalar *lb = &lam[(l * W + s[j]) * nv];
+            for (PetscInt i = 0; i < nv; ++i) {
+              lb[i] += dsy * dv[j] * lt[i];
+            }
+          }
+          for (PetscInt i = 0; i < nv; ++i) {
+            lt[i] *= dsx;
+          }
+        }
+      }
+    }
+
+    // Final contributions to the top layer of the slab below
+    PetscInt end = AdjointPrefix (c, L);
+    if (prev >= 0 && end > sendEnd) {
+      PetscInt w = end - sendEnd;
+      for (PetscInt b = 0; b < W2; ++b) {
+        for (PetscInt a = 0; a < w; ++a) {
+          for (PetscInt i = 0; i < nv; ++i) {
+            buf[(b * w + a) * nv + i] = lam[(sendEnd + a + W1 * b) * nv + i];
+          }
+        }
+      }
+      ierr = MPI_Send (buf.data (), w * W2 * nv, MPIU_SCALAR, prev,
+          adjointTag, comm);
+      CHKERRQ(ierr);
+      sendEnd = end;
+    }
+  }
+
+  for (PetscInt i = 0; i < nv; ++i) {
+    VecGetArray (slab, &sp);
+    for (PetscInt e = 0; e < L * W; ++e) {
+      sp[e] = lam[(W + e) * nv + i];
+    }
+    VecRestoreArray (slab, &sp);
+    ierr = VecScatterBegin (scatter, slab, vecs[i], INSERT_VALUES,
+        SCATTER_REVERSE);
+    CHKERRQ(ierr);
+    ierr = VecScatterEnd (scatter, slab, vecs[i], INSERT_VALUES,
+        SCATTER_REVERSE);
+    CHKERRQ(ierr);
+  }
+
+  return ierr;
+}
+
+PetscErrorCode AMFilter::AccountMemory (MemoryReport *mem) {
+  PetscErrorCode ierr = 0;
+  if (!Active ()) return ierr;
+  mem->Add ("AM filter slabs",
+      MemoryReport::VecBytes (slab)
+      + (xBlue.size () + design.size () + xi.size () + lam.capacity ()
+          + work.capacity ()) * sizeof(PetscScalar));
+  return ierr;
+}
+
+TOPOPT_NAMESPACE_END // # new
@@ -0,0 +1,151 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * AMFilter.h
+ */
+
+#ifndef AMFILTER_H_
+#define AMFILTER_H_
+
+#include <vector>
+#include <petsc.h>
+
+#include "options.h"
+#include "memoryreport.h"
+
+TOPOPT_NAMESPACE_BEGIN // # new
+
+/*
+ * Additive manufacturing filter (Langelaar 2017): the printed density of an
+ * element is the smooth minimum of its blueprint density and the smooth
+ * maximum of the printed densities of its supports, the element below and
+ * its neighbours in the layer below (3 in 2D, 5 in 3D). The first layer
+ * lies on the base plate; the passive elements are not filtered but do
+ * support the layers above.
+ *
+ * The layers are sequential, so the elements are redistributed into slabs
+ * of whole layers, one slab per rank along the build direction. The slabs
+ * are swept as a pipeline: the layers of a slab are cut into tiles along
+ * the first transverse axis, skewed by one element per layer, and the
+ * final part of the top layer is sent to the next slab after every tile,
+ * so all the slabs work at the same time after a start up of one tile per
+ * rank. The sensitivities are swept the same way from the top down.
+ *
+ * Options:
+ * -amBasePlate <string>  face of the base plate, e.g. zmin; the build
+ *                        direction points into the domain (default none,
+ *                        no AM filter)
+ * -amTile <int>          tile width in elements (default: 4 tiles per
+ *                        slab and rank)
+ * -amP <real>            exponent of the smooth maximum (default 40)
+ * -amEpsilon <real>      smoothing of the smooth minimum (default 1e-4)
+ */
+class AMFilter {
+  public:
+
+    /*
+     * Constructor, reads the options and sets up the slabs
+     * \param[in] nodal mesh and design elements (xPassive0) of TopOpt
+     */
+    AMFilter (DM da_nodes, Vec xPassive0);
+
+    /*
+     * Destructor
+     */
+    ~AMFilter ();
+
+    /*
+     * A base plate has been given
+     */
+    PetscBool Active () const {
+      return (PetscBool) (buildAxis >= 0);
+    }
+
+    /*
+     * Printed densities of the blueprint densities
+     * \param[in] blueprint densities
+     * \param[out] printed densities, may be the same vector
+     * \return PetscErrorCode
+     */
+    PetscErrorCode FilterProject (Vec x, Vec xPrint);
+
+    /*
+     * Chain rule of the printed densities of the last FilterProject, in
+     * place: derivatives w.r.t. the printed densities in, w.r.t. the
+     * blueprint densities out
+     * \param[in,out] objective and constraint sensitivities
+     * \return PetscErrorCode
+     */
+    PetscErrorCode Gradients (Vec dfdx, PetscInt m, Vec *dgdx);
+
+    /*
+     * Add the bytes of the slabs to the memory report
+     */
+    PetscErrorCode AccountMemory (MemoryReport *mem);
+
+  private:
+    PetscInt buildAxis; // axis of the build direction, -1 without filter
+    PetscInt buildSign; // 1 from the minimum face, -1 from the maximum
+    PetscInt nLayers; // along the build direction
+    PetscInt W1, W2; // layer size along the transverse axes (W2 = 1 in 2D)
+    PetscInt L, layer0; // local layers and first local layer
+    PetscInt tile; // tile width along the first transverse axis
+    PetscMPIInt prev, next; // ranks of the slabs below and above, or -1
+    std::vector<PetscInt> layers; // layers of every rank
+    PetscScalar P, epsilon, xi0;
+
+    Vec slab; // slab layout
+    VecScatter scatter; // element mesh -> slabs
+
+    // Per local element of the slab, layer by layer: blueprint density and
+    // design flag; printed density with the top layer of the slab below
+    // first
+    std::vector<PetscScalar> xBlue, design, xi;
+
+    // Scratch of the sweeps, kept between the iterations: adjoints of all
+    // the sensitivities and the message buffer
+    std::vector<Vec> vecs;
+    std::vector<PetscScalar> lam, work;
+
+    // Tiles of a slab of n layers
+    PetscInt Tiles (PetscInt n) const {
+      return (W1 + n - 1 + tile - 1) / tile;
+    }
+
+    // Columns of the top layer final after tile c, forward sweep
+    PetscInt ForwardPrefix (PetscInt c, PetscInt n) const;
+
+    // Columns of the layer below final after tile c, adjoint sweep
+    PetscInt AdjointPrefix (PetscInt c, PetscInt n) const;
+
+    // Supports of element (a, b) in the layer below, returns their number
+    PetscInt Supports (PetscInt a, PetscInt b, PetscInt *s) const;
+
+    // Smooth maximum of the supports and its derivatives
+    PetscScalar SmoothMax (const PetscScalar *v, PetscInt n,
+        PetscScalar *dv) const;
+
+    // Smooth minimum and its derivatives
+    PetscScalar SmoothMin (PetscScalar x, PetscScalar y, PetscScalar *dx,
+        PetscScalar *dy) const;
+};
+
+TOPOPT_NAMESPACE_END // # new
+
+#endif /* AMFILTER_H_ */
@@ -0,0 +1,320 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * assemblymap.cc
+ */
+
+#include "assemblymap.h"
+
+#include <algorithm>
+#include <climits>
+
+AssemblyMap::AssemblyMap () {
+  enabled = PETSC_TRUE;
+  tried = PETSC_FALSE;
+  active = PETSC_FALSE;
+  nedof = 0;
+  nodes = 0;
+  PetscBool flg;
+  PetscOptionsGetBool (NULL, NULL, "-assemblyMap", &enabled, &flg);
+}
+
+PetscErrorCode AssemblyMap::Blocks (Mat K, Mat *Ad, Mat *Ao) {
+  PetscErrorCode ierr = 0;
+  PetscBool isMPI;
+  ierr = PetscObjectTypeCompare ((PetscObject) K, MATMPIAIJ, &isMPI);
+  CHKERRQ(ierr);
+  if (isMPI) {
+    const PetscInt *garray;
+    ierr = MatMPIAIJGetSeqAIJ (K, Ad, Ao, &garray);
+    CHKERRQ(ierr);
+  } else {
+    *Ad = K;
+    *Ao = NULL;
+  }
+  return ierr;
+}
+
+PetscErrorCode AssemblyMap::SetUp (Mat K, PetscInt nel, PetscInt nen,
+    const PetscInt *necon, PetscInt dof) {
+  PetscErrorCode ierr = 0;
+  tried = PETSC_TRUE;
+
+  PetscBool isMPI, isSeq;
+  ierr = PetscObjectTypeCompare ((PetscObject) K, MATMPIAIJ, &isMPI);
+  CHKERRQ(ierr);
+  ierr = PetscObjectTypeCompare ((PetscObject) K, MATSEQAIJ, &isSeq);
+  CHKERRQ(ierr);
+  if (!isMPI && !isSeq) return ierr;
+
+  Mat Ad, Ao = NULL;
+  const PetscInt *garray = NULL;
+  PetscInt nGarray = 0;
+  if (isMPI) {
+    ierr = MatMPIAIJGetSeqAIJ (K, &Ad, &Ao, &garray);
+    CHKERRQ(ierr);
+    ierr = MatGetSize (Ao, NULL, &nGarray);
+    CHKERRQ(ierr);
+  } else {
+    Ad = K;
+  }
+  PetscInt rstart, rend, cstart, cend;
+  ierr = MatGetOwnershipRange (K, &rstart, &rend);
+  CHKERRQ(ierr);
+  ierr = MatGetOwnershipRangeColumn (K, &cstart, &cend);
+  CHKERRQ(ierr);
+  ISLocalToGlobalMapping rmap, cmap;
+  ierr = MatGetLocalToGlobalMapping (K, &rmap, &cmap);
+  CHKERRQ(ierr);
+
+  // Rows of the blocks, the columns are sorted within a row
+  PetscInt nd, no = 0;
+  const PetscInt *iad, *jad, *iao = NULL, *jao = NULL;
+  PetscBool done;
+  ierr = MatGetRowIJ (Ad, 0, PETSC_FALSE, PETSC_FALSE, &nd, &iad, &jad,
+      &done);
+  CHKERRQ(ierr);
+  PetscBool ok = done;
+  if (Ao != NULL) {
+    ierr = MatGetRowIJ (Ao, 0, PETSC_FALSE, PETSC_FALSE, &no, &iao, &jao,
+        &done);
+    CHKERRQ(ierr);
+    ok = (PetscBool) (ok && done);
+  }
+  if (ok && (iad[nd] >= INT_MAX || (Ao != NULL && iao[no] >= INT_MAX))) {
+    ok = PETSC_FALSE;
+  }
+
+  nedof = nen * dof;
+  nodes = nen;
+  offsets.assign (ok ? nel * nedof * nen : 0, -1);
+  ghostElements.clear ();
+  std::vector<PetscInt> gdof (nedof);
+  edof.resize (nedof);
+  for (PetscInt i = 0; ok && i < nel; i++) {
+    for (PetscInt j = 0; j < nen; j++) {
+      for (PetscInt k = 0; k < dof; k++) {
+        edof[j * dof + k] = dof * necon[i * nen + j] + k;
+      }
+    }
+    ierr = ISLocalToGlobalMappingApply (rmap, nedof, edof.data (),
+        gdof.data ());
+    CHKERRQ(ierr);
+    int *o = &offsets[i * nedof * nen];
+    PetscBool ghost = PETSC_FALSE;
+    for (PetscInt k = 0; ok && k < nedof; k++) {
+      if (gdof[k] < rstart || gdof[k] >= rend) {
+        ghost = PETSC_TRUE;
+        continue;
+      }
+      PetscInt r = gdof[k] - rstart;
+      // The dofs of a node are consecutive columns of the row, in either
+      // block, so only the first one is recorded
+      for (PetscInt j = 0; ok && j < nen; j++) {
+        PetscInt c = gdof[j * dof];
+        if (c >= cstart && c < cend) {
+          const PetscInt *p = std::lower_bound (jad + iad[r], jad + iad[r + 1],
+              c - cstart);
+          for (PetscInt d = 0; ok && d < dof; d++) {
+            ok = (PetscBool) (p + d < jad + iad[r + 1]
+                              && p[d] == c - cstart + d);
+          }
+          o[k * nen + j] = (int) (p - jad);
+        } else if (Ao != NULL) {
+          // Compressed columns of the off-diagonal block
+          const PetscInt *g = std::lower_bound (garray, garray + nGarray, c);
+          const PetscInt *p = std::lower_bound (jao + iao[r], jao + iao[r + 1],
+              (PetscInt) (g - garray));
+          for (PetscInt d = 0; ok && d < dof; d++) {
+            ok = (PetscBool) (g + d < garray + nGarray && g[d] == c + d
+                              && p + d < jao + iao[r + 1]
+                              && p[d] == g - garray + d);
+          }
+          o[k * nen + j] = -(int) (p - jao) - 2;
+        } else {
+          ok = PETSC_FALSE;
+        }
+      }
+    }
+    if (ghost) ghostElements.push_back (i);
+  }
+
+  ierr = MatRestoreRowIJ (Ad, 0, PETSC_FALSE, PETSC_FALSE, &nd, &iad, &jad,
+      &done);
+  CHKERRQ(ierr);
+  if (Ao != NULL) {
+    ierr = MatRestoreRowIJ (Ao, 0, PETSC_FALSE, PETSC_FALSE, &no, &iao, &jao,
+        &done);
+    CHKERRQ(ierr);
+  }
+
+  // All the ranks assemble the same way
+  PetscMPIInt local = ok ? 1 : 0, global;
+  MPI_Comm comm;
+  PetscObjectGetComm ((PetscObject) K, &comm);
+  ierr = MPI_Allreduce (&local, &global, 1, MPI_INT, MPI_MIN, comm);
+  CHKERRQ(ierr);
+  if (!global) {
+    std::vector<int> ().swap (offsets);
+    std::vector<PetscInt> ().swap (ghostElements);
+    return ierr;
+  }
+  coloring.SetUp (nel, nen, necon);
+  active = PETSC_TRUE;
+
+  PetscPrintf (comm, "# Assembly map (-assemblyMap): %i offsets per element "
+      "cached\n", nedof * nen);
+  return ierr;
+}
+
+template<PetscInt NSD, PetscInt NDOF>
+void AssemblyMap::AddElements (PetscScalar *ad, PetscScalar *ao,
+    const PetscScalar *KE, const PetscScalar *xp, PetscScalar Emin,
+    PetscScalar Emax, PetscScalar penal) {
+  const PetscInt nen = NSD > 0 ? (1 << NSD) : nodes;
+  const PetscInt dof = NDOF > 0 ? NDOF : nedof / nodes;
+  const PetscInt n = nen * dof;
+  for (PetscInt c = 0; c < coloring.Colors (); c++) {
+    const PetscInt *elements = coloring.Elements (c);
+    TOPOPT_OMP(parallel for)
+    for (PetscInt e = 0; e < coloring.Size (c); e++) {
+      PetscInt i = elements[e];
+      PetscScalar dens = Emin + PetscPowScalar(xp[i], penal) * (Emax - Emin);
+      const int *o = &offsets[i * n * nen];
+      for (PetscInt k = 0; k < n; k++) {
+        for (PetscInt j = 0; j < nen; j++) {
+          // Row k, the dof columns of node j
+          const PetscScalar *ke = &KE[k * n + j * dof];
+          const int q = o[k * nen + j];
+          if (q >= 0) {
+            PetscScalar *a = &ad[q];
+            for (PetscInt d = 0; d < dof; d++) {
+              a[d] += ke[d] * dens;
+            }
+          } else if (q < -1) {
+            PetscScalar *a = &ao[-q - 2];
+            for (PetscInt d = 0; d < dof; d++) {
+              a[d] += ke[d] * dens;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+PetscErrorCode AssemblyMap::Assemble (Mat K, PetscInt nel, PetscInt nen,
+    const PetscInt *necon, PetscInt dof, const PetscScalar *KE,
+    const PetscScalar *xp, PetscScalar Emin, PetscScalar Emax,
+    PetscScalar penal) {
+  PetscErrorCode ierr = 0;
+
+  // The structure of K is final after its first assembly
+  if (enabled && !tried) {
+    PetscBool assembled;
+    ierr = MatAssembled (K, &assembled);
+    CHKERRQ(ierr);
+    if (assembled) {
+      ierr = SetUp (K, nel, nen, necon, dof);
+      CHKERRQ(ierr);
+    }
+  }
+
+  // Zero the matrix
+  ierr = MatZeroEntries (K);
+  CHKERRQ(ierr);
+
+  PetscInt n = nen * dof;
+  edof.resize (n);
+  ke.resize (n * n);
+  if (!active) {
+    // Loop over elements
+    for (PetscInt i = 0; i < nel; i++) {
+      for (PetscInt j = 0; j < nen; j++) {
+        for (PetscInt k = 0; k < dof; k++) {
+          edof[j * dof + k] = dof * necon[i * nen + j] + k;
+        }
+      }
+      // Use SIMP for stiffness interpolation
+      PetscScalar dens = Emin + PetscPowScalar(xp[i], penal) * (Emax - Emin);
+      for (PetscInt k = 0; k < n * n; k++) {
+        ke[k] = KE[k] * dens;
+      }
+      // Add values to the sparse matrix
+      ierr = MatSetValuesLocal (K, n, edof.data (), n, edof.data (),
+          ke.data (), ADD_VALUES);
+      CHKERRQ(ierr);
+    }
+    return ierr;
+  }
+
+  // Local rows straight into the value arrays, the elements of a color
+  // share no row
+  Mat Ad, Ao;
+  ierr = Blocks (K, &Ad, &Ao);
+  CHKERRQ(ierr);
+  PetscScalar *ad, *ao = NULL;
+  ierr = MatSeqAIJGetArray (Ad, &ad);
+  CHKERRQ(ierr);
+  if (Ao != NULL) {
+    ierr = MatSeqAIJGetArray (Ao, &ao);
+    CHKERRQ(ierr);
+  }
+  // Element sizes known at compile time for the meshes of the physics
+  if (nodes == 4 && dof == 1) {
+    AddElements<2, 1> (ad, ao, KE, xp, Emin, Emax, penal);
+  } else if (nodes == 4 && dof == 2) {
+    AddElements<2, 2> (ad, ao, KE, xp, Emin, Emax, penal);
+  } else if (nodes == 8 && dof == 1) {
+    AddElements<3, 1> (ad, ao, KE, xp, Emin, Emax, penal);
+  } else if (nodes == 8 && dof == 3) {
+    AddElements<3, 3> (ad, ao, KE, xp, Emin, Emax, penal);
+  } else {
+    AddElements<0, 0> (ad, ao, KE, xp, Emin, Emax, penal);
+  }
+  ierr = MatSeqAIJRestoreArray (Ad, &ad);
+  CHKERRQ(ierr);
+  if (Ao != NULL) {
+    ierr = MatSeqAIJRestoreArray (Ao, &ao);
+    CHKERRQ(ierr);
+  }
+
+  // Rows of other ranks through the stash
+  for (size_t g = 0; g < ghostElements.size (); g++) {
+    PetscInt i = ghostElements[g];
+    for (PetscInt j = 0; j < nen; j++) {
+      for (PetscInt k = 0; k < dof; k++) {
+        edof[j * dof + k] = dof * necon[i * nen + j] + k;
+      }
+    }
+    PetscScalar dens = Emin + PetscPowScalar(xp[i], penal) * (Emax - Emin);
+    const int *o = &offsets[i * n * nodes];
+    for (PetscInt k = 0; k < n; k++) {
+      if (o[k * nodes] != -1) continue;
+      for (PetscInt h = 0; h < n; h++) {
+        ke[h] = KE[k * n + h] * dens;
+      }
+      ierr = MatSetValuesLocal (K, 1, &edof[k], n, edof.data (), ke.data (),
+          ADD_VALUES);
+      CHKERRQ(ierr);
+    }
+  }
+
+  return ierr;
+}
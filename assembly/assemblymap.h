@@ -0,0 +1,117 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * assemblymap.h
+ */
+
+#ifndef ASSEMBLYMAP_H_
+#define ASSEMBLYMAP_H_
+
+#include <petsc.h>
+#include <vector>
+
+#include "elementcoloring.h"
+
+/*
+ * Cached assembly of the SIMP stiffness (conductivity) matrix
+ * K = sum_e (Emin + x_e^penal (Emax - Emin)) KE of a structured mesh.
+ *
+ * At the first assembly of a K with its final nonzero structure (as created
+ * by DMCreateMatrix), the destination of the element entries in the value
+ * arrays of K is recorded: the diagonal and off-diagonal blocks of MPIAIJ,
+ * or SeqAIJ. The dofs of a node are consecutive columns of a row, so one
+ * destination is kept per element row and node. From then on an assembly
+ * is a streaming scaled copy of KE into those arrays, threaded by the
+ * element colors, with no local to global mapping and no search in the
+ * rows. The copy is instantiated for the 2D/3D elements with 1, 2 or 3 dofs
+ * per node and chosen at run time. Only the entries in the rows of
+ * other ranks still go through MatSetValuesLocal. Other matrix types, or
+ * entries missing from the structure, keep MatSetValuesLocal throughout.
+ *
+ * Options:
+ * -assemblyMap <bool>  cache the destinations (default true)
+ */
+class AssemblyMap {
+  public:
+
+    AssemblyMap ();
+
+    /*
+     * Zero K and add the scaled element matrices, without assembling K
+     * \param[in] matrix, assembled once before the map can be recorded
+     * \param[in] local elements, nodes per element, connectivity of
+     * DMDAGetElements and dofs per node
+     * \param[in] element matrix, nedof x nedof with nedof = nen * dof
+     * \param[in] element densities and the SIMP parameters
+     * \return PetscErrorCode
+     */
+    PetscErrorCode Assemble (Mat K, PetscInt nel, PetscInt nen,
+        const PetscInt *necon, PetscInt dof, const PetscScalar *KE,
+        const PetscScalar *xp, PetscScalar Emin, PetscScalar Emax,
+        PetscScalar penal);
+
+    /*
+     * The destinations are recorded
+     */
+    PetscBool Active () const {
+      return active;
+    }
+
+    /*
+     * Bytes of the map, for the memory report
+     */
+    PetscLogDouble Bytes () const {
+      return offsets.capacity () * sizeof(int)
+             + ghostElements.capacity () * sizeof(PetscInt)
+             + coloring.Bytes ();
+    }
+
+  private:
+    PetscErrorCode SetUp (Mat K, PetscInt nel, PetscInt nen,
+        const PetscInt *necon, PetscInt dof);
+
+    // Diagonal and off-diagonal (NULL for SeqAIJ) blocks of K
+    PetscErrorCode Blocks (Mat K, Mat *Ad, Mat *Ao);
+
+    // Scaled copy of KE into the local rows, for elements of NSD space
+    // dimensions with NDOF dofs per node; 0 takes both from the map
+    template<PetscInt NSD, PetscInt NDOF>
+    void AddElements (PetscScalar *ad, PetscScalar *ao, const PetscScalar *KE,
+        const PetscScalar *xp, PetscScalar Emin, PetscScalar Emax,
+        PetscScalar penal);
+
+    PetscBool enabled, tried, active;
+    PetscInt nedof, nodes;
+
+    // Per element row and node, the first of its dof columns: >= 0 the value
+    // index in the diagonal block, <= -2 the value index -(offset+2) in the
+    // off-diagonal block, -1 a row of another rank
+    std::vector<int> offsets;
+
+    // Elements with rows of other ranks
+    std::vector<PetscInt> ghostElements;
+
+    ElementColoring coloring;
+
+    // Element dofs and matrix of MatSetValuesLocal
+    std::vector<PetscInt> edof;
+    std::vector<PetscScalar> ke;
+};
+
+#endif /* ASSEMBLYMAP_H_ */
@@ -0,0 +1,252 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * dirichletrows.cc
+ */
+
+#include "dirichletrows.h"
+
+DirichletRows::DirichletRows () {
+  rows = NULL;
+  mask = NULL;
+  nRows = 0;
+  tried = PETSC_FALSE;
+  active = PETSC_FALSE;
+}
+
+DirichletRows::~DirichletRows () {
+  ISDestroy (&rows);
+  VecDestroy (&mask);
+}
+
+PetscErrorCode DirichletRows::SetUp (Vec N) {
+  PetscErrorCode ierr = 0;
+  ierr = ISDestroy (&rows);
+  CHKERRQ(ierr);
+  ierr = VecDestroy (&mask);
+  CHKERRQ(ierr);
+  ierr = PetscObjectReference ((PetscObject) N);
+  CHKERRQ(ierr);
+  mask = N;
+  tried = PETSC_FALSE;
+  active = PETSC_FALSE;
+  zeroDiag.clear ();
+  zeroOff.clear ();
+  unitDiag.clear ();
+
+  PetscInt rstart, rend;
+  ierr = VecGetOwnershipRange (N, &rstart, &rend);
+  CHKERRQ(ierr);
+  const PetscScalar *np;
+  ierr = VecGetArrayRead (N, &np);
+  CHKERRQ(ierr);
+  std::vector<PetscInt> idx;
+  for (PetscInt i = 0; i < rend - rstart; i++) {
+    if (np[i] == 0.0) idx.push_back (rstart + i);
+  }
+  ierr = VecRestoreArrayRead (N, &np);
+  CHKERRQ(ierr);
+  nRows = (PetscInt) idx.size ();
+
+  MPI_Comm comm;
+  PetscObjectGetComm ((PetscObject) N, &comm);
+  ierr = ISCreateGeneral (comm, nRows, idx.data (), PETSC_COPY_VALUES, &rows);
+  CHKERRQ(ierr);
+  return ierr;
+}
+
+PetscErrorCode DirichletRows::Record (Mat K) {
+  PetscErrorCode ierr = 0;
+  tried = PETSC_TRUE;
+
+  PetscBool isMPI, isSeq;
+  ierr = PetscObjectTypeCompare ((PetscObject) K, MATMPIAIJ, &isMPI);
+  CHKERRQ(ierr);
+  ierr = PetscObjectTypeCompare ((PetscObject) K, MATSEQAIJ, &isSeq);
+  CHKERRQ(ierr);
+  if (!isMPI && !isSeq) return ierr;
+
+  Mat Ad, Ao = NULL;
+  const PetscInt *garray = NULL;
+  PetscInt nGarray = 0;
+  if (isMPI) {
+    ierr = MatMPIAIJGetSeqAIJ (K, &Ad, &Ao, &garray);
+    CHKERRQ(ierr);
+    ierr = MatGetSize (Ao, NULL, &nGarray);
+    CHKERRQ(ierr);
+  } else {
+    Ad = K;
+  }
+  PetscInt rstart, rend, cstart, cend;
+  ierr = MatGetOwnershipRange (K, &rstart, &rend);
+  CHKERRQ(ierr);
+  ierr = MatGetOwnershipRangeColumn (K, &cstart, &cend);
+  CHKERRQ(ierr);
+
+  // The mask of the off-diagonal block columns, i.e. of other ranks
+  Vec gmask = NULL;
+  const PetscScalar *np, *gp = NULL;
+  if (Ao != NULL) {
+    IS from;
+    VecScatter scatter;
+    ierr = ISCreateGeneral (PETSC_COMM_SELF, nGarray, garray,
+        PETSC_COPY_VALUES, &from);
+    CHKERRQ(ierr);
+    ierr = VecCreateSeq (PETSC_COMM_SELF, nGarray, &gmask);
+    CHKERRQ(ierr);
+    ierr = VecScatterCreate (mask, from, gmask, NULL, &scatter);
+    CHKERRQ(ierr);
+    ierr = VecScatterBegin (scatter, mask, gmask, INSERT_VALUES,
+        SCATTER_FORWARD);
+    CHKERRQ(ierr);
+    ierr = VecScatterEnd (scatter, mask, gmask, INSERT_VALUES,
+        SCATTER_FORWARD);
+    CHKERRQ(ierr);
+    ierr = VecScatterDestroy (&scatter);
+    CHKERRQ(ierr);
+    ierr = ISDestroy (&from);
+    CHKERRQ(ierr);
+    ierr = VecGetArrayRead (gmask, &gp);
+    CHKERRQ(ierr);
+  }
+  ierr = VecGetArrayRead (mask, &np);
+  CHKERRQ(ierr);
+
+  PetscInt nd, no = 0;
+  const PetscInt *iad, *jad, *iao = NULL, *jao = NULL;
+  PetscBool done;
+  ierr = MatGetRowIJ (Ad, 0, PETSC_FALSE, PETSC_FALSE, &nd, &iad, &jad,
+      &done);
+  CHKERRQ(ierr);
+  PetscBool ok = (PetscBool) (done && rstart == cstart && rend == cend);
+  if (Ao != NULL) {
+    ierr = MatGetRowIJ (Ao, 0, PETSC_FALSE, PETSC_FALSE, &no, &iao, &jao,
+        &done);
+    CHKERRQ(ierr);
+    ok = (PetscBool) (ok && done);
+  }
+
+  for (PetscInt r = 0; ok && r < rend - rstart; r++) {
+    if (np[r] == 0.0) {
+      // Constrained row: all zero but the diagonal
+      PetscBool diagonal = PETSC_FALSE;
+      for (PetscInt p = iad[r]; p < iad[r + 1]; p++) {
+        if (jad[p] == r) {
+          unitDiag.push_back (p);
+          diagonal = PETSC_TRUE;
+        } else {
+          zeroDiag.push_back (p);
+        }
+      }
+      ok = diagonal;
+      for (PetscInt p = (Ao != NULL ? iao[r] : 0);
+          Ao != NULL && p < iao[r + 1]; p++) {
+        zeroOff.push_back (p);
+      }
+    } else {
+      // Free row: the constrained columns
+      for (PetscInt p = iad[r]; p < iad[r + 1]; p++) {
+        if (np[jad[p]] == 0.0) zeroDiag.push_back (p);
+      }
+      for (PetscInt p = (Ao != NULL ? iao[r] : 0);
+          Ao != NULL && p < iao[r + 1]; p++) {
+        if (gp[jao[p]] == 0.0) zeroOff.push_back (p);
+      }
+    }
+  }
+
+  ierr = MatRestoreRowIJ (Ad, 0, PETSC_FALSE, PETSC_FALSE, &nd, &iad, &jad,
+      &done);
+  CHKERRQ(ierr);
+  if (Ao != NULL) {
+    ierr = MatRestoreRowIJ (Ao, 0, PETSC_FALSE, PETSC_FALSE, &no, &iao, &jao,
+        &done);
+    CHKERRQ(ierr);
+    ierr = VecRestoreArrayRead (gmask, &gp);
+    CHKERRQ(ierr);
+    ierr = VecDestroy (&gmask);
+    CHKERRQ(ierr);
+  }
+  ierr = VecRestoreArrayRead (mask, &np);
+  CHKERRQ(ierr);
+
+  // All the ranks impose the conditions the same way
+  PetscMPIInt local = ok ? 1 : 0, global;
+  MPI_Comm comm;
+  PetscObjectGetComm ((PetscObject) K, &comm);
+  ierr = MPI_Allreduce (&local, &global, 1, MPI_INT, MPI_MIN, comm);
+  CHKERRQ(ierr);
+  if (!global) {
+    std::vector<PetscInt> ().swap (zeroDiag);
+    std::vector<PetscInt> ().swap (zeroOff);
+    std::vector<PetscInt> ().swap (unitDiag);
+    return ierr;
+  }
+  active = PETSC_TRUE;
+  return ierr;
+}
+
+PetscErrorCode DirichletRows::Apply (Mat K) {
+  PetscErrorCode ierr = 0;
+  if (!tried) {
+    ierr = Record (K);
+    CHKERRQ(ierr);
+  }
+  if (!active) {
+    ierr = MatZeroRowsColumnsIS (K, rows, 1.0, NULL, NULL);
+    CHKERRQ(ierr);
+    return ierr;
+  }
+
+  PetscBool isMPI;
+  ierr = PetscObjectTypeCompare ((PetscObject) K, MATMPIAIJ, &isMPI);
+  CHKERRQ(ierr);
+  Mat Ad, Ao = NULL;
+  if (isMPI) {
+    const PetscInt *garray;
+    ierr = MatMPIAIJGetSeqAIJ (K, &Ad, &Ao, &garray);
+    CHKERRQ(ierr);
+  } else {
+    Ad = K;
+  }
+
+  PetscScalar *a;
+  ierr = MatSeqAIJGetArray (Ad, &a);
+  CHKERRQ(ierr);
+  for (size_t i = 0; i < zeroDiag.size (); i++) {
+    a[zeroDiag[i]] = 0.0;
+  }
+  for (size_t i = 0; i < unitDiag.size (); i++) {
+    a[unitDiag[i]] = 1.0;
+  }
+  ierr = MatSeqAIJRestoreArray (Ad, &a);
+  CHKERRQ(ierr);
+  if (Ao != NULL) {
+    ierr = MatSeqAIJGetArray (Ao, &a);
+    CHKERRQ(ierr);
+    for (size_t i = 0; i < zeroOff.size (); i++) {
+      a[zeroOff[i]] = 0.0;
+    }
+    ierr = MatSeqAIJRestoreArray (Ao, &a);
+    CHKERRQ(ierr);
+  }
+  ierr = PetscObjectStateIncrease ((PetscObject) K);
+  CHKERRQ(ierr);
+  return ierr;
+}
@@ -0,0 +1,91 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * dirichletrows.h
+ */
+
+#ifndef DIRICHLETROWS_H_
+#define DIRICHLETROWS_H_
+
+#include <petsc.h>
+#include <vector>
+
+/*
+ * Homogeneous Dirichlet conditions of an assembled matrix,
+ * K = N'*K*N + I - N with N the 0/1 mask of the free dofs.
+ *
+ * The constrained dofs of a load case are collected once into an IS. The
+ * first time the conditions are imposed on a K of MPIAIJ or SeqAIJ type,
+ * the value indices of the constrained rows and columns and of their
+ * diagonals are recorded in the blocks of K; from then on the conditions
+ * are a zeroing of these entries in place, without the passes over all of
+ * K of MatDiagonalScale and MatDiagonalSet, and without allocations. Other
+ * matrix types use MatZeroRowsColumnsIS. The loads on the constrained dofs
+ * are not touched: zero them once when the loads are set up.
+ */
+class DirichletRows {
+  public:
+
+    DirichletRows ();
+    ~DirichletRows ();
+
+    /*
+     * Collect the constrained dofs, i.e. the zeros of the mask, and forget
+     * the recorded entries
+     * \param[in] mask of the free dofs, 1 free and 0 constrained
+     * \return PetscErrorCode
+     */
+    PetscErrorCode SetUp (Vec N);
+
+    /*
+     * Zero the constrained rows and columns of K, with a unit diagonal
+     * \param[in,out] assembled matrix, with the structure of the first call
+     * \return PetscErrorCode
+     */
+    PetscErrorCode Apply (Mat K);
+
+    /*
+     * Locally owned constrained dofs, global numbering
+     */
+    IS Rows () const {
+      return rows;
+    }
+
+    /*
+     * Bytes of the index set and the recorded entries, for the memory report
+     */
+    PetscLogDouble Bytes () const {
+      return (zeroDiag.capacity () + zeroOff.capacity () + unitDiag.capacity ())
+             * sizeof(PetscInt) + nRows * sizeof(PetscInt);
+    }
+
+  private:
+    PetscErrorCode Record (Mat K);
+
+    IS rows;
+    Vec mask;
+    PetscInt nRows;
+    PetscBool tried, active;
+
+    // Value indices in the diagonal and off-diagonal blocks to zero, and of
+    // the diagonals of the constrained rows
+    std::vector<PetscInt> zeroDiag, zeroOff, unitDiag;
+};
+
+#endif /* DIRICHLETROWS_H_ */
@@ -0,0 +1,465 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * microbench.cc
+ *
+ * Micro-benchmarks of the hot element loops on the synthetic benchmark
+ * domain (-benchmark), timed in isolation from a full optimization run:
+ * - element stiffness matrix (Quad4Isoparametric/Hex8Isoparametric)
+ * - uKu sensitivity loop
+ * - stiffness assembly with MatSetValuesLocal, and with the cached
+ *   destinations of AssemblyMap::Assemble
+ * - filter apply (Filter::FilterProject)
+ * - MMA dual sweeps (XYZofLAMBDA, DualGrad, DualHess)
+ *
+ * Throughput is reported as elements/s and GB/s of the estimated minimal
+ * memory traffic of each kernel, over all ranks. Run with mpiexec -np 1 for
+ * the serial numbers.
+ *
+ * Options:
+ * -mbReps <int>  repetitions per kernel (default 10)
+ * -dim <int>     2-2D, 3-3D (default 2)
+ * plus all the mesh/filter options of topopt, e.g. -nx -ny -nz -filter -rmin
+ */
+
+#include <petsc.h>
+#include "Filter.h"
+#include "MMA.h"
+#include "TopOpt.h"
+#include "LinearElasticity.h"
+#include "PrePostProcess.h"
+#include "elementcoloring.h"
+#include "assemblymap.h"
+
+#include "options.h"
+
+TOPOPT_NAMESPACE_BEGIN
+
+static char help[] = "Micro-benchmarks of the TopOpt element kernels\n";
+
+/*
+ * Friend of the benchmarked classes, so the private kernels are timed as
+ * they are, without copies
+ */
+class MicroBenchmark {
+  public:
+    MicroBenchmark (TopOpt *opt, LinearElasticity *physics, Filter *filter,
+        MMA *mma, PetscInt reps);
+
+    PetscErrorCode ElementStiffness ();
+    PetscErrorCode SensitivityLoop ();
+    PetscErrorCode Assembly ();
+    PetscErrorCode AssemblyCached ();
+    PetscErrorCode FilterApply ();
+    PetscErrorCode MMADualSweeps ();
+
+  private:
+    TopOpt *opt;
+    LinearElasticity *physics;
+    Filter *filter;
+    MMA *mma;
+    PetscInt reps;
+
+    // Print one line of the report: time is the max over the ranks, work is
+    // summed over the ranks
+    PetscErrorCode Report (const char *name, double tloc, double nelLoc,
+        double bytesLoc);
+};
+
+MicroBenchmark::MicroBenchmark (TopOpt *opt, LinearElasticity *physics,
+    Filter *filter, MMA *mma, PetscInt reps) {
+  this->opt = opt;
+  this->physics = physics;
+  this->filter = filter;
+  this->mma = mma;
+  this->reps = reps;
+}
+
+PetscErrorCode MicroBenchmark::Report (const char *name, double tloc,
+    double nelLoc, double bytesLoc) {
+  PetscErrorCode ierr = 0;
+  double t, work[2], workLoc[2] = { nelLoc, bytesLoc };
+  ierr = MPI_Allreduce (&tloc, &t, 1, MPI_DOUBLE, MPI_MAX, PETSC_COMM_WORLD);
+  CHKERRQ(ierr);
+  ierr = MPI_Allreduce (workLoc, work, 2, MPI_DOUBLE, MPI_SUM,
+      PETSC_COMM_WORLD);
+  CHKERRQ(ierr);
+  t = t / reps;
+  PetscPrintf (PETSC_COMM_WORLD, "# %-24s %12.4e %14.4e %10.3f\n", name, t,
+      work[0] / t, work[1] / t / 1.0e9);
+  return ierr;
+}
+
+PetscErrorCode MicroBenchmark::ElementStiffness () {
+  PetscErrorCode ierr = 0;
+  const PetscInt nedof = LinearElasticity::nedof;
+
+  // One element matrix per local element, as if the grid was not uniform
+  PetscInt nel, nen;
+  const PetscInt *necon;
+#if DIM == 2
+  ierr = physics->DMDAGetElements_2D (physics->da_nodal, &nel, &nen, &necon);
+  CHKERRQ(ierr);
+  PetscScalar X[4] = { 0.0, physics->dx, physics->dx, 0.0 };
+  PetscScalar Y[4] = { 0.0, 0.0, physics->dy, physics->dy };
+#elif DIM == 3
+  ierr = physics->DMDAGetElements_3D (physics->da_nodal, &nel, &nen, &necon);
+  CHKERRQ(ierr);
+  PetscScalar X[8] = { 0.0, physics->dx, physics->dx, 0.0, 0.0, physics->dx,
+      physics->dx, 0.0 };
+  PetscScalar Y[8] = { 0.0, 0.0, physics->dy, physics->dy, 0.0, 0.0,
+      physics->dy, physics->dy };
+  PetscScalar Z[8] = { 0.0, 0.0, 0.0, 0.0, physics->dz, physics->dz,
+      physics->dz, physics->dz };
+#endif
+  PetscScalar ke[nedof * nedof];
+
+  MPI_Barrier (PETSC_COMM_WORLD);
+  double t1 = MPI_Wtime ();
+  for (PetscInt r = 0; r < reps; r++) {
+    for (PetscInt i = 0; i < nel; i++) {
+#if DIM == 2
+      physics->Quad4Isoparametric (X, Y, physics->nu, false, ke);
+#elif DIM == 3
+      physics->Hex8Isoparametric (X, Y, Z, physics->nu, false, ke);
+#endif
+    }
+  }
+  double t2 = MPI_Wtime ();
+
+  // Only the element matrix is written
+  ierr = Report ("ElementStiffness", t2 - t1, nel,
+      nel * nedof * nedof * sizeof(PetscScalar));
+  CHKERRQ(ierr);
+  return ierr;
+}
+
+PetscErrorCode MicroBenchmark::SensitivityLoop () {
+  PetscErrorCode ierr = 0;
+  const PetscInt nedof = LinearElasticity::nedof;
+
+  PetscInt nel, nen;
+  const PetscInt *necon;
+#if DIM == 2
+  ierr = physics->DMDAGetElements_2D (physics->da_nodal, &nel, &nen, &necon);
+  CHKERRQ(ierr);
+#elif DIM == 3
+  ierr = physics->DMDAGetElements_3D (physics->da_nodal, &nel, &nen, &necon);
+  CHKERRQ(ierr);
+#endif
+
+  // Deterministic non-trivial displacement field
+  Vec Uloc;
+  ierr = DMGetLocalVector (physics->da_nodal, &Uloc);
+  CHKERRQ(ierr);
+  PetscScalar *up, *xp, *df;
+  PetscInt nloc;
+  VecGetLocalSize (Uloc, &nloc);
+  VecGetArray (Uloc, &up);
+  for (PetscInt i = 0; i < nloc; i++) {
+    up[i] = 1.0e-3 * ((i * 7919) % 101) / 101.0;
+  }
+  VecGetArray (opt->xPhys, &xp);
+  VecGetArray (opt->dfdx, &df);
+
+  PetscInt edof[nedof];
+  PetscScalar fx = 0.0;
+  MPI_Barrier (PETSC_COMM_WORLD);
+  double t1 = MPI_Wtime ();
+  for (PetscInt r = 0; r < reps; r++) {
+    for (PetscInt i = 0; i < nel; i++) {
+      for (PetscInt j = 0; j < nen; j++) {
+        for (PetscInt k = 0; k < DIM; k++) {
+          edof[j * DIM + k] = DIM * necon[i * nen + j] + k;
+        }
+      }
+      PetscScalar uKu = 0.0;
+      for (PetscInt k = 0; k < nedof; k++) {
+        for (PetscInt h = 0; h < nedof; h++) {
+          uKu += up[edof[k]] * physics->KE[k * nedof + h] * up[edof[h]];
+        }
+      }
+      fx += (opt->Emin + PetscPowScalar(xp[i], opt->penal)
+             * (opt->Emax - opt->Emin)) * uKu;
+      df[i] = -1.0 * opt->penal * PetscPowScalar(xp[i], opt->penal - 1)
+              * (opt->Emax - opt->Emin) * uKu;
+    }
+  }
+  double t2 = MPI_Wtime ();
+
+  VecRestoreArray (opt->dfdx, &df);
+  VecRestoreArray (opt->xPhys, &xp);
+  VecRestoreArray (Uloc, &up);
+  ierr = DMRestoreLocalVector (physics->da_nodal, &Uloc);
+  CHKERRQ(ierr);
+
+  // Per element: connectivity, gathered displacements, density and
+  // sensitivity; KE stays in cache
+  ierr = Report ("SensitivityLoop (uKu)", t2 - t1, nel,
+      nel * (nen * sizeof(PetscInt) + (nedof + 2) * sizeof(PetscScalar)));
+  CHKERRQ(ierr);
+  PetscPrintf (PETSC_COMM_WORLD, "#   (local checksum %e)\n", fx);
+  return ierr;
+}
+
+PetscErrorCode MicroBenchmark::Assembly () {
+  PetscErrorCode ierr = 0;
+  const PetscInt nedof = LinearElasticity::nedof;
+
+  PetscInt nel, nen;
+  const PetscInt *necon;
+#if DIM == 2
+  ierr = physics->DMDAGetElements_2D (physics->da_nodal, &nel, &nen, &necon);
+  CHKERRQ(ierr);
+#elif DIM == 3
+  ierr = physics->DMDAGetElements_3D (physics->da_nodal, &nel, &nen, &necon);
+  CHKERRQ(ierr);
+#endif
+
+  PetscScalar *xp;
+  PetscInt edof[nedof];
+  PetscScalar ke[nedof * nedof];
+  MPI_Barrier (PETSC_COMM_WORLD);
+  double t1 = MPI_Wtime ();
+  for (PetscInt r = 0; r < reps; r++) {
+    VecGetArray (opt->xPhys, &xp);
+    MatZeroEntries (physics->K);
+    for (PetscInt i = 0; i < nel; i++) {
+      for (PetscInt j = 0; j < nen; j++) {
+        for (PetscInt k = 0; k < DIM; k++) {
+          edof[j * DIM + k] = DIM * necon[i * nen + j] + k;
+        }
+      }
+      PetscScalar dens = opt->Emin
+                         + PetscPowScalar(xp[i], opt->penal)
+                           * (opt->Emax - opt->Emin);
+      for (PetscInt k = 0; k < nedof * nedof; k++) {
+        ke[k] = physics->KE[k] * dens;
+      }
+      ierr = MatSetValuesLocal (physics->K, nedof, edof, nedof, edof, ke,
+          ADD_VALUES);
+      CHKERRQ(ierr);
+    }
+    MatAssemblyBegin (physics->K, MAT_FINAL_ASSEMBLY);
+    MatAssemblyEnd (physics->K, MAT_FINAL_ASSEMBLY);
+    VecRestoreArray (opt->xPhys, &xp);
+  }
+  double t2 = MPI_Wtime ();
+
+  // Every element entry is read and added into the matrix values
+  ierr = Report ("Assembly (SetValuesLocal)", t2 - t1, nel,
+      nel * (2.0 * nedof * nedof * sizeof(PetscScalar)
+             + nedof * sizeof(PetscInt)));
+  CHKERRQ(ierr);
+  return ierr;
+}
+
+PetscErrorCode MicroBenchmark::AssemblyCached () {
+  PetscErrorCode ierr = 0;
+  const PetscInt nedof = LinearElasticity::nedof;
+
+  PetscInt nel, nen;
+  const PetscInt *necon;
+#if DIM == 2
+  ierr = physics->DMDAGetElements_2D (physics->da_nodal, &nel, &nen, &necon);
+  CHKERRQ(ierr);
+#elif DIM == 3
+  ierr = physics->DMDAGetElements_3D (physics->da_nodal, &nel, &nen, &necon);
+  CHKERRQ(ierr);
+#endif
+
+  // A map of its own on the same K, recorded by an untimed first assembly
+  // since K is assembled by Assembly ()
+  AssemblyMap map;
+  PetscScalar *xp;
+  VecGetArray (opt->xPhys, &xp);
+  ierr = map.Assemble (physics->K, nel, nen, necon, DIM, physics->KE, xp,
+      opt->Emin, opt->Emax, opt->penal);
+  CHKERRQ(ierr);
+  MatAssemblyBegin (physics->K, MAT_FINAL_ASSEMBLY);
+  MatAssemblyEnd (physics->K, MAT_FINAL_ASSEMBLY);
+
+  MPI_Barrier (PETSC_COMM_WORLD);
+  double t1 = MPI_Wtime ();
+  for (PetscInt r = 0; r < reps; r++) {
+    ierr = map.Assemble (physics->K, nel, nen, necon, DIM, physics->KE, xp,
+        opt->Emin, opt->Emax, opt->penal);
+    CHKERRQ(ierr);
+    MatAssemblyBegin (physics->K, MAT_FINAL_ASSEMBLY);
+    MatAssemblyEnd (physics->K, MAT_FINAL_ASSEMBLY);
+  }
+  double t2 = MPI_Wtime ();
+  VecRestoreArray (opt->xPhys, &xp);
+
+  // Every element entry is added into the matrix values through one
+  // destination per element row and node; without the map (-assemblyMap
+  // false, or a matrix type it does not handle) this is the path above
+  const char *name = map.Active () ? "Assembly (AssemblyMap)" :
+                                     "Assembly (map inactive)";
+  ierr = Report (name, t2 - t1, nel,
+      nel * (2.0 * nedof * nedof * sizeof(PetscScalar)
+             + nedof * nen * sizeof(int) + sizeof(PetscScalar)));
+  CHKERRQ(ierr);
+  return ierr;
+}
+
+PetscErrorCode MicroBenchmark::FilterApply () {
+  PetscErrorCode ierr = 0;
+
+  PetscInt nloc;
+  VecGetLocalSize (opt->x, &nloc);
+
+  // Bytes of the matrix for the density/sensitivity filter, or of the
+  // vectors otherwise
+  double bytes = 3.0 * nloc * sizeof(PetscScalar);
+  if (filter->filterType == 0 || filter->filterType == 1) {
+    MatInfo info;
+    ierr = MatGetInfo (filter->H, MAT_LOCAL, &info);
+    CHKERRQ(ierr);
+    bytes += info.nz_used * (sizeof(PetscScalar) + sizeof(PetscInt));
+  }
+
+  MPI_Barrier (PETSC_COMM_WORLD);
+  double t1 = MPI_Wtime ();
+  for (PetscInt r = 0; r < reps; r++) {
+    ierr = filter->FilterProject (opt->x, opt->xTilde, opt->xPhys,
+        opt->projectionFilter, opt->beta, opt->eta);
+    CHKERRQ(ierr);
+  }
+  double t2 = MPI_Wtime ();
+
+  ierr = Report ("FilterProject", t2 - t1, nloc, bytes);
+  CHKERRQ(ierr);
+  return ierr;
+}
+
+PetscErrorCode MicroBenchmark::MMADualSweeps () {
+  PetscErrorCode ierr = 0;
+
+  // One full update generates the subproblem and a valid dual point
+  ierr = mma->SetOuterMovelimit (opt->Xmin, opt->Xmax, opt->movlim, opt->x,
+      opt->xmin, opt->xmax);
+  CHKERRQ(ierr);
+  VecSet (opt->dfdx, -1.0);
+  for (PetscInt i = 0; i < opt->m; i++) {
+    VecSet (opt->dgdx[i], 1.0 / opt->n);
+    opt->gx[i] = 0.0;
+  }
+  ierr = mma->Update (opt->x, opt->dfdx, opt->gx, opt->dgdx, opt->xmin,
+      opt->xmax);
+  CHKERRQ(ierr);
+
+  PetscInt nloc;
+  VecGetLocalSize (opt->x, &nloc);
+  MPI_Barrier (PETSC_COMM_WORLD);
+  double t1 = MPI_Wtime ();
+  for (PetscInt r = 0; r < reps; r++) {
+    mma->XYZofLAMBDA (opt->x);
+    mma->DualGrad (opt->x);
+    mma->DualHess (opt->x);
+  }
+  double t2 = MPI_Wtime ();
+
+  // Each sweep streams x, L, U, p0, q0, alpha, beta and pij, qij
+  double sweeps = 3.0;
+  ierr = Report ("MMA dual sweeps (x3)", t2 - t1, nloc,
+      sweeps * nloc * (7.0 + 2.0 * opt->m) * sizeof(PetscScalar));
+  CHKERRQ(ierr);
+  return ierr;
+}
+
+// Entry point of the variant of DIM, see dispatch.cc
+int Main (int argc, char *argv[]) {
+
+  PetscErrorCode ierr = 0;
+
+  PetscInitialize (&argc, &argv, PETSC_NULL, help);
+  ThreadsSetUp (); // -numThreads, as in main.cc
+
+  PetscInt reps = 10;
+  PetscBool flg;
+  PetscOptionsGetInt (NULL, NULL, "-mbReps", &reps, &flg);
+
+  // Synthetic domain, never restart
+  PetscOptionsSetValue (NULL, "-benchmark", "true");
+  PetscOptionsSetValue (NULL, "-restart", "false");
+
+  TopOpt *opt = new TopOpt ();
+  PrePostProcess *prepost = new PrePostProcess (opt);
+  prepost->DesignDomainInitialization (opt);
+
+  LinearElasticity *physics = NULL;
+  if (opt->physics == 0) {
+    physics = new LinearElasticity (opt->da_nodes, opt->m, opt->numDES,
+        opt->numLODFIX, opt->numNodeLoadAddingCounts, opt->nu, opt->E,
+        opt->loadVector, opt->xPassive0, opt->xPassive1, opt->xPassive2,
+        opt->xPassive3);
+  }
+  Filter *filter = new Filter (opt->da_nodes, opt->xPhys, opt->filter,
+      opt->rmin, opt->xPassive0, opt->xPassive1, opt->xPassive2,
+      opt->xPassive3);
+  MMA *mma;
+  PetscInt itr = 0;
+  opt->AllocateMMAwithRestart (&itr, &mma);
+  ierr = filter->FilterProject (opt->x, opt->xTilde, opt->xPhys,
+      opt->projectionFilter, opt->beta, opt->eta);
+  CHKERRQ(ierr);
+
+  PetscMPIInt size;
+  MPI_Comm_size (PETSC_COMM_WORLD, &size);
+  PetscPrintf (PETSC_COMM_WORLD,
+      "######################## Micro-benchmarks ########################\n");
+  PetscPrintf (PETSC_COMM_WORLD, "# ranks: %i, elements: %i, -mbReps: %i\n",
+      size, opt->n, reps);
+  PetscPrintf (PETSC_COMM_WORLD, "# %-24s %12s %14s %10s\n", "Kernel",
+      "time (s)", "elements/s", "GB/s");
+
+  MicroBenchmark bench (opt, physics, filter, mma, reps);
+  if (physics != NULL) {
+    ierr = bench.ElementStiffness ();
+    CHKERRQ(ierr);
+    ierr = bench.SensitivityLoop ();
+    CHKERRQ(ierr);
+    ierr = bench.Assembly ();
+    CHKERRQ(ierr);
+    ierr = bench.AssemblyCached ();
+    CHKERRQ(ierr);
+  } else {
+    PetscPrintf (PETSC_COMM_WORLD,
+        "# Element kernels are only available for -physics 0\n");
+  }
+  ierr = bench.FilterApply ();
+  CHKERRQ(ierr);
+  ierr = bench.MMADualSweeps ();
+  CHKERRQ(ierr);
+
+  PetscPrintf (PETSC_COMM_WORLD,
+      "##################################################################\n");
+
+  delete mma;
+  delete filter;
+  if (physics != NULL) delete physics;
+  delete prepost;
+  delete opt;
+
+  PetscFinalize ();
+  return 0;
+}
+
+TOPOPT_NAMESPACE_END
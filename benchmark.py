@@ -0,0 +1,150 @@
+#!/usr/bin/python
+#
+# Strong and weak scaling driver for the synthetic benchmark mode (-benchmark)
+#
+# Every run optimizes the synthetic box domain for a fixed number of
+# iterations and writes its per-iteration metrics (-metricsFile). The driver
+# reads them back and prints the mean time per iteration and per phase,
+# skipping the first iteration (solver set up, first output).
+#
+# Usage e.g.
+#   python benchmark.py --np 1 2 4 8 --nx 256 --ny 128 --itr 20
+#   python benchmark.py --mode weak --np 1 2 4 8 --nx 128 --ny 64
+#   python benchmark.py --mpiexec "srun" --dim 3 --np 16 32 64 --nx 512 --ny 256 --nz 256
+#
+# The element counts are snapped to multiples of 2^(nlvls-1) so that the mesh
+# is compatible with the multigrid hierarchy.
+
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+PHASES = ["physics", "assemble", "pcsetup", "kspsolve", "sensitivity",
+          "filterGradients", "mma", "filterProject", "output"]
+
+
+def snap(ne, nlvls):
+	# Element count divisible by 2^(nlvls-1), at least one coarse element
+	div = 2 ** (nlvls - 1)
+	return max(div, int(round(float(ne) / div)) * div)
+
+
+def weakSizes(ne, np, np0, dim):
+	# Grow the elements per rank-constant domain by doubling the axes in turn
+	ne = list(ne)
+	factor = float(np) / np0
+	axis = 0
+	while factor >= 2.0 - 1e-12:
+		ne[axis] *= 2
+		factor /= 2.0
+		axis = (axis + 1) % dim
+	return ne
+
+
+def runCase(args, np, ne, dim, tag):
+	metricsFile = os.path.join(args.workdir, "bench_%s_np%d.jsonl" % (tag, np))
+	cmd = args.mpiexec.split() + ["-np", str(np), args.binary, "-dim", str(dim), "-benchmark",
+		"-restart", "false", "-maxItr", str(args.itr),
+		"-nlvls", str(args.nlvls), "-metricsFile", metricsFile,
+		"-nx", str(ne[0] + 1), "-ny", str(ne[1] + 1)]
+	if dim == 3:
+		cmd += ["-nz", str(ne[2] + 1)]
+	cmd += args.extra.split()
+	print("# " + " ".join(cmd))
+	sys.stdout.flush()
+	with open(os.path.join(args.workdir, "bench_%s_np%d.log" % (tag, np)), "w") as log:
+		ret = subprocess.call(cmd, stdout=log, stderr=subprocess.STDOUT)
+	if ret != 0:
+		exit("Benchmark run failed, see the log in " + args.workdir)
+	return readMetrics(metricsFile)
+
+
+def readMetrics(metricsFile):
+	records = []
+	with open(metricsFile) as f:
+		for line in f:
+			if line.strip():
+				records.append(json.loads(line))
+	# Skip the warm up iteration when possible
+	if len(records) > 1:
+		records = records[1:]
+	mean = {"iteration": 0.0}
+	for p in PHASES:
+		mean[p] = 0.0
+	for r in records:
+		for key in mean:
+			mean[key] += r["time"].get(key, 0.0) / len(records)
+	mean["kspIterations"] = sum(sum(r["kspIterations"]) for r in records) / float(len(records))
+	mean["peakRSSMB"] = records[-1]["peakRSSMB"]
+	return mean
+
+
+def printTable(title, rows, mode):
+	print("")
+	print("#" * 24 + " " + title + " " + "#" * 24)
+	header = "%6s %12s %10s %8s %8s" % ("np", "elements", "it. (s)", "eff.", "ksp its")
+	for p in PHASES:
+		header += " %10s" % p[:10]
+	header += " %10s" % "RSS (MB)"
+	print(header)
+	base = rows[0]
+	for np, nel, m in rows:
+		if mode == "strong":
+			eff = base[2]["iteration"] * base[0] / (m["iteration"] * np)
+		else:
+			eff = base[2]["iteration"] / m["iteration"]
+		line = "%6d %12d %10.4f %8.3f %8.1f" % (np, nel, m["iteration"], eff, m["kspIterations"])
+		for p in PHASES:
+			line += " %10.4f" % m[p]
+		line += " %10.1f" % m["peakRSSMB"]
+		print(line)
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Strong/weak scaling of the synthetic benchmark")
+	parser.add_argument("--mode", choices=["strong", "weak", "both"], default="both")
+	parser.add_argument("--np", type=int, nargs="+", default=[1, 2, 4])
+	parser.add_argument("--dim", type=int, choices=[2, 3], default=2, help="dimension of the runs, passed as -dim")
+	parser.add_argument("--nx", type=int, default=128, help="elements in x (smallest run for weak scaling)")
+	parser.add_argument("--ny", type=int, default=64)
+	parser.add_argument("--nz", type=int, default=64)
+	parser.add_argument("--itr", type=int, default=20)
+	parser.add_argument("--nlvls", type=int, default=4)
+	parser.add_argument("--mpiexec", default="mpiexec")
+	parser.add_argument("--binary", default="./topopt")
+	parser.add_argument("--workdir", default="./benchmark")
+	parser.add_argument("--extra", default="", help="additional options passed to topopt")
+	args = parser.parse_args()
+
+	dim = args.dim
+	if not os.path.isdir(args.workdir):
+		os.makedirs(args.workdir)
+
+	ne0 = [snap(n, args.nlvls) for n in [args.nx, args.ny, args.nz][:dim]]
+
+	def nel(ne):
+		total = 1
+		for n in ne:
+			total *= n
+		return total
+
+	if args.mode in ["strong", "both"]:
+		rows = []
+		for np in args.np:
+			rows.append((np, nel(ne0), runCase(args, np, ne0, dim, "strong")))
+		printTable("Strong scaling", rows, "strong")
+
+	if args.mode in ["weak", "both"]:
+		rows = []
+		for np in args.np:
+			ne = [snap(n, args.nlvls) for n in weakSizes(ne0, np, args.np[0], dim)]
+			rows.append((np, nel(ne), runCase(args, np, ne, dim, "weak")))
+		printTable("Weak scaling", rows, "weak")
+
+
+if __name__ == "__main__":
+	main()
@@ -11,6 +11,7 @@ import makevtu as cvw
 # in case partition size changes etc
 import subprocess
 import binascii
+import array
 
 #"Global constants":
 FIN = "output_00000.dat"	#Std. input file format
@@ -29,7 +30,11 @@ def main(itr):
 	# The file always starts with a user defined string
 	# Here it is discarded, but if you have some information in it, 
 	# it can be saved.
-	readInString(fin)
+	# It may declare the mirror planes of a reduced model (-symmetry)
+	planes = readSymmetry(readInString(fin))
+	copies = 2**len(planes)
+	if planes:
+		print("Mirroring the reduced model at " + " ".join(planes))
 
 	print("Reading in mesh information")
 	#Load information from header
@@ -55,8 +60,8 @@ def main(itr):
 		#Multiply by 3 because we have 3D
 		#Multiply by 4 == length of float32
 		rawP += fin.read(3*4*nPointsT[i])
-	cvw.writeHeader(fout,sum(nPointsT),sum(nCellsT))
-	cvw.writeRawPoints(fout,rawP)
+	cvw.writeHeader(fout,copies*sum(nPointsT),copies*sum(nCellsT))
+	cvw.writeRawPoints(fout,mirrorPoints(rawP,planes))
 	rawP = None # delete rawP from memory
 
 	print("Read/write in mesh data: element connectivity")
@@ -66,15 +71,15 @@ def main(itr):
 	for i in range(nDom):
 		#Multiply by 8 because we have 8 nodes per element
                 #Multiply by 8 == length of unsigned long int
-		rawP += fin.read(4*8*nCellsT[i]) # Note: for 2D use "4*8", 3D use "8*8" because 2D has 4 nodes. 
-	cvw.writeRawCellsConn(fout,rawP)
+		rawP += fin.read(nodesPerElement*8*nCellsT[i]) # 2D has 4 nodes, 3D has 8 nodes
+	cvw.writeRawCellsConn(fout,mirrorConnectivity(rawP,sum(nPointsT),nodesPerElement,planes))
 	#print st.unpack('Q'*128*8,rawP[0:8*128*8])
 	
 	rawP = ""
 	for i in range(nDom):
                 #Multiply by 8 == length of unsigned long int
                 rawP += fin.read(8*nCellsT[i])
-	cvw.writeRawCellsOffset(fout,rawP)
+	cvw.writeRawCellsOffset(fout,mirrorOffsets(rawP,planes))
 
 	# Convert from binary to e.g. floats and return in a tuple:
 	#print st.unpack('Q'*128,rawP[0:8*128])
@@ -84,7 +89,7 @@ def main(itr):
                 #Multiply by 8 == length of unsigned long int
                 rawP += fin.read(8*nCellsT[i])
 
-        cvw.writeRawCellsType(fout,rawP)
+        cvw.writeRawCellsType(fout,mirrorData(rawP,'L',"",planes))
 	#print st.unpack('Q'*128,rawP[0:8*128])	
 	rawP=None
 	print("Done writing in mesh")
@@ -131,6 +136,8 @@ def main(itr):
 							lCFieldNames.append("Cell Field " + str(j))
 					#Multiply by 4 == length of float32
 					lrawCFields[j] += fin.read(4*nCellsT[i])
+			lrawPFields = [mirrorData(lrawPFields[j],'f',lPFieldNames[j],planes) for j in range(len(lrawPFields))]
+			lrawCFields = [mirrorData(lrawCFields[j],'f',lCFieldNames[j],planes) for j in range(len(lrawCFields))]
 			cvw.writeRawScalarPointData(fout,lrawPFields,lPFieldNames)
 			cvw.writeRawScalarCellData(fout,lrawCFields,lCFieldNames)
 			cvw.writeFooter(fout)
@@ -157,6 +164,68 @@ def main(itr):
 
 
 
+# Mirror planes of a reduced model from the user defined string, e.g.
+# "TopOpt result version 1.1 symmetry xmin ymax"
+def readSymmetry(info):
+	words = info.split()
+	if "symmetry" not in words:
+		return []
+	return words[words.index("symmetry")+1:]
+
+# Each plane doubles the mesh: the mirrored copy is appended to the data
+def mirrorPoints(rawP,planes):
+	p = array.array('f')
+	p.fromstring(rawP)
+	for plane in planes:
+		axis = "xyz".index(plane[0])
+		coords = p[axis::3]
+		c = min(coords) if plane[1:] == "min" else max(coords)
+		q = array.array('f',p)
+		for i in range(axis,len(q),3):
+			q[i] = 2.0*c - q[i]
+		p.extend(q)
+	return p.tostring()
+
+def mirrorConnectivity(rawP,nPoints,nodesPerElement,planes):
+	conn = array.array('L')
+	conn.fromstring(rawP)
+	# A reflection flips the orientation: reverse the quads, swap the
+	# bottom and top faces of the hexahedra
+	if nodesPerElement == 4:
+		perm = [0,3,2,1]
+	else:
+		perm = [4,5,6,7,0,1,2,3]
+	for plane in planes:
+		n = len(conn)
+		for e in range(0,n,nodesPerElement):
+			for k in perm:
+				conn.append(conn[e+k] + nPoints)
+		nPoints *= 2
+	return conn.tostring()
+
+def mirrorOffsets(rawP,planes):
+	off = array.array('L')
+	off.fromstring(rawP)
+	for plane in planes:
+		last = off[-1]
+		off.extend(array.array('L',[o + last for o in off]))
+	return off.tostring()
+
+# Cell types and fields: a copy per plane, the displacement normal to the
+# plane changes its sign
+def mirrorData(rawP,typecode,name,planes):
+	if not planes:
+		return rawP
+	d = array.array(typecode)
+	d.fromstring(rawP)
+	for plane in planes:
+		# The state of each verification load is ux_<i>, uy_<i>, uz_<i>
+		if name.split("_")[0] == "u" + plane[0]:
+			d.extend(array.array(typecode,[-v for v in d]))
+		else:
+			d.extend(array.array(typecode,d))
+	return d.tostring()
+
 def getNoNodes(i):
 	if(i==10):
 		return 4
@@ -225,5 +294,9 @@ if __name__ == "__main__":
 	itr = 0
 	if len(sys.argv) > 1:
 	        itr = sys.argv[1]
+	# Another result file, e.g. output_fea.dat of the verification loads
+	if len(sys.argv) > 2:
+		FIN = sys.argv[2]
+		FOUT = FIN[:-4] if FIN.endswith(".dat") else FIN
 
 	main(itr)
@@ -0,0 +1,258 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * Campaign.cc
+ */
+
+#include "Campaign.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+TOPOPT_NAMESPACE_BEGIN // # new
+
+Campaign::Campaign () {
+  x0 = NULL;
+  filterRmin = 0.0;
+  dirname = "./campaign";
+  warmStart = PETSC_FALSE;
+
+  PetscBool flg;
+  char filenameChar[PETSC_MAX_PATH_LEN];
+  PetscOptionsGetString (NULL, NULL, "-campaignDir", filenameChar,
+      sizeof(filenameChar), &flg);
+  if (flg) {
+    dirname = filenameChar;
+  }
+  PetscOptionsGetBool (NULL, NULL, "-campaignWarmStart", &warmStart, &flg);
+  PetscOptionsGetString (NULL, NULL, "-campaign", filenameChar,
+      sizeof(filenameChar), &flg);
+  if (!flg) return;
+
+  std::ifstream file (filenameChar);
+  if (!file.good ()) {
+    PetscPrintf (PETSC_COMM_WORLD, "# Campaign file %s cannot be read\n",
+        filenameChar);
+    exit (0);
+  }
+
+  // One design per line: -key value pairs
+  std::string line;
+  while (std::getline (file, line)) {
+    std::istringstream tokens (line);
+    std::string key, value;
+    if (!(tokens >> key) || key[0] == '#') continue;
+    std::map<std::string, PetscScalar> design;
+    do {
+      if (key[0] != '-' || !(tokens >> value)) {
+        PetscPrintf (PETSC_COMM_WORLD,
+            "# Campaign design %i: '%s' is not an option with a value\n",
+            (PetscInt) designs.size (), key.c_str ());
+        exit (0);
+      }
+      design[key.substr (1)] = atof (value.c_str ());
+    } while (tokens >> key);
+    designs.push_back (design);
+  }
+  params.resize (designs.size ());
+  finals.resize (designs.size (), NULL);
+
+  PetscPrintf (PETSC_COMM_WORLD,
+      "##############################################################\n");
+  PetscPrintf (PETSC_COMM_WORLD, "# Campaign (-campaign): %s, %i designs\n",
+      filenameChar, (PetscInt) designs.size ());
+  PetscPrintf (PETSC_COMM_WORLD, "# Output (-campaignDir): %s/design_<i>\n",
+      dirname.c_str ());
+  PetscPrintf (PETSC_COMM_WORLD, "# Warm start (-campaignWarmStart): %i\n",
+      warmStart);
+}
+
+Campaign::~Campaign () {
+  if (x0 != NULL) {
+    VecDestroy (&x0);
+  }
+  for (size_t i = 0; i < finals.size (); ++i) {
+    if (finals[i] != NULL) {
+      VecDestroy (&finals[i]);
+    }
+  }
+}
+
+PetscErrorCode Campaign::SetUpDesign (PetscInt d, TopOpt *opt,
+    Filter **filter, MMA **mma) {
+  PetscErrorCode ierr = 0;
+
+  // The command line is the base of every design
+  if (x0 == NULL) {
+    base.volfrac = opt->volfrac;
+    base.penal = opt->penal;
+    base.rmin = opt->rmin;
+    base.Emin = opt->Emin;
+    base.movlim = opt->movlim;
+    base.beta = opt->beta;
+    base.betaFinal = opt->betaFinal;
+    base.eta = opt->eta;
+    base.maxItr = opt->maxItr;
+    filterRmin = opt->rmin;
+    ierr = VecDuplicate (opt->x, &x0);
+    CHKERRQ(ierr);
+    ierr = VecCopy (opt->x, x0);
+    CHKERRQ(ierr);
+  }
+
+  Parameters &p = params[d];
+  p = base;
+  std::map<std::string, PetscScalar>::const_iterator it;
+  for (it = designs[d].begin (); it != designs[d].end (); ++it) {
+    if (it->first == "volfrac") {
+      p.volfrac = it->second;
+    } else if (it->first == "penal") {
+      p.penal = it->second;
+    } else if (it->first == "rmin") {
+      p.rmin = it->second;
+    } else if (it->first == "Emin") {
+      p.Emin = it->second;
+    } else if (it->first == "movlim") {
+      p.movlim = it->second;
+    } else if (it->first == "beta") {
+      p.beta = it->second;
+    } else if (it->first == "betaFinal") {
+      p.betaFinal = it->second;
+    } else if (it->first == "eta") {
+      p.eta = it->second;
+    } else if (it->first == "maxItr") {
+      p.maxItr = (PetscInt) it->second;
+    } else {
+      PetscPrintf (PETSC_COMM_WORLD,
+          "# Campaign design %i: -%s cannot be changed, ignored\n", d,
+          it->first.c_str ());
+    }
+  }
+  opt->volfrac = p.volfrac;
+  opt->penal = p.penal;
+  opt->rmin = p.rmin;
+  opt->Emin = p.Emin;
+  opt->movlim = p.movlim;
+  opt->beta = p.beta;
+  opt->betaFinal = p.betaFinal;
+  opt->eta = p.eta;
+  opt->maxItr = p.maxItr;
+
+  // The campaign designs are not restarted
+  opt->restart = PETSC_FALSE;
+
+  PetscPrintf (PETSC_COMM_WORLD,
+      "##############################################################\n");
+  PetscPrintf (PETSC_COMM_WORLD,
+      "# Campaign design %i/%i: volfrac %f, penal %f, rmin %f, Emin %e, "
+          "movlim %f, beta %f, betaFinal %f, eta %f, maxItr %i\n", d + 1,
+      (PetscInt) designs.size (), p.volfrac, p.penal, p.rmin, p.Emin,
+      p.movlim, p.beta, p.betaFinal, p.eta, p.maxItr);
+
+  // The filter operator depends on the radius only
+  if (p.rmin != filterRmin) {
+    delete *filter;
+    *filter = new Filter (opt->da_nodes, opt->xPhys, opt->filter, opt->rmin,
+        opt->xPassive0, opt->xPassive1, opt->xPassive2, opt->xPassive3);
+    filterRmin = p.rmin;
+  }
+
+  // Output directory of the design, read by MPIIO and the physics
+  std::ostringstream workdir;
+  workdir << dirname << "/design_" << d;
+  PetscMPIInt rank;
+  MPI_Comm_rank (PETSC_COMM_WORLD, &rank);
+  if (rank == 0) {
+    mkdir (dirname.c_str (), 0755);
+    mkdir (workdir.str ().c_str (), 0755);
+  }
+  MPI_Barrier (PETSC_COMM_WORLD);
+  ierr = PetscOptionsSetValue (NULL, "-workdir", workdir.str ().c_str ());
+  CHKERRQ(ierr);
+
+  // Initial design: the nearest finished design scaled to the volume
+  // fraction, or the design elements at the volume fraction
+  PetscInt nearest = warmStart ? Nearest (d) : -1;
+  PetscScalar *xp, *xPassive0p, *xnp = NULL;
+  PetscInt nel;
+  ierr = VecCopy (x0, opt->x);
+  CHKERRQ(ierr);
+  VecGetLocalSize (opt->x, &nel);
+  VecGetArray (opt->x, &xp);
+  VecGetArray (opt->xPassive0, &xPassive0p);
+  if (nearest >= 0) {
+    VecGetArray (finals[nearest], &xnp);
+    PetscPrintf (PETSC_COMM_WORLD, "# Warm start from design %i\n",
+        nearest + 1);
+  }
+  for (PetscInt i = 0; i < nel; i++) {
+    if (xPassive0p[i] == 0) continue;
+    if (xnp != NULL) {
+      xp[i] = PetscMin(opt->Xmax,
+          PetscMax(opt->Xmin, xnp[i] * p.volfrac / params[nearest].volfrac));
+    } else {
+      xp[i] = p.volfrac;
+    }
+  }
+  if (xnp != NULL) {
+    VecRestoreArray (finals[nearest], &xnp);
+  }
+  VecRestoreArray (opt->x, &xp);
+  VecRestoreArray (opt->xPassive0, &xPassive0p);
+  ierr = VecCopy (opt->x, opt->xold);
+  CHKERRQ(ierr);
+
+  // Fresh optimizer history
+  delete *mma;
+  *mma = new MMA (opt->n, opt->m, opt->x);
+
+  return ierr;
+}
+
+PetscErrorCode Campaign::FinishDesign (PetscInt d, TopOpt *opt) {
+  PetscErrorCode ierr = 0;
+  if (!warmStart) return ierr;
+  ierr = VecDuplicate (opt->x, &finals[d]);
+  CHKERRQ(ierr);
+  ierr = VecCopy (opt->x, finals[d]);
+  CHKERRQ(ierr);
+  return ierr;
+}
+
+PetscInt Campaign::Nearest (PetscInt d) {
+  // Distance relative to the parameters of the command line
+  PetscInt nearest = -1;
+  PetscScalar distMin = PETSC_MAX_REAL;
+  for (PetscInt i = 0; i < d; ++i) {
+    if (finals[i] == NULL) continue;
+    PetscScalar dv = (params[i].volfrac - params[d].volfrac) / base.volfrac;
+    PetscScalar dp = (params[i].penal - params[d].penal) / base.penal;
+    PetscScalar dr = (params[i].rmin - params[d].rmin) / base.rmin;
+    PetscScalar dist = dv * dv + dp * dp + dr * dr;
+    if (dist < distMin) {
+      distMin = dist;
+      nearest = i;
+    }
+  }
+  return nearest;
+}
+
+TOPOPT_NAMESPACE_END // # new
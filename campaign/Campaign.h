@@ -0,0 +1,125 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * Campaign.h
+ */
+
+#ifndef CAMPAIGN_H_
+#define CAMPAIGN_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <petsc.h>
+
+#include "Filter.h"
+#include "MMA.h"
+#include "TopOpt.h"
+
+TOPOPT_NAMESPACE_BEGIN // # new
+
+/*
+ * Parameter sweep within one run: the designs of the campaign file are
+ * optimized one after the other on the same mesh, voxelization, passive
+ * element vectors, physics (matrix pattern and multigrid hierarchy) and
+ * filter. The filter is only rebuilt when the filter radius changes.
+ *
+ * Every non-empty line of the campaign file not starting with '#' is one
+ * design, given as options overriding the ones of the command line, e.g.
+ *   -volfrac 0.2 -penal 3.0
+ *   -volfrac 0.3 -rmin 0.08
+ * Parameters: volfrac, penal, rmin, Emin, maxItr, movlim, beta, betaFinal
+ * and eta. The output of design d goes to <campaignDir>/design_<d>.
+ *
+ * Options:
+ * -campaign <string>          campaign file (default none, no campaign)
+ * -campaignDir <string>       output directory (default ./campaign)
+ * -campaignWarmStart <bool>   start from the nearest finished design,
+ *                             scaled to the volume fraction (default false)
+ */
+class Campaign {
+  public:
+
+    /*
+     * Constructor, reads the options and the campaign file
+     */
+    Campaign ();
+
+    /*
+     * Destructor, frees the kept designs
+     */
+    ~Campaign ();
+
+    /*
+     * A campaign file has been given
+     */
+    PetscBool Active () const {
+      return (PetscBool) (designs.size () > 0);
+    }
+
+    /*
+     * Number of designs
+     */
+    PetscInt Size () const {
+      return designs.size ();
+    }
+
+    /*
+     * Set the parameters and the initial design of design d, rebuild the
+     * filter if needed and create a new optimizer
+     * \param[in] design index
+     * \param[in,out] TopOpt of the target grid
+     * \param[in,out] filter and optimizer
+     * \return PetscErrorCode
+     */
+    PetscErrorCode SetUpDesign (PetscInt d, TopOpt *opt, Filter **filter,
+        MMA **mma);
+
+    /*
+     * Keep the final design of design d for the warm starts
+     * \param[in] design index
+     * \param[in] TopOpt of the target grid
+     * \return PetscErrorCode
+     */
+    PetscErrorCode FinishDesign (PetscInt d, TopOpt *opt);
+
+  private:
+    // Parameters of a design
+    struct Parameters {
+        PetscScalar volfrac, penal, rmin, Emin, movlim;
+        PetscReal beta, betaFinal, eta;
+        PetscInt maxItr;
+    };
+
+    std::vector<std::map<std::string, PetscScalar> > designs; // overrides
+    std::vector<Parameters> params; // resolved parameters per design
+    std::vector<Vec> finals; // final designs, warm start only
+    Parameters base; // parameters of the command line
+    Vec x0; // initial design of the command line
+    PetscScalar filterRmin; // radius of the current filter
+    std::string dirname;
+    PetscBool warmStart;
+
+    // Finished design closest to design d in (volfrac, penal, rmin)
+    PetscInt Nearest (PetscInt d);
+};
+
+TOPOPT_NAMESPACE_END // # new
+
+#endif /* CAMPAIGN_H_ */
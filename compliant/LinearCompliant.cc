@@ -1,4 +1,10 @@
 #include "LinearCompliant.h"
+#include "scopedtimer.h" // # new; timed regions
+#include "imbalance.h" // # new; load-imbalance diagnostics
+#include "petscutils.h" // # new; GetArrays
+#include "elementcoloring.h" // # new; threaded element loops
+
+TOPOPT_NAMESPACE_BEGIN // # new
 
 /*
  Authors: Niels Aage, Erik Andreassen, Boyan Lazarov, August 2013
@@ -22,6 +28,7 @@ LinearCompliant::LinearCompliant (DM da_nodes, PetscInt m, PetscInt numDES,
   RHS = NULL;
   N = NULL;
   ksp = NULL;
+  reusePC = PETSC_FALSE; // # new
   da_nodal = NULL;
 
   // Parameters - to be changed on read of variables
@@ -35,11 +42,17 @@ LinearCompliant::LinearCompliant (DM da_nodes, PetscInt m, PetscInt numDES,
   this->m = m;
   this->numDES = numDES; // save for internal uses
   this->numLODFIX = numLODFIX; // save for internal uses
+  kspIterations.resize (numLODFIX, 0); // # new
+  kspResiduals.resize (numLODFIX, 0.0); // # new
   Sv = NULL;
 
   U = new Vec[numLODFIX];
+  Uloc = new Vec[numLODFIX]; // # new
+  up = new PetscScalar*[numLODFIX]; // # new
+  dgp = new PetscScalar*[m]; // # new
   RHS = new Vec[numLODFIX];
   N = new Vec[numLODFIX];
+  dirichlet = new DirichletRows[numLODFIX]; // # new
 
   // Setup sitffness matrix, load vector and bcs (Dirichlet) for the design
   // problem
@@ -56,6 +69,7 @@ LinearCompliant::~LinearCompliant ()
   VecDestroyVecs (numLODFIX, &(U));
   VecDestroyVecs (numLODFIX, &(RHS));
   VecDestroyVecs (numLODFIX, &(N));
+  delete[] dirichlet; // # new
   MatDestroy (&(K));
   KSPDestroy (&(ksp));
 
@@ -64,6 +78,9 @@ LinearCompliant::~LinearCompliant ()
   }
 
   VecDestroy (&(Sv));
+  delete[] Uloc; // # new
+  delete[] up; // # new
+  delete[] dgp; // # new
 }
 
 PetscErrorCode
@@ -119,9 +136,15 @@ LinearCompliant::SetUpLoadAndBC (DM da_nodes, Vec xPassive0,
       xc[3] = ne[1] * dy;
     }
 
-    // Create the nodal mesh
-    DMDACreate2d (PETSC_COMM_WORLD, bx, by, stype, nn[0], nn[1], PETSC_DECIDE,
-    PETSC_DECIDE, numnodaldof, stencilwidth, 0, 0, &(da_nodal));
+    // # modified; Create the nodal mesh with the partition of da_nodes, which
+    // may be occupancy weighted (-balanceDomain)
+    PetscInt mdn, ndn;
+    const PetscInt *lxn, *lyn;
+    DMDAGetInfo (da_nodes, NULL, NULL, NULL, NULL, &mdn, &ndn, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL);
+    DMDAGetOwnershipRanges (da_nodes, &lxn, &lyn, NULL);
+    DMDACreate2d (PETSC_COMM_WORLD, bx, by, stype, nn[0], nn[1], mdn, ndn,
+        numnodaldof, stencilwidth, lxn, lyn, &(da_nodal));
     // Initialize
     DMSetFromOptions (da_nodal);
     DMSetUp (da_nodal);
@@ -193,7 +216,7 @@ LinearCompliant::SetUpLoadAndBC (DM da_nodes, Vec xPassive0,
   const PetscInt *necon;
   DMDAGetElements_2D (da_nodal, &nel, &nen, &necon);
 
-  if (IMPORT_GEO == 0) {
+  if (importGeo == 0) { // # modified; -importGeo
     // Set the values:
     // In this case: N = the four corners at x=xmin is clamped
     // Force in: RHS(z) = 1 at (x=xmin,y=ymin,z=zmax)
@@ -342,11 +365,15 @@ LinearCompliant::SetUpLoadAndBC (DM da_nodes, Vec xPassive0,
       xc[5] = ne[2] * dz;
     }
 
-    // Create the nodal mesh
-    DMDACreate3d (PETSC_COMM_WORLD, bx, by, bz, stype, nn[0], nn[1], nn[2],
-    PETSC_DECIDE, PETSC_DECIDE, PETSC_DECIDE, numnodaldof, stencilwidth, 0, 0,
-        0,
-        &(da_nodal));
+    // # modified; Create the nodal mesh with the partition of da_nodes, which
+    // may be occupancy weighted (-balanceDomain)
+    PetscInt mdn, ndn, pdn;
+    const PetscInt *lxn, *lyn, *lzn;
+    DMDAGetInfo (da_nodes, NULL, NULL, NULL, NULL, &mdn, &ndn, &pdn, NULL, NULL,
+        NULL, NULL, NULL, NULL);
+    DMDAGetOwnershipRanges (da_nodes, &lxn, &lyn, &lzn);
+    DMDACreate3d (PETSC_COMM_WORLD, bx, by, bz, stype, nn[0], nn[1], nn[2], mdn,
+        ndn, pdn, numnodaldof, stencilwidth, lxn, lyn, lzn, &(da_nodal));
     // Initialize
     DMSetFromOptions (da_nodal);
     DMSetUp (da_nodal);
@@ -423,7 +450,7 @@ LinearCompliant::SetUpLoadAndBC (DM da_nodes, Vec xPassive0,
   const PetscInt *necon;
   DMDAGetElements_3D (da_nodal, &nel, &nen, &necon);
 
-  if (IMPORT_GEO == 0) {
+  if (importGeo == 0) { // # modified; -importGeo
     // Set the values:
     // In this case: N = the four corners at x=xmin is clamped
     // Force in: RHS(z) = 1 at (x=xmin,y=ymin,z=zmax)
@@ -538,11 +565,23 @@ LinearCompliant::SetUpLoadAndBC (DM da_nodes, Vec xPassive0,
 
 #endif
 
+  // # new; Mirror planes of a reduced model, -symmetry
+  ierr = symmetry.ZeroNormalDisplacement (N[loadCondition], lcoorp, nn, xc,
+      epsi);
+  CHKERRQ(ierr);
+
   // Restore vectors
   VecAssemblyBegin (N[loadCondition]);
   VecAssemblyEnd (N[loadCondition]);
   VecAssemblyBegin (RHS[loadCondition]);
   VecAssemblyEnd (RHS[loadCondition]);
+
+  // # new; The constrained dofs, and no loads on them
+  ierr = dirichlet[loadCondition].SetUp (N[loadCondition]);
+  CHKERRQ(ierr);
+  ierr = VecPointwiseMult (RHS[loadCondition], RHS[loadCondition],
+      N[loadCondition]);
+  CHKERRQ(ierr);
   VecRestoreArray (lcoor, &lcoorp);
   DMDARestoreElements (da_nodal, &nel, &nen, &necon);
   VecAssemblyBegin (Sv);
@@ -561,24 +600,100 @@ LinearCompliant::SolveState (Vec xPhys, PetscScalar Emin,
 
   PetscErrorCode ierr;
 
-  double t1, t2;
-  t1 = MPI_Wtime ();
+  ScopedTimer solveTimer ("SolveState"); // # modified
 
-  // Assemble the stiffness matrix
-  ierr = AssembleStiffnessMatrix (xPhys, Emin, Emax, penal, loadCondition);
+  // # modified; Assemble the stiffness matrix and set up the solver
+  ierr = AssembleAndSetUp (xPhys, Emin, Emax, penal, loadCondition);
   CHKERRQ(ierr);
 
-  // Setup the solver
-  if (ksp == NULL) {
-    ierr = SetUpSolver ();
+  // # modified; Solve
+  ierr = SolveLoadCase (loadCondition, solveTimer);
+  CHKERRQ(ierr);
+
+  return ierr;
+}
+
+PetscErrorCode
+LinearCompliant::SolveStates (Vec xPhys, PetscScalar Emin,
+    PetscScalar Emax, PetscScalar penal) { // # new
+
+  PetscErrorCode ierr = 0;
+
+  // The input and output ports share K and Sv, so one assembly and one
+  // preconditioner setup serve all the load cases when their Dirichlet
+  // vectors agree
+  PetscBool shared = PETSC_TRUE;
+  for (PetscInt loadCondition = 1; loadCondition < numLODFIX && shared;
+      ++loadCondition) {
+    ierr = VecEqual (N[0], N[loadCondition], &shared);
     CHKERRQ(ierr);
-  } else {
-    ierr = KSPSetOperators (ksp, K, K);
+  }
+  if (!shared) {
+    for (PetscInt loadCondition = 0; loadCondition < numLODFIX;
+        ++loadCondition) {
+      ierr = SolveState (xPhys, Emin, Emax, penal, loadCondition);
+      CHKERRQ(ierr);
+    }
+    return ierr;
+  }
+
+  ScopedTimer solveTimer ("SolveState");
+
+  ierr = AssembleAndSetUp (xPhys, Emin, Emax, penal, 0);
+  CHKERRQ(ierr);
+
+  for (PetscInt loadCondition = 0; loadCondition < numLODFIX;
+      ++loadCondition) {
+    ierr = SolveLoadCase (loadCondition, solveTimer);
+    CHKERRQ(ierr);
+  }
+
+  return ierr;
+}
+
+PetscErrorCode
+LinearCompliant::AssembleAndSetUp (Vec xPhys, PetscScalar Emin,
+    PetscScalar Emax, PetscScalar penal, PetscInt loadCondition) { // # new
+
+  PetscErrorCode ierr;
+
+  // Assemble the stiffness matrix
+  {
+    ScopedTimer assembleTimer ("Assemble"); // # new
+    ierr = AssembleStiffnessMatrix (xPhys, Emin, Emax, penal, loadCondition);
     CHKERRQ(ierr);
-    KSPSetUp (ksp);
   }
 
+  // # new; Time the wait for the slowest rank's assembly, -imbalance
+  ierr = ImbalanceWait (PETSC_COMM_WORLD);
+  CHKERRQ(ierr);
+
+  // Setup the solver
+  {
+    ScopedTimer setupTimer ("PCSetUp"); // # new
+    if (ksp == NULL) {
+      ierr = SetUpSolver ();
+      CHKERRQ(ierr);
+    } else {
+      ierr = KSPSetOperators (ksp, K, K);
+      CHKERRQ(ierr);
+      ierr = KSPSetReusePreconditioner (ksp, reusePC); // # new
+      CHKERRQ(ierr);
+      KSPSetUp (ksp);
+    }
+  }
+
+  return ierr;
+}
+
+PetscErrorCode
+LinearCompliant::SolveLoadCase (PetscInt loadCondition,
+    const ScopedTimer &solveTimer) { // # new
+
+  PetscErrorCode ierr;
+
   // Solve
+  ScopedTimer kspTimer ("KSPSolve"); // # new
   ierr = KSPSolve (ksp, RHS[loadCondition], U[loadCondition]);
   CHKERRQ(ierr);
 
@@ -592,10 +707,15 @@ LinearCompliant::SolveState (Vec xPhys, PetscScalar Emin,
   ierr = VecNorm (RHS[loadCondition], NORM_2, &RHSnorm);
   CHKERRQ(ierr);
   rnorm = rnorm / RHSnorm;
+  kspTimer.Stop (); // # new
+  if (loadCondition < (PetscInt) kspIterations.size ()) { // # new
+    kspIterations[loadCondition] = niter;
+    kspResiduals[loadCondition] = PetscRealPart (rnorm);
+  }
 
-  t2 = MPI_Wtime ();
   PetscPrintf (PETSC_COMM_WORLD,
-      "State solver:  iter: %i, rerr.: %e, time: %f\n", niter, rnorm, t2 - t1);
+      "State solver:  iter: %i, rerr.: %e, time: %f\n", niter, rnorm,
+      solveTimer.Elapsed ()); // # modified
 
   return ierr;
 }
@@ -608,12 +728,11 @@ LinearCompliant::ComputeObjectiveConstraintsSensitivities (
   // Errorcode
   PetscErrorCode ierr;
 
-  // Solve state eqs
-  for (PetscInt loadCondition = 0; loadCondition < numLODFIX;
-      ++loadCondition) { // loop over number of loads
-    ierr = SolveState (xPhys, Emin, Emax, penal, loadCondition);
-    CHKERRQ(ierr);
-  }
+  // # modified; Solve state eqs, input and output port with one assembly
+  ierr = SolveStates (xPhys, Emin, Emax, penal);
+  CHKERRQ(ierr);
+
+  ScopedTimer sensTimer ("Sensitivity"); // # new
 
 // Get the FE mesh structure (from the nodal mesh)
   PetscInt nel, nen;
@@ -636,30 +755,27 @@ LinearCompliant::ComputeObjectiveConstraintsSensitivities (
   VecGetArray (xPassive2, &xPassive2p);
   VecGetArray (xPassive3, &xPassive3p);
 
-  // Get Solution
-  Vec Uloctmp, *Uloc;
-  DMCreateLocalVector (da_nodal, &Uloctmp);
-  VecDuplicateVecs (Uloctmp, numLODFIX, &Uloc);
+  // # modified; Get Solution, into the work vectors of the DM
   for (int i = 0; i < numLODFIX; ++i) { // loop over number of loads
+    DMGetLocalVector (da_nodal, &Uloc[i]);
     DMGlobalToLocalBegin (da_nodal, U[i], INSERT_VALUES, Uloc[i]);
     DMGlobalToLocalEnd (da_nodal, U[i], INSERT_VALUES, Uloc[i]);
   }
 
   // get pointer to local vector
-  PetscScalar **up;
-  VecGetArrays (Uloc, numLODFIX, &up);
+  GetArrays (Uloc, numLODFIX, up); // # modified
 
   // Get dfdx
   PetscScalar *df;
   VecGetArray (dfdx, &df);
 
   // Get dgdx
-  PetscScalar **dg;
+  PetscScalar **dg = dgp; // # modified
   for (PetscInt i = 0; i < m; ++i) {
     VecSet (dgdx[i], 0);
     gx[i] = 0;
   }
-  VecGetArrays (dgdx, m, &dg);
+  GetArrays (dgdx, m, dg); // # modified
 
   // Number of total elements and nonDesign domain elements
   PetscInt neltot = 0;
@@ -669,19 +785,19 @@ LinearCompliant::ComputeObjectiveConstraintsSensitivities (
   // Get Sv, the spring vector
   PetscScalar *svp;
   Vec Svloc;
-  VecDuplicate (Uloctmp, &Svloc);
+  DMGetLocalVector (da_nodal, &Svloc); // # modified
   DMGlobalToLocalBegin (da_nodal, Sv, INSERT_VALUES, Svloc);
   DMGlobalToLocalEnd (da_nodal, Sv, INSERT_VALUES, Svloc);
   VecGetArray (Svloc, &svp);
 
-  // Edof array
-  PetscInt edof[nedof];
-
-  fx[0] = 0.0;
-  // Loop over elements
+  // # modified; Loop over elements, threaded with the sums reduced
+  PetscScalar fsum = 0.0, volume = 0.0;
+  TOPOPT_OMP(parallel for reduction(+:fsum, volume, nNonDesign))
   for (PetscInt i = 0; i < nel; i++) {
     // loop over element nodes
     if (xPassive0p[i] != 0) {
+      // Edof array
+      PetscInt edof[nedof];
       for (PetscInt j = 0; j < nen; j++) {
         // Get local dofs
         for (PetscInt k = 0; k < DIM; k++) {
@@ -702,12 +818,12 @@ LinearCompliant::ComputeObjectiveConstraintsSensitivities (
         }
       }
       // Add to objective
-      fx[0] += (Emin + PetscPowScalar(xp[i], penal) * (Emax - Emin)) * uKu;
+      fsum += (Emin + PetscPowScalar(xp[i], penal) * (Emax - Emin)) * uKu;
       // Set the Senstivity
       df[i] = penal * PetscPowScalar(xp[i], penal - 1) * (Emax - Emin) * uKu;
       // # new; Constraints
+      volume += xp[i];
       for (PetscInt j = 0; j < m; ++j) {
-        gx[j] += xp[i];
         dg[j][i] = 1;
       }
     } else if (xPassive1p[i] != 0 || xPassive2p[i] != 0 || xPassive3p[i] != 0) {
@@ -719,6 +835,10 @@ LinearCompliant::ComputeObjectiveConstraintsSensitivities (
 
     }
   }
+  fx[0] = fsum;
+  for (PetscInt j = 0; j < m; ++j) {
+    gx[j] = volume;
+  }
 
   // Allreduce fx[0]
   PetscScalar tmp = fx[0];
@@ -746,14 +866,35 @@ LinearCompliant::ComputeObjectiveConstraintsSensitivities (
   VecRestoreArray (xPassive1, &xPassive1p); // # new
   VecRestoreArray (xPassive2, &xPassive2p); // # new
   VecRestoreArray (xPassive3, &xPassive3p); // # new
-  VecRestoreArrays (Uloc, numLODFIX, &up);
+  RestoreArrays (Uloc, numLODFIX, up); // # modified
   VecRestoreArray (dfdx, &df);
-  VecRestoreArrays (dgdx, m, &dg);
-  VecDestroyVecs (numLODFIX, &Uloc);
+  RestoreArrays (dgdx, m, dg); // # modified
+  for (int i = 0; i < numLODFIX; ++i) { // # modified
+    DMRestoreLocalVector (da_nodal, &Uloc[i]);
+  }
+  VecRestoreArray (Svloc, &svp); // # new
+  DMRestoreLocalVector (da_nodal, &Svloc); // # new
 
   return (ierr);
 }
 
+PetscErrorCode
+LinearCompliant::AccountMemory (MemoryReport *mem)
+{
+  PetscErrorCode ierr = 0;
+  mem->Add ("Physics K", MemoryReport::MatBytes (K));
+  mem->Add ("Physics assembly map", assemblyMap.Bytes ()); // # new
+  for (PetscInt i = 0; i < numLODFIX; i++) { // # new
+    mem->Add ("Physics Dirichlet rows", dirichlet[i].Bytes ());
+  }
+  mem->Add ("Physics MG hierarchy", MemoryReport::MGBytes (ksp));
+  mem->Add ("Physics U, RHS/N per load case",
+      MemoryReport::VecsBytes (U, numLODFIX)
+      + MemoryReport::VecsBytes (RHS, numLODFIX)
+      + MemoryReport::VecsBytes (N, numLODFIX) + MemoryReport::VecBytes (Sv));
+  return ierr;
+}
+
 PetscErrorCode
 LinearCompliant::WriteRestartFiles ()
 {
@@ -794,15 +935,16 @@ LinearCompliant::WriteRestartFiles ()
 
 PetscErrorCode
 LinearCompliant::FEAWithTopOptResults (Vec xPhys, Vec xPassive0,
-    Vec xPassive1, Vec xPassive2, Vec xPassive3, PetscInt loadConditionFEA,
-    PetscScalar *loadVectorFEAp) { // # new
+    Vec xPassive1, Vec xPassive2, Vec xPassive3, PetscInt numLoadFEA,
+    PetscScalar * /* loadVectorFEAp, the loads are fixed */) { // # new
   // Errorcode
   PetscErrorCode ierr = 0;
 
-  PetscPrintf (PETSC_COMM_WORLD, "FEA with TopOpt Results, step: %d\n",
-      loadConditionFEA);
+  // # modified; The loads do not depend on the verification load vector, the
+  // state of the first load condition stands for all of them
+  PetscPrintf (PETSC_COMM_WORLD, "FEA with TopOpt Results, %i loads as one\n",
+      numLoadFEA);
 
-  // only first load condition because we are solving FEA only one at a time
   SetUpLoadAndBC (da_nodal, xPassive0, xPassive1, xPassive2, xPassive3, 0);
   // Solve state eqs,
   ierr = SolveState (xPhys, 1E-9, 1.0, 1.0, 0);
@@ -840,31 +982,11 @@ LinearCompliant::AssembleStiffnessMatrix (Vec xPhys,
   PetscScalar *xp;
   VecGetArray (xPhys, &xp);
 
-// Zero the matrix
-  MatZeroEntries (K);
-
-// Edof array
-  PetscInt edof[nedof];
-  PetscScalar ke[nedof * nedof];
-
-// Loop over elements
-  for (PetscInt i = 0; i < nel; i++) {
-    // loop over element nodes
-    for (PetscInt j = 0; j < nen; j++) {
-      // Get local dofs
-      for (PetscInt k = 0; k < DIM; k++) {
-        edof[j * DIM + k] = DIM * necon[i * nen + j] + k;
-      }
-    }
-    // Use SIMP for stiffness interpolation
-    PetscScalar dens = Emin + PetscPowScalar(xp[i], penal) * (Emax - Emin);
-    for (PetscInt k = 0; k < nedof * nedof; k++) {
-      ke[k] = KE[k] * dens;
-    }
-    // Add values to the sparse matrix
-    ierr = MatSetValuesLocal (K, nedof, edof, nedof, edof, ke, ADD_VALUES);
-    CHKERRQ(ierr);
-  }
+// # modified; Zero the matrix and add the SIMP scaled element matrices,
+// through the cached destinations of the element entries (-assemblyMap)
+  ierr = assemblyMap.Assemble (K, nel, nen, necon, DIM, KE, xp, Emin, Emax,
+      penal);
+  CHKERRQ(ierr);
 // Add the external spring
   ierr = MatDiagonalSet (K, Sv, ADD_VALUES);
   CHKERRQ(ierr);
@@ -872,21 +994,12 @@ LinearCompliant::AssembleStiffnessMatrix (Vec xPhys,
   MatAssemblyBegin (K, MAT_FINAL_ASSEMBLY);
   MatAssemblyEnd (K, MAT_FINAL_ASSEMBLY);
 
-// Impose the dirichlet conditions, i.e. K = N'*K*N - (N-I)
-// 1.: K = N'*K*N
-  MatDiagonalScale (K, N[loadCondition], N[loadCondition]);
-// 2. Add ones, i.e. K = K + NI, NI = I - N
-  Vec NI;
-  VecDuplicate (N[loadCondition], &NI);
-  VecSet (NI, 1.0);
-  VecAXPY (NI, -1.0, N[loadCondition]);
-  MatDiagonalSet (K, NI, ADD_VALUES);
-
-// Zero out possible loads in the RHS that coincide
-// with Dirichlet conditions
-  VecPointwiseMult (RHS[loadCondition], RHS[loadCondition], N[loadCondition]);
-
-  VecDestroy (&NI);
+// # modified; Impose the dirichlet conditions, i.e. K = N'*K*N - (N-I), by
+// zeroing the constrained rows and columns in place; the loads on them are
+// zeroed in SetUpLoadAndBC
+  ierr = dirichlet[loadCondition].Apply (K);
+  CHKERRQ(ierr);
+
   VecRestoreArray (xPhys, &xp);
   DMDARestoreElements (da_nodal, &nel, &nen, &necon);
 
@@ -1655,3 +1768,5 @@ LinearCompliant::Dot (PetscScalar *v1, PetscScalar *v2,
   }
   return result;
 }
+
+TOPOPT_NAMESPACE_END // # new
@@ -1,13 +1,23 @@
-#ifndef __LINEARELASTICITY__
-#define __LINEARELASTICITY__
+#ifndef __LINEARCOMPLIANT__
+#define __LINEARCOMPLIANT__
 
 #include <fstream>
 #include <iostream>
 #include <math.h>
 #include <petsc.h>
 #include <petsc/private/dmdaimpl.h>
+#include <vector>
 
+#include "Physics.h" // # new; interface of the physical problems
 #include "options.h" // framework options, new
+#include "memoryreport.h" // # new
+#include "assemblymap.h" // # new
+#include "dirichletrows.h" // # new
+#include "SymmetryPlanes.h" // # new; mirror planes of reduced models
+
+class ScopedTimer; // # new
+
+TOPOPT_NAMESPACE_BEGIN // # new
 
 /*
  Authors: Niels Aage, Erik Andreassen, Boyan Lazarov, August 2013
@@ -24,7 +34,7 @@
  * Modified by Zhidong Brian Zhang in May 2020, University of Waterloo
  */
 
-class LinearCompliant {
+class LinearCompliant : public Physics { // # modified
 
   public:
     // Constructor
@@ -50,20 +60,34 @@ class LinearCompliant {
       return (U[0]);
     }
 
-    // Get pointer to DMDA
-    DM GetDM () {
-      return (da_nodal);
+    // # new; Keep the preconditioner of the last set up for the next solves,
+    // e.g. the realizations of the robust formulation after the blueprint
+    void SetReusePreconditioner (PetscBool reuse) {
+      reusePC = reuse;
     }
 
-    // Logical mesh
-    DM da_nodal; // Nodal mesh
+    // # new; Add the bytes of the system matrix, its multigrid hierarchy and
+    // the vectors of all load cases to the memory report
+    PetscErrorCode AccountMemory (MemoryReport *mem);
 
-    // # new; FEA with the TopOpt final results
+    // # new; FEA with the TopOpt final results for all the verification
+    // loads
     PetscErrorCode FEAWithTopOptResults (Vec xPhys, Vec xPassive0,
-        Vec xPassive1, Vec xPassive2, Vec xPassive3, PetscInt loadConditionFEA,
+        Vec xPassive1, Vec xPassive2, Vec xPassive3, PetscInt numLoadFEA,
         PetscScalar *loadVectorFEAp);
 
+    // # new; States of the verification loads, one for all of them
+    PetscInt GetNumFEAStates () {
+      return (1);
+    }
+    Vec *GetFEAStates () {
+      return (&U[0]);
+    }
+
   private:
+    // # new; Mirror planes, zero normal displacement
+    SymmetryPlanes symmetry;
+
     // Logical mesh
     PetscInt nn[DIM]; // Number of nodes in each direction, new
     PetscInt ne[DIM]; // Number of elements in each direction, new
@@ -74,6 +98,10 @@ class LinearCompliant {
     Vec *U; // Displacement vector
     Vec *RHS; // Load vector
     Vec *N; // Dirichlet vector (used when imposing BCs)
+    Vec *Uloc; // # new; local states, work vectors of da_nodal
+    PetscScalar **up, **dgp; // # new; the arrays of Uloc and dgdx
+    AssemblyMap assemblyMap; // # new; cached element assembly of K
+    DirichletRows *dirichlet; // # new; constrained dofs of each load case
 #if DIM == 2
     static const PetscInt nedof = 8; // new Number of elemental dofs
 #elif DIM == 3
@@ -83,6 +111,7 @@ class LinearCompliant {
 
     // Solver
     KSP ksp; // Pointer to the KSP object i.e. the linear solver+prec
+    PetscBool reusePC; // # new; see SetReusePreconditioner
     PetscInt nlvls;
     PetscScalar nu; // Possions ratio
     PetscScalar E; // Possions ratio
@@ -108,6 +137,20 @@ class LinearCompliant {
     PetscErrorCode SolveState (Vec xPhys, PetscScalar Emin, PetscScalar Emax,
         PetscScalar penal, PetscInt loadStep);
 
+    // # new; Solve all the load cases, assembling K and setting up the
+    // preconditioner once when they share the Dirichlet conditions
+    PetscErrorCode SolveStates (Vec xPhys, PetscScalar Emin, PetscScalar Emax,
+        PetscScalar penal);
+
+    // # new; Assemble K with the Dirichlet conditions of a load case and
+    // set up the solver
+    PetscErrorCode AssembleAndSetUp (Vec xPhys, PetscScalar Emin,
+        PetscScalar Emax, PetscScalar penal, PetscInt loadCondition);
+
+    // # new; Solve one load case with the current operator
+    PetscErrorCode SolveLoadCase (PetscInt loadCondition,
+        const ScopedTimer &solveTimer);
+
     // Assemble the stiffness matrix
     PetscErrorCode AssembleStiffnessMatrix (Vec xPhys, PetscScalar Emin,
         PetscScalar Emax, PetscScalar penal, PetscInt loadCondition);
@@ -158,4 +201,6 @@ class LinearCompliant {
     }
 };
 
+TOPOPT_NAMESPACE_END // # new
+
 #endif
@@ -0,0 +1,55 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * dispatch.cc
+ *
+ * Entry point of topopt and microbench. Every class depending on the
+ * dimension is compiled once for 2D and once for 3D into the namespace
+ * topopt_d<DIM> (see options.h and the makefile), so its element loops keep
+ * the dimension as a compile time constant. The dimension is selected here
+ * at run time, the physical problem by Physics::Create within the variant.
+ *
+ * Options:
+ * -dim <int>  2-2D, 3-3D (default 2)
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace topopt_d2 { int Main (int argc, char *argv[]); }
+namespace topopt_d3 { int Main (int argc, char *argv[]); }
+
+int main (int argc, char *argv[]) {
+
+  // Read before PetscInitialize, which is called by the variant. The option
+  // stays in argv and is ignored by PETSc.
+  int dim = 2;
+  for (int i = 1; i + 1 < argc; i++) {
+    if (strcmp (argv[i], "-dim") == 0) {
+      dim = atoi (argv[i + 1]);
+    }
+  }
+
+  if (dim == 2) return topopt_d2::Main (argc, argv);
+  if (dim == 3) return topopt_d3::Main (argc, argv);
+
+  fprintf (stderr, "# Unsupported -dim %i: 2 or 3\n", dim);
+  return 1;
+}
@@ -1,4 +1,10 @@
 #include "LinearHeatConduction.h"
+#include "scopedtimer.h" // # new; timed regions
+#include "imbalance.h" // # new; load-imbalance diagnostics
+#include "petscutils.h" // # new; GetArrays, CreateElementDA
+#include "elementcoloring.h" // # new; threaded element loops
+
+TOPOPT_NAMESPACE_BEGIN // # new
 
 /*
  Authors: Niels Aage, Erik Andreassen, Boyan Lazarov, August 2013
@@ -13,6 +19,266 @@
  * Modified by Zhidong Brian Zhang in August 2020, University of Waterloo
  */
 
+// # new; Level of the matrix-free multigrid hierarchy (-heatMatrixFree).
+// The operator N'*K*N + I - N is applied element by element with the
+// element coefficients kappa = Emin + x^penal*(Emax-Emin) and the element
+// matrix of the level, rediscretized for the coarsened element size. The
+// coefficients of a coarse element are the average of its 2^DIM children.
+static const PetscInt mfNen = (DIM == 2) ? 4 : 8;
+
+struct MatrixFreeLevel {
+    DM da; // nodal mesh, da_nodal on the finest level
+    DM daElem; // element mesh with the element partition of da
+    Mat A; // shell operator, assembled on the coarsest level
+    Mat R; // averaging of the coefficients of the next finer level
+    Mat inj; // injection of the Dirichlet vector of the next finer level
+    Vec kappa; // element coefficients
+    Vec Nv, Nloc; // Dirichlet vector, global and ghosted
+    Vec xloc, yloc; // ghosted work vectors of the shell product
+    PetscInt nel, nen;
+    const PetscInt *necon;
+    PetscScalar KE[mfNen * mfNen]; // element matrix of the level
+    ElementColoring coloring; // colors of the threaded element loops
+};
+
+static void DestroyMatrixFreeLevel (MatrixFreeLevel *lev, PetscBool ownDA) {
+  MatDestroy (&(lev->A));
+  MatDestroy (&(lev->R));
+  MatDestroy (&(lev->inj));
+  VecDestroy (&(lev->kappa));
+  VecDestroy (&(lev->Nv));
+  VecDestroy (&(lev->Nloc));
+  VecDestroy (&(lev->xloc));
+  VecDestroy (&(lev->yloc));
+  DMDestroy (&(lev->daElem));
+  if (ownDA) {
+    DMDestroy (&(lev->da));
+  }
+  delete lev;
+}
+
+// y = N*K*N*x + (I - N)*x, the elements are added on the ghosted vectors
+static PetscErrorCode MatrixFreeMult (Mat A, Vec x, Vec y) {
+  PetscErrorCode ierr = 0;
+  MatrixFreeLevel *lev;
+  MatShellGetContext (A, (void**) &lev);
+
+  ierr = DMGlobalToLocalBegin (lev->da, x, INSERT_VALUES, lev->xloc);
+  CHKERRQ(ierr);
+  ierr = DMGlobalToLocalEnd (lev->da, x, INSERT_VALUES, lev->xloc);
+  CHKERRQ(ierr);
+  VecPointwiseMult (lev->xloc, lev->xloc, lev->Nloc);
+  VecSet (lev->yloc, 0.0);
+
+  PetscScalar *xp, *yp, *kp;
+  VecGetArray (lev->xloc, &xp);
+  VecGetArray (lev->yloc, &yp);
+  VecGetArray (lev->kappa, &kp);
+  const ElementColoring &coloring = lev->coloring;
+  for (PetscInt c = 0; c < coloring.Colors (); c++) {
+    const PetscInt *elements = coloring.Elements (c);
+    TOPOPT_OMP(parallel for)
+    for (PetscInt e = 0; e < coloring.Size (c); e++) {
+      PetscInt i = elements[e];
+      const PetscInt *en = &(lev->necon[i * mfNen]);
+      PetscScalar ue[mfNen];
+      for (PetscInt j = 0; j < mfNen; j++) {
+        ue[j] = xp[en[j]];
+      }
+      for (PetscInt k = 0; k < mfNen; k++) {
+        PetscScalar ke = 0.0;
+        for (PetscInt h = 0; h < mfNen; h++) {
+          ke += lev->KE[k * mfNen + h] * ue[h];
+        }
+        yp[en[k]] += kp[i] * ke;
+      }
+    }
+  }
+  VecRestoreArray (lev->xloc, &xp);
+  VecRestoreArray (lev->yloc, &yp);
+  VecRestoreArray (lev->kappa, &kp);
+
+  VecSet (y, 0.0);
+  ierr = DMLocalToGlobalBegin (lev->da, lev->yloc, ADD_VALUES, y);
+  CHKERRQ(ierr);
+  ierr = DMLocalToGlobalEnd (lev->da, lev->yloc, ADD_VALUES, y);
+  CHKERRQ(ierr);
+
+  // Dirichlet rows: the identity, x is locked read only by MatMult
+  PetscScalar *np, *ygp;
+  const PetscScalar *xgp;
+  PetscInt nloc;
+  VecGetLocalSize (y, &nloc);
+  VecGetArray (lev->Nv, &np);
+  VecGetArrayRead (x, &xgp);
+  VecGetArray (y, &ygp);
+  for (PetscInt i = 0; i < nloc; i++) {
+    ygp[i] = np[i] * ygp[i] + (1.0 - np[i]) * xgp[i];
+  }
+  VecRestoreArray (lev->Nv, &np);
+  VecRestoreArrayRead (x, &xgp);
+  VecRestoreArray (y, &ygp);
+
+  return ierr;
+}
+
+// Diagonal of the operator, for the Jacobi preconditioner of the smoothers
+static PetscErrorCode MatrixFreeGetDiagonal (Mat A, Vec d) {
+  PetscErrorCode ierr = 0;
+  MatrixFreeLevel *lev;
+  MatShellGetContext (A, (void**) &lev);
+
+  VecSet (lev->yloc, 0.0);
+  PetscScalar *yp, *kp;
+  VecGetArray (lev->yloc, &yp);
+  VecGetArray (lev->kappa, &kp);
+  const ElementColoring &coloring = lev->coloring;
+  for (PetscInt c = 0; c < coloring.Colors (); c++) {
+    const PetscInt *elements = coloring.Elements (c);
+    TOPOPT_OMP(parallel for)
+    for (PetscInt e = 0; e < coloring.Size (c); e++) {
+      PetscInt i = elements[e];
+      const PetscInt *en = &(lev->necon[i * mfNen]);
+      for (PetscInt k = 0; k < mfNen; k++) {
+        yp[en[k]] += kp[i] * lev->KE[k * mfNen + k];
+      }
+    }
+  }
+  VecRestoreArray (lev->yloc, &yp);
+  VecRestoreArray (lev->kappa, &kp);
+
+  VecSet (d, 0.0);
+  ierr = DMLocalToGlobalBegin (lev->da, lev->yloc, ADD_VALUES, d);
+  CHKERRQ(ierr);
+  ierr = DMLocalToGlobalEnd (lev->da, lev->yloc, ADD_VALUES, d);
+  CHKERRQ(ierr);
+
+  PetscScalar *np, *dp;
+  PetscInt nloc;
+  VecGetLocalSize (d, &nloc);
+  VecGetArray (lev->Nv, &np);
+  VecGetArray (d, &dp);
+  for (PetscInt i = 0; i < nloc; i++) {
+    dp[i] = np[i] * dp[i] + (1.0 - np[i]);
+  }
+  VecRestoreArray (lev->Nv, &np);
+  VecRestoreArray (d, &dp);
+
+  return ierr;
+}
+
+// Assemble the operator of the coarsest level
+static PetscErrorCode MatrixFreeAssemble (MatrixFreeLevel *lev) {
+  PetscErrorCode ierr = 0;
+
+  MatZeroEntries (lev->A);
+  PetscScalar *kp;
+  VecGetArray (lev->kappa, &kp);
+  PetscInt edof[mfNen];
+  PetscScalar ke[mfNen * mfNen];
+  for (PetscInt i = 0; i < lev->nel; i++) {
+    for (PetscInt j = 0; j < mfNen; j++) {
+      edof[j] = lev->necon[i * mfNen + j];
+    }
+    for (PetscInt k = 0; k < mfNen * mfNen; k++) {
+      ke[k] = lev->KE[k] * kp[i];
+    }
+    ierr = MatSetValuesLocal (lev->A, mfNen, edof, mfNen, edof, ke,
+        ADD_VALUES);
+    CHKERRQ(ierr);
+  }
+  VecRestoreArray (lev->kappa, &kp);
+  MatAssemblyBegin (lev->A, MAT_FINAL_ASSEMBLY);
+  MatAssemblyEnd (lev->A, MAT_FINAL_ASSEMBLY);
+
+  // K = N'*K*N + I - N
+  MatDiagonalScale (lev->A, lev->Nv, lev->Nv);
+  Vec NI;
+  DMGetGlobalVector (lev->da, &NI);
+  VecSet (NI, 1.0);
+  VecAXPY (NI, -1.0, lev->Nv);
+  MatDiagonalSet (lev->A, NI, ADD_VALUES);
+  DMRestoreGlobalVector (lev->da, &NI);
+
+  return ierr;
+}
+
+// Averaging of the 2^DIM children of every coarse element, matched by the
+// natural ordering of the element meshes since the partitions differ
+static PetscErrorCode CreateAveraging (DM daCoarse, DM daFine, Mat *R) {
+  PetscErrorCode ierr = 0;
+
+  MPI_Comm comm;
+  PetscObjectGetComm ((PetscObject) daCoarse, &comm);
+  PetscInt Mc, Nc, Mf, Nf;
+  DMDAGetInfo (daCoarse, NULL, &Mc, &Nc, NULL, NULL, NULL, NULL, NULL, NULL,
+      NULL, NULL, NULL, NULL);
+  DMDAGetInfo (daFine, NULL, &Mf, &Nf, NULL, NULL, NULL, NULL, NULL, NULL,
+      NULL, NULL, NULL, NULL);
+  PetscInt xs, ys, zs, xm, ym, zm;
+  DMDAGetCorners (daCoarse, &xs, &ys, &zs, &xm, &ym, &zm);
+#if DIM == 2
+  zs = 0;
+  zm = 1;
+#endif
+
+  const PetscInt nc = 1 << DIM;
+  PetscInt nrow = xm * ym * zm;
+  std::vector<PetscInt> rows (nrow), cols (nrow * nc);
+  PetscInt cnt = 0;
+  for (PetscInt k = zs; k < zs + zm; k++) {
+    for (PetscInt j = ys; j < ys + ym; j++) {
+      for (PetscInt i = xs; i < xs + xm; i++) {
+        rows[cnt] = i + j * Mc + k * Mc * Nc;
+        PetscInt c = 0;
+        for (PetscInt kk = 0; kk < (DIM == 3 ? 2 : 1); kk++) {
+          for (PetscInt jj = 0; jj < 2; jj++) {
+            for (PetscInt ii = 0; ii < 2; ii++) {
+              cols[cnt * nc + c++] = (2 * i + ii) + (2 * j + jj) * Mf
+                                     + (2 * k + kk) * Mf * Nf;
+            }
+          }
+        }
+        cnt++;
+      }
+    }
+  }
+
+  // Natural ordering -> PETSc ordering
+  AO aoCoarse, aoFine;
+  ierr = DMDAGetAO (daCoarse, &aoCoarse);
+  CHKERRQ(ierr);
+  ierr = DMDAGetAO (daFine, &aoFine);
+  CHKERRQ(ierr);
+  ierr = AOApplicationToPetsc (aoCoarse, nrow, rows.data ());
+  CHKERRQ(ierr);
+  ierr = AOApplicationToPetsc (aoFine, nrow * nc, cols.data ());
+  CHKERRQ(ierr);
+
+  Vec vc, vf;
+  PetscInt mloc, nloc;
+  DMGetGlobalVector (daCoarse, &vc);
+  DMGetGlobalVector (daFine, &vf);
+  VecGetLocalSize (vc, &mloc);
+  VecGetLocalSize (vf, &nloc);
+  DMRestoreGlobalVector (daCoarse, &vc);
+  DMRestoreGlobalVector (daFine, &vf);
+
+  ierr = MatCreateAIJ (comm, mloc, nloc, PETSC_DETERMINE, PETSC_DETERMINE, nc,
+      NULL, nc, NULL, R);
+  CHKERRQ(ierr);
+  std::vector<PetscScalar> w (nc, 1.0 / nc);
+  for (PetscInt r = 0; r < nrow; r++) {
+    ierr = MatSetValues (*R, 1, &rows[r], nc, &cols[r * nc], w.data (),
+        INSERT_VALUES);
+    CHKERRQ(ierr);
+  }
+  MatAssemblyBegin (*R, MAT_FINAL_ASSEMBLY);
+  MatAssemblyEnd (*R, MAT_FINAL_ASSEMBLY);
+
+  return ierr;
+}
+
 LinearHeatConduction::LinearHeatConduction (DM da_nodes, DM da_elem, PetscInt m,
     PetscInt numDES, PetscInt numLODFIX, Vec xPassive0, Vec xPassive1,
     Vec xPassive2, Vec xPassive3) {
@@ -22,19 +288,26 @@ LinearHeatConduction::LinearHeatConduction (DM da_nodes, DM da_elem, PetscInt m,
   RHS = NULL;
   N = NULL;
   ksp = NULL;
+  reusePC = PETSC_FALSE; // # new
   da_nodal = NULL;
 
   // Parameters - to be changed on read of variables
   nlvls = 4;
   PetscBool flg;
   PetscOptionsGetInt (NULL, NULL, "-nlvls", &nlvls, &flg);
+  matrixFree = PETSC_FALSE; // # new
+  PetscOptionsGetBool (NULL, NULL, "-heatMatrixFree", &matrixFree, &flg);
 
   this->m = m;
+  dgp = new PetscScalar*[m]; // # new
   this->numDES = numDES; // num of design domain, save for internal uses
   this->numLODFIX = numLODFIX; // num of loads, save for internal uses
+  kspIterations.resize (numLODFIX, 0); // # new
+  kspResiduals.resize (numLODFIX, 0.0); // # new
 
   RHS = new Vec[numLODFIX];
   N = new Vec[numLODFIX];
+  dirichlet = new DirichletRows[numLODFIX]; // # new
 
   // Setup heat conductivity matrix, heat load vector and bcs (Dirichlet) for the design
   // problem
@@ -50,12 +323,17 @@ LinearHeatConduction::~LinearHeatConduction () {
   VecDestroy (&(U));
   VecDestroyVecs (numLODFIX, &(RHS));
   VecDestroyVecs (numLODFIX, &(N));
+  delete[] dirichlet; // # new
   MatDestroy (&(K));
   KSPDestroy (&(ksp));
+  for (size_t l = 0; l < mfLevels.size (); ++l) { // # new
+    DestroyMatrixFreeLevel (mfLevels[l], (PetscBool) (l > 0));
+  }
 
   if (da_nodal != NULL) {
     DMDestroy (&(da_nodal));
   }
+  delete[] dgp; // # new
 }
 
 PetscErrorCode LinearHeatConduction::SetUpLoadAndBC (DM da_nodes, DM da_elem,
@@ -111,9 +389,15 @@ PetscErrorCode LinearHeatConduction::SetUpLoadAndBC (DM da_nodes, DM da_elem,
       xc[3] = ne[1] * dy;
     }
 
-    // Create the nodal mesh
-    DMDACreate2d (PETSC_COMM_WORLD, bx, by, stype, nn[0], nn[1], PETSC_DECIDE,
-    PETSC_DECIDE, numnodaldof, stencilwidth, 0, 0, &(da_nodal));
+    // # modified; Create the nodal mesh with the partition of da_nodes, which
+    // may be occupancy weighted (-balanceDomain)
+    PetscInt mdn, ndn;
+    const PetscInt *lxn, *lyn;
+    DMDAGetInfo (da_nodes, NULL, NULL, NULL, NULL, &mdn, &ndn, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL);
+    DMDAGetOwnershipRanges (da_nodes, &lxn, &lyn, NULL);
+    DMDACreate2d (PETSC_COMM_WORLD, bx, by, stype, nn[0], nn[1], mdn, ndn,
+        numnodaldof, stencilwidth, lxn, lyn, &(da_nodal));
     // Initialize
     DMSetFromOptions (da_nodal);
     DMSetUp (da_nodal);
@@ -125,8 +409,10 @@ PetscErrorCode LinearHeatConduction::SetUpLoadAndBC (DM da_nodes, DM da_elem,
     DMDASetElementType (da_nodal, DMDA_ELEMENT_Q1);
 
     // Allocate matrix and the RHS and Solution vector and Dirichlet vector
-    ierr = DMCreateMatrix (da_nodal, &(K));
-    CHKERRQ(ierr);
+    if (!matrixFree) { // # modified; no matrix with -heatMatrixFree
+      ierr = DMCreateMatrix (da_nodal, &(K));
+      CHKERRQ(ierr);
+    }
     ierr = DMCreateGlobalVector (da_nodal, &(U));
     CHKERRQ(ierr);
     VecDuplicateVecs (U, numLODFIX, &(RHS));
@@ -188,7 +474,7 @@ PetscErrorCode LinearHeatConduction::SetUpLoadAndBC (DM da_nodes, DM da_elem,
   const PetscInt *necon;
   DMDAGetElements_2D (da_nodes, &nel, &nen, &necon);
 
-  if (IMPORT_GEO == 0) {
+  if (importGeo == 0) { // # modified; -importGeo
     // Set the values:
     // In this case: N = the wall at (1/4 * 1/4) of the bottom is clamped,
     //               RHS(z) = 0.001 within the whole domain;
@@ -310,11 +596,15 @@ PetscErrorCode LinearHeatConduction::SetUpLoadAndBC (DM da_nodes, DM da_elem,
       xc[5] = ne[2] * dz;
     }
 
-    // Create the nodal mesh
-    DMDACreate3d (PETSC_COMM_WORLD, bx, by, bz, stype, nn[0], nn[1], nn[2],
-    PETSC_DECIDE, PETSC_DECIDE, PETSC_DECIDE, numnodaldof, stencilwidth, 0, 0,
-        0,
-        &(da_nodal));
+    // # modified; Create the nodal mesh with the partition of da_nodes, which
+    // may be occupancy weighted (-balanceDomain)
+    PetscInt mdn, ndn, pdn;
+    const PetscInt *lxn, *lyn, *lzn;
+    DMDAGetInfo (da_nodes, NULL, NULL, NULL, NULL, &mdn, &ndn, &pdn, NULL, NULL,
+        NULL, NULL, NULL, NULL);
+    DMDAGetOwnershipRanges (da_nodes, &lxn, &lyn, &lzn);
+    DMDACreate3d (PETSC_COMM_WORLD, bx, by, bz, stype, nn[0], nn[1], nn[2], mdn,
+        ndn, pdn, numnodaldof, stencilwidth, lxn, lyn, lzn, &(da_nodal));
     // Initialize
     DMSetFromOptions (da_nodal);
     DMSetUp (da_nodal);
@@ -328,8 +618,10 @@ PetscErrorCode LinearHeatConduction::SetUpLoadAndBC (DM da_nodes, DM da_elem,
 //  DMDASetElementType (da_nodal, DMDA_ELEMENT_Q1);
 
     // Allocate matrix and the RHS and Solution vector and Dirichlet vector
-    ierr = DMCreateMatrix (da_nodal, &(K));
-    CHKERRQ(ierr);
+    if (!matrixFree) { // # modified; no matrix with -heatMatrixFree
+      ierr = DMCreateMatrix (da_nodal, &(K));
+      CHKERRQ(ierr);
+    }
     ierr = DMCreateGlobalVector (da_nodal, &(U));
     CHKERRQ(ierr);
     VecDuplicateVecs (U, numLODFIX, &(RHS));
@@ -395,7 +687,7 @@ PetscErrorCode LinearHeatConduction::SetUpLoadAndBC (DM da_nodes, DM da_elem,
   const PetscInt *necon;
   DMDAGetElements_3D (da_nodes, &nel, &nen, &necon);
 
-  if (IMPORT_GEO == 0) {
+  if (importGeo == 0) { // # modified; -importGeo
     // Set the values:
     // In this case: N = the wall at (1/4 * 1/4) of the bottom is clamped,
     //               RHS(z) = 0.001 within the whole domain;
@@ -470,6 +762,13 @@ PetscErrorCode LinearHeatConduction::SetUpLoadAndBC (DM da_nodes, DM da_elem,
   VecAssemblyEnd (N[loadCondition]);
   VecAssemblyBegin (RHS[loadCondition]);
   VecAssemblyEnd (RHS[loadCondition]);
+
+  // # new; The constrained dofs, and no loads on them
+  ierr = dirichlet[loadCondition].SetUp (N[loadCondition]);
+  CHKERRQ(ierr);
+  ierr = VecPointwiseMult (RHS[loadCondition], RHS[loadCondition],
+      N[loadCondition]);
+  CHKERRQ(ierr);
   VecRestoreArray (lcoor, &lcoorp);
   VecRestoreArray (elcoor, &elcoorp);
   DMDARestoreElements (da_nodes, &nel, &nen, &necon);
@@ -486,24 +785,47 @@ PetscErrorCode LinearHeatConduction::SolveState (Vec xPhys, PetscScalar Emin,
 
   PetscErrorCode ierr;
 
-  double t1, t2;
-  t1 = MPI_Wtime ();
+  ScopedTimer solveTimer ("SolveState"); // # modified
 
   // Assemble the heat conductivity matrix
-  ierr = AssembleConductivityMatrix (xPhys, Emin, Emax, penal, loadCondition);
+  {
+    ScopedTimer assembleTimer ("Assemble"); // # new
+    if (matrixFree) { // # new; update the level coefficients instead
+      if (mfLevels.empty ()) {
+        ierr = SetUpMatrixFree ();
+        CHKERRQ(ierr);
+      }
+      ierr = UpdateMatrixFree (xPhys, Emin, Emax, penal, loadCondition);
+      CHKERRQ(ierr);
+    } else {
+      ierr = AssembleConductivityMatrix (xPhys, Emin, Emax, penal,
+          loadCondition);
+      CHKERRQ(ierr);
+    }
+  }
+
+  // # new; Time the wait for the slowest rank's assembly, -imbalance
+  ierr = ImbalanceWait (PETSC_COMM_WORLD);
   CHKERRQ(ierr);
 
   // Setup the solver
-  if (ksp == NULL) {
-    ierr = SetUpSolver ();
-    CHKERRQ(ierr);
-  } else {
-    ierr = KSPSetOperators (ksp, K, K);
-    CHKERRQ(ierr);
-    KSPSetUp (ksp);
+  {
+    ScopedTimer setupTimer ("PCSetUp"); // # new
+    if (ksp == NULL) {
+      ierr = SetUpSolver ();
+      CHKERRQ(ierr);
+    } else {
+      Mat A = matrixFree ? mfLevels[0]->A : K; // # modified
+      ierr = KSPSetOperators (ksp, A, A);
+      CHKERRQ(ierr);
+      ierr = KSPSetReusePreconditioner (ksp, reusePC); // # new
+      CHKERRQ(ierr);
+      KSPSetUp (ksp);
+    }
   }
 
   // Solve
+  ScopedTimer kspTimer ("KSPSolve"); // # new
   ierr = KSPSolve (ksp, RHS[loadCondition], U);
   CHKERRQ(ierr);
   CHKERRQ(ierr);
@@ -518,10 +840,15 @@ PetscErrorCode LinearHeatConduction::SolveState (Vec xPhys, PetscScalar Emin,
   ierr = VecNorm (RHS[loadCondition], NORM_2, &RHSnorm);
   CHKERRQ(ierr);
   rnorm = rnorm / RHSnorm;
+  kspTimer.Stop (); // # new
+  if (loadCondition < (PetscInt) kspIterations.size ()) { // # new
+    kspIterations[loadCondition] = niter;
+    kspResiduals[loadCondition] = PetscRealPart (rnorm);
+  }
 
-  t2 = MPI_Wtime ();
   PetscPrintf (PETSC_COMM_WORLD,
-      "State solver:  iter: %i, rerr.: %e, time: %f\n", niter, rnorm, t2 - t1);
+      "State solver:  iter: %i, rerr.: %e, time: %f\n", niter, rnorm,
+      solveTimer.Elapsed ()); // # modified
 
   return ierr;
 }
@@ -533,11 +860,16 @@ PetscErrorCode LinearHeatConduction::ComputeObjectiveConstraintsSensitivities (
   // Errorcode
   PetscErrorCode ierr;
 
+  // # new; The objective and its sensitivities are summed over the load cases
+  fx[0] = 0.0;
+  VecSet (dfdx, 0.0);
   for (PetscInt loadCondition = 0; loadCondition < numLODFIX; ++loadCondition) {
     // Solve state eqs
     ierr = SolveState (xPhys, Emin, Emax, penal, loadCondition);
     CHKERRQ(ierr);
 
+    ScopedTimer sensTimer ("Sensitivity"); // # new
+
     // Get the FE mesh structure (from the nodal mesh)
     PetscInt nel, nen;
     const PetscInt *necon;
@@ -561,7 +893,7 @@ PetscErrorCode LinearHeatConduction::ComputeObjectiveConstraintsSensitivities (
 
     // Get Solution
     Vec Uloc;
-    DMCreateLocalVector (da_nodal, &Uloc);
+    DMGetLocalVector (da_nodal, &Uloc); // # modified
     DMGlobalToLocalBegin (da_nodal, U, INSERT_VALUES, Uloc);
     DMGlobalToLocalEnd (da_nodal, U, INSERT_VALUES, Uloc);
 
@@ -574,27 +906,26 @@ PetscErrorCode LinearHeatConduction::ComputeObjectiveConstraintsSensitivities (
     VecGetArray (dfdx, &df);
 
     // Get dgdx
-    PetscScalar **dg;
+    PetscScalar **dg = dgp; // # modified
     for (PetscInt i = 0; i < m; ++i) {
       VecSet (dgdx[i], 0);
       gx[i] = 0;
     }
-    VecGetArrays (dgdx, m, &dg);
+    GetArrays (dgdx, m, dg); // # modified
 
     // Number of total elements and nonDesign domain elements
     PetscInt neltot = 0;
     PetscScalar nNonDesign = 0;
     VecGetSize (xPhys, &neltot);
 
-    // Edof array
-    PetscInt edof[nedof];
-
-    fx[0] = 0.0;
-    // Loop over elements
+    // # modified; Loop over elements, threaded with the sums reduced
+    PetscScalar fsum = 0.0, volume = 0.0;
+    TOPOPT_OMP(parallel for reduction(+:fsum, volume, nNonDesign))
     for (PetscInt i = 0; i < nel; i++) {
       // loop over element nodes
       if (xPassive0p[i] != 0) {
-
+        // Edof array
+        PetscInt edof[nedof];
         for (PetscInt j = 0; j < nen; j++) {
           // Get local dofs
           edof[j] = necon[i * nen + j];
@@ -607,13 +938,13 @@ PetscErrorCode LinearHeatConduction::ComputeObjectiveConstraintsSensitivities (
           }
         }
         // Add to objective
-        fx[0] += (Emin + PetscPowScalar(xp[i], penal) * (Emax - Emin)) * uKu;
-        // Set the Senstivity
-        df[i] = -1.0 * penal * PetscPowScalar(xp[i], penal - 1) * (Emax - Emin)
-                * uKu;
+        fsum += (Emin + PetscPowScalar(xp[i], penal) * (Emax - Emin)) * uKu;
+        // Add to the Senstivity
+        df[i] += -1.0 * penal * PetscPowScalar(xp[i], penal - 1)
+                 * (Emax - Emin) * uKu;
         // Constraints
+        volume += xp[i];
         for (PetscInt j = 0; j < m; ++j) {
-          gx[j] += xp[i];
           dg[j][i] = 1;
         }
       } else if (xPassive1p[i] != 0 || xPassive2p[i] != 0
@@ -626,11 +957,15 @@ PetscErrorCode LinearHeatConduction::ComputeObjectiveConstraintsSensitivities (
 
       }
     }
+    for (PetscInt j = 0; j < m; ++j) {
+      gx[j] = volume;
+    }
 
-    // Allreduce fx[0]
-    PetscScalar tmp = fx[0];
-    fx[0] = 0.0;
-    MPI_Allreduce(&tmp, &(fx[0]), 1, MPIU_SCALAR, MPI_SUM, PETSC_COMM_WORLD);
+    // # modified; Allreduce the objective of this load case and add it
+    PetscScalar tmp = fsum;
+    fsum = 0.0;
+    MPI_Allreduce(&tmp, &fsum, 1, MPIU_SCALAR, MPI_SUM, PETSC_COMM_WORLD);
+    fx[0] += fsum;
 
     tmp = nNonDesign;
     nNonDesign = 0.0;
@@ -656,13 +991,38 @@ PetscErrorCode LinearHeatConduction::ComputeObjectiveConstraintsSensitivities (
     VecRestoreArray (xPassive3, &xPassive3p); // # new
     VecRestoreArray (Uloc, &up);
     VecRestoreArray (dfdx, &df);
-    VecRestoreArrays (dgdx, m, &dg);
-    VecDestroy (&Uloc);
+    RestoreArrays (dgdx, m, dg); // # modified
+    DMRestoreLocalVector (da_nodal, &Uloc); // # modified
   }
 
   return (ierr);
 }
 
+PetscErrorCode LinearHeatConduction::AccountMemory (MemoryReport *mem) {
+  PetscErrorCode ierr = 0;
+  mem->Add ("Physics K", MemoryReport::MatBytes (K));
+  mem->Add ("Physics assembly map", assemblyMap.Bytes ()); // # new
+  for (PetscInt i = 0; i < numLODFIX; i++) { // # new
+    mem->Add ("Physics Dirichlet rows", dirichlet[i].Bytes ());
+  }
+  mem->Add ("Physics MG hierarchy", MemoryReport::MGBytes (ksp));
+  mem->Add ("Physics U, RHS/N per load case",
+      MemoryReport::VecBytes (U) + MemoryReport::VecsBytes (RHS, numLODFIX)
+      + MemoryReport::VecsBytes (N, numLODFIX));
+  if (!mfLevels.empty ()) { // # new
+    PetscLogDouble b = 0.0;
+    for (size_t l = 0; l < mfLevels.size (); ++l) {
+      MatrixFreeLevel *lev = mfLevels[l];
+      b += MemoryReport::MatBytes (lev->A) + MemoryReport::MatBytes (lev->R)
+           + MemoryReport::VecBytes (lev->kappa)
+           + MemoryReport::VecBytes (lev->Nv)
+           + 3 * MemoryReport::VecBytes (lev->Nloc);
+    }
+    mem->Add ("Physics matrix-free levels", b);
+  }
+  return ierr;
+}
+
 PetscErrorCode LinearHeatConduction::WriteRestartFiles () {
 
   PetscErrorCode ierr = 0;
@@ -700,15 +1060,16 @@ PetscErrorCode LinearHeatConduction::WriteRestartFiles () {
 
 PetscErrorCode LinearHeatConduction::FEAWithTopOptResults (Vec xPhys,
     Vec xPassive0,
-    Vec xPassive1, Vec xPassive2, Vec xPassive3, PetscInt loadConditionFEA,
-    PetscScalar *loadVectorFEAp) { // # new
+    Vec xPassive1, Vec xPassive2, Vec xPassive3, PetscInt numLoadFEA,
+    PetscScalar * /* loadVectorFEAp, the loads are fixed */) { // # new
   // Errorcode
   PetscErrorCode ierr = 0;
 
-  PetscPrintf (PETSC_COMM_WORLD, "FEA with TopOpt Results, step: %d\n",
-      loadConditionFEA);
+  // # modified; The loads do not depend on the verification load vector, the
+  // state of the first load condition stands for all of them
+  PetscPrintf (PETSC_COMM_WORLD, "FEA with TopOpt Results, %i loads as one\n",
+      numLoadFEA);
 
-  // only first load condition because we are solving FEA only one at a time
   SetUpLoadAndBC (da_nodal, da_nodal, xPassive0, xPassive1, xPassive2,
       xPassive3, 0);
   // Solve state eqs,
@@ -746,49 +1107,152 @@ PetscErrorCode LinearHeatConduction::AssembleConductivityMatrix (Vec xPhys,
   PetscScalar *xp;
   VecGetArray (xPhys, &xp);
 
-  // Zero the matrix
-  MatZeroEntries (K);
+  // # modified; Zero the matrix and add the SIMP scaled element matrices,
+  // through the cached destinations of the element entries (-assemblyMap)
+  ierr = assemblyMap.Assemble (K, nel, nen, necon, 1, KE, xp, Emin, Emax,
+      penal);
+  CHKERRQ(ierr);
+  MatAssemblyBegin (K, MAT_FINAL_ASSEMBLY);
+  MatAssemblyEnd (K, MAT_FINAL_ASSEMBLY);
 
-  // Edof array
-  PetscInt edof[nedof];
-  PetscScalar ke[nedof * nedof];
+  // # modified; Impose the dirichlet conditions, i.e. K = N'*K*N - (N-I), by
+  // zeroing the constrained rows and columns in place; the loads on them are
+  // zeroed in SetUpLoadAndBC
+  ierr = dirichlet[loadCondition].Apply (K);
+  CHKERRQ(ierr);
 
-  // Loop over elements
-  for (PetscInt i = 0; i < nel; i++) {
-    // loop over element nodes
-    for (PetscInt j = 0; j < nen; j++) {
-      // Get local dofs
-      edof[j] = necon[i * nen + j];
+  VecRestoreArray (xPhys, &xp);
+  DMDARestoreElements (da_nodal, &nel, &nen, &necon);
+
+  return ierr;
+}
+
+PetscErrorCode LinearHeatConduction::SetUpMatrixFree () { // # new
+
+  PetscErrorCode ierr = 0;
+
+  std::vector<DM> das (nlvls, (DM) NULL);
+  das[0] = da_nodal;
+  ierr = DMCoarsenHierarchy (da_nodal, nlvls - 1, &das[1]);
+  CHKERRQ(ierr);
+
+  mfLevels.resize (nlvls, NULL);
+  for (PetscInt l = 0; l < nlvls; l++) {
+    MatrixFreeLevel *lev = new MatrixFreeLevel;
+    mfLevels[l] = lev;
+    lev->da = das[l];
+    lev->A = NULL;
+    lev->R = NULL;
+    lev->inj = NULL;
+    DMDASetElementType (lev->da, DMDA_ELEMENT_Q1);
+#if DIM == 2
+    ierr = DMDAGetElements_2D (lev->da, &(lev->nel), &(lev->nen),
+        &(lev->necon));
+    CHKERRQ(ierr);
+#elif DIM == 3
+    ierr = DMDAGetElements_3D (lev->da, &(lev->nel), &(lev->nen),
+        &(lev->necon));
+    CHKERRQ(ierr);
+#endif
+    lev->coloring.SetUp (lev->nel, mfNen, lev->necon);
+    ierr = CreateElementDA (lev->da, &(lev->daElem));
+    CHKERRQ(ierr);
+    DMCreateGlobalVector (lev->daElem, &(lev->kappa));
+    DMCreateGlobalVector (lev->da, &(lev->Nv));
+    DMCreateLocalVector (lev->da, &(lev->Nloc));
+    VecDuplicate (lev->Nloc, &(lev->xloc));
+    VecDuplicate (lev->Nloc, &(lev->yloc));
+
+    // Rediscretized element matrix of the coarsened element size
+    PetscScalar h = (PetscScalar) (1 << l);
+#if DIM == 2
+    PetscScalar X[4] = { 0.0, h * dx, h * dx, 0.0 };
+    PetscScalar Y[4] = { 0.0, 0.0, h * dy, h * dy };
+    Quad4Isoparametric (X, Y, false, lev->KE);
+#elif DIM == 3
+    PetscScalar X[8] = { 0.0, h * dx, h * dx, 0.0, 0.0, h * dx, h * dx, 0.0 };
+    PetscScalar Y[8] = { 0.0, 0.0, h * dy, h * dy, 0.0, 0.0, h * dy, h * dy };
+    PetscScalar Z[8] = { 0.0, 0.0, 0.0, 0.0, h * dz, h * dz, h * dz, h * dz };
+    Hex8Isoparametric (X, Y, Z, false, lev->KE);
+#endif
+
+    // Transfers from the next finer level
+    if (l > 0) {
+      ierr = CreateAveraging (lev->daElem, mfLevels[l - 1]->daElem,
+          &(lev->R));
+      CHKERRQ(ierr);
+      ierr = DMCreateInjection (lev->da, mfLevels[l - 1]->da, &(lev->inj));
+      CHKERRQ(ierr);
     }
-    // Use SIMP for heat conductivity interpolation
-    PetscScalar dens = Emin + PetscPowScalar(xp[i], penal) * (Emax - Emin);
-    for (PetscInt k = 0; k < nedof * nedof; k++) {
-      ke[k] = KE[k] * dens;
+
+    // Operator
+    if (l < nlvls - 1) {
+      PetscInt nloc, nglob;
+      VecGetLocalSize (lev->Nv, &nloc);
+      VecGetSize (lev->Nv, &nglob);
+      ierr = MatCreateShell (PETSC_COMM_WORLD, nloc, nloc, nglob, nglob, lev,
+          &(lev->A));
+      CHKERRQ(ierr);
+      MatShellSetOperation (lev->A, MATOP_MULT,
+          (void (*) (void)) MatrixFreeMult);
+      MatShellSetOperation (lev->A, MATOP_MULT_TRANSPOSE,
+          (void (*) (void)) MatrixFreeMult);
+      MatShellSetOperation (lev->A, MATOP_GET_DIAGONAL,
+          (void (*) (void)) MatrixFreeGetDiagonal);
+      MatSetOption (lev->A, MAT_SYMMETRIC, PETSC_TRUE);
+    } else {
+      ierr = DMCreateMatrix (lev->da, &(lev->A));
+      CHKERRQ(ierr);
     }
-    // Add values to the sparse matrix
-    ierr = MatSetValuesLocal (K, nedof, edof, nedof, edof, ke, ADD_VALUES);
-    CHKERRQ(ierr);
   }
-  MatAssemblyBegin (K, MAT_FINAL_ASSEMBLY);
-  MatAssemblyEnd (K, MAT_FINAL_ASSEMBLY);
 
-  // Impose the dirichlet conditions, i.e. K = N'*K*N - (N-I)
-  // 1.: K = N'*K*N
-  MatDiagonalScale (K, N[loadCondition], N[loadCondition]);
-  // 2. Add ones, i.e. K = K + NI, NI = I - N
-  Vec NI;
-  VecDuplicate (N[loadCondition], &NI);
-  VecSet (NI, 1.0);
-  VecAXPY (NI, -1.0, N[loadCondition]);
-  MatDiagonalSet (K, NI, ADD_VALUES);
+  PetscPrintf (PETSC_COMM_WORLD,
+      "# Matrix-free conductivity operator (-heatMatrixFree), %i levels, "
+          "assembled coarsest level\n", nlvls);
+
+  return ierr;
+}
+
+PetscErrorCode LinearHeatConduction::UpdateMatrixFree (Vec xPhys,
+    PetscScalar Emin, PetscScalar Emax, PetscScalar penal,
+    PetscInt loadCondition) { // # new
 
-  // Zero out possible loads in the RHS that coincide
-  // with Dirichlet conditions
-  VecPointwiseMult (RHS[loadCondition], RHS[loadCondition], N[loadCondition]);
+  PetscErrorCode ierr = 0;
 
-  VecDestroy (&NI);
+  // Use SIMP for heat conductivity interpolation
+  MatrixFreeLevel *fine = mfLevels[0];
+  PetscScalar *xp, *kp;
+  PetscInt nel;
+  VecGetLocalSize (xPhys, &nel);
+  VecGetArray (xPhys, &xp);
+  VecGetArray (fine->kappa, &kp);
+  for (PetscInt i = 0; i < nel; i++) {
+    kp[i] = Emin + PetscPowScalar(xp[i], penal) * (Emax - Emin);
+  }
   VecRestoreArray (xPhys, &xp);
-  DMDARestoreElements (da_nodal, &nel, &nen, &necon);
+  VecRestoreArray (fine->kappa, &kp);
+  ierr = VecCopy (N[loadCondition], fine->Nv);
+  CHKERRQ(ierr);
+
+  // Coarse coefficients and Dirichlet nodes
+  for (PetscInt l = 1; l < nlvls; l++) {
+    ierr = MatMult (mfLevels[l]->R, mfLevels[l - 1]->kappa,
+        mfLevels[l]->kappa);
+    CHKERRQ(ierr);
+    ierr = MatMult (mfLevels[l]->inj, mfLevels[l - 1]->Nv, mfLevels[l]->Nv);
+    CHKERRQ(ierr);
+  }
+  for (PetscInt l = 0; l < nlvls; l++) {
+    MatrixFreeLevel *lev = mfLevels[l];
+    DMGlobalToLocalBegin (lev->da, lev->Nv, INSERT_VALUES, lev->Nloc);
+    DMGlobalToLocalEnd (lev->da, lev->Nv, INSERT_VALUES, lev->Nloc);
+    // The shell operators changed, i.e. new smoother eigenvalue estimates
+    if (l < nlvls - 1) {
+      PetscObjectStateIncrease ((PetscObject) lev->A);
+    }
+  }
+  ierr = MatrixFreeAssemble (mfLevels[nlvls - 1]);
+  CHKERRQ(ierr);
 
   return ierr;
 }
@@ -886,9 +1350,15 @@ PetscErrorCode LinearHeatConduction::SetUpSolver () {
   // Set up the solver
   ierr = KSPSetType (ksp, KSPFGMRES); // KSPCG, KSPGMRES
   CHKERRQ(ierr);
+  if (matrixFree) { // # new; symmetric operator and smoothers
+    ierr = KSPSetType (ksp, KSPCG);
+    CHKERRQ(ierr);
+  }
 
-  ierr = KSPGMRESSetRestart (ksp, restart);
-  CHKERRQ(ierr);
+  if (!matrixFree) { // # modified; no restart for CG
+    ierr = KSPGMRESSetRestart (ksp, restart);
+    CHKERRQ(ierr);
+  }
 
   ierr = KSPSetTolerances (ksp, rtol, atol, dtol, maxitsGlobal);
   CHKERRQ(ierr);
@@ -896,7 +1366,8 @@ PetscErrorCode LinearHeatConduction::SetUpSolver () {
   ierr = KSPSetInitialGuessNonzero (ksp, PETSC_TRUE);
   CHKERRQ(ierr);
 
-  ierr = KSPSetOperators (ksp, K, K);
+  Mat A = matrixFree ? mfLevels[0]->A : K; // # modified
+  ierr = KSPSetOperators (ksp, A, A);
   CHKERRQ(ierr);
 
   // The preconditinoer
@@ -914,8 +1385,53 @@ PetscErrorCode LinearHeatConduction::SetUpSolver () {
   PetscBool pcmg_flag = PETSC_TRUE;
   PetscObjectTypeCompare ((PetscObject) pc, PCMG, &pcmg_flag);
 
-  // Only if PCMG is used
-  if (pcmg_flag) {
+  // # new; Rediscretized levels of the matrix-free operator
+  if (pcmg_flag && matrixFree) {
+    PCMGSetLevels (pc, nlvls, NULL);
+    PCMGSetType (pc, PC_MG_MULTIPLICATIVE);
+    ierr = PCMGSetCycleType (pc, PC_MG_CYCLE_V);
+    CHKERRQ(ierr);
+    PCMGSetGalerkin (pc, PC_MG_GALERKIN_NONE);
+    for (PetscInt k = 1; k < nlvls; k++) {
+      Mat R;
+      DMCreateInterpolation (mfLevels[nlvls - k]->da,
+          mfLevels[nlvls - 1 - k]->da, &R, NULL);
+      PCMGSetInterpolation (pc, k, R);
+      MatDestroy (&R);
+    }
+    for (PetscInt k = 0; k < nlvls; k++) {
+      KSP dksp;
+      PCMGGetSmoother (pc, k, &dksp);
+      ierr = KSPSetOperators (dksp, mfLevels[nlvls - 1 - k]->A,
+          mfLevels[nlvls - 1 - k]->A);
+      CHKERRQ(ierr);
+    }
+
+    // The coarsest level is assembled. CG needs a fixed, symmetric
+    // preconditioner, so the coarse problem is solved exactly by a redundant
+    // LU rather than by an inner Krylov iteration
+    KSP cksp;
+    PCMGGetCoarseSolve (pc, &cksp);
+    ierr = KSPSetType (cksp, KSPPREONLY);
+    CHKERRQ(ierr);
+    PC cpc;
+    KSPGetPC (cksp, &cpc);
+    ierr = PCSetType (cpc, PCREDUNDANT);
+    CHKERRQ(ierr);
+
+    // Chebyshev smoothers need the diagonal only
+    for (PetscInt k = 1; k < nlvls; k++) {
+      KSP dksp;
+      PCMGGetSmoother (pc, k, &dksp);
+      PC dpc;
+      KSPGetPC (dksp, &dpc);
+      ierr = KSPSetType (dksp, KSPCHEBYSHEV);
+      ierr = KSPChebyshevEstEigSet (dksp, 0.0, 0.1, 0.0, 1.1);
+      ierr = KSPSetTolerances (dksp, PETSC_DEFAULT, PETSC_DEFAULT,
+      PETSC_DEFAULT, smooth_sweeps);
+      PCSetType (dpc, PCJACOBI);
+    }
+  } else if (pcmg_flag) { // # modified
 
     // DMs for grid hierachy
     DM *da_list, *daclist;
@@ -1503,3 +2019,5 @@ PetscScalar LinearHeatConduction::Dot (PetscScalar *v1, PetscScalar *v2,
   }
   return result;
 }
+
+TOPOPT_NAMESPACE_END // # new
@@ -6,8 +6,18 @@
 #include <math.h>
 #include <petsc.h>
 #include <petsc/private/dmdaimpl.h>
+#include <vector>
 
+#include "Physics.h" // # new; interface of the physical problems
 #include "options.h" // framework options
+#include "memoryreport.h" // # new
+#include "assemblymap.h" // # new
+#include "dirichletrows.h" // # new
+
+TOPOPT_NAMESPACE_BEGIN // # new
+
+// # new; Level of the matrix-free multigrid hierarchy, see the .cc file
+struct MatrixFreeLevel;
 
 /*
  Authors: Niels Aage, Erik Andreassen, Boyan Lazarov, August 2013
@@ -24,7 +34,7 @@
  * Modified by Zhidong Brian Zhang in August 2020, University of Waterloo
  */
 
-class LinearHeatConduction {
+class LinearHeatConduction : public Physics { // # modified
 
   public:
     // Constructor
@@ -50,19 +60,30 @@ class LinearHeatConduction {
       return (U);
     }
 
-    // Get pointer to DMDA
-    DM GetDM () {
-      return (da_nodal);
+    // # new; Keep the preconditioner of the last set up for the next solves,
+    // e.g. the realizations of the robust formulation after the blueprint
+    void SetReusePreconditioner (PetscBool reuse) {
+      reusePC = reuse;
     }
 
-    // Logical mesh
-    DM da_nodal; // Nodal mesh
+    // # new; Add the bytes of the system matrix, its multigrid hierarchy and
+    // the vectors of all load cases to the memory report
+    PetscErrorCode AccountMemory (MemoryReport *mem);
 
-    // # new; FEA with the TopOpt final results
+    // # new; FEA with the TopOpt final results for all the verification
+    // loads
     PetscErrorCode FEAWithTopOptResults (Vec xPhys, Vec xPassive0,
-        Vec xPassive1, Vec xPassive2, Vec xPassive3, PetscInt loadConditionFEA,
+        Vec xPassive1, Vec xPassive2, Vec xPassive3, PetscInt numLoadFEA,
         PetscScalar *loadVectorFEAp);
 
+    // # new; States of the verification loads, one for all of them
+    PetscInt GetNumFEAStates () {
+      return (1);
+    }
+    Vec *GetFEAStates () {
+      return (&U);
+    }
+
   private:
     // Logical mesh
     PetscInt nn[DIM]; // Number of nodes in each direction
@@ -84,6 +105,7 @@ class LinearHeatConduction {
 
     // Solver
     KSP ksp; // Pointer to the KSP object i.e. the linear solver+prec
+    PetscBool reusePC; // # new; see SetReusePreconditioner
     PetscInt nlvls;
 
     // Loading conditions
@@ -95,6 +117,9 @@ class LinearHeatConduction {
 
     // Number of constraints
     PetscInt m; // # new
+    PetscScalar **dgp; // # new; the arrays of dgdx, see GetArrays
+    AssemblyMap assemblyMap; // # new; cached element assembly of K
+    DirichletRows *dirichlet; // # new; constrained dofs of each load case
 
     // Set up the FE mesh and data structures
     PetscErrorCode SetUpLoadAndBC (DM da_nodes, DM da_elem, Vec xPassive0,
@@ -111,6 +136,21 @@ class LinearHeatConduction {
     // Start the solver
     PetscErrorCode SetUpSolver ();
 
+    // # new; Matrix-free operator (-heatMatrixFree): the conductivity matrix
+    // is applied element by element on every multigrid level, finest level
+    // first, and only the coarsest level is assembled
+    PetscBool matrixFree;
+    std::vector<MatrixFreeLevel*> mfLevels;
+
+    // # new; Create the mesh hierarchy, the element coefficients and the
+    // level operators
+    PetscErrorCode SetUpMatrixFree ();
+
+    // # new; Set the element coefficients and the Dirichlet vectors of all
+    // the levels for the densities and load case, and assemble the coarsest
+    PetscErrorCode UpdateMatrixFree (Vec xPhys, PetscScalar Emin,
+        PetscScalar Emax, PetscScalar penal, PetscInt loadCondition);
+
 #if DIM == 2
     // Routine that doesn't change the element type upon repeated calls
     PetscErrorCode DMDAGetElements_2D (DM dm, PetscInt *nel, PetscInt *nen,
@@ -154,4 +194,6 @@ class LinearHeatConduction {
     }
 };
 
+TOPOPT_NAMESPACE_END // # new
+
 #endif
@@ -4,20 +4,26 @@
 #include "TopOpt.h"
 #include "mpi.h"
 #include <petsc.h>
+#include <sstream> // # new
 
 #include "options.h" // # new; all the switchers in it
 #include "timer.h" // # new
+#include "scopedtimer.h" // # new; hierarchical timed regions
+#include "metricslog.h" // # new; per-iteration metrics
+#include "memoryreport.h" // # new; memory by owner
+#include "imbalance.h" // # new; load-imbalance diagnostics
+#include "alloccounter.h" // # new; allocations per iteration
+#include "elementcoloring.h" // # new; threads of the element loops
 
 #include "PrePostProcess.h" // # new; Pre- and post-processing class
 
-// Choose the physical problem to be solved
-#if PHYSICS == 0
-#include "LinearElasticity.h"
-#elif PHYSICS == 1
-#include "LinearCompliant.h"   // # new
-#elif PHYSICS == 2
-#include "LinearHeatConduction.h" // # new
-#endif
+// # modified; The physical problem is chosen at run time (-physics)
+#include "Physics.h"
+
+#include "Campaign.h" // # new; parameter sweeps within one run
+#include "RobustDesign.h" // # new; eroded/intermediate/dilated realizations
+
+TOPOPT_NAMESPACE_BEGIN // # new
 
 /*
  Authors: Niels Aage, Erik Andreassen, Boyan Lazarov, August 2013
@@ -37,79 +43,71 @@
 
 static char help[] = "2D/3D TopOpt using KSP-MG on PETSc's DMDA (structured grids) \n"; // # modified
 
-int main (int argc, char *argv[]) {
-
-  // Error code for debugging
+// # new; Physics of the robust realizations as one batch: the intermediate
+// realization sets up the preconditioner, the eroded and dilated ones reuse
+// it and start from the last state
+static PetscErrorCode ComputeRealizations (TopOpt *opt, Physics *physics,
+    RobustDesign *robust) {
   PetscErrorCode ierr = 0;
 
-  // Initialize PETSc / MPI and pass input arguments to PETSc
-  PetscInitialize (&argc, &argv, PETSC_NULL, help);
-
-  // STEP 1: THE OPTIMIZATION PARAMETERS, DATA AND MESH (!!! THE DMDA !!!)
-  TopOpt *opt = new TopOpt ();
-
-  // STEP 2: Pre-processing to define the design domain by using passive element assigning method
-  PrePostProcess *prepost = new PrePostProcess (opt); // # new
-#if IMPORT_GEO == 1
-  prepost->DesignDomainInitialization (opt); // # new
-#endif
-
-  // STEP 3: THE PHYSICS
-  // 0 - linear elasticity, 1 - linear heat conduction, 2 - compliant
-#if PHYSICS == 0
-  LinearElasticity *physics = new LinearElasticity (opt->da_nodes, opt->m,
-      opt->numDES, opt->numLODFIX, opt->numNodeLoadAddingCounts, opt->nu,
-      opt->E, opt->loadVector, opt->xPassive0, opt->xPassive1, opt->xPassive2,
-      opt->xPassive3);
-#elif PHYSICS ==1
-  LinearCompliant *physics = new LinearCompliant (opt->da_nodes, opt->m,
-      opt->numDES, opt->numLODFIX, opt->nu, opt->E, opt->xPassive0,
-      opt->xPassive1, opt->xPassive2, opt->xPassive3); // # new
-#elif PHYSICS == 2
-  LinearHeatConduction *physics = new LinearHeatConduction (opt->da_nodes,
-      opt->da_elem, opt->m, opt->numDES, opt->numLODFIX, opt->xPassive0,
-      opt->xPassive1, opt->xPassive2, opt->xPassive3); // # new
-#endif
-
-  // STEP 4: THE FILTERING
-  Filter *filter = new Filter (opt->da_nodes, opt->xPhys, opt->filter,
-      opt->rmin, opt->xPassive0, opt->xPassive1, opt->xPassive2,
-      opt->xPassive3); // # modified
-
-  // STEP 5: VISUALIZATION USING VTK
-  MPIIO *output = new MPIIO (opt->da_nodes, 4, "ux, uy, uz, nodeDen", 7,
-      "x, xTilde, xPhys, xPassive0, xPassive1, xPassive2, xPassive3"); // # modified; all point data must use 3 coordinates in VTK
-
-  // STEP 6: THE OPTIMIZER MMA
-  MMA *mma;
-  PetscInt itr = 0;
-  opt->AllocateMMAwithRestart (&itr, &mma); // allow for restart !
-  // mma->SetAsymptotes(0.2, 0.65, 1.05);
+  const PetscInt order[RobustDesign::nReal] = { RobustDesign::intermediate, 0,
+      2 };
+  for (PetscInt r = 0; r < RobustDesign::nReal; ++r) {
+    PetscInt k = order[r];
+    PetscBool blueprint = (PetscBool) (k == RobustDesign::intermediate);
+    physics->SetReusePreconditioner ((PetscBool) (r > 0));
+    ierr = physics->ComputeObjectiveConstraintsSensitivities (&(robust->fx[k]),
+        blueprint ? opt->gx : robust->gxWork, robust->dfReal[k],
+        blueprint ? opt->dgdx : robust->dgWork, robust->xReal[k], opt->Emin,
+        opt->Emax, opt->penal, opt->volfrac, opt->xPassive0, opt->xPassive1,
+        opt->xPassive2, opt->xPassive3);
+    CHKERRQ(ierr);
+  }
+  physics->SetReusePreconditioner (PETSC_FALSE);
 
-  // STEP 7: FILTER THE INITIAL DESIGN/RESTARTED DESIGN
-  ierr = filter->FilterProject (opt->x, opt->xTilde, opt->xPhys,
-      opt->projectionFilter, opt->beta, opt->eta);
+  ierr = robust->Collect (opt);
   CHKERRQ(ierr);
 
-  // STEP 8: OPTIMIZATION LOOP
+  return ierr;
+}
+
+// # new; Optimization loop (step 8) from the current iteration up to itrEnd
+static PetscErrorCode Optimize (TopOpt *opt, Physics *physics, Filter *filter,
+    RobustDesign *robust, MMA *mma, MPIIO *output, PrePostProcess *prepost,
+    MetricsLog *metrics, PetscInt *itr, PetscInt itrEnd,
+    PetscBool writeFiles) {
+  PetscErrorCode ierr = 0;
+
   PetscScalar ch = 1.0;
-  double t1, t2;
-  while (itr < opt->maxItr && ch > 0.01) {
+  ScopedTimer optTimer ("Optimization"); // # new
+  while (*itr < itrEnd && (ch > 0.01 || opt->benchmark)) { // # modified; benchmarks run exactly -maxItr iterations
     // Update iteration counter
-    itr++;
+    (*itr)++;
+    AllocationCounter::Instance ().BeginIteration (); // # new
 
     // start timer
-    t1 = MPI_Wtime ();
+    ScopedTimer itrTimer ("Iteration"); // # modified
 
     // Compute (a) obj+const, (b) sens, (c) obj+const+sens
-    ierr = physics->ComputeObjectiveConstraintsSensitivities (&(opt->fx),
-        &(opt->gx[0]), opt->dfdx, opt->dgdx, opt->xPhys, opt->Emin,
-        opt->Emax, opt->penal, opt->volfrac, opt->xPassive0, opt->xPassive1,
-        opt->xPassive2, opt->xPassive3); // # new
-    CHKERRQ(ierr);
+    {
+      ScopedTimer physicsTimer ("Physics"); // # new
+      if (robust->Active ()) { // # new
+        ierr = ComputeRealizations (opt, physics, robust);
+      } else {
+        ierr = physics->ComputeObjectiveConstraintsSensitivities (&(opt->fx),
+            &(opt->gx[0]), opt->dfdx, opt->dgdx, opt->xPhys, opt->Emin,
+            opt->Emax, opt->penal, opt->volfrac, opt->xPassive0,
+            opt->xPassive1, opt->xPassive2, opt->xPassive3); // # new
+      }
+      CHKERRQ(ierr);
+
+      // # new; Time the wait for the slowest rank's sensitivities
+      ierr = ImbalanceWait (PETSC_COMM_WORLD);
+      CHKERRQ(ierr);
+    }
 
     // Compute objective scale
-    if (itr == 1) {
+    if (*itr == 1) {
       opt->fscale = 10.0 / opt->fx;
     }
     // Scale objectie and sens
@@ -117,85 +115,325 @@ int main (int argc, char *argv[]) {
     VecScale (opt->dfdx, opt->fscale);
 
     // Filter sensitivities (chainrule)
-    ierr = filter->Gradients (opt->x, opt->xTilde, opt->dfdx, opt->m, opt->dgdx,
-        opt->projectionFilter, opt->beta, opt->eta);
-    CHKERRQ(ierr);
+    {
+      ScopedTimer filterTimer ("FilterGradients"); // # new
+      ierr = robust->Gradients (opt, filter); // # modified
+      CHKERRQ(ierr);
+    }
 
-    // Sets outer movelimits on design variables
-    ierr = mma->SetOuterMovelimit (opt->Xmin, opt->Xmax, opt->movlim, opt->x,
-        opt->xmin, opt->xmax);
-    CHKERRQ(ierr);
+    {
+      ScopedTimer mmaTimer ("MMA"); // # new
 
-    // Update design by MMA
-    ierr = mma->Update (opt->x, opt->dfdx, opt->gx, opt->dgdx, opt->xmin,
-        opt->xmax);
-    CHKERRQ(ierr);
+      // Sets outer movelimits on design variables
+      ierr = mma->SetOuterMovelimit (opt->Xmin, opt->Xmax, opt->movlim,
+          opt->x, opt->xmin, opt->xmax);
+      CHKERRQ(ierr);
 
-    // Inf norm on the design change
-    ch = mma->DesignChange (opt->x, opt->xold);
+      // Update design by MMA
+      // # modified; with the constraints of the bound formulation, -robust
+      ierr = mma->Update (opt->x, opt->dfdx,
+          robust->Active () ? robust->gx : opt->gx,
+          robust->Active () ? robust->dgdx : opt->dgdx, opt->xmin, opt->xmax);
+      CHKERRQ(ierr);
+
+      // Inf norm on the design change
+      ch = mma->DesignChange (opt->x, opt->xold);
+    }
 
     // Increase beta if needed
     PetscBool changeBeta = PETSC_FALSE;
     if (opt->projectionFilter) {
       changeBeta = filter->IncreaseBeta (&(opt->beta), opt->betaFinal,
-          opt->gx[0], itr, ch);
+          opt->gx[0], *itr, ch);
     }
 
     // Filter design field
-    ierr = filter->FilterProject (opt->x, opt->xTilde, opt->xPhys,
-        opt->projectionFilter, opt->beta, opt->eta);
-    CHKERRQ(ierr);
-
-    // Discreteness measure
-    PetscScalar mnd = filter->GetMND (opt->xPhys);
-
-    // stop timer
-    t2 = MPI_Wtime ();
+    PetscScalar mnd;
+    {
+      ScopedTimer filterTimer ("FilterProject"); // # new
+      ierr = robust->FilterProject (opt, filter); // # modified
+      CHKERRQ(ierr);
+
+      // Discreteness measure
+      mnd = filter->GetMND (opt->xPhys);
+    }
 
     // Print to screen
     PetscPrintf (PETSC_COMM_WORLD,
         "It.: %i, True fx: %f, Scaled fx: %f, gx[0]: %f, ch.: %f, "
-            "mnd.: %f, time: %f\n", itr, opt->fx / opt->fscale, opt->fx,
-        opt->gx[0], ch, mnd, t2 - t1);
+            "mnd.: %f, time: %f\n", *itr, opt->fx / opt->fscale, opt->fx,
+        opt->gx[0], ch, mnd, itrTimer.Elapsed ()); // # modified
+
+    // # new; No allocations after the warm-up, -allocCheck
+    ierr = AllocationCounter::Instance ().EndIteration (*itr,
+        PETSC_COMM_WORLD);
+    CHKERRQ(ierr);
 
     // Write field data: first 10 iterations and then every 20th
-    if (itr < 11 || itr % 20 == 0 || changeBeta) {
+    // # modified; of the target grid only
+    if (writeFiles && (*itr < 11 || *itr % 20 == 0 || changeBeta)) {
+      ScopedTimer outputTimer ("Output"); // # new
       prepost->UpdateNodeDensity (opt); // # new; update node density
       output->WriteVTK (physics->da_nodal, physics->GetStateField (),
           opt->nodeDensity, opt->x, opt->xTilde, opt->xPhys, opt->xPassive0,
-          opt->xPassive1, opt->xPassive2, opt->xPassive3, itr); // # modified
+          opt->xPassive1, opt->xPassive2, opt->xPassive3, *itr); // # modified
     }
 
     // Dump data needed for restarting code at termination
-    if (itr % 10 == 0) {
-      opt->WriteRestartFiles (&itr, mma);
+    if (writeFiles && opt->restart && *itr % 10 == 0) { // # modified
+      ScopedTimer restartTimer ("Restart"); // # new
+      opt->WriteRestartFiles (itr, mma);
       physics->WriteRestartFiles ();
     }
+
+    // # new; Append the metrics of this iteration
+    metrics->WriteIteration (*itr, opt->fx / opt->fscale, opt->gx, opt->m, ch,
+        mnd, opt->beta, physics->kspIterations, physics->kspResiduals,
+        itrTimer.Elapsed (), output->GetBytesWritten ());
   }
+  optTimer.Stop (); // # new
+
+  return ierr;
+}
 
-  // # new; FEA with the TopOpt final results
-  for (PetscInt loadConditionFEA = 0; loadConditionFEA < opt->numLODFIXFEA;
-      ++loadConditionFEA) {
-    physics->FEAWithTopOptResults (opt->xPhys, opt->xPassive0, opt->xPassive1,
-        opt->xPassive2, opt->xPassive3, loadConditionFEA, opt->loadVectorFEA);
-    output->WriteVTK (physics->da_nodal, physics->GetStateField (),
-        opt->nodeDensity, opt->x, opt->xTilde, opt->xPhys, opt->xPassive0,
-        opt->xPassive1, opt->xPassive2, opt->xPassive3, itr); // # modified
-    itr++;
+// # new; FEA of the final design for the FEA load cases and the final dump
+static PetscErrorCode FinalAnalysis (TopOpt *opt, Physics *physics, MMA *mma,
+    MPIIO *output, PetscInt *itr, PetscBool writeRestart) {
+  PetscErrorCode ierr = 0;
+
+  ScopedTimer feaTimer ("PostFEA"); // # new
+  // # modified; All the verification loads from one assembly of the final
+  // stiffness, written as one step of output_fea.dat with the state of each
+  // load as point fields ux_<i>, uy_<i>, uz_<i>
+  ierr = physics->FEAWithTopOptResults (opt->xPhys, opt->xPassive0,
+      opt->xPassive1, opt->xPassive2, opt->xPassive3, opt->numLODFIXFEA,
+      opt->loadVectorFEA);
+  CHKERRQ(ierr);
+  {
+    PetscInt nStates = physics->GetNumFEAStates ();
+    std::ostringstream pnames;
+    for (PetscInt i = 0; i < nStates; ++i) {
+      pnames << "ux_" << i << ", uy_" << i << ", uz_" << i << ", ";
+    }
+    pnames << "nodeDen";
+    MPIIO verification (opt->da_nodes, 3 * nStates + 1, pnames.str (), 7,
+        "x, xTilde, xPhys, xPassive0, xPassive1, xPassive2, xPassive3",
+        "output_fea");
+    ierr = verification.WriteVTK (physics->da_nodal, nStates,
+        physics->GetFEAStates (), opt->nodeDensity, opt->x, opt->xTilde,
+        opt->xPhys, opt->xPassive0, opt->xPassive1, opt->xPassive2,
+        opt->xPassive3, *itr);
+    CHKERRQ(ierr);
   }
 
   // Write restart WriteRestartFiles
-  opt->WriteRestartFiles (&itr, mma);
-  physics->WriteRestartFiles ();
+  if (writeRestart) { // # modified
+    opt->WriteRestartFiles (itr, mma);
+    physics->WriteRestartFiles ();
+  }
 
   // Dump final design
   output->WriteVTK (physics->da_nodal, physics->GetStateField (),
       opt->nodeDensity, opt->x, opt->xTilde, opt->xPhys, opt->xPassive0,
-      opt->xPassive1, opt->xPassive2, opt->xPassive3, itr); // # modified
+      opt->xPassive1, opt->xPassive2, opt->xPassive3, *itr); // # modified
+  feaTimer.Stop (); // # new
+
+  return ierr;
+}
+
+// # modified; entry point of the variant of DIM, see dispatch.cc
+int Main (int argc, char *argv[]) {
+
+  // Error code for debugging
+  PetscErrorCode ierr = 0;
+
+  // Initialize PETSc / MPI and pass input arguments to PETSc
+  PetscInitialize (&argc, &argv, PETSC_NULL, help);
+  AllocationCounter::Instance ().SetUp (); // # new; -allocCheck
+  ThreadsSetUp (); // # new; -numThreads
+
+  // # new; Grid sequencing (-gridSequence <n>): the design is first
+  // optimized on grids coarsened n, n-1, .., 1 times by 2 for at most
+  // -gridSequenceItr iterations each, and prolongated to the next finer grid
+  PetscInt gridSequence = 0, gridSequenceItr = 50;
+  PetscBool flg;
+  PetscOptionsGetInt (NULL, NULL, "-gridSequence", &gridSequence, &flg);
+  PetscOptionsGetInt (NULL, NULL, "-gridSequenceItr", &gridSequenceItr,
+      &flg);
+
+  // # new; Parameter sweep (-campaign <file>) on the target grid
+  Campaign *campaign = new Campaign ();
+  if (campaign->Active () && gridSequence > 0) {
+    PetscPrintf (PETSC_COMM_WORLD,
+        "# -campaign runs on the target grid only, -gridSequence ignored\n");
+    gridSequence = 0;
+  }
+
+  TopOpt *opt = NULL, *coarse = NULL;
+  PrePostProcess *prepost = NULL;
+  Physics *physics = NULL;
+  Filter *filter = NULL;
+  RobustDesign *robust = NULL; // # new
+  MPIIO *output = NULL;
+  MMA *mma = NULL, *coarseMMA = NULL;
+  MemoryReport *memory = NULL;
+  ImbalanceReport *imbalance = NULL;
+  PetscInt itr = 0;
+
+  // # new; Machine-readable per-iteration record
+  MetricsLog *metrics = new MetricsLog ();
+
+  for (PetscInt stage = gridSequence; stage >= 0; --stage) { // # new
+
+    // # new; Time the set up phase (steps 1-7)
+    ScopedTimer setupTimer ("Setup");
+
+    // STEP 1: THE OPTIMIZATION PARAMETERS, DATA AND MESH (!!! THE DMDA !!!)
+    opt = new TopOpt (1, stage); // # modified
+
+    // STEP 2: Pre-processing to define the design domain by using passive element assigning method
+    // # modified; With -balanceDomain the geometry is already voxelized
+    prepost = opt->voxels;
+    if (prepost == NULL) {
+      prepost = new PrePostProcess (opt);
+    }
+    if (opt->importGeo == 1) { // # modified; -importGeo
+      prepost->DesignDomainInitialization (opt); // # new
+    }
+
+    // STEP 3: THE PHYSICS
+    // # modified; of -physics: 0 - linear elasticity, 1 - compliant,
+    // 2 - linear heat conduction
+    ierr = Physics::Create (opt, &physics);
+    CHKERRQ(ierr);
+
+    // STEP 4: THE FILTERING
+    filter = new Filter (opt->da_nodes, opt->xPhys, opt->filter, opt->rmin,
+        opt->xPassive0, opt->xPassive1, opt->xPassive2, opt->xPassive3); // # modified
+    robust = new RobustDesign (opt); // # new
+
+    // STEP 5: VISUALIZATION USING VTK
+    output = new MPIIO (opt->da_nodes, 4, "ux, uy, uz, nodeDen", 7,
+        "x, xTilde, xPhys, xPassive0, xPassive1, xPassive2, xPassive3"); // # modified; all point data must use 3 coordinates in VTK
+    metrics->ResetBytesWritten (); // # new; the count of the writer starts at zero
+
+    // STEP 6: THE OPTIMIZER MMA
+    // # modified; allow for restart, or continue from the coarser stage
+    opt->AllocateMMAwithRestart (&itr, &mma, coarse, coarseMMA);
+    robust->AllocateMMA (opt, &mma, itr); // # new
+    // mma->SetAsymptotes(0.2, 0.65, 1.05);
+
+    // # new; The coarser stage is not needed anymore
+    if (coarse != NULL) {
+      delete coarseMMA;
+      delete coarse;
+      coarseMMA = NULL;
+      coarse = NULL;
+    }
+
+    // STEP 7: FILTER THE INITIAL DESIGN/RESTARTED DESIGN
+    ierr = robust->FilterProject (opt, filter); // # modified
+    CHKERRQ(ierr);
+    setupTimer.Stop (); // # new
+
+    if (stage == 0) { // # new; reports of the target grid
+      // # new; Memory held by the major data structures after the set up
+      memory = new MemoryReport ();
+      opt->AccountMemory (memory);
+      prepost->AccountMemory (memory);
+      physics->AccountMemory (memory);
+      filter->AccountMemory (memory);
+      robust->AccountMemory (memory); // # new
+      mma->AccountMemory (memory);
+      output->AccountMemory (memory);
+      memory->Report (PETSC_COMM_WORLD, "Setup");
+
+      // # new; Element classes of the partition, -imbalance
+      imbalance = new ImbalanceReport ();
+      imbalance->CountElements (opt->xPassive0, opt->xPassive1,
+          opt->xPassive2, opt->xPassive3);
+    }
+
+    // # new; Iterations of this stage, the counter runs over all stages
+    PetscInt stageItr = opt->maxItr;
+    if (stage > 0) {
+      stageItr = PetscMin(itr + gridSequenceItr, opt->maxItr);
+    }
+
+    // # new; Campaign designs start below on the target grid
+    if (stage == 0 && campaign->Active ()) break;
+
+    // STEP 8: OPTIMIZATION LOOP
+    ierr = Optimize (opt, physics, filter, robust, mma, output, prepost,
+        metrics, &itr, stageItr, (PetscBool) (stage == 0)); // # modified
+    CHKERRQ(ierr);
+
+    // # new; Keep the design and the optimizer of a coarse stage for the
+    // prolongation, the rest is rebuilt on the finer grid
+    if (stage > 0) {
+      PetscPrintf (PETSC_COMM_WORLD,
+          "# Grid sequencing: stage %i done after iteration %i\n", stage, itr);
+      coarse = opt;
+      coarseMMA = mma;
+      delete output;
+      delete robust; // # new
+      delete filter;
+      delete physics;
+      delete prepost;
+    }
+  }
+
+  // # modified; FEA with the TopOpt final results, or the campaign designs
+  if (!campaign->Active ()) {
+    ierr = FinalAnalysis (opt, physics, mma, output, &itr, PETSC_TRUE);
+    CHKERRQ(ierr);
+  }
+  for (PetscInt design = 0; design < campaign->Size (); ++design) {
+    itr = 0;
+    ierr = campaign->SetUpDesign (design, opt, &filter, &mma);
+    CHKERRQ(ierr);
+    ierr = robust->AllocateMMA (opt, &mma, itr); // # new
+    CHKERRQ(ierr);
+    delete output;
+    output = new MPIIO (opt->da_nodes, 4, "ux, uy, uz, nodeDen", 7,
+        "x, xTilde, xPhys, xPassive0, xPassive1, xPassive2, xPassive3");
+    metrics->ResetBytesWritten ();
+    ierr = robust->FilterProject (opt, filter); // # modified
+    CHKERRQ(ierr);
+    ierr = Optimize (opt, physics, filter, robust, mma, output, prepost,
+        metrics, &itr, opt->maxItr, PETSC_TRUE);
+    CHKERRQ(ierr);
+    ierr = FinalAnalysis (opt, physics, mma, output, &itr, PETSC_FALSE);
+    CHKERRQ(ierr);
+    ierr = campaign->FinishDesign (design, opt);
+    CHKERRQ(ierr);
+  }
+
+  // # new; Per-rank min/max/mean of the timed regions
+  TimerRegistry::Instance ().Report (PETSC_COMM_WORLD);
+  TimerRegistry::Instance ().ReportCounters (PETSC_COMM_WORLD); // # new
+
+  // # new; Memory at the end of the run, e.g. with the MG coarse operators,
+  // and the phase which set the RSS high-water mark
+  opt->AccountMemory (memory);
+  prepost->AccountMemory (memory);
+  physics->AccountMemory (memory);
+  filter->AccountMemory (memory);
+  robust->AccountMemory (memory); // # new
+  mma->AccountMemory (memory);
+  output->AccountMemory (memory);
+  memory->Report (PETSC_COMM_WORLD, "End of run");
+  TimerRegistry::Instance ().ReportRSS (PETSC_COMM_WORLD);
+  imbalance->Report (PETSC_COMM_WORLD); // # new
 
   // STEP 9: CLEAN UP AFTER YOURSELF
+  delete campaign; // # new
+  delete metrics; // # new
+  delete memory; // # new
+  delete imbalance; // # new
   delete mma;
   delete output;
+  delete robust; // # new
   delete filter;
   delete opt;
   delete physics;
@@ -205,3 +443,5 @@ int main (int argc, char *argv[]) {
   PetscFinalize ();
   return 0;
 }
+
+TOPOPT_NAMESPACE_END // # new
@@ -4,12 +4,29 @@
  * Created by Zhidong Brian Zhang in May 2020, University of Waterloo
  */
 
-// Dimension
-#define DIM 2                 // 2-2D, 3-3D
+// PHYSICS and IMPORT_GEO are only the defaults of -physics and -importGeo,
+// see Physics.h. They can be overridden at build time, e.g.
+// make topopt TOPOPT_DEFS="-DPHYSICS=2"
+
+// Dimension: not a switch. The makefile compiles every class depending on
+// it once for 2D and once for 3D into the namespace topopt_d<DIM>, and
+// dispatch.cc selects one with -dim at run time.
+#ifndef DIM
+#error "DIM is set per variant by the makefile, choose it with -dim"
+#endif
 
 // Import geometry or not
+#ifndef IMPORT_GEO
 #define IMPORT_GEO 1          // 0-Default geometries, 1-Imported CAD geometries
+#endif
 
 // Physical problems to be studied
+#ifndef PHYSICS
 #define PHYSICS 0       //0-Linear elasticity, 1-Compliant, 2-Heat conduction
+#endif
 
+// Namespace of the variant of DIM, e.g. topopt_d3
+#define TOPOPT_CONCAT_(d) topopt_d ## d
+#define TOPOPT_CONCAT(d) TOPOPT_CONCAT_(d)
+#define TOPOPT_NAMESPACE_BEGIN namespace TOPOPT_CONCAT(DIM) {
+#define TOPOPT_NAMESPACE_END }
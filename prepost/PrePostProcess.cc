@@ -18,6 +18,9 @@
 // ---------------------------------------------------------------------
 
 #include <PrePostProcess.h>
+#include <scopedtimer.h>
+
+TOPOPT_NAMESPACE_BEGIN // # new
 
 PrePostProcess::PrePostProcess (TopOpt *opt) {
   // Design domain dimensions
@@ -40,6 +43,8 @@ PrePostProcess::PrePostProcess (TopOpt *opt) {
   this->numSLD = opt->numSLD;
   this->numLODFIX = opt->numLODFIX;
   voxIndex = 0;
+  occBytes = 0.0;
+  voxelized = PETSC_FALSE;
   occDES.resize (numDES);
   occSLD.resize (numSLD);
   occFIX.resize (numLODFIX);
@@ -49,27 +54,109 @@ PrePostProcess::PrePostProcess (TopOpt *opt) {
 PrePostProcess::~PrePostProcess () {
 }
 
+PetscErrorCode PrePostProcess::Voxelize (TopOpt *opt) {
+  PetscErrorCode ierr = 0;
+  if (voxelized) return ierr;
+
+  // Import and voxelize, or generate the synthetic benchmark domain
+  if (opt->benchmark) {
+    ScopedTimer voxTimer ("Synthetic");
+    ierr = SyntheticGeometry (opt);
+    CHKERRQ(ierr);
+    PetscPrintf (PETSC_COMM_WORLD,
+        "# Generating the synthetic benchmark domain took %f s\n",
+        voxTimer.Elapsed ());
+  } else {
+    ScopedTimer voxTimer ("Voxelize");
+    ierr = ImportAndVoxelizeGeometry (opt);
+    PetscPrintf (PETSC_COMM_WORLD,
+        "# Importing and voxelizing totally took %f s\n", voxTimer.Elapsed ());
+  }
+  voxelized = PETSC_TRUE;
+
+  return ierr;
+}
+
+PetscErrorCode PrePostProcess::SlabWeights (PetscScalar voidWeight,
+    std::vector<PetscScalar> *weights) {
+  PetscErrorCode ierr = 0;
+
+  weights[0].assign (nx, 0.0);
+  weights[1].assign (ny, 0.0);
+#if DIM == 3
+  weights[2].assign (nz, 0.0);
+#endif
+
+  // Unused domains have empty bitsets
+  auto occupied = [this] (const std::vector<int> &occ) {
+    return !occ.empty () && ((occ[voxIndex / BATCH] >> (voxIndex % BATCH)) & 1);
+  };
+
+  for (unsigned int k = 0; k < nz; k++) {
+    for (unsigned int j = 0; j < ny; j++) {
+      for (unsigned int i = 0; i < nx; i++) {
+        voxIndex = k * nx * ny + j * nx + i;
+        bool active = false;
+        for (unsigned int designDomain = 0; designDomain < numDES && !active;
+            ++designDomain) {
+          active = occupied (occDES[designDomain]);
+        }
+        for (unsigned int solidDomain = 0; solidDomain < numSLD && !active;
+            ++solidDomain) {
+          active = occupied (occSLD[solidDomain]);
+        }
+        for (unsigned int loadCondition = 0;
+            loadCondition < numLODFIX && !active; ++loadCondition) {
+          active = occupied (occFIX[loadCondition])
+                   || occupied (occLOD[loadCondition]);
+        }
+
+        PetscScalar w = active ? 1.0 : voidWeight;
+        weights[0][i] += w;
+        weights[1][j] += w;
+#if DIM == 3
+        weights[2][k] += w;
+#endif
+      }
+    }
+  }
+
+  return ierr;
+}
+
 PetscErrorCode PrePostProcess::DesignDomainInitialization (TopOpt *opt) {
   PetscErrorCode ierr = 0;
 
-  double t1, t2;
+  ScopedTimer initTimer ("DomainInit");
 
   PetscPrintf (PETSC_COMM_WORLD,
       "################ Design domain initialization ################\n");
 
-  // Import and voxelize
-  t1 = MPI_Wtime ();
-  ierr = ImportAndVoxelizeGeometry (opt);
-  t2 = MPI_Wtime ();
-  PetscPrintf (PETSC_COMM_WORLD,
-      "# Importing and voxelizing totally took %f s\n", t2 - t1);
+  // # modified; Import and voxelize, unless done before the mesh partition
+  ierr = Voxelize (opt);
+  CHKERRQ(ierr);
 
   // Assign passive element
-  t1 = MPI_Wtime ();
-  ierr = AssignPassiveElement (opt);
-  t2 = MPI_Wtime ();
-  PetscPrintf (PETSC_COMM_WORLD, "# Assigning passive element took %f s\n",
-      t2 - t1);
+  {
+    ScopedTimer assignTimer ("AssignPassive");
+    ierr = AssignPassiveElement (opt);
+    PetscPrintf (PETSC_COMM_WORLD, "# Assigning passive element took %f s\n",
+        assignTimer.Elapsed ());
+  }
+
+  // Keep the size of the bitsets for the memory report
+  occBytes = 0.0;
+  for (unsigned int designDomain = 0; designDomain < numDES; ++designDomain) {
+    occBytes += occDES[designDomain].capacity () * sizeof(int);
+  }
+  for (unsigned int solidDomain = 0; solidDomain < numSLD; ++solidDomain) {
+    occBytes += occSLD[solidDomain].capacity () * sizeof(int);
+  }
+  for (unsigned int loadCondition = 0; loadCondition < numLODFIX;
+      ++loadCondition) {
+    occBytes += occFIX[loadCondition].capacity () * sizeof(int);
+    occBytes += occLOD[loadCondition].capacity () * sizeof(int);
+  }
 
   // Clean the occupancy data and free memory
   CleanUp ();
@@ -123,9 +210,9 @@ PetscErrorCode PrePostProcess::CalculateNodeLoadAddingTotalCounts (
 //      memset (eNodeDensity, 0.0, sizeof(eNodeDensity[0]) * nen);
       for (PetscInt j = 0; j < nen; j++) {
         // global numbering of each node
-        if (PHYSICS == 0 || PHYSICS == 1) {
+        if (opt->physics == 0 || opt->physics == 1) { // # modified
           edof[j] = DIM * necon[i * nen + j];
-        } else if (PHYSICS == 2) {
+        } else if (opt->physics == 2) {
           edof[j] = 1 * necon[i * nen + j]; // for heat conduction, only has 1 dof per node
         }
       }
@@ -156,114 +243,164 @@ PetscErrorCode PrePostProcess::UpdateNodeDensity (TopOpt *opt) {
 #if DIM == 2
   ierr = DMDAGetElements_2D (opt->da_nodes, &nel, &nen, &necon);
   CHKERRQ(ierr);
-  PetscScalar eNodeAddingCounts[4] = { 1, 1, 1, 1 }; // elemental node adding counts
-  PetscScalar eNodeDensity[4]; // elemental node density
 #elif DIM == 3
   ierr = DMDAGetElements_3D (opt->da_nodes, &nel, &nen, &necon);
   CHKERRQ(ierr);
-  PetscScalar eNodeAddingCounts[8] = { 1, 1, 1, 1, 1, 1, 1, 1 }; // elemental node adding counts
-  PetscScalar eNodeDensity[8]; // elemental node density
 #endif
-
-  VecZeroEntries (opt->nodeDensity); // zero off nodeDensity vector
-  VecZeroEntries (opt->nodeAddingCounts); // zero off nodeAddingCounts vector
   // DMDAGetElements(da_nodes,&nel,&nen,&necon); // Still issue with elemtype
   // change !
 
   // Get pointer to the densities
-  PetscScalar *xp, *xPassive0p, *xPassive1p, *xPassive2p, *xPassive3p;
+  PetscScalar *xp, *xPassive0p;
   VecGetArray (opt->xPhys, &xp);
   VecGetArray (opt->xPassive0, &xPassive0p);
-  VecGetArray (opt->xPassive1, &xPassive1p);
-  VecGetArray (opt->xPassive2, &xPassive2p);
-  VecGetArray (opt->xPassive3, &xPassive3p);
 
-  // Edof array, new
-  PetscInt edof[nen];
+  // # modified; The element densities and adding counts go to the ghosted
+  // arrays, the threads by colors of elements without common nodes
+  if (coloring.Colors () == 0) {
+    coloring.SetUp (nel, nen, necon);
+  }
+  Vec nodeDensityLoc, nodeAddingCountsLoc;
+  DMGetLocalVector (opt->da_nodes, &nodeDensityLoc);
+  DMGetLocalVector (opt->da_nodes, &nodeAddingCountsLoc);
+  VecSet (nodeDensityLoc, 0.0);
+  VecSet (nodeAddingCountsLoc, 0.0);
+  PetscScalar *ndp, *ncp;
+  VecGetArray (nodeDensityLoc, &ndp);
+  VecGetArray (nodeAddingCountsLoc, &ncp);
+  // for heat conduction, only has 1 dof per node
+  const PetscInt dof = (opt->physics == 2) ? 1 : DIM;
 
   // Loop over elements
-  for (PetscInt i = 0; i < nel; i++) {
-    // loop over element nodes
-    if (xPassive0p[i] == 0 /*&& xPassive1p[i] == 0 && xPassive2p[i] == 0
-     && xPassive3p[i] == 0*/) {
-      memset (eNodeDensity, 0.0, sizeof(eNodeDensity[0]) * nen);
-      for (PetscInt j = 0; j < nen; j++) {
-        eNodeDensity[j] = xp[i];
-        // global numbering of each node
-        if (PHYSICS == 0 || PHYSICS == 1) {
-          edof[j] = DIM * necon[i * nen + j];
-        } else if (PHYSICS == 2) {
-          edof[j] = 1 * necon[i * nen + j]; // for heat conduction, only has 1 dof per node
+  for (PetscInt c = 0; c < coloring.Colors (); c++) {
+    const PetscInt *elements = coloring.Elements (c);
+    TOPOPT_OMP(parallel for)
+    for (PetscInt e = 0; e < coloring.Size (c); e++) {
+      PetscInt i = elements[e];
+      if (xPassive0p[i] == 0 /*&& xPassive1p[i] == 0 && xPassive2p[i] == 0
+       && xPassive3p[i] == 0*/) {
+        for (PetscInt j = 0; j < nen; j++) {
+          // local numbering of each node
+          PetscInt n = dof * necon[i * nen + j];
+          ndp[n] += xp[i];
+          ncp[n] += 1.0;
         }
       }
-      ierr = VecSetValuesLocal (opt->nodeDensity, nen, edof, eNodeDensity,
-          ADD_VALUES);
-      CHKERRQ(ierr);
-      ierr = VecSetValuesLocal (opt->nodeAddingCounts, nen, edof,
-          eNodeAddingCounts, ADD_VALUES);
-      CHKERRQ(ierr);
     }
   }
+  VecRestoreArray (nodeDensityLoc, &ndp);
+  VecRestoreArray (nodeAddingCountsLoc, &ncp);
+  VecRestoreArray (opt->xPhys, &xp);
+  VecRestoreArray (opt->xPassive0, &xPassive0p);
+
+  VecZeroEntries (opt->nodeDensity); // zero off nodeDensity vector
+  VecZeroEntries (opt->nodeAddingCounts); // zero off nodeAddingCounts vector
+  DMLocalToGlobalBegin (opt->da_nodes, nodeDensityLoc, ADD_VALUES,
+      opt->nodeDensity);
+  DMLocalToGlobalEnd (opt->da_nodes, nodeDensityLoc, ADD_VALUES,
+      opt->nodeDensity);
+  DMLocalToGlobalBegin (opt->da_nodes, nodeAddingCountsLoc, ADD_VALUES,
+      opt->nodeAddingCounts);
+  DMLocalToGlobalEnd (opt->da_nodes, nodeAddingCountsLoc, ADD_VALUES,
+      opt->nodeAddingCounts);
+  DMRestoreLocalVector (opt->da_nodes, &nodeDensityLoc);
+  DMRestoreLocalVector (opt->da_nodes, &nodeAddingCountsLoc);
 
   //  Calculate the average node density by using pointwise dividing
-  VecAssemblyBegin (opt->nodeAddingCounts);
-  VecAssemblyEnd (opt->nodeAddingCounts);
-  VecAssemblyBegin (opt->nodeDensity);
-  VecAssemblyEnd (opt->nodeDensity);
   VecPointwiseDivide (opt->nodeDensity, opt->nodeDensity,
       opt->nodeAddingCounts);
-  VecAssemblyBegin (opt->nodeAddingCounts);
-  VecAssemblyEnd (opt->nodeAddingCounts);
   DMDARestoreElements (opt->da_nodes, &nel, &nen, &necon);
-  VecAssemblyBegin (opt->nodeDensity);
-  VecAssemblyEnd (opt->nodeDensity);
 
   return ierr;
 }
 
-PetscErrorCode PrePostProcess::ImportAndVoxelizeGeometry (TopOpt *opt) {
-  PetscErrorCode ierr = 0;
-
-  double t1, t2;
+// Read an STL file into the voxelizer, a missing or malformed file is an
+// error (Read_file throws or returns false)
+static PetscErrorCode ReadStl (StlVoxelizer *sv, const std::string &filename) {
+  bool ok;
+  try {
+    ok = sv->Read_file (filename);
+  } catch (...) {
+    ok = false;
+  }
+  if (!ok) {
+    SETERRQ1(PETSC_COMM_SELF, PETSC_ERR_FILE_READ,
+        "Cannot read the STL file %s", filename.c_str ());
+  }
+  return 0;
+}
 
-  // Create voxelizer class
-  StlVoxelizer *sv = new StlVoxelizer ();
-  PetscPrintf (PETSC_COMM_WORLD, "# Start to voxelize the geometries\n");
+PetscErrorCode PrePostProcess::ReadGeometry (TopOpt *opt,
+    StlVoxelizer *sv) {
+  PetscErrorCode ierr = 0;
 
-  // Read and voxelize the geometries
-  t1 = MPI_Wtime ();
-  for (unsigned int designDomain = 0; designDomain < numDES;
+  for (PetscInt designDomain = 0; designDomain < opt->numDES;
       ++designDomain) {
-    if (!opt->inputSTL_DES[designDomain].empty ())
-      ierr = sv->Read_file (opt->inputSTL_DES[designDomain]);
+    if (!opt->inputSTL_DES[designDomain].empty ()) {
+      ierr = ReadStl (sv, opt->inputSTL_DES[designDomain]);
+      CHKERRQ(ierr);
+    }
   }
-  for (unsigned int solidDomain = 0; solidDomain < numSLD;
-      ++solidDomain) {
-    if (!opt->inputSTL_SLD[solidDomain].empty ())
-      ierr = sv->Read_file (opt->inputSTL_SLD[solidDomain]);
-    t2 = MPI_Wtime ();
-    PetscPrintf (PETSC_COMM_WORLD, "# Read STL files took: %f s\n", t2 - t1);
+  for (PetscInt solidDomain = 0; solidDomain < opt->numSLD; ++solidDomain) {
+    if (!opt->inputSTL_SLD[solidDomain].empty ()) {
+      ierr = ReadStl (sv, opt->inputSTL_SLD[solidDomain]);
+      CHKERRQ(ierr);
+    }
   }
-  for (unsigned int loadCondition = 0; loadCondition < numLODFIX;
+  for (PetscInt loadCondition = 0; loadCondition < opt->numLODFIX;
       ++loadCondition) {
-    for (unsigned int backSearch = 0; backSearch <= loadCondition;
+    for (PetscInt backSearch = 0; backSearch <= loadCondition;
         ++backSearch) {
       if (!opt->inputSTL_FIX[loadCondition - backSearch].empty ()) {
-        ierr = sv->Read_file (opt->inputSTL_FIX[loadCondition - backSearch]);
+        ierr = ReadStl (sv, opt->inputSTL_FIX[loadCondition - backSearch]);
+        CHKERRQ(ierr);
         break;
       }
     }
-    for (unsigned int backSearch = 0; backSearch <= loadCondition;
+    for (PetscInt backSearch = 0; backSearch <= loadCondition;
         ++backSearch) {
       if (!opt->inputSTL_LOD[loadCondition - backSearch].empty ()) {
-        ierr = sv->Read_file (opt->inputSTL_LOD[loadCondition - backSearch]);
+        ierr = ReadStl (sv, opt->inputSTL_LOD[loadCondition - backSearch]);
+        CHKERRQ(ierr);
         break;
       }
     }
   }
 
+  return ierr;
+}
+
+PetscErrorCode PrePostProcess::GeometryBound (TopOpt *opt, float *bound) {
+  PetscErrorCode ierr = 0;
+
+  StlVoxelizer *sv = new StlVoxelizer ();
+  ierr = ReadGeometry (opt, sv);
+  CHKERRQ(ierr);
+  sv->InputBound (bound);
+  delete sv;
+
+  return ierr;
+}
+
+PetscErrorCode PrePostProcess::ImportAndVoxelizeGeometry (TopOpt *opt) {
+  PetscErrorCode ierr = 0;
+
+  double t1, t2;
+
+  // Create voxelizer class
+  StlVoxelizer *sv = new StlVoxelizer ();
+  PetscPrintf (PETSC_COMM_WORLD, "# Start to voxelize the geometries\n");
+
+  // Read and voxelize the geometries
   t1 = MPI_Wtime ();
-  sv->ScaleAndTranslate (nx, ny, nz, dx, dy, dz);
+  ierr = ReadGeometry (opt, sv); // # modified
+  CHKERRQ(ierr);
+  t2 = MPI_Wtime ();
+  PetscPrintf (PETSC_COMM_WORLD, "# Read STL files took: %f s\n", t2 - t1);
+
+  t1 = MPI_Wtime ();
+  sv->ScaleAndTranslate (nx, ny, nz, dx, dy, dz,
+      opt->cropDomain ? opt->cropPadding : 0); // # modified; -cropDomain
   t2 = MPI_Wtime ();
   PetscPrintf (PETSC_COMM_WORLD, "# Scale and translate took: %f s\n",
       t2 - t1);
@@ -367,6 +504,60 @@ PetscErrorCode PrePostProcess::ImportAndVoxelizeGeometry (TopOpt *opt) {
   return ierr;
 }
 
+PetscErrorCode PrePostProcess::SyntheticGeometry (TopOpt *opt) {
+  PetscErrorCode ierr = 0;
+
+  PetscPrintf (PETSC_COMM_WORLD,
+      "# Benchmark mode (-benchmark): synthetic box domain, no STL input\n");
+
+  // Same batched layout as the voxelizer output
+  unsigned int occSize = (nx * ny * nz - 1) / BATCH + 1;
+  occDES[0].assign (occSize, 0);
+  for (unsigned int loadCondition = 0; loadCondition < numLODFIX;
+      ++loadCondition) {
+    occFIX[loadCondition].assign (occSize, 0);
+    occLOD[loadCondition].assign (occSize, 0);
+  }
+
+  for (unsigned int k = 0; k < nz; k++) {
+    for (unsigned int j = 0; j < ny; j++) {
+      for (unsigned int i = 0; i < nx; i++) {
+        voxIndex = k * nx * ny + j * nx + i;
+
+        // The whole box is designable
+        occDES[0][voxIndex / BATCH] |= (1 << (voxIndex % BATCH));
+
+        bool fix, lod;
+        if (opt->physics == 0) {
+          // Cantilever: clamped at x = xmin, loaded along the lower edge at
+          // x = xmax
+          fix = (i == 0);
+          lod = (i == nx - 1 && j == 0);
+        } else if (opt->physics == 1) {
+          // Inverter: clamped at the lower part of x = xmin, ports are set by
+          // the physics
+          fix = (i == 0 && j < PetscMax(ny / 8, 1u));
+          lod = false;
+        } else {
+          // Heat sink: fixed temperature at the middle of y = ymin, body load
+          // everywhere
+          fix = (j == 0 && i >= 3 * nx / 8 && i < 5 * nx / 8);
+          lod = false;
+        }
+        for (unsigned int loadCondition = 0; loadCondition < numLODFIX;
+            ++loadCondition) {
+          if (fix)
+            occFIX[loadCondition][voxIndex / BATCH] |= (1 << (voxIndex % BATCH));
+          if (lod)
+            occLOD[loadCondition][voxIndex / BATCH] |= (1 << (voxIndex % BATCH));
+        }
+      }
+    }
+  }
+
+  return ierr;
+}
+
 // Passive element assignment
 PetscErrorCode
 PrePostProcess::AssignPassiveElement (TopOpt *opt)
@@ -723,6 +914,12 @@ PrePostProcess::AssignPassiveElement (TopOpt *opt)
   return ierr;
 }
 
+PetscErrorCode PrePostProcess::AccountMemory (MemoryReport *mem) {
+  PetscErrorCode ierr = 0;
+  mem->Add ("Voxel bitsets (freed)", occBytes);
+  return ierr;
+}
+
 PetscErrorCode
 PrePostProcess::CleanUp ()
 {
@@ -867,3 +1064,5 @@ PrePostProcess::DMDAGetElements_3D (DM dm, PetscInt *nel,
   return (0);
 }
 #endif
+
+TOPOPT_NAMESPACE_END // # new
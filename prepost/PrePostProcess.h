@@ -26,6 +26,10 @@
 #include "options.h"
 // Stl voxelizer
 #include <./vox/StlVoxelizer.h>
+// # new; Colors of the threaded element loops
+#include "elementcoloring.h"
+
+TOPOPT_NAMESPACE_BEGIN // # new
 
 /**
  * class Pre- and post-processing class
@@ -85,6 +89,35 @@ class PrePostProcess {
      */
     PetscErrorCode DesignDomainInitialization (TopOpt *opt);
 
+    /**
+     * Import and voxelize the geometry, or generate the synthetic benchmark
+     * domain. Called by the design domain initialization, or before it when
+     * the mesh partition is weighted by the occupancy (-balanceDomain).
+     * \param[in] pointer of the TopOpt class
+     * \param[out]
+     * \return PetscErrorCode
+     */
+    PetscErrorCode Voxelize (TopOpt *opt);
+
+    /**
+     * Work weights of the element slabs along each axis: an active (design,
+     * solid, fixture or load) voxel counts 1, a void voxel voidWeight
+     * \param[in] weight of a void voxel
+     * \param[out] weights, DIM vectors with the slab weights along x, y, z
+     * \return PetscErrorCode
+     */
+    PetscErrorCode SlabWeights (PetscScalar voidWeight,
+        std::vector<PetscScalar> *weights);
+
+    /**
+     * Bound of the union of the input STL geometries before scaling, for
+     * cropping the mesh to the geometry (-cropDomain) before it is created
+     * \param[in] pointer of the TopOpt class
+     * \param[out] bound, min and max corner as (xmin,xmax,ymin,ymax,zmin,zmax)
+     * \return PetscErrorCode
+     */
+    static PetscErrorCode GeometryBound (TopOpt *opt, float *bound);
+
     /**
      * Caculate the number of nodal-wisely adding loads in the LOD domains during the loading vector assembly
      * \param[in] pointer of the TopOpt class
@@ -101,8 +134,33 @@ class PrePostProcess {
      */
     PetscErrorCode UpdateNodeDensity (TopOpt *opt);
 
+    /**
+     * Add the bytes of the voxel bitsets to the memory report. The bitsets
+     * cover the whole domain on every rank and are freed at the end of the
+     * design domain initialization, so their size at that point is reported.
+     * \param[in] memory report
+     * \param[out]
+     * \return PetscErrorCode
+     */
+    PetscErrorCode AccountMemory (MemoryReport *mem);
+
   private:
 
+    /*
+     * Bytes of the voxel bitsets before they are freed
+     */
+    PetscLogDouble occBytes;
+
+    /*
+     * Element colors of the threaded node density update
+     */
+    ElementColoring coloring;
+
+    /*
+     * The occupancy has been generated
+     */
+    PetscBool voxelized;
+
     /**
      * Import and voxelize the geometry
      * \param[in] vector of the voxelization information, 0 represents void, 1 represents solid
@@ -111,6 +169,22 @@ class PrePostProcess {
      */
     PetscErrorCode ImportAndVoxelizeGeometry (TopOpt *opt);
 
+    /**
+     * Read the STL files of all the domains into the voxelizer
+     * \param[in] pointer of the TopOpt class
+     * \param[in] voxelizer
+     * \return PetscErrorCode
+     */
+    static PetscErrorCode ReadGeometry (TopOpt *opt, StlVoxelizer *sv);
+
+    /**
+     * Generate the occupancy of the synthetic benchmark domain (-benchmark)
+     * \param[in] pointer of the TopOpt class
+     * \param[out]
+     * \return PetscErrorCode
+     */
+    PetscErrorCode SyntheticGeometry (TopOpt *opt);
+
     /**
      * Passive element assignment
      * \param[in] pointer of the TopOpt class
@@ -144,4 +218,6 @@ class PrePostProcess {
 
 };
 
+TOPOPT_NAMESPACE_END // # new
+
 #endif /* PrePostProcess_H_ */
@@ -0,0 +1,132 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * SymmetryPlanes.cc
+ */
+
+#include "SymmetryPlanes.h"
+
+#include <cstdlib>
+#include <sstream>
+
+TOPOPT_NAMESPACE_BEGIN // # new
+
+static const char *faceNames[6] = { "xmin", "xmax", "ymin", "ymax", "zmin",
+    "zmax" };
+
+SymmetryPlanes::SymmetryPlanes () {
+  nPlanes = 0;
+  for (PetscInt f = 0; f < 2 * DIM; ++f) {
+    mirrored[f] = PETSC_FALSE;
+  }
+
+  char planesChar[PETSC_MAX_PATH_LEN];
+  PetscBool flg;
+  PetscOptionsGetString (NULL, NULL, "-symmetry", planesChar,
+      sizeof(planesChar), &flg);
+  if (!flg) return;
+
+  std::istringstream planes (planesChar);
+  std::string plane;
+  while (std::getline (planes, plane, ',')) {
+    PetscInt f = 0;
+    while (f < 2 * DIM && plane != faceNames[f]) {
+      f++;
+    }
+    if (f == 2 * DIM) {
+      PetscPrintf (PETSC_COMM_WORLD,
+          "# -symmetry: '%s' is not a face of the %iD mesh (xmin, xmax, ..)\n",
+          plane.c_str (), DIM);
+      exit (0);
+    }
+    if (!mirrored[f]) {
+      mirrored[f] = PETSC_TRUE;
+      nPlanes++;
+    }
+  }
+  for (PetscInt a = 0; a < DIM; ++a) {
+    if (mirrored[2 * a] && mirrored[2 * a + 1]) {
+      PetscPrintf (PETSC_COMM_WORLD,
+          "# -symmetry: only one mirror plane per axis\n");
+      exit (0);
+    }
+  }
+}
+
+PetscErrorCode SymmetryPlanes::ZeroNormalDisplacement (Vec N,
+    const PetscScalar *lcoorp, PetscInt nn, const PetscScalar *xc,
+    PetscScalar epsi) const {
+  PetscErrorCode ierr = 0;
+  if (nPlanes == 0) return ierr;
+
+  for (PetscInt i = 0; i < nn; i += DIM) {
+    for (PetscInt a = 0; a < DIM; ++a) {
+      for (PetscInt s = 0; s < 2; ++s) {
+        if (mirrored[2 * a + s]
+            && PetscAbsScalar (lcoorp[i + a] - xc[2 * a + s]) < epsi) {
+          ierr = VecSetValueLocal (N, i + a, 0.0, INSERT_VALUES);
+          CHKERRQ(ierr);
+        }
+      }
+    }
+  }
+  return ierr;
+}
+
+PetscScalar SymmetryPlanes::FilterWeight (const PetscScalar *xr,
+    const PetscScalar *xe, const PetscScalar *xc, PetscScalar R) const {
+  PetscScalar weight = 0.0;
+
+  // Image 0 is xe itself, bit a of the image mirrors xe across the plane of
+  // axis a
+  for (PetscInt image = 0; image < (1 << DIM); ++image) {
+    PetscScalar dist = 0.0;
+    PetscBool exists = PETSC_TRUE;
+    for (PetscInt a = 0; a < DIM; ++a) {
+      PetscScalar x = xe[a];
+      if (image & (1 << a)) {
+        PetscInt s = mirrored[2 * a] ? 0 : 1;
+        if (!mirrored[2 * a + s]) {
+          exists = PETSC_FALSE;
+          break;
+        }
+        x = 2.0 * xc[2 * a + s] - x;
+      }
+      dist += (xr[a] - x) * (xr[a] - x);
+    }
+    if (!exists) continue;
+    dist = PetscSqrtScalar(dist);
+    if (dist < R) {
+      weight += R - dist;
+    }
+  }
+  return weight;
+}
+
+std::string SymmetryPlanes::Describe () const {
+  std::string planes;
+  for (PetscInt f = 0; f < 2 * DIM; ++f) {
+    if (!mirrored[f]) continue;
+    if (!planes.empty ()) planes += " ";
+    planes += faceNames[f];
+  }
+  return planes;
+}
+
+TOPOPT_NAMESPACE_END // # new
@@ -0,0 +1,102 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * SymmetryPlanes.h
+ */
+
+#ifndef SYMMETRYPLANES_H_
+#define SYMMETRYPLANES_H_
+
+#include <string>
+#include <petsc.h>
+
+#include "options.h"
+
+TOPOPT_NAMESPACE_BEGIN // # new
+
+/*
+ * Mirror planes of a reduced (half, quarter or eighth) model, on faces of
+ * the mesh: the part is solved on the reduced domain and mirrored back to
+ * the full part by bin2vtu.py.
+ *
+ * Symmetric conditions on a plane: the normal displacement is zero for
+ * elasticity, the heat flux is zero for heat conduction, which is the
+ * natural condition of the weak form, so nothing is imposed. The density
+ * filter adds the weights of the mirror images of the elements near a plane,
+ * the PDE filter keeps its zero flux there, which is the mirror condition.
+ *
+ * Options:
+ * -symmetry <string>  comma separated faces, e.g. xmin,ymax (default none)
+ */
+class SymmetryPlanes {
+  public:
+
+    /*
+     * Constructor, reads the option
+     */
+    SymmetryPlanes ();
+
+    /*
+     * At least one plane is declared
+     */
+    PetscBool Active () const {
+      return (PetscBool) (nPlanes > 0);
+    }
+
+    /*
+     * Face 2 * axis + side (side 0 at the minimum, 1 at the maximum) is a
+     * mirror plane
+     */
+    PetscBool Mirrored (PetscInt face) const {
+      return mirrored[face];
+    }
+
+    /*
+     * Zero the normal displacement of the nodes on the planes
+     * \param[in,out] Dirichlet vector, set with INSERT_VALUES
+     * \param[in] local coordinates (DIM per node, including ghosts) and size
+     * \param[in] domain coordinates (min, max per axis) and tolerance
+     * \return PetscErrorCode
+     */
+    PetscErrorCode ZeroNormalDisplacement (Vec N, const PetscScalar *lcoorp,
+        PetscInt nn, const PetscScalar *xc, PetscScalar epsi) const;
+
+    /*
+     * Weight R - distance of the density filter between the element centers
+     * xr and xe, summed over xe and its images across the planes
+     * \param[in] element centers (DIM each)
+     * \param[in] domain coordinates (min, max per axis) and filter radius
+     * \return the weight, 0 out of the radius
+     */
+    PetscScalar FilterWeight (const PetscScalar *xr, const PetscScalar *xe,
+        const PetscScalar *xc, PetscScalar R) const;
+
+    /*
+     * Planes as in the option, e.g. "xmin ymax", for the output header
+     */
+    std::string Describe () const;
+
+  private:
+    PetscBool mirrored[2 * DIM];
+    PetscInt nPlanes;
+};
+
+TOPOPT_NAMESPACE_END // # new
+
+#endif /* SYMMETRYPLANES_H_ */
@@ -259,38 +259,38 @@ void StlVoxelizer::Voxelize_solid (std::vector<int> &occ, unsigned int nx,
 }
 
 void StlVoxelizer::ScaleAndTranslate (unsigned int nx, unsigned int ny,
-    unsigned int nz, float dx, float dy, float dz) {
+    unsigned int nz, float dx, float dy, float dz, unsigned int padding) {
 // Get bound of the input models
   GetBound (bound);
 
   if ((bound[5] - bound[4]) == 0) { // z direction dimension 0, meaning it is 2D model, otherwise 3D
     // Scaling
-    factor[0] = std::min (nx * dx / (bound[1] - bound[0]),
-        ny * dy / (bound[3] - bound[2])); // scale the CAD model of the  part to the prescribe domain size
+    factor[0] = std::min ((nx - 2 * padding) * dx / (bound[1] - bound[0]),
+        (ny - 2 * padding) * dy / (bound[3] - bound[2])); // # modified; scale the CAD model of the  part to the prescribe domain size
     factor[1] = factor[0];
     factor[2] = 1.0;
     Scale (factor);
     // Get bound of the input models
     GetBound (bound);
     // Translate the input models
-    trans[0] = -bound[0];
-    trans[1] = -bound[2];
+    trans[0] = -bound[0] + padding * dx; // # modified
+    trans[1] = -bound[2] + padding * dy; // # modified
     trans[2] = -bound[4];
     Translate (trans);
   } else {
     // Scaling
-    factor[0] = std::min (nx * dx / (bound[1] - bound[0]),
-        std::min (ny * dy / (bound[3] - bound[2]),
-            nz * dz / (bound[5] - bound[4]))); // scale the CAD model of the  part to the prescribe domain size
+    factor[0] = std::min ((nx - 2 * padding) * dx / (bound[1] - bound[0]),
+        std::min ((ny - 2 * padding) * dy / (bound[3] - bound[2]),
+            (nz - 2 * padding) * dz / (bound[5] - bound[4]))); // # modified; scale the CAD model of the  part to the prescribe domain size
     factor[1] = factor[0];
     factor[2] = factor[0];
     Scale (factor);
     // Get bound of the input models
     GetBound (bound);
     // Translate the input models
-    trans[0] = -bound[0];
-    trans[1] = -bound[2];
-    trans[2] = -bound[4];
+    trans[0] = -bound[0] + padding * dx; // # modified
+    trans[1] = -bound[2] + padding * dy; // # modified
+    trans[2] = -bound[4] + padding * dz; // # modified
     Translate (trans);
   }
 }
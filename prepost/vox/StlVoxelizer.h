@@ -157,10 +157,19 @@ class StlVoxelizer {
     /*
      * Bound adjust, scale and translate the vertices data
      * \param[out] background mesh info: element numbers and sizes
+     * \param[in] padding, number of empty elements kept around the geometry
      * \return
      */
     void ScaleAndTranslate (unsigned int nx, unsigned int ny, unsigned int nz,
-        float dx, float dy, float dz);
+        float dx, float dy, float dz, unsigned int padding = 0); // # modified
+
+    /*
+     * Bound of the vertices read so far, before scaling
+     * \param[out] bd(0,2,4)-min corner, bd(1,3,5)-max corner
+     */
+    void InputBound (float *bd) { // # new
+      GetBound (bd);
+    }
 
     /*
      * Clean the occupancy data and free memory
@@ -0,0 +1,212 @@
+#!/usr/bin/python
+#
+# Performance regression harness
+#
+# Runs a fixed set of small problems on the synthetic benchmark domain
+# (-benchmark) for a fixed number of iterations and compares them with
+# - the golden records in ./regression/golden, part of the repository: the
+#   fx/gx/ch trajectory has to match within the tolerances, i.e. the designs
+#   are unchanged. A case without a golden record is skipped and listed at
+#   the end, it neither passes nor fails.
+# - the timing baselines in ./regression/baseline, machine specific and not
+#   part of the repository: the mean time per phase (skipping the first
+#   iteration) must not exceed the baseline by more than the timing
+#   tolerance. A case without a baseline is not timed.
+#
+# One binary is built (make topopt), the cases choose the dimension and the
+# physics with -dim and -physics.
+# Record the baselines on the reference node with --update-timing, e.g.
+# before a performance change. --update records the golden trajectories as
+# well, only for a change that is meant to change the designs.
+#
+# Usage e.g.
+#   python regression.py                      # check all cases
+#   python regression.py --cases elasticity2d heat3d --no-timing
+#   python regression.py --update-timing      # record the timing baselines
+#   python regression.py --update             # record both
+#
+# The exit status is non-zero if any case fails.
+
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+
+# name, options of the case (dimension, physics, mesh in nodes), ranks
+CASES = [
+	("elasticity2d", ["-dim", "2", "-physics", "0", "-nx", "65", "-ny", "33"], 2),
+	("elasticity3d", ["-dim", "3", "-physics", "0", "-nx", "33", "-ny", "17", "-nz", "17"], 2),
+	("compliant2d", ["-dim", "2", "-physics", "1", "-nx", "65", "-ny", "33"], 2),
+	("compliant3d", ["-dim", "3", "-physics", "1", "-nx", "33", "-ny", "17", "-nz", "17"], 2),
+	("heat2d", ["-dim", "2", "-physics", "2", "-nx", "65", "-ny", "65"], 2),
+	("heat3d", ["-dim", "3", "-physics", "2", "-nx", "33", "-ny", "33", "-nz", "17"], 2),
+]
+
+PHASES = ["iteration", "physics", "assemble", "pcsetup", "kspsolve",
+          "sensitivity", "filterGradients", "mma", "filterProject"]
+
+
+def build(args):
+	binary = os.path.join(args.workdir, "topopt_regression")
+	if args.no_build and os.path.isfile(binary):
+		return binary
+	print("# Building topopt")
+	sys.stdout.flush()
+	with open(os.path.join(args.workdir, "build.log"), "w") as log:
+		ret = subprocess.call(["make", "topopt"], stdout=log,
+			stderr=subprocess.STDOUT)
+	if ret != 0 or not os.path.isfile("topopt"):
+		exit("Build of topopt failed, see " + log.name)
+	shutil.move("topopt", binary)
+	return binary
+
+
+def run(args, name, binary, mesh, np):
+	metricsFile = os.path.join(args.workdir, name + ".jsonl")
+	cmd = args.mpiexec.split() + ["-np", str(np), binary, "-benchmark",
+		"-restart", "false", "-maxItr", str(args.itr), "-nlvls", "3",
+		"-metricsFile", metricsFile] + mesh
+	print("# " + " ".join(cmd))
+	sys.stdout.flush()
+	with open(os.path.join(args.workdir, name + ".log"), "w") as log:
+		ret = subprocess.call(cmd, stdout=log, stderr=subprocess.STDOUT)
+	if ret != 0:
+		exit("Run of " + name + " failed, see " + log.name)
+
+	records = []
+	with open(metricsFile) as f:
+		for line in f:
+			if line.strip():
+				records.append(json.loads(line))
+
+	# Trajectory of every iteration, mean phase times without the warm up
+	timed = records[1:] if len(records) > 1 else records
+	times = {}
+	for p in PHASES:
+		times[p] = sum(r["time"].get(p, 0.0) for r in timed) / len(timed)
+	return {
+		"itr": args.itr,
+		"np": np,
+		"fx": [r["fx"] for r in records],
+		"gx": [r["gx"] for r in records],
+		"ch": [r["ch"] for r in records],
+	}, {
+		"itr": args.itr,
+		"np": np,
+		"time": times,
+	}
+
+
+def record(fileName, data):
+	with open(fileName, "w") as f:
+		json.dump(data, f, indent=1, sort_keys=True)
+		f.write("\n")
+
+
+def compare(args, golden, result):
+	failures = []
+	if len(golden["fx"]) != len(result["fx"]):
+		return ["%d iterations instead of %d" % (len(result["fx"]), len(golden["fx"]))]
+
+	for i in range(len(golden["fx"])):
+		fx0, fx = golden["fx"][i], result["fx"][i]
+		if abs(fx - fx0) > args.rtol * abs(fx0):
+			failures.append("fx at iteration %d: %.10e, golden %.10e" % (i + 1, fx, fx0))
+		for j in range(len(golden["gx"][i])):
+			gx0, gx = golden["gx"][i][j], result["gx"][i][j]
+			if abs(gx - gx0) > args.atol:
+				failures.append("gx[%d] at iteration %d: %.10e, golden %.10e" % (j, i + 1, gx, gx0))
+		ch0, ch = golden["ch"][i], result["ch"][i]
+		if abs(ch - ch0) > args.atol:
+			failures.append("ch at iteration %d: %.6e, golden %.6e" % (i + 1, ch, ch0))
+	return failures
+
+
+def compareTiming(args, baseline, timing):
+	failures = []
+	for p in PHASES:
+		t0, t = baseline["time"].get(p, 0.0), timing["time"][p]
+		# Phases below the floor are dominated by noise
+		if t0 > args.time_floor and t > t0 * (1.0 + args.time_tol):
+			failures.append("%s: %.4e s per iteration, baseline %.4e s (+%.0f%%)" % (p, t, t0, 100.0 * (t / t0 - 1.0)))
+	return failures
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Performance regression harness")
+	parser.add_argument("--cases", nargs="+", default=[c[0] for c in CASES])
+	parser.add_argument("--itr", type=int, default=10)
+	parser.add_argument("--update", action="store_true", help="record the golden records and the timing baselines")
+	parser.add_argument("--update-timing", action="store_true", help="record the timing baselines only")
+	parser.add_argument("--no-build", action="store_true", help="reuse the binaries of the last run")
+	parser.add_argument("--no-timing", action="store_true", help="compare the trajectories only")
+	parser.add_argument("--rtol", type=float, default=1e-6, help="relative tolerance of fx")
+	parser.add_argument("--atol", type=float, default=1e-6, help="absolute tolerance of gx and ch")
+	parser.add_argument("--time-tol", type=float, default=0.2, help="allowed relative slowdown per phase")
+	parser.add_argument("--time-floor", type=float, default=1e-3, help="phases faster than this (s) are not timed")
+	parser.add_argument("--mpiexec", default="mpiexec")
+	parser.add_argument("--workdir", default="./regression")
+	args = parser.parse_args()
+
+	goldenDir = os.path.join(args.workdir, "golden")
+	baselineDir = os.path.join(args.workdir, "baseline")
+	for d in [goldenDir, baselineDir]:
+		if not os.path.isdir(d):
+			os.makedirs(d)
+
+	failed = []
+	skipped = []
+	binary = build(args)
+	for name, mesh, np in CASES:
+		if name not in args.cases:
+			continue
+		goldenFile = os.path.join(goldenDir, name + ".json")
+		baselineFile = os.path.join(baselineDir, name + ".json")
+		if not (args.update or args.update_timing or os.path.isfile(goldenFile)):
+			print("# %-16s SKIPPED: no golden record %s, record it with make regression-update" % (name, goldenFile))
+			skipped.append(name)
+			continue
+		result, timing = run(args, name, binary, mesh, np)
+
+		if args.update or args.update_timing:
+			record(baselineFile, timing)
+			if args.update:
+				record(goldenFile, result)
+			print("# %-16s recorded %s" % (name, goldenFile + " " + baselineFile if args.update else baselineFile))
+			continue
+
+		with open(goldenFile) as f:
+			golden = json.load(f)
+		failures = compare(args, golden, result)
+
+		timed = ""
+		if args.no_timing:
+			timed = ", not timed"
+		elif not os.path.isfile(baselineFile):
+			timed = ", not timed: no baseline, run with --update-timing"
+		else:
+			with open(baselineFile) as f:
+				baseline = json.load(f)
+			failures += compareTiming(args, baseline, timing)
+			timed = " (iteration %.4e s, baseline %.4e s)" % (timing["time"]["iteration"], baseline["time"]["iteration"])
+
+		if failures:
+			print("# %-16s FAILED" % name)
+			for msg in failures:
+				print("#   " + msg)
+			failed.append(name)
+		else:
+			print("# %-16s passed%s" % (name, timed))
+
+	if skipped:
+		print("# Skipped without a golden record: " + " ".join(skipped))
+	if failed:
+		exit("Regression failed: " + " ".join(failed))
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,250 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * RobustDesign.cc
+ */
+
+#include "RobustDesign.h"
+
+#include <cstdlib>
+#include <vector>
+
+TOPOPT_NAMESPACE_BEGIN // # new
+
+RobustDesign::RobustDesign (TopOpt *opt) {
+  active = PETSC_FALSE;
+  mVol = opt->m;
+  m = opt->m;
+  gx = NULL;
+  dgdx = NULL;
+  gxWork = NULL;
+  dgWork = NULL;
+  for (PetscInt k = 0; k < nReal; ++k) {
+    xReal[k] = NULL;
+    dfReal[k] = NULL;
+    fx[k] = 0.0;
+  }
+
+  PetscBool flg;
+  PetscReal eta = 0.5, deltaEta = 0.2;
+  PetscOptionsGetBool (NULL, NULL, "-robust", &active, &flg);
+  if (!active) return;
+  PetscOptionsGetReal (NULL, NULL, "-robustEta", &eta, &flg);
+  PetscOptionsGetReal (NULL, NULL, "-robustDeltaEta", &deltaEta, &flg);
+  etaReal[0] = eta + deltaEta;
+  etaReal[1] = eta;
+  etaReal[2] = eta - deltaEta;
+
+  // The realizations are projections of the filtered densities
+  PetscBool amFilter;
+  PetscOptionsHasName (NULL, NULL, "-amBasePlate", &amFilter);
+  if (!opt->projectionFilter || opt->filter == 0 || amFilter) {
+    PetscPrintf (PETSC_COMM_WORLD,
+        "# -robust needs -projectionFilter 1 and -filter 1 or 2, without "
+            "-amBasePlate\n");
+    exit (0);
+  }
+  if (etaReal[2] <= 0.0 || etaReal[0] >= 1.0) {
+    PetscPrintf (PETSC_COMM_WORLD,
+        "# -robustEta +/- -robustDeltaEta must lie in (0, 1)\n");
+    exit (0);
+  }
+
+  xReal[intermediate] = opt->xPhys;
+  for (PetscInt k = 0; k < nReal; ++k) {
+    if (k != intermediate) {
+      VecDuplicate (opt->xPhys, &xReal[k]);
+      VecCopy (opt->xPhys, xReal[k]);
+    }
+    VecDuplicate (opt->xPhys, &dfReal[k]);
+  }
+  gxWork = new PetscScalar[mVol];
+  VecDuplicateVecs (opt->xPhys, mVol, &dgWork);
+
+  m = mVol + nReal;
+  gx = new PetscScalar[m];
+  dgdx = new Vec[m];
+  for (PetscInt j = 0; j < mVol; ++j) {
+    dgdx[j] = opt->dgdx[j];
+  }
+  for (PetscInt k = 0; k < nReal; ++k) {
+    dgdx[mVol + k] = dfReal[k];
+  }
+
+  // The objective and the volume constraints belong to the intermediate
+  // realization
+  dv.assign (1 + m, NULL);
+  real.assign (1 + m, intermediate);
+  dv[0] = opt->dfdx;
+  for (PetscInt j = 0; j < m; ++j) {
+    dv[1 + j] = dgdx[j];
+  }
+  for (PetscInt k = 0; k < nReal; ++k) {
+    real[1 + mVol + k] = k;
+  }
+
+  PetscPrintf (PETSC_COMM_WORLD,
+      "##############################################################\n");
+  PetscPrintf (PETSC_COMM_WORLD,
+      "# Robust formulation (-robust): eta eroded/intermediate/dilated "
+          "(-robustEta, -robustDeltaEta) %f/%f/%f, MMA m= %i\n", etaReal[0],
+      etaReal[1], etaReal[2], m);
+}
+
+RobustDesign::~RobustDesign () {
+  for (PetscInt k = 0; k < nReal; ++k) {
+    if (k != intermediate && xReal[k] != NULL) {
+      VecDestroy (&xReal[k]);
+    }
+    if (dfReal[k] != NULL) {
+      VecDestroy (&dfReal[k]);
+    }
+  }
+  if (dgWork != NULL) {
+    VecDestroyVecs (mVol, &dgWork);
+  }
+  if (gxWork != NULL) delete[] gxWork;
+  if (gx != NULL) delete[] gx;
+  if (dgdx != NULL) delete[] dgdx;
+}
+
+PetscErrorCode RobustDesign::AllocateMMA (TopOpt *opt, MMA **mma,
+    PetscInt itr) {
+  PetscErrorCode ierr = 0;
+  if (!active) return ierr;
+
+  // min z + sum(c_j y_j) s.t. f_j - a_j z - y_j <= 0, a_j = 1 for the
+  // realizations
+  std::vector<PetscScalar> a (m, 0.0), c (m, 1000.0), d (m, 0.0);
+  for (PetscInt k = 0; k < nReal; ++k) {
+    a[mVol + k] = 1.0;
+  }
+
+  MMA *robustMMA;
+  if (itr >= 3) {
+    Vec xo1, xo2, U, L;
+    VecDuplicate (opt->x, &xo1);
+    VecDuplicate (opt->x, &xo2);
+    VecDuplicate (opt->x, &U);
+    VecDuplicate (opt->x, &L);
+    ierr = (*mma)->Restart (xo1, xo2, U, L);
+    CHKERRQ(ierr);
+    robustMMA = new MMA (opt->n, m, itr, xo1, xo2, U, L, a.data (),
+        c.data (), d.data ());
+    VecDestroy (&xo1);
+    VecDestroy (&xo2);
+    VecDestroy (&U);
+    VecDestroy (&L);
+  } else {
+    robustMMA = new MMA (opt->n, m, opt->x, a.data (), c.data (), d.data ());
+  }
+  delete *mma;
+  *mma = robustMMA;
+
+  return ierr;
+}
+
+PetscErrorCode RobustDesign::FilterProject (TopOpt *opt, Filter *filter) {
+  PetscErrorCode ierr = 0;
+  if (!active) {
+    ierr = filter->FilterProject (opt->x, opt->xTilde, opt->xPhys,
+        opt->projectionFilter, opt->beta, opt->eta);
+    CHKERRQ(ierr);
+    return ierr;
+  }
+  ierr = filter->FilterProjectRobust (opt->x, opt->xTilde, nReal, xReal,
+      etaReal, opt->beta);
+  CHKERRQ(ierr);
+  return ierr;
+}
+
+PetscErrorCode RobustDesign::Collect (TopOpt *opt) {
+  PetscErrorCode ierr = 0;
+  if (!active) return ierr;
+
+  opt->fx = fx[0];
+  for (PetscInt k = 1; k < nReal; ++k) {
+    opt->fx = PetscMax(opt->fx, fx[k]);
+  }
+
+  // The physics marks the non-design elements in the objective
+  // sensitivities, which go to the objective z of the bound formulation
+  PetscScalar *df, *xPassive0p, *dr[nReal];
+  PetscInt nel;
+  VecGetLocalSize (opt->dfdx, &nel);
+  VecGetArray (opt->dfdx, &df);
+  VecGetArray (opt->xPassive0, &xPassive0p);
+  for (PetscInt k = 0; k < nReal; ++k) {
+    VecGetArray (dfReal[k], &dr[k]);
+  }
+  for (PetscInt i = 0; i < nel; i++) {
+    if (xPassive0p[i] != 0) {
+      df[i] = 0.0;
+      continue;
+    }
+    df[i] = dr[intermediate][i];
+    for (PetscInt k = 0; k < nReal; ++k) {
+      dr[k][i] = 0.0;
+    }
+  }
+  for (PetscInt k = 0; k < nReal; ++k) {
+    VecRestoreArray (dfReal[k], &dr[k]);
+  }
+  VecRestoreArray (opt->xPassive0, &xPassive0p);
+  VecRestoreArray (opt->dfdx, &df);
+
+  return ierr;
+}
+
+PetscErrorCode RobustDesign::Gradients (TopOpt *opt, Filter *filter) {
+  PetscErrorCode ierr = 0;
+  if (!active) {
+    ierr = filter->Gradients (opt->x, opt->xTilde, opt->dfdx, opt->m,
+        opt->dgdx, opt->projectionFilter, opt->beta, opt->eta);
+    CHKERRQ(ierr);
+    return ierr;
+  }
+
+  for (PetscInt j = 0; j < mVol; ++j) {
+    gx[j] = opt->gx[j];
+  }
+  for (PetscInt k = 0; k < nReal; ++k) {
+    gx[mVol + k] = opt->fscale * fx[k];
+    ierr = VecScale (dfReal[k], opt->fscale);
+    CHKERRQ(ierr);
+  }
+
+  ierr = filter->GradientsRobust (opt->x, opt->xTilde, 1 + m, dv.data (),
+      real.data (), nReal, etaReal, opt->beta);
+  CHKERRQ(ierr);
+
+  return ierr;
+}
+
+PetscErrorCode RobustDesign::AccountMemory (MemoryReport *mem) {
+  PetscErrorCode ierr = 0;
+  if (!active) return ierr;
+  mem->Add ("Robust realizations",
+      MemoryReport::VecBytes (xReal[0]) + MemoryReport::VecBytes (xReal[2])
+      + MemoryReport::VecsBytes (dfReal, nReal)
+      + MemoryReport::VecsBytes (dgWork, mVol));
+  return ierr;
+}
+
+TOPOPT_NAMESPACE_END // # new
@@ -0,0 +1,142 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * RobustDesign.h
+ */
+
+#ifndef ROBUSTDESIGN_H_
+#define ROBUSTDESIGN_H_
+
+#include <petsc.h>
+#include <vector>
+
+#include "Filter.h"
+#include "MMA.h"
+#include "TopOpt.h"
+#include "memoryreport.h"
+
+TOPOPT_NAMESPACE_BEGIN // # new
+
+/*
+ * Robust formulation (Wang, Lazarov and Sigmund 2011): the filtered field
+ * is projected with three thresholds into the eroded, intermediate
+ * (blueprint, xPhys) and dilated realizations, and the worst objective of
+ * the three is minimized. MMA gets the bound formulation: the objective z
+ * and one constraint fscale * f_k - z <= 0 per realization k, next to the
+ * volume constraints of the intermediate realization.
+ *
+ * The physics solves the realizations as one batch (see main.cc): the
+ * intermediate one sets up the preconditioner, the eroded and dilated ones
+ * reuse it and start from the last state.
+ *
+ * Options:
+ * -robust <bool>         robust formulation, needs -projectionFilter and
+ *                        the density or PDE filter (default false)
+ * -robustEta <real>      threshold of the intermediate realization
+ *                        (default 0.5)
+ * -robustDeltaEta <real> the eroded and dilated thresholds are
+ *                        -robustEta +/- -robustDeltaEta (default 0.2)
+ */
+class RobustDesign {
+  public:
+    static const PetscInt nReal = 3; // eroded, intermediate, dilated
+    static const PetscInt intermediate = 1;
+
+    /*
+     * Constructor, reads the options and allocates the realizations
+     * \param[in] TopOpt of the current grid
+     */
+    RobustDesign (TopOpt *opt);
+
+    /*
+     * Destructor
+     */
+    ~RobustDesign ();
+
+    /*
+     * The robust formulation is on
+     */
+    PetscBool Active () const {
+      return active;
+    }
+
+    /*
+     * Replace the optimizer by one of the bound formulation, keeping the
+     * history of the current one from iteration 3 on
+     * \param[in] TopOpt of the current grid
+     * \param[in,out] optimizer
+     * \param[in] current iteration
+     * \return PetscErrorCode
+     */
+    PetscErrorCode AllocateMMA (TopOpt *opt, MMA **mma, PetscInt itr);
+
+    /*
+     * Filter and project opt->x into the realizations, or the plain
+     * FilterProject of the filter without the robust formulation
+     */
+    PetscErrorCode FilterProject (TopOpt *opt, Filter *filter);
+
+    /*
+     * After the physics of all the realizations: the worst objective to
+     * opt->fx, the passive element sensitivities of the intermediate
+     * realization to opt->dfdx
+     */
+    PetscErrorCode Collect (TopOpt *opt);
+
+    /*
+     * After the scaling of the objective: the constraints of the bound
+     * formulation and the chainrule of all the sensitivities, or the plain
+     * Gradients of the filter without the robust formulation
+     */
+    PetscErrorCode Gradients (TopOpt *opt, Filter *filter);
+
+    /*
+     * Add the bytes of the realizations to the memory report
+     */
+    PetscErrorCode AccountMemory (MemoryReport *mem);
+
+    // Realizations, the intermediate one is opt->xPhys
+    Vec xReal[nReal];
+    PetscReal etaReal[nReal];
+
+    // Physics output per realization: objective and its sensitivities; the
+    // volume constraints of the eroded and dilated realizations (unused)
+    PetscScalar fx[nReal];
+    Vec dfReal[nReal];
+    PetscScalar *gxWork;
+    Vec *dgWork;
+
+    // MMA constraints: the volume constraints of opt, then one per
+    // realization (dgdx aliases opt->dgdx and dfReal)
+    PetscInt m;
+    PetscScalar *gx;
+    Vec *dgdx;
+
+  private:
+    PetscBool active;
+    PetscInt mVol; // volume constraints of opt
+
+    // Sensitivities of the chainrule and their realizations, set up once
+    std::vector<Vec> dv;
+    std::vector<PetscInt> real;
+};
+
+TOPOPT_NAMESPACE_END // # new
+
+#endif /* ROBUSTDESIGN_H_ */
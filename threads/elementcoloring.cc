@@ -0,0 +1,112 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * elementcoloring.cc
+ */
+
+#include "elementcoloring.h"
+
+// Set by ThreadsSetUp, 0 before
+static PetscInt numThreads = 0;
+
+PetscErrorCode ThreadsSetUp () {
+  PetscErrorCode ierr = 0;
+#ifdef _OPENMP
+  PetscInt n = omp_get_max_threads ();
+  PetscBool flg;
+  PetscOptionsGetInt (NULL, NULL, "-numThreads", &n, &flg);
+  if (n < 1) n = 1;
+  omp_set_num_threads (n);
+  numThreads = n;
+#else
+  numThreads = 1;
+#endif
+  PetscMPIInt size;
+  MPI_Comm_size (PETSC_COMM_WORLD, &size);
+  PetscPrintf (PETSC_COMM_WORLD,
+      "# Element loops: %i MPI ranks x %i threads (-numThreads)\n", size,
+      numThreads);
+  return ierr;
+}
+
+PetscInt NumThreads () {
+  if (numThreads > 0) return numThreads;
+#ifdef _OPENMP
+  // Without ThreadsSetUp, e.g. in microbench: the default team
+  return omp_get_max_threads ();
+#else
+  return 1;
+#endif
+}
+
+ElementColoring::ElementColoring () {
+  offsets.assign (1, 0);
+}
+
+void ElementColoring::SetUp (PetscInt nel, PetscInt nen,
+    const PetscInt *necon) {
+  elements.resize (nel);
+  if (NumThreads () == 1) {
+    offsets.assign (2, 0);
+    offsets[1] = nel;
+    for (PetscInt i = 0; i < nel; ++i) {
+      elements[i] = i;
+    }
+    return;
+  }
+
+  // Greedy: the lowest color none of the element's nodes has seen yet. A
+  // Q1 element has at most 3^DIM - 1 neighbours, so 64 colors always do
+  PetscInt nNodes = 0;
+  for (PetscInt i = 0; i < nel * nen; ++i) {
+    nNodes = PetscMax(nNodes, necon[i] + 1);
+  }
+  std::vector<unsigned long long> seen (nNodes, 0);
+  std::vector<PetscInt> color (nel);
+  PetscInt nColors = 0;
+  for (PetscInt i = 0; i < nel; ++i) {
+    const PetscInt *en = &necon[i * nen];
+    unsigned long long used = 0;
+    for (PetscInt j = 0; j < nen; ++j) {
+      used |= seen[en[j]];
+    }
+    PetscInt c = 0;
+    while (used & (1ULL << c)) {
+      ++c;
+    }
+    for (PetscInt j = 0; j < nen; ++j) {
+      seen[en[j]] |= 1ULL << c;
+    }
+    color[i] = c;
+    nColors = PetscMax(nColors, c + 1);
+  }
+
+  // Elements sorted by color, in mesh order within a color
+  offsets.assign (nColors + 1, 0);
+  for (PetscInt i = 0; i < nel; ++i) {
+    offsets[color[i] + 1]++;
+  }
+  for (PetscInt c = 0; c < nColors; ++c) {
+    offsets[c + 1] += offsets[c];
+  }
+  std::vector<PetscInt> next (offsets.begin (), offsets.end () - 1);
+  for (PetscInt i = 0; i < nel; ++i) {
+    elements[next[color[i]]++] = i;
+  }
+}
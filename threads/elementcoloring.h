@@ -0,0 +1,104 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * elementcoloring.h
+ */
+
+#ifndef ELEMENTCOLORING_H_
+#define ELEMENTCOLORING_H_
+
+#include <petsc.h>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// OpenMP pragma of the element loops, e.g. TOPOPT_OMP(parallel for); nothing
+// without OpenMP, so the serial build has no unknown pragmas
+#define TOPOPT_OMP_STR(...) #__VA_ARGS__
+#ifdef _OPENMP
+#define TOPOPT_OMP(...) _Pragma(TOPOPT_OMP_STR(omp __VA_ARGS__))
+#else
+#define TOPOPT_OMP(...)
+#endif
+
+/*
+ * Threads of the element loops of every rank, for fewer MPI ranks per node
+ * with several threads each. Built with TOPOPT_OPENMP=1 (makefile), the
+ * threads are OMP_NUM_THREADS unless -numThreads is given to ThreadsSetUp.
+ * Before ThreadsSetUp, NumThreads is the default OpenMP team, so an element
+ * coloring is never set up for fewer threads than the loops run with.
+ *
+ * Options:
+ * -numThreads <int>  threads of the element loops (default OMP_NUM_THREADS)
+ *
+ * Without OpenMP there is 1 thread.
+ */
+PetscErrorCode ThreadsSetUp ();
+PetscInt NumThreads ();
+
+/*
+ * Coloring of the local elements for the threaded element loops that add
+ * into nodal arrays: the elements of a color share no node, so the threads
+ * of one color scatter-add into the ghosted arrays without conflicts, e.g.
+ *
+ *   for (PetscInt c = 0; c < coloring.Colors (); ++c) {
+ *     const PetscInt *elements = coloring.Elements (c);
+ *     TOPOPT_OMP(parallel for)
+ *     for (PetscInt e = 0; e < coloring.Size (c); ++e) { ... }
+ *   }
+ *
+ * The colors are greedy over the connectivity, 4 on the 2D and 8 on the 3D
+ * structured mesh. With 1 thread there is a single color of all the
+ * elements in mesh order, so the serial sums are unchanged.
+ */
+class ElementColoring {
+  public:
+
+    ElementColoring ();
+
+    /*
+     * Color the elements
+     * \param[in] local elements, nodes per element and the connectivity of
+     * DMDAGetElements (local node numbers)
+     */
+    void SetUp (PetscInt nel, PetscInt nen, const PetscInt *necon);
+
+    PetscInt Colors () const {
+      return (PetscInt) offsets.size () - 1;
+    }
+
+    // Elements of color c
+    PetscInt Size (PetscInt c) const {
+      return offsets[c + 1] - offsets[c];
+    }
+    const PetscInt *Elements (PetscInt c) const {
+      return elements.data () + offsets[c];
+    }
+
+    PetscLogDouble Bytes () const {
+      return (offsets.capacity () + elements.capacity ()) * sizeof(PetscInt);
+    }
+
+  private:
+    std::vector<PetscInt> offsets, elements;
+};
+
+#endif /* ELEMENTCOLORING_H_ */
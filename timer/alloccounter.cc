@@ -0,0 +1,136 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * alloccounter.cc
+ */
+
+#include "alloccounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<unsigned long> heapAllocations (0);
+static std::atomic<unsigned long> petscAllocations (0);
+
+// The global operator new of the program, counting each allocation
+void *operator new (std::size_t size) {
+  heapAllocations.fetch_add (1, std::memory_order_relaxed);
+  void *p = std::malloc (size > 0 ? size : 1);
+  if (p == NULL) throw std::bad_alloc ();
+  return p;
+}
+
+void *operator new[] (std::size_t size) {
+  heapAllocations.fetch_add (1, std::memory_order_relaxed);
+  void *p = std::malloc (size > 0 ? size : 1);
+  if (p == NULL) throw std::bad_alloc ();
+  return p;
+}
+
+void operator delete (void *p) noexcept {
+  std::free (p);
+}
+
+void operator delete[] (void *p) noexcept {
+  std::free (p);
+}
+
+// The allocator of PETSc before -allocCheck wrapped it, e.g. the tracing one
+// of -malloc_debug
+static PetscErrorCode (*petscMalloc) (size_t, int, const char[],
+    const char[], void**) = NULL;
+static PetscErrorCode (*petscFree) (void*, int, const char[],
+    const char[]) = NULL;
+
+static PetscErrorCode CountingMalloc (size_t size, int line,
+    const char function[], const char file[], void **result) {
+  petscAllocations.fetch_add (1, std::memory_order_relaxed);
+  return petscMalloc (size, line, function, file, result);
+}
+
+static PetscErrorCode CountingFree (void *p, int line, const char function[],
+    const char file[]) {
+  return petscFree (p, line, function, file);
+}
+
+AllocationCounter &AllocationCounter::Instance () {
+  static AllocationCounter counter;
+  return counter;
+}
+
+AllocationCounter::AllocationCounter () {
+  active = PETSC_FALSE;
+  warmup = 0;
+  heap0 = 0;
+  petsc0 = 0;
+}
+
+PetscErrorCode AllocationCounter::SetUp () {
+  PetscErrorCode ierr = 0;
+  PetscBool flg;
+  PetscOptionsGetInt (NULL, NULL, "-allocCheck", &warmup, &flg);
+  if (!flg || active) return ierr;
+  active = PETSC_TRUE;
+
+  // Chain to the current allocator, the frees of its earlier allocations go
+  // to it as well
+  petscMalloc = PetscTrMalloc;
+  petscFree = PetscTrFree;
+  ierr = PetscMallocClear ();
+  CHKERRQ(ierr);
+  ierr = PetscMallocSet (CountingMalloc, CountingFree);
+  CHKERRQ(ierr);
+
+  PetscPrintf (PETSC_COMM_WORLD,
+      "# Allocation check (-allocCheck): no allocations from iteration %i on\n",
+      warmup);
+  return ierr;
+}
+
+void AllocationCounter::BeginIteration () {
+  heap0 = HeapCount ();
+  petsc0 = PetscCount ();
+}
+
+PetscErrorCode AllocationCounter::EndIteration (PetscInt itr,
+    MPI_Comm comm) {
+  PetscErrorCode ierr = 0;
+  if (!active) return ierr;
+
+  unsigned long loc[2] = { HeapCount () - heap0, PetscCount () - petsc0 };
+  unsigned long max[2];
+  ierr = MPI_Allreduce (loc, max, 2, MPI_UNSIGNED_LONG, MPI_MAX, comm);
+  CHKERRQ(ierr);
+  PetscPrintf (comm, "Allocations: heap %lu, PETSc %lu\n", max[0], max[1]);
+  if (itr >= warmup && max[0] + max[1] > 0) {
+    SETERRQ3(comm, PETSC_ERR_PLIB,
+        "%lu allocations in iteration %D after the warm-up of -allocCheck %D",
+        max[0] + max[1], itr, warmup);
+  }
+  return ierr;
+}
+
+unsigned long AllocationCounter::HeapCount () {
+  return heapAllocations.load (std::memory_order_relaxed);
+}
+
+unsigned long AllocationCounter::PetscCount () {
+  return petscAllocations.load (std::memory_order_relaxed);
+}
@@ -0,0 +1,90 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * alloccounter.h
+ */
+
+#ifndef ALLOCCOUNTER_H_
+#define ALLOCCOUNTER_H_
+
+#include <petsc.h>
+
+/*
+ * Heap allocations of the optimization loop: the C++ operator new/new[] of
+ * the whole program (replaced in alloccounter.cc, always counted) and the
+ * PetscMalloc calls of PETSc and the framework (counted with -allocCheck
+ * only, by wrapping the PETSc allocator). The steady-state iterations are
+ * meant to run on the work vectors and scratch arrays set up by the first
+ * ones, so after the warm-up every new allocation is a regression.
+ *
+ * Options:
+ * -allocCheck <n>  print the allocations of each iteration (max over the
+ *                  ranks) and fail from iteration n on if there are any; the
+ *                  output, restart and metrics files of an iteration are not
+ *                  counted (default off)
+ */
+class AllocationCounter {
+  public:
+
+    /*
+     * The process-wide counter
+     */
+    static AllocationCounter &Instance ();
+
+    /*
+     * Read the option and wrap the PETSc allocator, after PetscInitialize
+     * \return PetscErrorCode
+     */
+    PetscErrorCode SetUp ();
+
+    /*
+     * -allocCheck is on
+     */
+    PetscBool Active () const {
+      return active;
+    }
+
+    /*
+     * Start counting the allocations of an iteration
+     */
+    void BeginIteration ();
+
+    /*
+     * Print the allocations since BeginIteration and fail after the warm-up
+     * if there are any
+     * \param[in] iteration
+     * \param[in] communicator
+     * \return PetscErrorCode
+     */
+    PetscErrorCode EndIteration (PetscInt itr, MPI_Comm comm);
+
+    /*
+     * Allocations of this rank since the start of the run
+     */
+    static unsigned long HeapCount ();
+    static unsigned long PetscCount ();
+
+  private:
+    AllocationCounter ();
+    PetscBool active;
+    PetscInt warmup;
+    unsigned long heap0, petsc0;
+};
+
+#endif /* ALLOCCOUNTER_H_ */
@@ -0,0 +1,146 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * imbalance.cc
+ */
+
+#include "imbalance.h"
+#include "scopedtimer.h"
+
+#include <vector>
+
+static PetscBool ImbalanceActive () {
+  PetscBool active = PETSC_FALSE, flg;
+  PetscOptionsGetBool (NULL, NULL, "-imbalance", &active, &flg);
+  return active;
+}
+
+PetscErrorCode ImbalanceWait (MPI_Comm comm) {
+  PetscErrorCode ierr = 0;
+  static PetscBool active = ImbalanceActive ();
+  if (!active) return ierr;
+  ScopedTimer waitTimer ("Wait");
+  ierr = MPI_Barrier (comm);
+  CHKERRQ(ierr);
+  return ierr;
+}
+
+ImbalanceReport::ImbalanceReport () {
+  active = ImbalanceActive ();
+  nDesign = 0;
+  nSolid = 0;
+  nVoid = 0;
+}
+
+PetscErrorCode ImbalanceReport::CountElements (Vec xPassive0, Vec xPassive1,
+    Vec xPassive2, Vec xPassive3) {
+  PetscErrorCode ierr = 0;
+  if (!active) return ierr;
+
+  // Same classification as the sensitivity loops of the physics
+  PetscScalar *xPassive0p, *xPassive1p, *xPassive2p, *xPassive3p;
+  PetscInt nel;
+  VecGetLocalSize (xPassive0, &nel);
+  VecGetArray (xPassive0, &xPassive0p);
+  VecGetArray (xPassive1, &xPassive1p);
+  VecGetArray (xPassive2, &xPassive2p);
+  VecGetArray (xPassive3, &xPassive3p);
+  nDesign = 0;
+  nSolid = 0;
+  nVoid = 0;
+  for (PetscInt i = 0; i < nel; i++) {
+    if (xPassive0p[i] != 0) {
+      nDesign++;
+    } else if (xPassive1p[i] != 0 || xPassive2p[i] != 0
+               || xPassive3p[i] != 0) {
+      nSolid++;
+    } else {
+      nVoid++;
+    }
+  }
+  VecRestoreArray (xPassive0, &xPassive0p);
+  VecRestoreArray (xPassive1, &xPassive1p);
+  VecRestoreArray (xPassive2, &xPassive2p);
+  VecRestoreArray (xPassive3, &xPassive3p);
+
+  return ierr;
+}
+
+PetscErrorCode ImbalanceReport::Report (MPI_Comm comm) {
+  PetscErrorCode ierr = 0;
+  if (!active) return ierr;
+
+  PetscMPIInt rank, size;
+  MPI_Comm_rank (comm, &rank);
+  MPI_Comm_size (comm, &size);
+
+  // Per rank: design, solid, void, assembly, sensitivity and wait
+  const PetscInt nq = 6;
+  TimerRegistry &registry = TimerRegistry::Instance ();
+  double loc[nq] = { (double) nDesign, (double) nSolid, (double) nVoid,
+      registry.GetTotalByName ("Assemble"),
+      registry.GetTotalByName ("Sensitivity"),
+      registry.GetTotalByName ("Wait") };
+  std::vector<double> all (rank == 0 ? nq * size : 0);
+  ierr = MPI_Gather (loc, nq, MPI_DOUBLE, all.data (), nq, MPI_DOUBLE, 0,
+      comm);
+  CHKERRQ(ierr);
+
+  if (rank == 0) {
+    PetscPrintf (PETSC_COMM_SELF,
+        "######################## Load imbalance ########################\n");
+    PetscPrintf (PETSC_COMM_SELF, "# %6s %10s %10s %10s %12s %12s %12s\n",
+        "rank", "design", "solid", "void", "assemble (s)", "sens. (s)",
+        "wait (s)");
+    double qmax[nq], qsum[nq];
+    double activeMax = 0.0, activeSum = 0.0, loopMax = 0.0, loopSum = 0.0;
+    for (PetscInt j = 0; j < nq; ++j) {
+      qmax[j] = 0.0;
+      qsum[j] = 0.0;
+    }
+    for (PetscMPIInt r = 0; r < size; ++r) {
+      double *q = &all[r * nq];
+      PetscPrintf (PETSC_COMM_SELF,
+          "# %6i %10.0f %10.0f %10.0f %12.4e %12.4e %12.4e\n", r, q[0], q[1],
+          q[2], q[3], q[4], q[5]);
+      for (PetscInt j = 0; j < nq; ++j) {
+        qmax[j] = PetscMax(qmax[j], q[j]);
+        qsum[j] += q[j];
+      }
+      activeMax = PetscMax(activeMax, q[0] + q[1]);
+      activeSum += q[0] + q[1];
+      loopMax = PetscMax(loopMax, q[3] + q[4]);
+      loopSum += q[3] + q[4];
+    }
+
+    // max/mean: 1 is perfect balance, the time lost is (max - mean)
+    PetscPrintf (PETSC_COMM_SELF, "# Imbalance (max/mean): active elements "
+        "%.3f, design elements %.3f, element loops %.3f\n",
+        activeSum > 0.0 ? activeMax * size / activeSum : 1.0,
+        qsum[0] > 0.0 ? qmax[0] * size / qsum[0] : 1.0,
+        loopSum > 0.0 ? loopMax * size / loopSum : 1.0);
+    PetscPrintf (PETSC_COMM_SELF,
+        "# Wait at the barriers: mean %.4e s, max %.4e s\n", qsum[5] / size,
+        qmax[5]);
+    PetscPrintf (PETSC_COMM_SELF,
+        "################################################################\n");
+  }
+
+  return ierr;
+}
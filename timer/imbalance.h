@@ -0,0 +1,74 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * imbalance.h
+ */
+
+#ifndef IMBALANCE_H_
+#define IMBALANCE_H_
+
+#include <petsc.h>
+
+/*
+ * Barrier timed as a "Wait" region under the open region, i.e. the time
+ * this rank waits for the slowest one before the next collective. Does
+ * nothing without -imbalance, so the production runs are not synchronized.
+ * \param[in] communicator
+ * \return PetscErrorCode
+ */
+PetscErrorCode ImbalanceWait (MPI_Comm comm);
+
+/*
+ * Load-imbalance diagnostics of the domain partition: per rank the design,
+ * solid (solid, fixture and load) and void element counts, the time of the
+ * element loops (assembly and sensitivities) and the time waited at the
+ * barriers of ImbalanceWait, with the max/mean imbalance factors.
+ *
+ * Options:
+ * -imbalance <bool>  time the waits and print the report (default false)
+ */
+class ImbalanceReport {
+  public:
+
+    /*
+     * Constructor, reads the option
+     */
+    ImbalanceReport ();
+
+    /*
+     * Classify the local elements by the passive element vectors
+     * \param[in] passive element vectors of TopOpt
+     * \return PetscErrorCode
+     */
+    PetscErrorCode CountElements (Vec xPassive0, Vec xPassive1,
+        Vec xPassive2, Vec xPassive3);
+
+    /*
+     * Print the per-rank table and the imbalance factors
+     * \param[in] communicator
+     * \return PetscErrorCode
+     */
+    PetscErrorCode Report (MPI_Comm comm);
+
+  private:
+    PetscBool active;
+    PetscInt nDesign, nSolid, nVoid;
+};
+
+#endif /* IMBALANCE_H_ */
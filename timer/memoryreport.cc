@@ -0,0 +1,165 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * memoryreport.cc
+ */
+
+#include "memoryreport.h"
+
+#include <cstdio>
+#include <sys/resource.h>
+#include <unistd.h>
+
+double PeakRSSMegaBytes () {
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0; // kB on Linux
+}
+
+double CurrentRSSMegaBytes () {
+  // Second field of statm, in pages
+  long pages = 0;
+  FILE *fp = fopen ("/proc/self/statm", "r");
+  if (fp == NULL) return 0.0;
+  if (fscanf (fp, "%*s %ld", &pages) != 1) pages = 0;
+  fclose (fp);
+  return pages * (sysconf (_SC_PAGESIZE) / 1048576.0);
+}
+
+void MemoryReport::Add (const char *owner, PetscLogDouble b) {
+  for (size_t i = 0; i < owners.size (); ++i) {
+    if (owners[i] == owner) {
+      bytes[i] += b;
+      return;
+    }
+  }
+  owners.push_back (owner);
+  bytes.push_back (b);
+}
+
+PetscErrorCode MemoryReport::Report (MPI_Comm comm, const char *title) {
+  PetscErrorCode ierr = 0;
+
+  PetscMPIInt size;
+  MPI_Comm_size (comm, &size);
+
+  // Owners, total and the current and peak RSS are reduced at once
+  PetscInt n = owners.size ();
+  std::vector<double> loc (n + 3), bmin (n + 3), bmax (n + 3), bsum (n + 3);
+  double total = 0.0;
+  for (PetscInt i = 0; i < n; ++i) {
+    loc[i] = bytes[i] / 1048576.0;
+    total += loc[i];
+  }
+  loc[n] = total;
+  loc[n + 1] = CurrentRSSMegaBytes ();
+  loc[n + 2] = PeakRSSMegaBytes ();
+  ierr = MPI_Allreduce (loc.data (), bmin.data (), n + 3, MPI_DOUBLE, MPI_MIN,
+      comm);
+  CHKERRQ(ierr);
+  ierr = MPI_Allreduce (loc.data (), bmax.data (), n + 3, MPI_DOUBLE, MPI_MAX,
+      comm);
+  CHKERRQ(ierr);
+  ierr = MPI_Allreduce (loc.data (), bsum.data (), n + 3, MPI_DOUBLE, MPI_SUM,
+      comm);
+  CHKERRQ(ierr);
+
+  PetscPrintf (comm, "######################## Memory: %s ########################\n",
+      title);
+  PetscPrintf (comm, "# %-32s %10s %10s %10s %8s\n", "Owner", "min (MB)",
+      "max (MB)", "sum (MB)", "max/mean");
+  const char *rows[] = { "Total accounted", "RSS current", "RSS peak" };
+  for (PetscInt i = 0; i < n + 3; ++i) {
+    double mean = bsum[i] / size;
+    PetscPrintf (comm, "# %-32s %10.2f %10.2f %10.2f %8.3f\n",
+        i < n ? owners[i].c_str () : rows[i - n], bmin[i], bmax[i], bsum[i],
+        mean > 0.0 ? bmax[i] / mean : 1.0);
+  }
+  PetscPrintf (comm,
+      "################################################################\n");
+
+  owners.clear ();
+  bytes.clear ();
+  return ierr;
+}
+
+PetscLogDouble MemoryReport::VecBytes (Vec v) {
+  if (v == NULL) return 0.0;
+  PetscInt nloc;
+  VecGetLocalSize (v, &nloc);
+  return nloc * (PetscLogDouble) sizeof(PetscScalar);
+}
+
+PetscLogDouble MemoryReport::VecsBytes (Vec *v, PetscInt n) {
+  if (v == NULL) return 0.0;
+  PetscLogDouble b = 0.0;
+  for (PetscInt i = 0; i < n; ++i) {
+    b += VecBytes (v[i]);
+  }
+  return b;
+}
+
+PetscLogDouble MemoryReport::MatBytes (Mat A) {
+  if (A == NULL) return 0.0;
+  // Matrix-free operators store no entries
+  PetscBool isShell;
+  PetscObjectTypeCompare ((PetscObject) A, MATSHELL, &isShell);
+  if (isShell) return 0.0;
+  MatInfo info;
+  PetscInt mloc, nloc;
+  MatGetInfo (A, MAT_LOCAL, &info);
+  MatGetLocalSize (A, &mloc, &nloc);
+  return info.nz_allocated * (sizeof(PetscScalar) + sizeof(PetscInt))
+         + (mloc + 1) * (PetscLogDouble) sizeof(PetscInt);
+}
+
+PetscLogDouble MemoryReport::MGBytes (KSP ksp) {
+  if (ksp == NULL) return 0.0;
+  PC pc;
+  PetscBool isMG;
+  KSPGetPC (ksp, &pc);
+  PetscObjectTypeCompare ((PetscObject) pc, PCMG, &isMG);
+  if (!isMG) return 0.0;
+
+  PetscInt nlvls;
+  PCMGGetLevels (pc, &nlvls);
+  PetscLogDouble b = 0.0;
+  for (PetscInt k = 0; k < nlvls; ++k) {
+    // The Galerkin coarse operators exist after the first PCSetUp
+    if (k < nlvls - 1) {
+      KSP smoother;
+      PC spc;
+      PetscBool set;
+      PCMGGetSmoother (pc, k, &smoother);
+      KSPGetPC (smoother, &spc);
+      PCGetOperatorsSet (spc, &set, NULL);
+      if (set) {
+        Mat A;
+        KSPGetOperators (smoother, &A, NULL);
+        b += MatBytes (A);
+      }
+    }
+    if (k > 0) {
+      Mat R;
+      PCMGGetInterpolation (pc, k, &R);
+      b += MatBytes (R);
+    }
+  }
+  return b;
+}
@@ -0,0 +1,82 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * memoryreport.h
+ */
+
+#ifndef MEMORYREPORT_H_
+#define MEMORYREPORT_H_
+
+#include <string>
+#include <vector>
+#include <petsc.h>
+
+/*
+ * Peak resident set size of the calling process in MB
+ */
+double PeakRSSMegaBytes ();
+
+/*
+ * Current resident set size of the calling process in MB
+ */
+double CurrentRSSMegaBytes ();
+
+/*
+ * Memory held by the major data structures, broken down by owner. The owners
+ * add their bytes on this rank (see the AccountMemory methods of the
+ * classes), and the report prints the min/max/sum over the ranks together
+ * with the current and peak RSS.
+ */
+class MemoryReport {
+  public:
+
+    /*
+     * Add bytes held by an owner on this rank, accumulated by name
+     */
+    void Add (const char *owner, PetscLogDouble bytes);
+
+    /*
+     * Print the per-rank summary of all owners and clear them
+     * \param[in] communicator of all ranks holding the owners
+     * \param[in] title of the report, e.g. the phase
+     * \return PetscErrorCode
+     */
+    PetscErrorCode Report (MPI_Comm comm, const char *title);
+
+    /*
+     * Local bytes of the values of a vector, of an array of vectors and of the
+     * values and indices of an AIJ matrix; NULL objects hold nothing
+     */
+    static PetscLogDouble VecBytes (Vec v);
+    static PetscLogDouble VecsBytes (Vec *v, PetscInt n);
+    static PetscLogDouble MatBytes (Mat A);
+
+    /*
+     * Local bytes of the coarse operators and interpolations of a multigrid
+     * preconditioner, without the fine operator. Operators which are not set
+     * up yet hold nothing.
+     */
+    static PetscLogDouble MGBytes (KSP ksp);
+
+  private:
+    std::vector<std::string> owners;
+    std::vector<PetscLogDouble> bytes;
+};
+
+#endif /* MEMORYREPORT_H_ */
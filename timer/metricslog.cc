@@ -0,0 +1,138 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * metricslog.cc
+ */
+
+#include "metricslog.h"
+#include "memoryreport.h"
+#include "scopedtimer.h"
+
+MetricsLog::MetricsLog () {
+  active = PETSC_TRUE;
+  filename = "metrics.jsonl";
+  fp = NULL;
+  bytesLast = 0;
+
+  PetscBool flg;
+  char filenameChar[PETSC_MAX_PATH_LEN];
+  PetscOptionsGetBool (NULL, NULL, "-metricsLog", &active, &flg);
+  PetscOptionsGetString (NULL, NULL, "-metricsFile", filenameChar,
+      sizeof(filenameChar), &flg);
+  if (flg) {
+    filename = filenameChar;
+  }
+
+  PetscPrintf (PETSC_COMM_WORLD,
+      "##############################################################\n");
+  PetscPrintf (PETSC_COMM_WORLD, "# Per-iteration metrics log (-metricsLog): %i\n",
+      active);
+  if (active) {
+    PetscPrintf (PETSC_COMM_WORLD, "# Metrics file (-metricsFile): %s\n",
+        filename.c_str ());
+    PetscFOpen (PETSC_COMM_WORLD, filename.c_str (), "w", &fp);
+  }
+
+  // Regions under the iteration timer, see main.cc and SolveState
+  const char *paths[][2] = {
+      { "Optimization/Iteration/Physics", "physics" },
+      { "Optimization/Iteration/Physics/SolveState/Assemble", "assemble" },
+      { "Optimization/Iteration/Physics/SolveState/PCSetUp", "pcsetup" },
+      { "Optimization/Iteration/Physics/SolveState/KSPSolve", "kspsolve" },
+      { "Optimization/Iteration/Physics/Sensitivity", "sensitivity" },
+      { "Optimization/Iteration/FilterGradients", "filterGradients" },
+      { "Optimization/Iteration/MMA", "mma" },
+      { "Optimization/Iteration/FilterProject", "filterProject" },
+      { "Optimization/Iteration/Output", "output" },
+      { "Optimization/Iteration/Restart", "restart" } };
+  for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); ++i) {
+    phasePaths.push_back (paths[i][0]);
+    phaseKeys.push_back (paths[i][1]);
+    phaseLast.push_back (0.0);
+  }
+}
+
+MetricsLog::~MetricsLog () {
+  if (fp != NULL) PetscFClose (PETSC_COMM_WORLD, fp);
+}
+
+PetscErrorCode MetricsLog::WriteIteration (PetscInt itr, PetscScalar fx,
+    PetscScalar *gx, PetscInt m, PetscScalar ch, PetscScalar mnd,
+    PetscReal beta, const std::vector<PetscInt> &kspIterations,
+    const std::vector<PetscReal> &kspResiduals, double itrTime,
+    unsigned long int bytesWritten) {
+  PetscErrorCode ierr = 0;
+  if (!active) return ierr;
+
+  // Phase times since the last record, the iteration time and the peak RSS
+  // are all reduced with a single max
+  PetscInt nPhase = phasePaths.size ();
+  std::vector<double> loc (nPhase + 2), glob (nPhase + 2);
+  for (PetscInt i = 0; i < nPhase; ++i) {
+    double total = TimerRegistry::Instance ().GetTotal (phasePaths[i]);
+    loc[i] = total - phaseLast[i];
+    phaseLast[i] = total;
+  }
+  loc[nPhase] = itrTime;
+  loc[nPhase + 1] = PeakRSSMegaBytes ();
+  ierr = MPI_Reduce (loc.data (), glob.data (), nPhase + 2, MPI_DOUBLE, MPI_MAX,
+      0, PETSC_COMM_WORLD);
+  CHKERRQ(ierr);
+
+  // Bytes written in this iteration, from the running total of the rank
+  unsigned long int bytesItr = bytesWritten - bytesLast, bytesTotal = 0;
+  bytesLast = bytesWritten;
+  ierr = MPI_Reduce (&bytesItr, &bytesTotal, 1, MPI_UNSIGNED_LONG, MPI_SUM, 0,
+      PETSC_COMM_WORLD);
+  CHKERRQ(ierr);
+
+  PetscFPrintf (PETSC_COMM_WORLD, fp,
+      "{\"itr\": %i, \"fx\": %.10e, \"gx\": [", itr, fx);
+  for (PetscInt i = 0; i < m; ++i) {
+    PetscFPrintf (PETSC_COMM_WORLD, fp, "%s%.10e", i ? ", " : "", gx[i]);
+  }
+  PetscFPrintf (PETSC_COMM_WORLD, fp,
+      "], \"ch\": %.6e, \"mnd\": %.6e, \"beta\": %g, \"kspIterations\": [", ch,
+      mnd, beta);
+  for (size_t i = 0; i < kspIterations.size (); ++i) {
+    PetscFPrintf (PETSC_COMM_WORLD, fp, "%s%i", i ? ", " : "",
+        kspIterations[i]);
+  }
+  PetscFPrintf (PETSC_COMM_WORLD, fp, "], \"kspResiduals\": [");
+  for (size_t i = 0; i < kspResiduals.size (); ++i) {
+    PetscFPrintf (PETSC_COMM_WORLD, fp, "%s%.6e", i ? ", " : "",
+        kspResiduals[i]);
+  }
+  PetscFPrintf (PETSC_COMM_WORLD, fp, "], \"time\": {\"iteration\": %.6e",
+      glob[nPhase]);
+  for (PetscInt i = 0; i < nPhase; ++i) {
+    PetscFPrintf (PETSC_COMM_WORLD, fp, ", \"%s\": %.6e", phaseKeys[i].c_str (),
+        glob[i]);
+  }
+  PetscFPrintf (PETSC_COMM_WORLD, fp,
+      "}, \"bytesWritten\": %lu, \"peakRSSMB\": %.1f}\n", bytesTotal,
+      glob[nPhase + 1]);
+
+  // Keep the log readable while the job runs
+  PetscMPIInt rank;
+  MPI_Comm_rank (PETSC_COMM_WORLD, &rank);
+  if (rank == 0 && fp != NULL) fflush (fp);
+
+  return ierr;
+}
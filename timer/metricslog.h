@@ -0,0 +1,91 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * metricslog.h
+ */
+
+#ifndef METRICSLOG_H_
+#define METRICSLOG_H_
+
+#include <string>
+#include <vector>
+#include <petsc.h>
+
+/*
+ * Machine-readable per-iteration metrics, one JSON object per line written
+ * by rank 0. Phase times are the maximum over the ranks of the time spent
+ * in the timed regions (see scopedtimer.h) since the previous record.
+ *
+ * Options:
+ * -metricsLog <bool>     write the log (default true)
+ * -metricsFile <string>  file name (default metrics.jsonl)
+ */
+class MetricsLog {
+  public:
+
+    /*
+     * Constructor, reads the options and opens the file on rank 0
+     */
+    MetricsLog ();
+
+    /*
+     * Destructor, closes the file
+     */
+    ~MetricsLog ();
+
+    /*
+     * Append the record of one optimization iteration
+     * \param[in] iteration number
+     * \param[in] true (unscaled) objective, constraints and number of them
+     * \param[in] design change, discreteness measure and projection beta
+     * \param[in] Krylov iterations and relative residuals per load case
+     * \param[in] wall time of the iteration
+     * \param[in] bytes written by this rank since the writer was created; the
+     * record holds the bytes of all the ranks since the previous record
+     * \return PetscErrorCode
+     */
+    PetscErrorCode WriteIteration (PetscInt itr, PetscScalar fx,
+        PetscScalar *gx, PetscInt m, PetscScalar ch, PetscScalar mnd,
+        PetscReal beta, const std::vector<PetscInt> &kspIterations,
+        const std::vector<PetscReal> &kspResiduals, double itrTime,
+        unsigned long int bytesWritten);
+
+    /*
+     * Start the byte count of a new writer, call it whenever the writer
+     * passed to WriteIteration is replaced since its count starts at zero
+     */
+    void ResetBytesWritten () {
+      bytesLast = 0;
+    }
+
+  private:
+    PetscBool active;
+    std::string filename;
+    FILE *fp;
+
+    /*
+     * Timed regions recorded per iteration: path and key in the record
+     */
+    std::vector<std::string> phasePaths;
+    std::vector<std::string> phaseKeys;
+    std::vector<double> phaseLast; // totals at the previous record
+    unsigned long int bytesLast; // bytes written at the previous record
+};
+
+#endif /* METRICSLOG_H_ */
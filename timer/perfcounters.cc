@@ -0,0 +1,99 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * perfcounters.cc
+ */
+
+#include "perfcounters.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+PerfCounters::PerfCounters () {
+  active = PETSC_FALSE;
+  for (PetscInt i = 0; i < nCounters; ++i) {
+    fd[i] = -1;
+  }
+
+  PetscBool flg;
+  PetscOptionsGetBool (NULL, NULL, "-perfCounters", &active, &flg);
+  if (!active) return;
+
+#ifdef __linux__
+  const unsigned long long configs[nCounters] = { PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES };
+  for (PetscInt i = 0; i < nCounters; ++i) {
+    struct perf_event_attr attr;
+    memset (&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = configs[i];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Count the threads created later on, i.e. the OpenMP team, and report
+    // the share of time the counter was on the PMU when multiplexed
+    attr.inherit = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+                       | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    fd[i] = syscall (__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+  active = fd[0] >= 0 ? PETSC_TRUE : PETSC_FALSE;
+#else
+  active = PETSC_FALSE;
+#endif
+
+  PetscPrintf (PETSC_COMM_WORLD, "# Hardware counters (-perfCounters):");
+  for (PetscInt i = 0; i < nCounters; ++i) {
+    PetscPrintf (PETSC_COMM_WORLD, " %s %s", Name (i),
+        fd[i] >= 0 ? "on" : "unavailable");
+  }
+  PetscPrintf (PETSC_COMM_WORLD, "\n");
+}
+
+PerfCounters::~PerfCounters () {
+#ifdef __linux__
+  for (PetscInt i = 0; i < nCounters; ++i) {
+    if (fd[i] >= 0) close (fd[i]);
+  }
+#endif
+}
+
+void PerfCounters::Read (double *values) {
+  for (PetscInt i = 0; i < nCounters; ++i) {
+    values[i] = 0.0;
+#ifdef __linux__
+    // value, time enabled and time running
+    unsigned long long count[3];
+    if (fd[i] >= 0 && read (fd[i], count, sizeof(count)) == sizeof(count)
+        && count[2] > 0) {
+      values[i] = (double) count[0] * ((double) count[1] / (double) count[2]);
+    }
+#endif
+  }
+}
+
+const char *PerfCounters::Name (PetscInt i) {
+  static const char *names[nCounters] = { "cycles", "instructions",
+      "LLC-misses" };
+  return names[i];
+}
@@ -0,0 +1,83 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * perfcounters.h
+ */
+
+#ifndef PERFCOUNTERS_H_
+#define PERFCOUNTERS_H_
+
+#include <petsc.h>
+
+/*
+ * Hardware counters of the calling process through Linux perf_event_open,
+ * counted in user space only: cycles, instructions and last level cache
+ * misses. The memory bandwidth is estimated from the LLC misses times the
+ * cache line size, since the memory controller counters are only available
+ * system-wide.
+ *
+ * The counters are read at the entry and exit of the timed regions (see
+ * scopedtimer.h). They are inherited by the threads created after they are
+ * opened with the first timed region, i.e. they include the OpenMP threads
+ * of the element loops. When the PMU multiplexes the counters, the counts
+ * are scaled by the ratio of the enabled to the running time. A counter
+ * which cannot be opened, e.g. in a virtual machine or with a restrictive
+ * /proc/sys/kernel/perf_event_paranoid, reads zero.
+ *
+ * Options:
+ * -perfCounters <bool>  count per timed region (default false)
+ */
+class PerfCounters {
+  public:
+    static const PetscInt nCounters = 3;
+
+    /*
+     * Constructor, reads the option and opens the counters
+     */
+    PerfCounters ();
+
+    /*
+     * Destructor, closes the counters
+     */
+    ~PerfCounters ();
+
+    /*
+     * At least the cycle counter is open
+     */
+    PetscBool Active () const {
+      return active;
+    }
+
+    /*
+     * Current counts since the counters have been opened
+     * \param[out] values, nCounters entries
+     */
+    void Read (double *values);
+
+    /*
+     * Name of a counter
+     */
+    static const char *Name (PetscInt i);
+
+  private:
+    PetscBool active;
+    int fd[nCounters];
+};
+
+#endif /* PERFCOUNTERS_H_ */
@@ -0,0 +1,385 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * scopedtimer.cc
+ */
+
+#include "scopedtimer.h"
+#include "memoryreport.h"
+
+TimerRegistry::TimerRegistry () {
+  classid = 0;
+  PetscClassIdRegister ("TopOpt", &classid);
+}
+
+TimerRegistry &TimerRegistry::Instance () {
+  static TimerRegistry registry;
+  return registry;
+}
+
+PetscInt TimerRegistry::Enter (const char *name) {
+  PetscInt parent = stack.empty () ? -1 : stack.back ();
+
+  // Look for the region among the children of the open region
+  PetscInt id = -1;
+  if (parent >= 0) {
+    for (size_t i = 0; i < nodes[parent].children.size (); ++i) {
+      if (nodes[nodes[parent].children[i]].name == name) {
+        id = nodes[parent].children[i];
+        break;
+      }
+    }
+  } else {
+    for (size_t i = 0; i < nodes.size (); ++i) {
+      if (nodes[i].parent == -1 && nodes[i].name == name) {
+        id = i;
+        break;
+      }
+    }
+  }
+
+  // Create the region on first entry
+  if (id < 0) {
+    TimerNode node;
+    node.name = name;
+    node.parent = parent;
+    node.depth = parent >= 0 ? nodes[parent].depth + 1 : 0;
+    node.calls = 0;
+    node.total = 0.0;
+    node.rssPeak = 0.0;
+    node.rssGrowth = 0.0;
+    for (PetscInt i = 0; i < PerfCounters::nCounters; ++i) {
+      node.counters[i] = 0.0;
+    }
+    node.stage = -1;
+    if (events.find (node.name) == events.end ()) {
+      PetscLogEvent event;
+      PetscLogEventRegister (name, classid, &event);
+      events[node.name] = event;
+    }
+    node.event = events[node.name];
+    if (parent < 0) {
+      if (stages.find (node.name) == stages.end ()) {
+        PetscLogStage stage;
+        PetscLogStageRegister (name, &stage);
+        stages[node.name] = stage;
+      }
+      node.stage = stages[node.name];
+    }
+    id = nodes.size ();
+    nodes.push_back (node);
+    if (parent >= 0) nodes[parent].children.push_back (id);
+  }
+
+  stack.push_back (id);
+  rssStack.push_back (PeakRSSMegaBytes ());
+  if (nodes[id].stage >= 0) PetscLogStagePush (nodes[id].stage);
+  PetscLogEventBegin (nodes[id].event, 0, 0, 0, 0);
+
+  // Read the counters last, so the region's own overhead is not counted
+  if (perf.Active ()) {
+    double counts[PerfCounters::nCounters];
+    perf.Read (counts);
+    counterStack.insert (counterStack.end (), counts,
+        counts + PerfCounters::nCounters);
+  }
+  return id;
+}
+
+void TimerRegistry::Exit (PetscInt id, double elapsed) {
+  double counts[PerfCounters::nCounters];
+  if (perf.Active ()) perf.Read (counts);
+
+  if (stack.empty () || stack.back () != id) {
+    PetscPrintf (PETSC_COMM_SELF,
+        "# Warning: timer region %s is not the innermost open region\n",
+        nodes[id].name.c_str ());
+    return;
+  }
+  PetscLogEventEnd (nodes[id].event, 0, 0, 0, 0);
+  if (nodes[id].stage >= 0) PetscLogStagePop ();
+  stack.pop_back ();
+
+  nodes[id].calls++;
+  nodes[id].total += elapsed;
+
+  double rss = PeakRSSMegaBytes ();
+  nodes[id].rssPeak = PetscMax(nodes[id].rssPeak, rss);
+  nodes[id].rssGrowth += rss - rssStack.back ();
+  rssStack.pop_back ();
+
+  if (perf.Active ()) {
+    double *entry = &counterStack[counterStack.size ()
+        - PerfCounters::nCounters];
+    for (PetscInt i = 0; i < PerfCounters::nCounters; ++i) {
+      nodes[id].counters[i] += counts[i] - entry[i];
+    }
+    counterStack.resize (counterStack.size () - PerfCounters::nCounters);
+  }
+}
+
+double TimerRegistry::GetTotal (const std::string &path) {
+  PetscInt parent = -1;
+  PetscInt id = -1;
+  size_t begin = 0;
+  while (begin <= path.size ()) {
+    size_t end = path.find ('/', begin);
+    if (end == std::string::npos) end = path.size ();
+    std::string name = path.substr (begin, end - begin);
+    id = -1;
+    for (size_t i = 0; i < nodes.size (); ++i) {
+      if (nodes[i].parent == parent && nodes[i].name == name) {
+        id = i;
+        break;
+      }
+    }
+    if (id < 0) return 0.0;
+    parent = id;
+    begin = end + 1;
+  }
+  return id >= 0 ? nodes[id].total : 0.0;
+}
+
+double TimerRegistry::GetTotalByName (const std::string &name) {
+  double total = 0.0;
+  for (size_t i = 0; i < nodes.size (); ++i) {
+    if (nodes[i].name == name) total += nodes[i].total;
+  }
+  return total;
+}
+
+PetscErrorCode TimerRegistry::Report (MPI_Comm comm) {
+  PetscErrorCode ierr = 0;
+
+  PetscMPIInt rank, size;
+  MPI_Comm_rank (comm, &rank);
+  MPI_Comm_size (comm, &size);
+
+  // All ranks have to hold the same regions for the reduction
+  PetscInt nloc = nodes.size (), nmin, nmax;
+  ierr = MPI_Allreduce (&nloc, &nmin, 1, MPIU_INT, MPI_MIN, comm);
+  CHKERRQ(ierr);
+  ierr = MPI_Allreduce (&nloc, &nmax, 1, MPIU_INT, MPI_MAX, comm);
+  CHKERRQ(ierr);
+  if (nmin != nmax) {
+    PetscPrintf (comm,
+        "# Warning: timer regions differ between ranks, no timing summary\n");
+    return ierr;
+  }
+  if (nloc == 0) return ierr;
+
+  std::vector<double> tloc (nloc), tmin (nloc), tmax (nloc), tsum (nloc);
+  for (PetscInt i = 0; i < nloc; ++i) {
+    tloc[i] = nodes[i].total;
+  }
+  ierr = MPI_Reduce (tloc.data (), tmin.data (), nloc, MPI_DOUBLE, MPI_MIN, 0,
+      comm);
+  CHKERRQ(ierr);
+  ierr = MPI_Reduce (tloc.data (), tmax.data (), nloc, MPI_DOUBLE, MPI_MAX, 0,
+      comm);
+  CHKERRQ(ierr);
+  ierr = MPI_Reduce (tloc.data (), tsum.data (), nloc, MPI_DOUBLE, MPI_SUM, 0,
+      comm);
+  CHKERRQ(ierr);
+
+  if (rank == 0) {
+    // Reference for the percentages: mean time of all root regions
+    double ttotal = 0.0;
+    for (PetscInt i = 0; i < nloc; ++i) {
+      if (nodes[i].parent == -1) ttotal += tsum[i] / size;
+    }
+
+    PetscPrintf (PETSC_COMM_SELF,
+        "######################## Timing summary ########################\n");
+    PetscPrintf (PETSC_COMM_SELF, "# %-32s %7s %10s %10s %10s %8s %6s\n",
+        "Region", "calls", "min (s)", "max (s)", "mean (s)", "max/mean",
+        "%");
+    for (PetscInt i = 0; i < nloc; ++i) {
+      if (nodes[i].parent == -1)
+        ReportNode (i, tmin.data (), tmax.data (), tsum.data (), size,
+            ttotal);
+    }
+    PetscPrintf (PETSC_COMM_SELF,
+        "################################################################\n");
+  }
+
+  return ierr;
+}
+
+PetscErrorCode TimerRegistry::ReportRSS (MPI_Comm comm) {
+  PetscErrorCode ierr = 0;
+
+  PetscMPIInt rank;
+  MPI_Comm_rank (comm, &rank);
+
+  PetscInt nloc = nodes.size (), nmin, nmax;
+  ierr = MPI_Allreduce (&nloc, &nmin, 1, MPIU_INT, MPI_MIN, comm);
+  CHKERRQ(ierr);
+  ierr = MPI_Allreduce (&nloc, &nmax, 1, MPIU_INT, MPI_MAX, comm);
+  CHKERRQ(ierr);
+  if (nmin != nmax || nloc == 0) return ierr;
+
+  std::vector<double> loc (2 * nloc), glob (2 * nloc);
+  for (PetscInt i = 0; i < nloc; ++i) {
+    loc[i] = nodes[i].rssPeak;
+    loc[nloc + i] = nodes[i].rssGrowth;
+  }
+  ierr = MPI_Reduce (loc.data (), glob.data (), 2 * nloc, MPI_DOUBLE, MPI_MAX,
+      0, comm);
+  CHKERRQ(ierr);
+
+  if (rank == 0) {
+    PetscPrintf (PETSC_COMM_SELF,
+        "####################### Peak RSS by region ######################\n");
+    PetscPrintf (PETSC_COMM_SELF, "# %-32s %12s %12s\n", "Region",
+        "peak (MB)", "growth (MB)");
+    for (PetscInt i = 0; i < nloc; ++i) {
+      if (nodes[i].parent == -1)
+        ReportRSSNode (i, glob.data (), glob.data () + nloc);
+    }
+    PetscPrintf (PETSC_COMM_SELF,
+        "################################################################\n");
+  }
+
+  return ierr;
+}
+
+void TimerRegistry::ReportRSSNode (PetscInt id, double *peak,
+    double *growth) {
+  std::string label = std::string (2 * nodes[id].depth, ' ')
+                      + nodes[id].name;
+  PetscPrintf (PETSC_COMM_SELF, "# %-32s %12.1f %12.1f\n", label.c_str (),
+      peak[id], growth[id]);
+  for (size_t i = 0; i < nodes[id].children.size (); ++i) {
+    ReportRSSNode (nodes[id].children[i], peak, growth);
+  }
+}
+
+PetscErrorCode TimerRegistry::ReportCounters (MPI_Comm comm) {
+  PetscErrorCode ierr = 0;
+
+  PetscMPIInt rank;
+  MPI_Comm_rank (comm, &rank);
+
+  // Only when the counters run on all ranks
+  PetscInt activeLoc = perf.Active () ? 1 : 0, activeMin, activeMax;
+  ierr = MPI_Allreduce (&activeLoc, &activeMin, 1, MPIU_INT, MPI_MIN, comm);
+  CHKERRQ(ierr);
+  ierr = MPI_Allreduce (&activeLoc, &activeMax, 1, MPIU_INT, MPI_MAX, comm);
+  CHKERRQ(ierr);
+  if (activeMax == 0) return ierr;
+  if (activeMin == 0) {
+    PetscPrintf (comm,
+        "# Warning: hardware counters are not available on all ranks\n");
+    return ierr;
+  }
+
+  PetscInt nloc = nodes.size (), nmin, nmax;
+  ierr = MPI_Allreduce (&nloc, &nmin, 1, MPIU_INT, MPI_MIN, comm);
+  CHKERRQ(ierr);
+  ierr = MPI_Allreduce (&nloc, &nmax, 1, MPIU_INT, MPI_MAX, comm);
+  CHKERRQ(ierr);
+  if (nmin != nmax || nloc == 0) return ierr;
+
+  const PetscInt nc = PerfCounters::nCounters;
+  std::vector<double> cloc (nc * nloc), csum (nc * nloc), tloc (nloc),
+      tmax (nloc);
+  for (PetscInt i = 0; i < nloc; ++i) {
+    for (PetscInt j = 0; j < nc; ++j) {
+      cloc[i * nc + j] = nodes[i].counters[j];
+    }
+    tloc[i] = nodes[i].total;
+  }
+  ierr = MPI_Reduce (cloc.data (), csum.data (), nc * nloc, MPI_DOUBLE,
+      MPI_SUM, 0, comm);
+  CHKERRQ(ierr);
+  ierr = MPI_Reduce (tloc.data (), tmax.data (), nloc, MPI_DOUBLE, MPI_MAX, 0,
+      comm);
+  CHKERRQ(ierr);
+
+  if (rank == 0) {
+    PetscPrintf (PETSC_COMM_SELF,
+        "####################### Hardware counters #######################\n");
+    PetscPrintf (PETSC_COMM_SELF, "# %-32s %12s %12s %6s %12s %10s\n",
+        "Region", "Gcycles", "Ginstr.", "IPC", "MLLC-misses", "est. GB/s");
+    for (PetscInt i = 0; i < nloc; ++i) {
+      if (nodes[i].parent == -1)
+        ReportCountersNode (i, csum.data (), tmax.data ());
+    }
+    PetscPrintf (PETSC_COMM_SELF,
+        "# Counts are summed over the ranks, GB/s = 64 B x LLC misses / max "
+            "time\n");
+    PetscPrintf (PETSC_COMM_SELF,
+        "################################################################\n");
+  }
+
+  return ierr;
+}
+
+void TimerRegistry::ReportCountersNode (PetscInt id, double *counts,
+    double *tmax) {
+  const PetscInt nc = PerfCounters::nCounters;
+  double cycles = counts[id * nc], instr = counts[id * nc + 1],
+      misses = counts[id * nc + 2];
+  std::string label = std::string (2 * nodes[id].depth, ' ')
+                      + nodes[id].name;
+  PetscPrintf (PETSC_COMM_SELF, "# %-32s %12.3f %12.3f %6.2f %12.3f %10.2f\n",
+      label.c_str (), cycles / 1.0e9, instr / 1.0e9,
+      cycles > 0.0 ? instr / cycles : 0.0, misses / 1.0e6,
+      tmax[id] > 0.0 ? 64.0 * misses / tmax[id] / 1.0e9 : 0.0);
+  for (size_t i = 0; i < nodes[id].children.size (); ++i) {
+    ReportCountersNode (nodes[id].children[i], counts, tmax);
+  }
+}
+
+void TimerRegistry::ReportNode (PetscInt id, double *tmin, double *tmax,
+    double *tsum, PetscInt size, double ttotal) {
+  double mean = tsum[id] / size;
+  std::string label = std::string (2 * nodes[id].depth, ' ')
+                      + nodes[id].name;
+  PetscPrintf (PETSC_COMM_SELF,
+      "# %-32s %7i %10.3e %10.3e %10.3e %8.3f %6.2f\n", label.c_str (),
+      nodes[id].calls, tmin[id], tmax[id], mean,
+      mean > 0.0 ? tmax[id] / mean : 1.0,
+      ttotal > 0.0 ? 100.0 * mean / ttotal : 0.0);
+  for (size_t i = 0; i < nodes[id].children.size (); ++i) {
+    ReportNode (nodes[id].children[i], tmin, tmax, tsum, size, ttotal);
+  }
+}
+
+ScopedTimer::ScopedTimer (const char *name) {
+  id = TimerRegistry::Instance ().Enter (name);
+  t0 = MPI_Wtime ();
+  active = PETSC_TRUE;
+}
+
+ScopedTimer::~ScopedTimer () {
+  Stop ();
+}
+
+void ScopedTimer::Stop () {
+  if (active) {
+    TimerRegistry::Instance ().Exit (id, MPI_Wtime () - t0);
+    active = PETSC_FALSE;
+  }
+}
+
+double ScopedTimer::Elapsed () const {
+  return MPI_Wtime () - t0;
+}
@@ -0,0 +1,168 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * scopedtimer.h
+ */
+
+#ifndef SCOPEDTIMER_H_
+#define SCOPEDTIMER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <petsc.h>
+#include "perfcounters.h"
+
+/*
+ * One node of the timing tree. A region is identified by its name and its
+ * parent, so the same name (e.g. "KSPSolve") under different parents is
+ * accounted separately.
+ */
+typedef struct TimerNode {
+    std::string name;
+    PetscInt parent; // -1 for a root region
+    PetscInt depth;
+    PetscInt calls;
+    double total; // accumulated wall time in seconds
+    double rssPeak; // peak RSS in MB at the exit of the region
+    double rssGrowth; // growth of the peak RSS inside the region in MB
+    double counters[PerfCounters::nCounters]; // hardware counts, -perfCounters
+    PetscLogEvent event;
+    PetscLogStage stage; // only valid for root regions
+    std::vector<PetscInt> children;
+} TimerNode;
+
+/*
+ * Registry of all the timed regions of the run. Regions are created lazily
+ * the first time they are entered. All ranks are expected to enter the
+ * regions in the same order, which holds for the collective code paths of
+ * the framework.
+ */
+class TimerRegistry {
+  public:
+
+    /*
+     * The process-wide registry
+     */
+    static TimerRegistry &Instance ();
+
+    /*
+     * Enter the region with the given name under the currently open region
+     * \param[in] name of the region
+     * \return id of the region
+     */
+    PetscInt Enter (const char *name);
+
+    /*
+     * Leave the region, it has to be the innermost open region
+     * \param[in] id of the region
+     * \param[in] elapsed wall time in seconds
+     */
+    void Exit (PetscInt id, double elapsed);
+
+    /*
+     * Accumulated time of a region given by its path, e.g.
+     * "Optimization/Iteration/Physics"; returns 0 for an unknown region
+     */
+    double GetTotal (const std::string &path);
+
+    /*
+     * Accumulated time of all the regions with the given name, whatever
+     * their parent
+     */
+    double GetTotalByName (const std::string &name);
+
+    /*
+     * Print the per-rank min/max/mean and max/mean ratio of each region
+     * \param[in] communicator
+     * \return PetscErrorCode
+     */
+    PetscErrorCode Report (MPI_Comm comm);
+
+    /*
+     * Print the max over the ranks of the peak RSS high-water mark at the end
+     * of each region and of its growth inside the region, i.e. which phase
+     * set the peak
+     * \param[in] communicator
+     * \return PetscErrorCode
+     */
+    PetscErrorCode ReportRSS (MPI_Comm comm);
+
+    /*
+     * Print the hardware counters of each region summed over the ranks, the
+     * instructions per cycle and the memory bandwidth estimated from the LLC
+     * misses; nothing without -perfCounters
+     * \param[in] communicator
+     * \return PetscErrorCode
+     */
+    PetscErrorCode ReportCounters (MPI_Comm comm);
+
+  private:
+    TimerRegistry ();
+
+    std::vector<TimerNode> nodes;
+    std::vector<PetscInt> stack; // currently open regions
+    std::vector<double> rssStack; // peak RSS at the entry of the open regions
+    std::vector<double> counterStack; // counts at the entry of the open regions
+    PerfCounters perf;
+    std::map<std::string, PetscLogEvent> events; // PETSc events are flat
+    std::map<std::string, PetscLogStage> stages;
+    PetscClassId classid;
+
+    void ReportNode (PetscInt id, double *tmin, double *tmax, double *tsum,
+        PetscInt size, double ttotal);
+    void ReportRSSNode (PetscInt id, double *peak, double *growth);
+    void ReportCountersNode (PetscInt id, double *counts, double *tmax);
+};
+
+/*
+ * RAII timed region: entered at construction and left at destruction, or
+ * earlier through Stop(). Nesting follows the C++ scopes.
+ *
+ * Usage e.g.
+ * {
+ *   ScopedTimer timer ("Assemble");
+ *   AssembleStiffnessMatrix (...);
+ * }
+ */
+class ScopedTimer {
+  public:
+    ScopedTimer (const char *name);
+    ~ScopedTimer ();
+
+    /*
+     * Leave the region before the end of the scope
+     */
+    void Stop ();
+
+    /*
+     * Wall time since the region has been entered
+     */
+    double Elapsed () const;
+
+  private:
+    PetscInt id;
+    double t0;
+    PetscBool active;
+
+    ScopedTimer (const ScopedTimer&);
+    ScopedTimer& operator= (const ScopedTimer&);
+};
+
+#endif /* SCOPEDTIMER_H_ */
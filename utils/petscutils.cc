@@ -0,0 +1,79 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * petscutils.cc
+ */
+
+#include "petscutils.h"
+
+#include <vector>
+
+PetscErrorCode GetArrays (const Vec *v, PetscInt n, PetscScalar **a) {
+  PetscErrorCode ierr = 0;
+  for (PetscInt i = 0; i < n; ++i) {
+    ierr = VecGetArray (v[i], &a[i]);
+    CHKERRQ(ierr);
+  }
+  return ierr;
+}
+
+PetscErrorCode RestoreArrays (const Vec *v, PetscInt n, PetscScalar **a) {
+  PetscErrorCode ierr = 0;
+  for (PetscInt i = 0; i < n; ++i) {
+    ierr = VecRestoreArray (v[i], &a[i]);
+    CHKERRQ(ierr);
+  }
+  return ierr;
+}
+
+PetscErrorCode CreateElementDA (DM daNodes, DM *daElem) {
+  PetscErrorCode ierr = 0;
+
+  MPI_Comm comm;
+  PetscObjectGetComm ((PetscObject) daNodes, &comm);
+  PetscInt dim, M, N, P, md, nd, pd;
+  DMBoundaryType bx, by, bz;
+  DMDAStencilType stype;
+  ierr = DMDAGetInfo (daNodes, &dim, &M, &N, &P, &md, &nd, &pd, NULL, NULL,
+      &bx, &by, &bz, &stype);
+  CHKERRQ(ierr);
+  const PetscInt *lxn, *lyn, *lzn;
+  ierr = DMDAGetOwnershipRanges (daNodes, &lxn, &lyn, &lzn);
+  CHKERRQ(ierr);
+
+  // subtract one from the lower left corner.
+  std::vector<PetscInt> lxe (lxn, lxn + md), lye (lyn, lyn + nd);
+  lxe[0] -= 1;
+  lye[0] -= 1;
+  if (dim == 2) {
+    ierr = DMDACreate2d (comm, bx, by, stype, M - 1, N - 1, md, nd, 1, 0,
+        lxe.data (), lye.data (), daElem);
+    CHKERRQ(ierr);
+  } else {
+    std::vector<PetscInt> lze (lzn, lzn + pd);
+    lze[0] -= 1;
+    ierr = DMDACreate3d (comm, bx, by, bz, stype, M - 1, N - 1, P - 1, md, nd,
+        pd, 1, 0, lxe.data (), lye.data (), lze.data (), daElem);
+    CHKERRQ(ierr);
+  }
+  ierr = DMSetUp (*daElem);
+  CHKERRQ(ierr);
+
+  return ierr;
+}
@@ -0,0 +1,50 @@
+//-------------------------------------------------------------------
+//
+// Copyright (C) 2018 - 2020 by the TopADD authors
+//
+// This file is part of the TopADD.
+//
+// The TopADD is free software; you can use it, redistribute
+// it, and/or modify it under the terms of the GNU Lesser General
+// Public License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+// The full text of the license can be found in the file LICENSE.md at
+// the top level directory of TopADD.
+//
+// Author: agent
+// Created on: Oct. 2026
+//
+// ---------------------------------------------------------------------
+
+/*
+ * petscutils.h
+ */
+
+#ifndef PETSCUTILS_H_
+#define PETSCUTILS_H_
+
+#include <petsc.h>
+
+/*
+ * VecGetArrays/VecRestoreArrays into n pointers provided by the caller, e.g.
+ * a member of the class; the PETSc functions allocate and free the array of
+ * pointers on every call
+ * \param[in] vectors
+ * \param[in] number of vectors
+ * \param[in,out] array of n pointers
+ * \return PetscErrorCode
+ */
+PetscErrorCode GetArrays (const Vec *v, PetscInt n, PetscScalar **a);
+PetscErrorCode RestoreArrays (const Vec *v, PetscInt n, PetscScalar **a);
+
+/*
+ * Element mesh of a nodal DMDA: the same process grid and boundary types,
+ * one element less in each direction, with the node ownership ranges minus
+ * one on the first rank, as da_elem of TopOpt
+ * \param[in] nodal mesh, 2d or 3d
+ * \param[out] element mesh, set up
+ * \return PetscErrorCode
+ */
+PetscErrorCode CreateElementDA (DM daNodes, DM *daElem);
+
+#endif /* PETSCUTILS_H_ */